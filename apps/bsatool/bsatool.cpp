@@ -1,5 +1,6 @@
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <vector>
 
 #include <boost/program_options.hpp>
@@ -7,6 +8,7 @@
 #include <boost/filesystem/fstream.hpp>
 
 #include <components/bsa/bsa_file.hpp>
+#include <components/bsa/compressedbsafile.hpp>
 
 #define BSATOOL_VERSION 1.1
 
@@ -157,15 +159,19 @@ int main(int argc, char** argv)
             return 1;
 
         // Open file
-        Bsa::BSAFile bsa;
-        bsa.open(info.filename);
+        std::unique_ptr<Bsa::BSAFile> bsa;
+        if (Bsa::BSAFile::detectVersion(info.filename) == Bsa::BSAVER_COMPRESSED)
+            bsa.reset(new Bsa::CompressedBSAFile);
+        else
+            bsa.reset(new Bsa::BSAFile);
+        bsa->open(info.filename);
 
         if (info.mode == "list")
-            return list(bsa, info);
+            return list(*bsa, info);
         else if (info.mode == "extract")
-            return extract(bsa, info);
+            return extract(*bsa, info);
         else if (info.mode == "extractall")
-            return extractAll(bsa, info);
+            return extractAll(*bsa, info);
         else
         {
             std::cout << "Unsupported mode. That is not supposed to happen." << std::endl;
@@ -3,12 +3,17 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include <memory>
 
 #include <components/nif/niffile.hpp>
 #include <components/files/constrainedfilestream.hpp>
 #include <components/vfs/manager.hpp>
 #include <components/vfs/bsaarchive.hpp>
 #include <components/vfs/filesystemarchive.hpp>
+#include <components/resource/resourcesystem.hpp>
+#include <components/resource/scenemanager.hpp>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -17,6 +22,14 @@
 namespace bpo = boost::program_options;
 namespace bfs = boost::filesystem;
 
+///How often each nif file is parsed, more than once to benchmark the parser
+int sParseRuns = 1;
+///Number of nif files and time spent parsing them, for the benchmark
+int sNumParsed = 0;
+double sParseSeconds = 0;
+///Where to store the converted nif files, empty to only check them
+std::string sSceneCacheDirectory;
+
 ///See if the file has the named extension
 bool hasExtension(std::string filename, std::string  extensionToFind)
 {
@@ -43,6 +56,32 @@ bool isBSA(std::string filename)
     return hasExtension(filename,"bsa");
 }
 
+///Parse a nif file from the VFS, or from the file system if no VFS is given.
+///Opening the file is not included in the parse time.
+void readNIF(const VFS::Manager* vfs, const std::string& name, const std::string& fullName)
+{
+    for (int i=0; i<sParseRuns; ++i)
+    {
+        Files::IStreamPtr stream = vfs ? vfs->get(name) : Files::openConstrainedFileStream(name.c_str());
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Nif::NIFFile temp_nif(stream, fullName);
+        sParseSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    ++sNumParsed;
+}
+
+///Convert a nif file from the VFS and store it in the scene cache.
+void bakeNIF(Resource::ResourceSystem* resourceSystem, const std::string& name)
+{
+    resourceSystem->getSceneManager()->getTemplate(name);
+
+    // Only keep one scene in memory at a time
+    static double time = 0;
+    time += 1;
+    resourceSystem->updateCache(time);
+}
+
 /// Check all the nif files in a given VFS::Archive
 /// \note Takes ownership!
 /// \note Can not read a bsa file inside of a bsa file.
@@ -52,6 +91,14 @@ void readVFS(VFS::Archive* anArchive,std::string archivePath = "")
     myManager.addArchive(anArchive);
     myManager.buildIndex();
 
+    std::unique_ptr<Resource::ResourceSystem> resourceSystem;
+    if (!sSceneCacheDirectory.empty())
+    {
+        resourceSystem.reset(new Resource::ResourceSystem(&myManager));
+        resourceSystem->setExpiryDelay(0);
+        resourceSystem->getSceneManager()->setSceneCacheDirectory(sSceneCacheDirectory);
+    }
+
     std::map<std::string, VFS::File*> files=myManager.getIndex();
     for(std::map<std::string, VFS::File*>::const_iterator it=files.begin(); it!=files.end(); ++it)
     {
@@ -61,7 +108,10 @@ void readVFS(VFS::Archive* anArchive,std::string archivePath = "")
             if(isNIF(name))
             {
             //           std::cout << "Decoding: " << name << std::endl;
-                Nif::NIFFile temp_nif(myManager.get(name),archivePath+name);
+                if (resourceSystem)
+                    bakeNIF(resourceSystem.get(), name);
+                else
+                    readNIF(&myManager, name, archivePath+name);
             }
             else if(isBSA(name))
             {
@@ -85,11 +135,18 @@ std::vector<std::string> parseOptions (int argc, char** argv)
     bpo::options_description desc("Ensure that OpenMW can use the provided NIF and BSA files\n\n"
         "Usages:\n"
         "  niftool <nif files, BSA files, or directories>\n"
-        "      Scan the file or directories for nif errors.\n\n"
+        "      Scan the file or directories for nif errors.\n"
+        "  niftool --benchmark <runs> <nif files, BSA files, or directories>\n"
+        "      Measure how long it takes to parse the nif files.\n"
+        "  niftool --scene-cache <cache directory> <BSA files or data directories>\n"
+        "      Convert the nif files and store those that can be cached, to fill the scene cache of OpenMW ahead of time.\n\n"
         "Allowed options");
     desc.add_options()
         ("help,h", "print help message.")
         ("input-file", bpo::value< std::vector<std::string> >(), "input file")
+        ("benchmark", bpo::value<int>(), "parse each nif file the given number of times and print the time spent parsing.")
+        ("scene-cache", bpo::value<std::string>(), "convert the nif files and store them in the given scene cache directory, "
+            "usually the scenes directory in the OpenMW cache directory.")
         ;
 
     //Default option if none provided
@@ -116,6 +173,14 @@ std::vector<std::string> parseOptions (int argc, char** argv)
         std::cout << desc << std::endl;
         exit(1);
     }
+    if (variables.count("benchmark"))
+    {
+        sParseRuns = std::max(1, variables["benchmark"].as<int>());
+    }
+    if (variables.count("scene-cache"))
+    {
+        sSceneCacheDirectory = variables["scene-cache"].as<std::string>();
+    }
     if (variables.count("input-file"))
     {
         return variables["input-file"].as< std::vector<std::string> >();
@@ -139,7 +204,7 @@ int main(int argc, char **argv)
             if(isNIF(name))
             {
                 //std::cout << "Decoding: " << name << std::endl;
-                Nif::NIFFile temp_nif(Files::openConstrainedFileStream(name.c_str()),name);
+                readNIF(NULL, name, name);
              }
              else if(isBSA(name))
              {
@@ -161,5 +226,11 @@ int main(int argc, char **argv)
             std::cerr << "ERROR, an exception has occurred:  " << e.what() << std::endl;
         }
      }
+
+     if (sParseRuns > 1)
+     {
+         std::cout << "Parsed " << sNumParsed << " nif files " << sParseRuns << " times in " << sParseSeconds * 1000 << " ms, "
+                   << (sNumParsed ? sParseSeconds * 1000 / (sNumParsed * sParseRuns) : 0) << " ms per file" << std::endl;
+     }
      return 0;
 }
@@ -35,6 +35,7 @@
 #include "mwgui/windowmanagerimp.hpp"
 
 #include "mwscript/scriptmanagerimp.hpp"
+#include "mwscript/scriptcache.hpp"
 #include "mwscript/extensions.hpp"
 #include "mwscript/interpretercontext.hpp"
 
@@ -43,6 +44,7 @@
 #include "mwworld/class.hpp"
 #include "mwworld/player.hpp"
 #include "mwworld/worldimp.hpp"
+#include "mwworld/contentfilekey.hpp"
 
 #include "mwrender/vismask.hpp"
 
@@ -63,20 +65,82 @@ namespace
         if (ret != 0)
             std::cerr << "SDL error: " << SDL_GetError() << std::endl;
     }
+
+    /// Runs the local scripts that were not already run with the ones depending on the frame time
+    struct RunDeferredScript
+    {
+        RunDeferredScript(MWBase::ScriptManager* scriptManager)
+            : mScriptManager(scriptManager)
+        {
+        }
+        MWBase::ScriptManager* mScriptManager;
+
+        void operator()(std::pair<std::string, MWWorld::Ptr>& script)
+        {
+            if (mScriptManager->dependsOnFrameTime(script.first))
+                return;
+
+            MWScript::InterpreterContext interpreterContext (
+                &script.second.getRefData().getLocals(), script.second);
+            mScriptManager->run (script.first, interpreterContext);
+        }
+    };
+
+    struct IsOverBudget
+    {
+        IsOverBudget(osg::Timer_t start, float budget)
+            : mStart(start)
+            , mBudget(budget)
+        {
+        }
+        osg::Timer_t mStart;
+        float mBudget;
+
+        bool operator()() const
+        {
+            return osg::Timer::instance()->delta_m(mStart, osg::Timer::instance()->tick()) >= mBudget;
+        }
+    };
 }
 
 void OMW::Engine::executeLocalScripts()
 {
     MWWorld::LocalScripts& localScripts = mEnvironment.getWorld()->getLocalScripts();
+    MWBase::ScriptManager* scriptManager = mEnvironment.getScriptManager();
+
+    if (mLocalScriptBudget <= 0.f)
+    {
+        localScripts.startIteration();
+        std::pair<std::string, MWWorld::Ptr> script;
+        while (localScripts.getNext(script))
+        {
+            MWScript::InterpreterContext interpreterContext (
+                &script.second.getRefData().getLocals(), script.second);
+            scriptManager->run (script.first, interpreterContext);
+        }
+        return;
+    }
 
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    // Scripts that depend on the frame time run every frame
     localScripts.startIteration();
     std::pair<std::string, MWWorld::Ptr> script;
     while (localScripts.getNext(script))
     {
+        if (!scriptManager->dependsOnFrameTime(script.first))
+            continue;
+
         MWScript::InterpreterContext interpreterContext (
             &script.second.getRefData().getLocals(), script.second);
-        mEnvironment.getScriptManager()->run (script.first, interpreterContext);
+        scriptManager->run (script.first, interpreterContext);
     }
+
+    // The other scripts run in turns until the budget is used up, but every script at least every sMaxDelay frames
+    const size_t sMaxDelay = 4;
+    RunDeferredScript run (scriptManager);
+    IsOverBudget isOverBudget (start, mLocalScriptBudget);
+    localScripts.runDeferred(run, isOverBudget, sMaxDelay);
 }
 
 void OMW::Engine::frame(float frametime)
@@ -188,6 +252,12 @@ void OMW::Engine::frame(float frametime)
 
             stats->setAttribute(frameNumber, "WorkQueue", mWorkQueue->getNumItems());
             stats->setAttribute(frameNumber, "WorkThread", mWorkQueue->getNumActiveThreads());
+
+            SceneUtil::WorkQueue::Stats workStats = mWorkQueue->resetStats();
+            stats->setAttribute(frameNumber, "WorkDone", workStats.mCompleted);
+            stats->setAttribute(frameNumber, "WorkCancelled", workStats.mCancelled);
+            // longest time in milliseconds that an item started this frame was waiting in the queue
+            stats->setAttribute(frameNumber, "WorkLatency", workStats.mMaxLatency * 1000.0);
         }
 
     }
@@ -214,6 +284,7 @@ OMW::Engine::Engine(Files::ConfigurationManager& configurationManager)
   , mFSStrict (false)
   , mScriptBlacklistUse (true)
   , mNewGame (false)
+  , mLocalScriptBudget (0.f)
   , mCfgMgr(configurationManager)
 {
     Misc::Rng::init();
@@ -460,6 +531,8 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
         Settings::Manager::getString("texture mipmap", "General"),
         Settings::Manager::getInt("anisotropy", "General")
     );
+    if (Settings::Manager::getBool("scene cache", "General"))
+        mResourceSystem->getSceneManager()->setSceneCacheDirectory((mCfgMgr.getCachePath() / "scenes").string());
 
     int numThreads = Settings::Manager::getInt("preload num threads", "Cells");
     if (numThreads <= 0)
@@ -518,7 +591,8 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     // Create the world
     mEnvironment.setWorld( new MWWorld::World (mViewer, rootNode, mResourceSystem.get(), mWorkQueue.get(),
         mFileCollections, mContentFiles, mEncoder, mFallbackMap,
-        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string(), mCfgMgr.getUserDataPath().string()));
+        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string(), mCfgMgr.getUserDataPath().string(),
+        mCfgMgr.getCachePath().string()));
     mEnvironment.getWorld()->setupPlayer();
     input->setPlayer(&mEnvironment.getWorld()->getPlayer());
 
@@ -536,8 +610,15 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     mScriptContext = new MWScript::CompilerContext (MWScript::CompilerContext::Type_Full);
     mScriptContext->setExtensions (&mExtensions);
 
+    mLocalScriptBudget = Settings::Manager::getFloat("local script budget", "General");
+
+    MWScript::ScriptCache* scriptCache = NULL;
+    if (Settings::Manager::getBool("script cache", "General"))
+        scriptCache = new MWScript::ScriptCache(mCfgMgr.getCachePath() / "scripts.cache",
+            MWWorld::ContentFileKey(mFileCollections, mContentFiles));
+
     mEnvironment.setScriptManager (new MWScript::ScriptManager (mEnvironment.getWorld()->getStore(), *mScriptContext, mWarningsMode,
-        mScriptBlacklistUse ? mScriptBlacklist : std::vector<std::string>()));
+        mScriptBlacklistUse ? mScriptBlacklist : std::vector<std::string>(), scriptCache, mWorkQueue.get()));
 
     // Create game mechanics system
     MWMechanics::MechanicsManager* mechanics = new MWMechanics::MechanicsManager;
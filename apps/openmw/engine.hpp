@@ -110,6 +110,10 @@ namespace OMW
             bool mScriptBlacklistUse;
             bool mNewGame;
 
+            /// Time in milliseconds local scripts may take per frame before the ones that do not depend
+            /// on the frame time are spread over several frames (0 for no limit)
+            float mLocalScriptBudget;
+
             osg::Timer_t mStartTick;
 
             // not implemented
@@ -60,6 +60,13 @@ namespace MWBase
             virtual int getJournalIndex (const std::string& id) const = 0;
             ///< Get the journal index.
 
+            virtual int getQuestHandle (const std::string& id) = 0;
+            ///< Return a handle for getting the journal index of quest \a id without searching for it.
+            /// Handles stay valid for the lifetime of the journal, including quests that are not started yet.
+
+            virtual int getLinkedJournalIndex (int handle) const = 0;
+            ///< Get the journal index of a quest by the handle returned by getQuestHandle.
+
             virtual void addTopic (const std::string& topicId, const std::string& infoId, const MWWorld::Ptr& actor) = 0;
             /// \note topicId must be lowercase
 
@@ -58,6 +58,9 @@ namespace MWBase
             virtual void updateCell(const MWWorld::Ptr &old, const MWWorld::Ptr &ptr) = 0;
             ///< Moves an object to a new cell
 
+            virtual void updatePosition(const MWWorld::Ptr& ptr) = 0;
+            ///< Update the position of an object for getObjectsInRange, after it was moved
+
             virtual void drop (const MWWorld::CellStore *cellStore) = 0;
             ///< Deregister all objects in the given cell.
 
@@ -2,6 +2,7 @@
 #define GAME_MWBASE_SCRIPTMANAGER_H
 
 #include <string>
+#include <vector>
 
 namespace Interpreter
 {
@@ -31,6 +32,14 @@ namespace MWBase
 
         public:
 
+            struct ScriptCost
+            {
+                std::string mName;
+                int mRuns;
+                double mTime; ///< total run time in milliseconds
+                double mMaxTime; ///< longest run in milliseconds
+            };
+
             ScriptManager() {}
 
             virtual ~ScriptManager() {}
@@ -46,6 +55,17 @@ namespace MWBase
             ///< Compile all scripts
             /// \return count, success
 
+            virtual void precompile (const std::vector<std::string>& names) = 0;
+            ///< Compile the given scripts in the background, for example the scripts of a cell that is being preloaded.
+
+            virtual bool dependsOnFrameTime (const std::string& name) = 0;
+            ///< Does the script need to run every frame? Scripts that use the frame duration or one-frame events
+            /// do, other scripts only react to state that lasts, so running them a few frames late is harmless.
+            /// (compile first, if not compiled yet)
+
+            virtual void getCosts (std::vector<ScriptCost>& costs, bool reset) = 0;
+            ///< Return the run time of all scripts that ran since the last reset.
+
             virtual const Compiler::Locals& getLocals (const std::string& name) = 0;
             ///< Return locals for script \a name.
 
@@ -162,6 +162,25 @@ namespace MWBase
             virtual char getGlobalVariableType (const std::string& name) const = 0;
             ///< Return ' ', if there is no global variable with this name.
 
+            virtual int getGlobalHandle (const std::string& name) const = 0;
+            ///< Return a handle for accessing global variable \a name without searching for it
+            /// (-1: no such variable, or it must be accessed by name).
+
+            virtual int getGlobalsRevision() const = 0;
+            ///< Global variable handles are invalidated when the revision changes.
+
+            virtual void setLinkedGlobalInt (int handle, int value) = 0;
+            ///< Set value independently from real type.
+
+            virtual void setLinkedGlobalFloat (int handle, float value) = 0;
+            ///< Set value independently from real type.
+
+            virtual int getLinkedGlobalInt (int handle) const = 0;
+            ///< Get value independently from real type.
+
+            virtual float getLinkedGlobalFloat (int handle) const = 0;
+            ///< Get value independently from real type.
+
             virtual std::string getCellName (const MWWorld::CellStore *cell = 0) const = 0;
             ///< Return name of the cell.
             ///
@@ -430,6 +449,9 @@ namespace MWBase
             virtual bool getLOS(const MWWorld::ConstPtr& actor,const MWWorld::ConstPtr& targetActor) = 0;
             ///< get Line of Sight (morrowind stupid implementation)
 
+            virtual void getLOS(const std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> >& actorPairs, std::vector<bool>& out) = 0;
+            ///< get Line of Sight for each pair of actors in one batch, \a out receives one entry per pair
+
             virtual float getDistToNearestRayHit(const osg::Vec3f& from, const osg::Vec3f& dir, float maxDist, bool includeWater = false) = 0;
 
             virtual void enableActorCollision(const MWWorld::Ptr& actor, bool enable) = 0;
@@ -425,7 +425,11 @@ namespace MWClass
         const MWWorld::LiveCellRef<ESM::NPC> *ref = ptr.get<ESM::NPC>();
 
         std::string model = "meshes\\base_anim.nif";
-        const ESM::Race* race = MWBase::Environment::get().getWorld()->getStore().get<ESM::Race>().find(ref->mBase->mRace);
+        // Races are never dynamic, so only look at the content file records. Unlike find(), that is safe
+        // while preloading in a worker thread, see ESMStore::findStatic().
+        const ESM::Race* race = MWBase::Environment::get().getWorld()->getStore().get<ESM::Race>().searchStatic(ref->mBase->mRace);
+        if (!race)
+            throw std::runtime_error("Race '" + ref->mBase->mRace + "' not found");
         if(race->mData.mFlags & ESM::Race::Beast)
             model = "meshes\\base_animkna.nif";
 
@@ -1,5 +1,7 @@
 #include "journalimp.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <iterator>
 
 #include <components/esm/esmwriter.hpp>
@@ -28,11 +30,20 @@ namespace MWDialogue
                 mQuests.insert (std::make_pair (id, Quest (id)));
 
             iter = result.first;
+            linkQuest (iter);
         }
 
         return iter->second;
     }
 
+    void Journal::linkQuest (TQuestContainer::const_iterator iter)
+    {
+        std::map<std::string, int>::const_iterator found = mQuestHandles.find (iter->first);
+
+        if (found!=mQuestHandles.end())
+            mLinkedQuests[found->second] = &iter->second;
+    }
+
     Topic& Journal::getTopic (const std::string& id)
     {
         TTopicContainer::iterator iter = mTopics.find (id);
@@ -73,6 +84,9 @@ namespace MWDialogue
         mJournal.clear();
         mQuests.clear();
         mTopics.clear();
+
+        // The handles remain, but the quests they refer to are gone
+        std::fill (mLinkedQuests.begin(), mLinkedQuests.end(), static_cast<const Quest *> (0));
     }
 
     void Journal::addEntry (const std::string& id, int index, const MWWorld::Ptr& actor)
@@ -132,6 +146,31 @@ namespace MWDialogue
         return iter->second.getIndex();
     }
 
+    int Journal::getQuestHandle (const std::string& id)
+    {
+        std::map<std::string, int>::const_iterator found = mQuestHandles.find (id);
+
+        if (found!=mQuestHandles.end())
+            return found->second;
+
+        int handle = static_cast<int> (mLinkedQuests.size());
+        mQuestHandles.insert (std::make_pair (id, handle));
+
+        TQuestContainer::const_iterator iter = mQuests.find (id);
+        mLinkedQuests.push_back (iter!=mQuests.end() ? &iter->second : 0);
+
+        return handle;
+    }
+
+    int Journal::getLinkedJournalIndex (int handle) const
+    {
+        assert (handle>=0 && handle<static_cast<int> (mLinkedQuests.size()));
+
+        const Quest *quest = mLinkedQuests[handle];
+
+        return quest ? quest->getIndex() : 0;
+    }
+
     Journal::TEntryIter Journal::begin() const
     {
         return mJournal.begin();
@@ -262,6 +301,8 @@ namespace MWDialogue
             if (isThere (record.mTopic))
             {
                 std::pair<TQuestContainer::iterator, bool> result = mQuests.insert (std::make_pair (record.mTopic, record));
+                if (result.second)
+                    linkQuest (result.first);
                 // reapply quest index, this is to handle users upgrading from only
                 // Morrowind.esm (no quest states) to Morrowind.esm + Tribunal.esm
                 result.first->second.setIndex(record.mState);
@@ -1,6 +1,9 @@
 #ifndef GAME_MWDIALOG_JOURNAL_H
 #define GAME_MWDIALOG_JOURNAL_H
 
+#include <map>
+#include <vector>
+
 #include "../mwbase/journal.hpp"
 
 #include "journalentry.hpp"
@@ -14,11 +17,16 @@ namespace MWDialogue
             TEntryContainer mJournal;
             TQuestContainer mQuests;
             TTopicContainer mTopics;
+            std::map<std::string, int> mQuestHandles;
+            std::vector<const Quest *> mLinkedQuests; ///< Indexed by quest handle, NULL until the quest is started
 
         private:
 
             Quest& getQuest (const std::string& id);
 
+            void linkQuest (TQuestContainer::const_iterator iter);
+            ///< Update the handle of the quest \a iter points to, after it was added to mQuests.
+
             Topic& getTopic (const std::string& id);
 
             bool isThere (const std::string& topicId, const std::string& infoId = "") const;
@@ -39,6 +47,13 @@ namespace MWDialogue
             virtual int getJournalIndex (const std::string& id) const;
             ///< Get the journal index.
 
+            virtual int getQuestHandle (const std::string& id);
+            ///< Return a handle for getting the journal index of quest \a id without searching for it.
+            /// Handles stay valid for the lifetime of the journal, including quests that are not started yet.
+
+            virtual int getLinkedJournalIndex (int handle) const;
+            ///< Get the journal index of a quest by the handle returned by getQuestHandle.
+
             virtual void addTopic (const std::string& topicId, const std::string& infoId, const MWWorld::Ptr& actor);
             /// \note topicId must be lowercase
 
@@ -1,5 +1,6 @@
 #include "actors.hpp"
 
+#include <algorithm>
 #include <typeinfo>
 #include <iostream>
 
@@ -236,8 +237,7 @@ namespace MWMechanics
         calculateRestoration(ptr, duration);
     }
 
-    void Actors::updateHeadTracking(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor,
-                                    MWWorld::Ptr& headTrackTarget, float& sqrHeadTrackDistance)
+    bool Actors::isHeadTrackCandidate(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor, float& sqrDist)
     {
         static const float fMaxHeadTrackDistance = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
                 .find("fMaxHeadTrackDistance")->getFloat();
@@ -250,16 +250,16 @@ namespace MWMechanics
 
         const ESM::Position& actor1Pos = actor.getRefData().getPosition();
         const ESM::Position& actor2Pos = targetActor.getRefData().getPosition();
-        float sqrDist = (actor1Pos.asVec3() - actor2Pos.asVec3()).length2();
+        sqrDist = (actor1Pos.asVec3() - actor2Pos.asVec3()).length2();
 
         if (sqrDist > maxDistance*maxDistance)
-            return;
+            return false;
 
         if (targetActor.getClass().getCreatureStats(targetActor).isDead())
-            return;
+            return false;
 
         if (!actor.getRefData().getBaseNode())
-            return;
+            return false;
 
         // stop tracking when target is behind the actor
         osg::Vec3f actorDirection = actor.getRefData().getBaseNode()->getAttitude() * osg::Vec3f(0,1,0);
@@ -268,14 +268,65 @@ namespace MWMechanics
         targetDirection.z() = 0;
         actorDirection.normalize();
         targetDirection.normalize();
-        if (std::acos(actorDirection * targetDirection) < osg::DegreesToRadians(90.f)
-            && sqrDist <= sqrHeadTrackDistance
-            && MWBase::Environment::get().getWorld()->getLOS(actor, targetActor) // check LOS and awareness last as it's the most expensive function
-            && MWBase::Environment::get().getMechanicsManager()->awarenessCheck(targetActor, actor))
+        return std::acos(actorDirection * targetDirection) < osg::DegreesToRadians(90.f);
+    }
+
+    void Actors::getHeadTrackCandidates(const MWWorld::Ptr& actor, HeadTrackCandidates& candidates)
+    {
+        for (ActorFrameStates::const_iterator it(mFrameStates.begin()); it != mFrameStates.end(); ++it)
         {
-            sqrHeadTrackDistance = sqrDist;
-            headTrackTarget = targetActor;
+            float sqrDist = 0.f;
+            if (it->mActor && it->mPtr != actor && isHeadTrackCandidate(actor, it->mPtr, sqrDist))
+                candidates.push_back(std::make_pair(sqrDist, &*it));
         }
+
+        std::sort(candidates.begin(), candidates.end());
+    }
+
+    void Actors::updateHeadTracking(const ActorFrameState& state, MWWorld::Ptr& headTrackTarget, const LineOfSightMap& lineOfSight)
+    {
+        const MWWorld::Ptr& actor = state.mPtr;
+
+        // The nearest candidate that is seen wins, so the candidates further away than it need no line of sight check
+        for (HeadTrackCandidates::const_iterator it(state.mHeadTrackCandidates.begin()); it != state.mHeadTrackCandidates.end(); ++it)
+        {
+            // Removed by the actors updated before this one
+            if (!it->second->mActor)
+                continue;
+
+            const MWWorld::Ptr& targetActor = it->second->mPtr;
+
+            // check LOS and awareness last as it's the most expensive function
+            LineOfSightMap::const_iterator found = lineOfSight.find(std::make_pair(MWWorld::ConstPtr(actor), MWWorld::ConstPtr(targetActor)));
+            bool LOS = found != lineOfSight.end() ? found->second : MWBase::Environment::get().getWorld()->getLOS(actor, targetActor);
+
+            if (LOS && MWBase::Environment::get().getMechanicsManager()->awarenessCheck(targetActor, actor))
+            {
+                headTrackTarget = targetActor;
+                return;
+            }
+        }
+    }
+
+    void Actors::prepareHeadTracking(LineOfSightMap& lineOfSight)
+    {
+        std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> > actorPairs;
+        for (ActorFrameStates::iterator iter(mFrameStates.begin()); iter != mFrameStates.end(); ++iter)
+        {
+            if (!iter->mActor || iter->mIsDead || !iter->mInProcessingRange)
+                continue;
+
+            // Only the nearest candidate, the others are only checked if it is not seen
+            getHeadTrackCandidates(iter->mPtr, iter->mHeadTrackCandidates);
+            if (!iter->mHeadTrackCandidates.empty())
+                actorPairs.push_back(std::make_pair(MWWorld::ConstPtr(iter->mPtr), MWWorld::ConstPtr(iter->mHeadTrackCandidates.front().second->mPtr)));
+        }
+
+        std::vector<bool> results;
+        MWBase::Environment::get().getWorld()->getLOS(actorPairs, results);
+
+        for (size_t i=0; i<actorPairs.size(); ++i)
+            lineOfSight[actorPairs[i]] = results[i];
     }
 
     void Actors::engageCombat (const MWWorld::Ptr& actor1, const MWWorld::Ptr& actor2, std::map<const MWWorld::Ptr, const std::set<MWWorld::Ptr> >& cachedAllies, bool againstPlayer)
@@ -423,9 +474,9 @@ namespace MWMechanics
         }
     }
 
-    void Actors::updateNpc (const MWWorld::Ptr& ptr, float duration)
+    void Actors::updateNpc (const MWWorld::Ptr& ptr, CharacterController* ctrl, float duration)
     {
-        updateDrowning(ptr, duration);
+        updateDrowning(ptr, ctrl, duration);
         calculateNpcStatModifiers(ptr, duration);
     }
 
@@ -800,13 +851,8 @@ namespace MWMechanics
         }
     }
 
-    void Actors::updateDrowning(const MWWorld::Ptr& ptr, float duration)
+    void Actors::updateDrowning(const MWWorld::Ptr& ptr, CharacterController* ctrl, float duration)
     {
-        PtrActorMap::iterator it = mActors.find(ptr);
-        if (it == mActors.end())
-            return;
-        CharacterController* ctrl = it->second->getCharacterController();
-
         NpcStats &stats = ptr.getClass().getNpcStats(ptr);
 
         // When npc stats are just initialized, mTimeToStartDrowning == -1 and we should get value from GMST
@@ -1009,7 +1055,10 @@ namespace MWMechanics
         }
     }
 
-    Actors::Actors() {}
+    Actors::Actors()
+        : mActorGrid(2048.f)
+    {
+    }
 
     Actors::~Actors()
     {
@@ -1024,6 +1073,7 @@ namespace MWMechanics
         if (!anim)
             return;
         mActors.insert(std::make_pair(ptr, new Actor(ptr, anim)));
+        mActorGrid.insert(ptr, ptr.getRefData().getPosition().asVec3());
         if (updateImmediately)
             mActors[ptr]->getCharacterController()->update(0);
     }
@@ -1035,6 +1085,8 @@ namespace MWMechanics
         {
             delete iter->second;
             mActors.erase(iter);
+            mActorGrid.remove(ptr);
+            removeFrameState(ptr);
         }
     }
 
@@ -1048,6 +1100,13 @@ namespace MWMechanics
 
             actor->updatePtr(ptr);
             mActors.insert(std::make_pair(ptr, actor));
+            mActorGrid.replace(old, ptr);
+
+            for (ActorFrameStates::iterator it(mFrameStates.begin()); it != mFrameStates.end(); ++it)
+            {
+                if (it->mPtr == old)
+                    it->mPtr = ptr;
+            }
         }
     }
 
@@ -1059,6 +1118,8 @@ namespace MWMechanics
             if((iter->first.isInCell() && iter->first.getCell()==cellStore) && iter->first != ignore)
             {
                 delete iter->second;
+                mActorGrid.remove(iter->first);
+                removeFrameState(iter->first);
                 mActors.erase(iter++);
             }
             else
@@ -1066,6 +1127,47 @@ namespace MWMechanics
         }
     }
 
+    void Actors::updatePosition (const MWWorld::Ptr& ptr)
+    {
+        if (mActors.find(ptr) != mActors.end())
+            mActorGrid.insert(ptr, ptr.getRefData().getPosition().asVec3());
+    }
+
+    void Actors::prepareFrameStates(const MWWorld::Ptr& player)
+    {
+        const osg::Vec3f playerPos = player.getRefData().getPosition().asVec3();
+
+        mFrameStates.clear();
+        mFrameStates.reserve(mActors.size());
+        for (PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
+        {
+            const CreatureStats& stats = iter->first.getClass().getCreatureStats(iter->first);
+
+            ActorFrameState state;
+            state.mPtr = iter->first;
+            state.mActor = iter->second;
+            state.mPosition = iter->first.getRefData().getPosition().asVec3();
+            state.mIsPlayer = iter->first == player;
+            state.mIsNpc = iter->first.getTypeName() == typeid(ESM::NPC).name();
+            state.mIsDead = stats.isDead();
+            // AI processing is only done within distance of 7168 units to the player. Note the "AI distance" slider doesn't affect this
+            // (it only does some throttling for targets beyond the "AI distance", so doesn't give any guarantees as to whether AI will be enabled or not)
+            // This distance could be made configurable later, but the setting must be marked with a big warning:
+            // using higher values will make a quest in Bloodmoon harder or impossible to complete (bug #1876)
+            state.mInProcessingRange = (playerPos - state.mPosition).length2() <= sqrAiProcessingDistance;
+            mFrameStates.push_back(state);
+        }
+    }
+
+    void Actors::removeFrameState(const MWWorld::Ptr& ptr)
+    {
+        for (ActorFrameStates::iterator it(mFrameStates.begin()); it != mFrameStates.end(); ++it)
+        {
+            if (it->mPtr == ptr)
+                it->mActor = NULL;
+        }
+    }
+
     void Actors::update (float duration, bool paused)
     {
         if(!paused)
@@ -1088,28 +1190,35 @@ namespace MWMechanics
 
             std::map<const MWWorld::Ptr, const std::set<MWWorld::Ptr> > cachedAllies; // will be filled as engageCombat iterates
 
+            prepareFrameStates(player);
+
+            // The targets each actor could turn its head to, and the line of sight to the nearest ones, resolved in one batch
+            LineOfSightMap headTrackLineOfSight;
+            if (timerUpdateHeadTrack == 0 && MWBase::Environment::get().getMechanicsManager()->isAIActive())
+                prepareHeadTracking(headTrackLineOfSight);
+
              // AI and magic effects update
-            for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
+            for(ActorFrameStates::iterator iter(mFrameStates.begin()); iter != mFrameStates.end(); ++iter)
             {
-                // AI processing is only done within distance of 7168 units to the player. Note the "AI distance" slider doesn't affect this
-                // (it only does some throttling for targets beyond the "AI distance", so doesn't give any guarantees as to whether AI will be enabled or not)
-                // This distance could be made configurable later, but the setting must be marked with a big warning:
-                // using higher values will make a quest in Bloodmoon harder or impossible to complete (bug #1876)
-                bool inProcessingRange = (player.getRefData().getPosition().asVec3() - iter->first.getRefData().getPosition().asVec3()).length2()
-                        <= sqrAiProcessingDistance;
+                if (!iter->mActor)
+                    continue;
+
+                const MWWorld::Ptr& actor = iter->mPtr;
+                CharacterController* ctrl = iter->mActor->getCharacterController();
 
-                iter->second->getCharacterController()->setActive(inProcessingRange);
+                ctrl->setActive(iter->mInProcessingRange);
 
-                if (iter->first == player)
-                    iter->second->getCharacterController()->setAttackingOrSpell(MWBase::Environment::get().getWorld()->getPlayer().getAttackingOrSpell());
+                if (iter->mIsPlayer)
+                    ctrl->setAttackingOrSpell(MWBase::Environment::get().getWorld()->getPlayer().getAttackingOrSpell());
 
                 // If dead or no longer in combat, no longer store any actors who attempted to hit us. Also remove for the player.
-                if (iter->first != player && (iter->first.getClass().getCreatureStats(iter->first).isDead()
-                    || !iter->first.getClass().getCreatureStats(iter->first).getAiSequence().isInCombat()
-                    || !inProcessingRange))
+                // Read live, the actors updated before may have killed this one or ended its combat
+                if (!iter->mIsPlayer && (actor.getClass().getCreatureStats(actor).isDead()
+                                         || !actor.getClass().getCreatureStats(actor).getAiSequence().isInCombat()
+                                         || !iter->mInProcessingRange))
                 {
-                    iter->first.getClass().getCreatureStats(iter->first).setHitAttemptActorId(-1);
-                    if (player.getClass().getCreatureStats(player).getHitAttemptActorId() == iter->first.getClass().getCreatureStats(iter->first).getActorId())
+                    actor.getClass().getCreatureStats(actor).setHitAttemptActorId(-1);
+                    if (player.getClass().getCreatureStats(player).getHitAttemptActorId() == actor.getClass().getCreatureStats(actor).getActorId())
                         player.getClass().getCreatureStats(player).setHitAttemptActorId(-1);
                 }
 
@@ -1118,63 +1227,55 @@ namespace MWMechanics
                 if (!playerHitAttemptActor.isInCell())
                     player.getClass().getCreatureStats(player).setHitAttemptActorId(-1);
 
-                if (!iter->first.getClass().getCreatureStats(iter->first).isDead())
+                // Not iter->mIsDead, the actors updated before may have killed this one
+                if (!actor.getClass().getCreatureStats(actor).isDead())
                 {
                     bool cellChanged = MWBase::Environment::get().getWorld()->hasCellChanged();
-                    MWWorld::Ptr actor = iter->first; // make a copy of the map key to avoid it being invalidated when the player teleports
                     updateActor(actor, duration);
                     if (!cellChanged && MWBase::Environment::get().getWorld()->hasCellChanged())
                     {
                         return; // for now abort update of the old cell when cell changes by teleportation magic effect
                                 // a better solution might be to apply cell changes at the end of the frame
                     }
-                    if (MWBase::Environment::get().getMechanicsManager()->isAIActive() && inProcessingRange)
+                    if (MWBase::Environment::get().getMechanicsManager()->isAIActive() && iter->mInProcessingRange)
                     {
-                        if (timerUpdateAITargets == 0)
+                        if (timerUpdateAITargets == 0 && !iter->mIsPlayer) // player is not AI-controlled
                         {
-                            if (iter->first != player)
-                                adjustCommandedActor(iter->first);
+                            adjustCommandedActor(actor);
 
-                            for(PtrActorMap::iterator it(mActors.begin()); it != mActors.end(); ++it)
+                            for(ActorFrameStates::const_iterator it(mFrameStates.begin()); it != mFrameStates.end(); ++it)
                             {
-                                if (it->first == iter->first || iter->first == player) // player is not AI-controlled
+                                if (it == iter || !it->mActor)
                                     continue;
-                                engageCombat(iter->first, it->first, cachedAllies, it->first == player);
+                                engageCombat(actor, it->mPtr, cachedAllies, it->mIsPlayer);
                             }
                         }
                         if (timerUpdateHeadTrack == 0)
                         {
-                            float sqrHeadTrackDistance = std::numeric_limits<float>::max();
                             MWWorld::Ptr headTrackTarget;
-
-                            for(PtrActorMap::iterator it(mActors.begin()); it != mActors.end(); ++it)
-                            {
-                                if (it->first == iter->first)
-                                    continue;
-                                updateHeadTracking(iter->first, it->first, headTrackTarget, sqrHeadTrackDistance);
-                            }
-                            iter->second->getCharacterController()->setHeadTrackTarget(headTrackTarget);
+                            updateHeadTracking(*iter, headTrackTarget, headTrackLineOfSight);
+                            ctrl->setHeadTrackTarget(headTrackTarget);
                         }
 
-                        if (iter->first.getClass().isNpc() && iter->first != player)
-                            updateCrimePersuit(iter->first, duration);
+                        if (iter->mIsNpc && !iter->mIsPlayer)
+                            updateCrimePersuit(actor, duration);
 
-                        if (iter->first != player)
+                        if (!iter->mIsPlayer)
                         {
-                            CreatureStats &stats = iter->first.getClass().getCreatureStats(iter->first);
-                            if (isConscious(iter->first))
-                                stats.getAiSequence().execute(iter->first, *iter->second->getCharacterController(), iter->second->getAiState(), duration);
+                            CreatureStats &stats = actor.getClass().getCreatureStats(actor);
+                            if (isConscious(actor))
+                                stats.getAiSequence().execute(actor, *ctrl, iter->mActor->getAiState(), duration);
 
                             if (stats.getAiSequence().isInCombat() && !stats.isDead()) hostilesCount++;
                         }
                     }
 
-                    if(iter->first.getTypeName() == typeid(ESM::NPC).name())
+                    if(iter->mIsNpc)
                     {
-                        updateNpc(iter->first, duration);
+                        updateNpc(actor, ctrl, duration);
 
                         if (timerUpdateEquippedLight == 0)
-                            updateEquippedLight(iter->first, updateEquippedLightInterval);
+                            updateEquippedLight(actor, updateEquippedLightInterval);
                     }
                 }
             }
@@ -1183,34 +1284,38 @@ namespace MWMechanics
             timerUpdateHeadTrack += duration;
             timerUpdateEquippedLight += duration;
 
+            // The AI pass may have added, killed or moved actors
+            prepareFrameStates(player);
+
             // Looping magic VFX update
             // Note: we need to do this before any of the animations are updated.
             // Reaching the text keys may trigger Hit / Spellcast (and as such, particles),
             // so updating VFX immediately after that would just remove the particle effects instantly.
             // There needs to be a magic effect update in between.
-            for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
-                iter->second->getCharacterController()->updateContinuousVfx();
+            for(ActorFrameStates::const_iterator iter(mFrameStates.begin()); iter != mFrameStates.end(); ++iter)
+            {
+                if (iter->mActor)
+                    iter->mActor->getCharacterController()->updateContinuousVfx();
+            }
 
             // Animation/movement update
             CharacterController* playerCharacter = NULL;
-            for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
+            for(ActorFrameStates::const_iterator iter(mFrameStates.begin()); iter != mFrameStates.end(); ++iter)
             {
-                if (iter->first != player &&
-                        (player.getRefData().getPosition().asVec3() - iter->first.getRefData().getPosition().asVec3()).length2()
-                        > sqrAiProcessingDistance)
+                if (!iter->mActor || (!iter->mIsPlayer && !iter->mInProcessingRange))
                     continue;
 
-                if (iter->first.getClass().getCreatureStats(iter->first).isParalyzed())
-                    iter->second->getCharacterController()->skipAnim();
+                if (iter->mPtr.getClass().getCreatureStats(iter->mPtr).isParalyzed())
+                    iter->mActor->getCharacterController()->skipAnim();
 
                 // Handle player last, in case a cell transition occurs by casting a teleportation spell
-                // (would invalidate the iterator)
-                if (iter->first == getPlayer())
+                // (would invalidate the actors of the old cell)
+                if (iter->mIsPlayer)
                 {
-                    playerCharacter = iter->second->getCharacterController();
+                    playerCharacter = iter->mActor->getCharacterController();
                     continue;
                 }
-                iter->second->getCharacterController()->update(duration);
+                iter->mActor->getCharacterController()->update(duration);
             }
 
             if (playerCharacter)
@@ -1274,18 +1379,18 @@ namespace MWMechanics
 
                     bool detected = false;
 
-                    for (PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
+                    for (ActorFrameStates::const_iterator iter(mFrameStates.begin()); iter != mFrameStates.end(); ++iter)
                     {
-                        MWWorld::Ptr observer = iter->first;
+                        const MWWorld::Ptr& observer = iter->mPtr;
 
-                        if (iter->first == player)  // not the player
+                        if (!iter->mActor || iter->mIsPlayer)  // not the player
                             continue;
 
                         if (observer.getClass().getCreatureStats(observer).isDead())
                             continue;
 
                         // is the player in range and can they be detected
-                        if ((observer.getRefData().getPosition().asVec3() - player.getRefData().getPosition().asVec3()).length2() <= radius*radius
+                        if ((iter->mPosition - player.getRefData().getPosition().asVec3()).length2() <= radius*radius
                             && MWBase::Environment::get().getWorld()->getLOS(player, observer))
                         {
                             if (MWBase::Environment::get().getMechanicsManager()->awarenessCheck(player, observer))
@@ -1521,11 +1626,11 @@ namespace MWMechanics
 
     void Actors::getObjectsInRange(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out)
     {
-        for (PtrActorMap::iterator iter = mActors.begin(); iter != mActors.end(); ++iter)
-        {
-            if ((iter->first.getRefData().getPosition().asVec3() - position).length2() <= radius*radius)
-                out.push_back(iter->first);
-        }
+        const size_t begin = out.size();
+        mActorGrid.getObjectsInRange(position, radius, out);
+
+        // The grid returns the actors in hash order. Callers roll dice for each actor, so keep the order of mActors.
+        std::sort(out.begin() + begin, out.end());
     }
 
     std::list<MWWorld::Ptr> Actors::getActorsSidingWith(const MWWorld::Ptr& actor)
@@ -1728,6 +1833,8 @@ namespace MWMechanics
             it->second = NULL;
         }
         mActors.clear();
+        mActorGrid.clear();
+        mFrameStates.clear();
         mDeathCount.clear();
     }
 
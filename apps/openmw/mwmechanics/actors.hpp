@@ -7,9 +7,12 @@
 #include <map>
 #include <list>
 
+#include <osg/Vec3f>
+
 #include "../mwbase/world.hpp"
 
 #include "movement.hpp"
+#include "spatialgrid.hpp"
 
 namespace MWWorld
 {
@@ -20,13 +23,43 @@ namespace MWWorld
 namespace MWMechanics
 {
     class Actor;
+    class CharacterController;
     class CreatureStats;
 
     class Actors
     {
             std::map<std::string, int> mDeathCount;
 
-            void updateNpc(const MWWorld::Ptr &ptr, float duration);
+            struct ActorFrameState;
+
+            /// Actors that could be looked at, paired with their squared distance, nearest first.
+            typedef std::vector<std::pair<float, const ActorFrameState*> > HeadTrackCandidates;
+
+            /// State of an actor at the start of the frame, packed so that the loops in update() can test it
+            /// without going through the map and the class of the actor every time.
+            /// @note Prepared again after the AI pass, which may add actors or change their state.
+            struct ActorFrameState
+            {
+                MWWorld::Ptr mPtr;
+                Actor* mActor; ///< NULL, if the actor was removed during the frame
+                osg::Vec3f mPosition;
+                bool mIsPlayer;
+                bool mIsNpc;
+                bool mIsDead;
+                bool mInProcessingRange;
+                HeadTrackCandidates mHeadTrackCandidates; ///< Filled by prepareHeadTracking, on frames that update head tracking
+            };
+
+            typedef std::vector<ActorFrameState> ActorFrameStates;
+
+            ActorFrameStates mFrameStates;
+
+            void prepareFrameStates(const MWWorld::Ptr& player);
+            ///< Fill mFrameStates with the current state of all actors, in the order of mActors.
+
+            void removeFrameState(const MWWorld::Ptr& ptr);
+
+            void updateNpc(const MWWorld::Ptr &ptr, CharacterController* ctrl, float duration);
 
             void adjustMagicEffects (const MWWorld::Ptr& creature);
 
@@ -37,7 +70,7 @@ namespace MWMechanics
 
             void calculateRestoration (const MWWorld::Ptr& ptr, float duration);
 
-            void updateDrowning (const MWWorld::Ptr& ptr, float duration);
+            void updateDrowning (const MWWorld::Ptr& ptr, CharacterController* ctrl, float duration);
 
             void updateEquippedLight (const MWWorld::Ptr& ptr, float duration);
 
@@ -77,6 +110,11 @@ namespace MWMechanics
             void dropActors (const MWWorld::CellStore *cellStore, const MWWorld::Ptr& ignore);
             ///< Deregister all actors (except for \a ignore) in the given cell.
 
+            void updatePosition (const MWWorld::Ptr& ptr);
+            ///< Update the position of an actor for getObjectsInRange, after it was moved.
+            ///
+            /// \note Ignored, if \a ptr is not a registered actor.
+
             void update (float duration, bool paused);
             ///< Update actor stats and store desired velocity vectors in \a movement
 
@@ -90,8 +128,25 @@ namespace MWMechanics
             */
             void engageCombat(const MWWorld::Ptr& actor1, const MWWorld::Ptr& actor2, std::map<const MWWorld::Ptr, const std::set<MWWorld::Ptr> >& cachedAllies, bool againstPlayer);
 
-            void updateHeadTracking(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor,
-                                            MWWorld::Ptr& headTrackTarget, float& sqrHeadTrackDistance);
+            typedef std::map<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr>, bool> LineOfSightMap;
+
+            /// @return true if \a targetActor is alive, in front of \a actor and close enough to be looked at.
+            /// @param sqrDist Receives the squared distance between the actors.
+            bool isHeadTrackCandidate(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor, float& sqrDist);
+
+            /// Add the actors \a actor could look at to \a candidates.
+            /// @note Uses the actor states prepared for the current frame.
+            void getHeadTrackCandidates(const MWWorld::Ptr& actor, HeadTrackCandidates& candidates);
+
+            /// Set \a headTrackTarget to the nearest candidate of \a state that the actor can see and is aware of, if any.
+            /// @param lineOfSight Precomputed line of sight checks, see prepareHeadTracking. Pairs that are
+            /// missing from it are checked on the spot.
+            void updateHeadTracking(const ActorFrameState& state, MWWorld::Ptr& headTrackTarget, const LineOfSightMap& lineOfSight);
+
+            /// Find the head tracking candidates of all living actors in AI processing range, and check the line of sight
+            /// to their nearest candidate in one batch.
+            /// @note Uses the actor states prepared for the current frame.
+            void prepareHeadTracking(LineOfSightMap& lineOfSight);
 
             void rest(bool sleep);
             ///< Update actors while the player is waiting or sleeping. This should be called every hour.
@@ -115,6 +170,7 @@ namespace MWMechanics
         void persistAnimationStates();
 
             void getObjectsInRange(const osg::Vec3f& position, float radius, std::vector<MWWorld::Ptr>& out);
+            ///< Add the actors within \a radius of \a position to \a out, in the same order as iterating over the actors.
 
             void cleanupSummonedCreature (CreatureStats& casterStats, int creatureActorId);
 
@@ -151,6 +207,9 @@ namespace MWMechanics
     private:
         PtrActorMap mActors;
 
+        /// Positions of the actors in mActors, for getObjectsInRange
+        SpatialGrid<MWWorld::Ptr> mActorGrid;
+
     };
 }
 
@@ -0,0 +1,197 @@
+#ifndef GAME_MWMECHANICS_SPATIALGRID_H
+#define GAME_MWMECHANICS_SPATIALGRID_H
+
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <osg/Vec3f>
+
+namespace MWMechanics
+{
+
+    /** \brief Uniform grid over the XY plane for proximity queries.
+     *  Objects are stored in the grid cell that contains their position. The positions
+     *  are not tracked automatically, insert() must be called again after an object moved.
+     */
+    template<class T>
+    class SpatialGrid
+    {
+    public:
+        /// @param cellSize Edge length of a grid cell. Should be around the typical query radius.
+        explicit SpatialGrid(float cellSize)
+            : mCellSize(cellSize)
+        {
+        }
+
+        /// Add an object, or update its position if it is already in the grid.
+        void insert(const T& object, const osg::Vec3f& position)
+        {
+            CellIndex index = getCellIndex(position);
+
+            typename ObjectMap::iterator found = mObjects.find(object);
+            if (found != mObjects.end())
+            {
+                if (found->second == index)
+                {
+                    Cell& cell = mCells[index];
+                    for (typename Cell::iterator it = cell.begin(); it != cell.end(); ++it)
+                    {
+                        if (it->mObject == object)
+                        {
+                            it->mPosition = position;
+                            return;
+                        }
+                    }
+                }
+                removeFromCell(object, found->second);
+                found->second = index;
+            }
+            else
+                mObjects.insert(std::make_pair(object, index));
+
+            Entry entry;
+            entry.mObject = object;
+            entry.mPosition = position;
+            mCells[index].push_back(entry);
+        }
+
+        /// Replace an object with another one at the same position, for example when an object changed its cell.
+        void replace(const T& old, const T& object)
+        {
+            typename ObjectMap::iterator found = mObjects.find(old);
+            if (found == mObjects.end())
+                return;
+
+            CellIndex index = found->second;
+            mObjects.erase(found);
+            mObjects[object] = index;
+
+            Cell& cell = mCells[index];
+            for (typename Cell::iterator it = cell.begin(); it != cell.end(); ++it)
+            {
+                if (it->mObject == old)
+                {
+                    it->mObject = object;
+                    return;
+                }
+            }
+        }
+
+        void remove(const T& object)
+        {
+            typename ObjectMap::iterator found = mObjects.find(object);
+            if (found == mObjects.end())
+                return;
+
+            removeFromCell(object, found->second);
+            mObjects.erase(found);
+        }
+
+        void clear()
+        {
+            mCells.clear();
+            mObjects.clear();
+        }
+
+        size_t size() const
+        {
+            return mObjects.size();
+        }
+
+        /// Add all objects within \a radius of \a position to \a out.
+        void getObjectsInRange(const osg::Vec3f& position, float radius, std::vector<T>& out) const
+        {
+            const float radius2 = radius * radius;
+            const CellIndex min = getCellIndex(position - osg::Vec3f(radius, radius, 0.f));
+            const CellIndex max = getCellIndex(position + osg::Vec3f(radius, radius, 0.f));
+
+            const double numCellsInRange = (static_cast<double>(max.first) - min.first + 1) * (static_cast<double>(max.second) - min.second + 1);
+            if (numCellsInRange > mCells.size())
+            {
+                // Large radius, looking at all occupied cells is cheaper than probing every cell in range
+                for (typename CellMap::const_iterator it = mCells.begin(); it != mCells.end(); ++it)
+                {
+                    if (it->first.first >= min.first && it->first.first <= max.first
+                            && it->first.second >= min.second && it->first.second <= max.second)
+                        addObjectsInRange(it->second, position, radius2, out);
+                }
+                return;
+            }
+
+            for (int x = min.first; x <= max.first; ++x)
+            {
+                for (int y = min.second; y <= max.second; ++y)
+                {
+                    typename CellMap::const_iterator found = mCells.find(CellIndex(x, y));
+                    if (found != mCells.end())
+                        addObjectsInRange(found->second, position, radius2, out);
+                }
+            }
+        }
+
+    private:
+        typedef std::pair<int, int> CellIndex;
+
+        struct CellIndexHash
+        {
+            size_t operator()(const CellIndex& index) const
+            {
+                return static_cast<size_t>(index.first) * 73856093u ^ static_cast<size_t>(index.second) * 19349663u;
+            }
+        };
+
+        struct Entry
+        {
+            T mObject;
+            osg::Vec3f mPosition;
+        };
+
+        typedef std::vector<Entry> Cell;
+        typedef std::unordered_map<CellIndex, Cell, CellIndexHash> CellMap;
+        typedef std::map<T, CellIndex> ObjectMap;
+
+        float mCellSize;
+        CellMap mCells;
+        ObjectMap mObjects;
+
+        CellIndex getCellIndex(const osg::Vec3f& position) const
+        {
+            return CellIndex(static_cast<int>(std::floor(position.x() / mCellSize)),
+                             static_cast<int>(std::floor(position.y() / mCellSize)));
+        }
+
+        void removeFromCell(const T& object, const CellIndex& index)
+        {
+            typename CellMap::iterator found = mCells.find(index);
+            if (found == mCells.end())
+                return;
+
+            Cell& cell = found->second;
+            for (typename Cell::iterator it = cell.begin(); it != cell.end(); ++it)
+            {
+                if (it->mObject == object)
+                {
+                    *it = cell.back();
+                    cell.pop_back();
+                    break;
+                }
+            }
+            if (cell.empty())
+                mCells.erase(found);
+        }
+
+        static void addObjectsInRange(const Cell& cell, const osg::Vec3f& position, float radius2, std::vector<T>& out)
+        {
+            for (typename Cell::const_iterator it = cell.begin(); it != cell.end(); ++it)
+            {
+                if ((it->mPosition - position).length2() <= radius2)
+                    out.push_back(it->mObject);
+            }
+        }
+    };
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "physicssystem.hpp"
 
+#include <iostream>
 #include <stdexcept>
 
 #include <osg/Group>
@@ -24,6 +25,8 @@
 #include <components/esm/loadgmst.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
+#include <components/sceneutil/workqueue.hpp>
+#include <components/settings/settings.hpp>
 
 #include <components/nifosg/particle.hpp> // FindRecIndexVisitor
 
@@ -58,6 +61,8 @@ namespace MWPhysics
     static const float sMinStep = 10.f;
     static const float sGroundOffset = 1.0f;
 
+    static const float sPhysicsDt = 1.f/60.0f;
+
     // Arbitrary number. To prevent infinite loops. They shouldn't happen but it's good to be prepared.
     static const int sMaxIterations = 8;
 
@@ -214,6 +219,43 @@ namespace MWPhysics
         }
     };
 
+    /// Input and result of solving the movement of one actor for a frame. Holds copies of the actor's state,
+    /// so that the movement can be solved while the main thread is using the actor.
+    struct ActorFrameData
+    {
+        MWWorld::Ptr mPtr;
+        Actor* mActor;
+        osg::Vec3f mMovement;
+        ESM::Position mRefPosition;
+        float mWaterlevel;
+        float mSlowFall;
+        bool mIsFlying;
+        bool mIsMobile;
+        bool mIsDead;
+        bool mIsPureWaterCreature;
+        bool mCollisionMode;
+
+        osg::Vec3f mInertia;
+        bool mOnGround;
+        bool mOnSlope;
+        bool mWalkingOnWater;
+
+        osg::Vec3f mPosition;
+        /// Position before the last step, to be used for the interpolation
+        osg::Vec3f mPreviousPosition;
+        bool mPositionChanged;
+        MWWorld::Ptr mStandingOn;
+    };
+
+    /// State of the world that the movement of all actors in a frame depends on
+    struct WorldFrameData
+    {
+        bool mIsInStorm;
+        osg::Vec3f mStormDirection;
+        float mSwimHeightScale;
+        float mStormWalkMult;
+    };
+
     class MovementSolver
     {
     private:
@@ -274,28 +316,33 @@ namespace MWPhysics
             }
         }
 
-        static osg::Vec3f move(osg::Vec3f position, const MWWorld::Ptr &ptr, Actor* physicActor, const osg::Vec3f &movement, float time,
-                                  bool isFlying, float waterlevel, float slowFall, const btCollisionWorld* collisionWorld,
-                               std::map<MWWorld::Ptr, MWWorld::Ptr>& standingCollisionTracker)
+        /// Solve the movement of one actor for one step.
+        /// @note Only modifies \a actor, and does not move any collision objects. Movements of different actors
+        /// can be solved in parallel, as long as the collision world is not modified at the same time.
+        static osg::Vec3f move(osg::Vec3f position, ActorFrameData& actor, float time, const WorldFrameData& worldData,
+                               const btCollisionWorld* collisionWorld)
         {
-            const ESM::Position& refpos = ptr.getRefData().getPosition();
+            const ESM::Position& refpos = actor.mRefPosition;
+            const osg::Vec3f& movement = actor.mMovement;
+            const bool isFlying = actor.mIsFlying;
+            const float waterlevel = actor.mWaterlevel;
             // Early-out for totally static creatures
             // (Not sure if gravity should still apply?)
-            if (!ptr.getClass().isMobile(ptr))
+            if (!actor.mIsMobile)
                 return position;
 
             // Reset per-frame data
-            physicActor->setWalkingOnWater(false);
+            actor.mWalkingOnWater = false;
             // Anything to collide with?
-            if(!physicActor->getCollisionMode())
+            if(!actor.mCollisionMode)
             {
                 return position +  (osg::Quat(refpos.rot[0], osg::Vec3f(-1, 0, 0)) *
                                     osg::Quat(refpos.rot[2], osg::Vec3f(0, 0, -1))
                                     ) * movement * time;
             }
 
-            const btCollisionObject *colobj = physicActor->getCollisionObject();
-            osg::Vec3f halfExtents = physicActor->getHalfExtents();
+            const btCollisionObject *colobj = actor.mActor->getCollisionObject();
+            osg::Vec3f halfExtents = actor.mActor->getHalfExtents();
 
             // NOTE: here we don't account for the collision box translation (i.e. physicActor->getPosition() - refpos.pos).
             // That means the collision shape used for moving this actor is in a different spot than the collision shape
@@ -303,12 +350,10 @@ namespace MWPhysics
             // While this is strictly speaking wrong, it's needed for MW compatibility.
             position.z() += halfExtents.z();
 
-            static const float fSwimHeightScale = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                    .find("fSwimHeightScale")->getFloat();
-            float swimlevel = waterlevel + halfExtents.z() - (physicActor->getRenderingHalfExtents().z() * 2 * fSwimHeightScale);
+            float swimlevel = waterlevel + halfExtents.z() - (actor.mActor->getRenderingHalfExtents().z() * 2 * worldData.mSwimHeightScale);
 
             ActorTracer tracer;
-            osg::Vec3f inertia = physicActor->getInertialForce();
+            osg::Vec3f inertia = actor.mInertia;
             osg::Vec3f velocity;
 
             if(position.z() < swimlevel || isFlying)
@@ -320,26 +365,22 @@ namespace MWPhysics
             {
                 velocity = (osg::Quat(refpos.rot[2], osg::Vec3f(0, 0, -1))) * movement;
 
-                if (velocity.z() > 0.f && physicActor->getOnGround() && !physicActor->getOnSlope())
+                if (velocity.z() > 0.f && actor.mOnGround && !actor.mOnSlope)
                     inertia = velocity;
-                else if(!physicActor->getOnGround() || physicActor->getOnSlope())
-                    velocity = velocity + physicActor->getInertialForce();
+                else if(!actor.mOnGround || actor.mOnSlope)
+                    velocity = velocity + actor.mInertia;
             }
 
             // dead actors underwater will float to the surface, if the CharacterController tells us to do so
-            if (movement.z() > 0 && ptr.getClass().getCreatureStats(ptr).isDead() && position.z() < swimlevel)
+            if (movement.z() > 0 && actor.mIsDead && position.z() < swimlevel)
                 velocity = osg::Vec3f(0,0,1) * 25;
 
-            ptr.getClass().getMovementSettings(ptr).mPosition[2] = 0;
-
             // Now that we have the effective movement vector, apply wind forces to it
-            if (MWBase::Environment::get().getWorld()->isInStorm())
+            if (worldData.mIsInStorm)
             {
-                osg::Vec3f stormDirection = MWBase::Environment::get().getWorld()->getStormDirection();
+                const osg::Vec3f& stormDirection = worldData.mStormDirection;
                 float angleDegrees = osg::RadiansToDegrees(std::acos(stormDirection * velocity / (stormDirection.length() * velocity.length())));
-                static const float fStromWalkMult = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                        .find("fStromWalkMult")->getFloat();
-                velocity *= 1.f-(fStromWalkMult * (angleDegrees/180.f));
+                velocity *= 1.f-(worldData.mStormWalkMult * (angleDegrees/180.f));
             }
 
             Stepper stepper(collisionWorld, colobj);
@@ -412,7 +453,7 @@ namespace MWPhysics
                 if (result)
                 {
                     // don't let pure water creatures move out of water after stepMove
-                    if (ptr.getClass().isPureWaterCreature(ptr)
+                    if (actor.mIsPureWaterCreature
                             && newPosition.z() + halfExtents.z() > waterlevel)
                         newPosition = oldPosition;
                 }
@@ -440,7 +481,7 @@ namespace MWPhysics
             if (!(inertia.z() > 0.f) && !(newPosition.z() < swimlevel))
             {
                 osg::Vec3f from = newPosition;
-                osg::Vec3f to = newPosition - (physicActor->getOnGround() ?
+                osg::Vec3f to = newPosition - (actor.mOnGround ?
                              osg::Vec3f(0,0,sStepSizeDown + 2*sGroundOffset) : osg::Vec3f(0,0,2*sGroundOffset));
                 tracer.doTrace(colobj, from, to, collisionWorld);
                 if(tracer.mFraction < 1.0f
@@ -449,10 +490,10 @@ namespace MWPhysics
                     const btCollisionObject* standingOn = tracer.mHitObject;
                     PtrHolder* ptrHolder = static_cast<PtrHolder*>(standingOn->getUserPointer());
                     if (ptrHolder)
-                        standingCollisionTracker[ptr] = ptrHolder->getPtr();
+                        actor.mStandingOn = ptrHolder->getPtr();
 
                     if (standingOn->getBroadphaseHandle()->m_collisionFilterGroup == CollisionType_Water)
-                        physicActor->setWalkingOnWater(true);
+                        actor.mWalkingOnWater = true;
                     if (!isFlying)
                         newPosition.z() = tracer.mEndPos.z() + sGroundOffset;
 
@@ -483,20 +524,20 @@ namespace MWPhysics
             }
 
             if((isOnGround && !isOnSlope) || newPosition.z() < swimlevel || isFlying)
-                physicActor->setInertialForce(osg::Vec3f(0.f, 0.f, 0.f));
+                actor.mInertia = osg::Vec3f(0.f, 0.f, 0.f);
             else
             {
                 inertia.z() += time * -627.2f;
                 if (inertia.z() < 0)
-                    inertia.z() *= slowFall;
-                if (slowFall < 1.f) {
-                    inertia.x() *= slowFall;
-                    inertia.y() *= slowFall;
+                    inertia.z() *= actor.mSlowFall;
+                if (actor.mSlowFall < 1.f) {
+                    inertia.x() *= actor.mSlowFall;
+                    inertia.y() *= actor.mSlowFall;
                 }
-                physicActor->setInertialForce(inertia);
+                actor.mInertia = inertia;
             }
-            physicActor->setOnGround(isOnGround);
-            physicActor->setOnSlope(isOnSlope);
+            actor.mOnGround = isOnGround;
+            actor.mOnSlope = isOnSlope;
 
             newPosition.z() -= halfExtents.z(); // remove what was added at the beginning
             return newPosition;
@@ -504,6 +545,110 @@ namespace MWPhysics
     };
 
 
+    // ---------------------------------------------------------------
+
+    static void solveMovement(ActorFrameData& data, int numSteps, float physicsDt, const WorldFrameData& worldData,
+                              const btCollisionWorld* collisionWorld)
+    {
+        osg::Vec3f position = data.mPosition;
+        data.mPositionChanged = false;
+        for (int i=0; i<numSteps; ++i)
+        {
+            data.mPreviousPosition = position;
+            position = MovementSolver::move(position, data, physicsDt, worldData, collisionWorld);
+            if (position != data.mPreviousPosition)
+                data.mPositionChanged = true;
+        }
+        data.mPosition = position;
+    }
+
+    /// Solves the movement of every n-th actor, starting with the given one
+    class SolveMovementWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        SolveMovementWorkItem(std::vector<ActorFrameData>& frameData, size_t first, size_t stride,
+                              int numSteps, float physicsDt, const WorldFrameData& worldData, const btCollisionWorld* collisionWorld)
+            : mFrameData(frameData)
+            , mFirst(first)
+            , mStride(stride)
+            , mNumSteps(numSteps)
+            , mPhysicsDt(physicsDt)
+            , mWorldData(worldData)
+            , mCollisionWorld(collisionWorld)
+        {
+        }
+
+        virtual void doWork()
+        {
+            for (size_t i=mFirst; i<mFrameData.size(); i+=mStride)
+                solveMovement(mFrameData[i], mNumSteps, mPhysicsDt, mWorldData, mCollisionWorld);
+        }
+
+    private:
+        std::vector<ActorFrameData>& mFrameData;
+        size_t mFirst;
+        size_t mStride;
+        int mNumSteps;
+        float mPhysicsDt;
+        const WorldFrameData& mWorldData;
+        const btCollisionWorld* mCollisionWorld;
+    };
+
+    /// Solve the movement of all actors against the collision world as it is now, optionally on several threads.
+    /// The result does not depend on the order of the actors or the number of threads.
+    static void solveMovements(std::vector<ActorFrameData>& frameData, int numSteps, float physicsDt, const WorldFrameData& worldData,
+                               const btCollisionWorld* collisionWorld, SceneUtil::WorkQueue* solverQueue, int numSolverThreads)
+    {
+        if (!solverQueue || frameData.size() < 2 || !numSteps)
+        {
+            for (size_t i=0; i<frameData.size(); ++i)
+                solveMovement(frameData[i], numSteps, physicsDt, worldData, collisionWorld);
+            return;
+        }
+
+        std::vector<osg::ref_ptr<SceneUtil::WorkItem> > items;
+        const size_t numItems = std::min(frameData.size(), static_cast<size_t>(numSolverThreads));
+        for (size_t i=0; i<numItems; ++i)
+        {
+            items.push_back(new SolveMovementWorkItem(frameData, i, numItems, numSteps, physicsDt, worldData, collisionWorld));
+            solverQueue->addWorkItem(items.back());
+        }
+        for (size_t i=0; i<items.size(); ++i)
+            items[i]->waitTillDone();
+    }
+
+    /// Solves the movement of a frame in the background, see PhysicsSystem::startSimulation
+    class SimulationWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        SimulationWorkItem(int numSteps, float physicsDt, float interpolationFactor, const btCollisionWorld* collisionWorld,
+                           SceneUtil::WorkQueue* solverQueue, int numSolverThreads)
+            : mNumSteps(numSteps)
+            , mPhysicsDt(physicsDt)
+            , mInterpolationFactor(interpolationFactor)
+            , mCollisionWorld(collisionWorld)
+            , mSolverQueue(solverQueue)
+            , mNumSolverThreads(numSolverThreads)
+        {
+        }
+
+        virtual void doWork()
+        {
+            solveMovements(mFrameData, mNumSteps, mPhysicsDt, mWorldData, mCollisionWorld, mSolverQueue, mNumSolverThreads);
+        }
+
+        std::vector<ActorFrameData> mFrameData;
+        WorldFrameData mWorldData;
+        int mNumSteps;
+        float mPhysicsDt;
+        float mInterpolationFactor;
+
+    private:
+        const btCollisionWorld* mCollisionWorld;
+        SceneUtil::WorkQueue* mSolverQueue;
+        int mNumSolverThreads;
+    };
+
     // ---------------------------------------------------------------
 
     class HeightField
@@ -680,6 +825,8 @@ namespace MWPhysics
         , mResourceSystem(resourceSystem)
         , mDebugDrawEnabled(false)
         , mTimeAccum(0.0f)
+        , mNumSolverThreads(0)
+        , mNumPendingSteps(0)
         , mWaterHeight(0)
         , mWaterEnabled(false)
         , mParentNode(parentNode)
@@ -695,10 +842,38 @@ namespace MWPhysics
         // Don't update AABBs of all objects every frame. Most objects in MW are static, so we don't need this.
         // Should a "static" object ever be moved, we have to update its AABB manually using DynamicsWorld::updateSingleAabb.
         mCollisionWorld->setForceUpdateAllAabbs(false);
+
+        int numThreads = Settings::Manager::getInt("solver threads", "Physics");
+        // Concurrent queries need a ray test stack for each thread, which Bullet only has when built with multithreading support
+        if (numThreads > 1 && static_cast<btDbvtBroadphase*>(mBroadphase)->m_rayTestStacks.size() <= 1)
+        {
+            std::cerr << "Warning: Bullet was not compiled with multithreading support, actor movement will be solved on the main thread" << std::endl;
+            numThreads = 0;
+        }
+        if (numThreads > 1)
+        {
+            mNumSolverThreads = numThreads;
+            mSolverQueue = new SceneUtil::WorkQueue(numThreads);
+        }
+
+        if (Settings::Manager::getBool("async simulation", "Physics"))
+        {
+            // The main thread runs queries while the simulation is in progress
+            if (static_cast<btDbvtBroadphase*>(mBroadphase)->m_rayTestStacks.size() <= 1)
+                std::cerr << "Warning: Bullet was not compiled with multithreading support, the physics simulation will run on the main thread" << std::endl;
+            else
+                mSimulationQueue = new SceneUtil::WorkQueue(1);
+        }
     }
 
     PhysicsSystem::~PhysicsSystem()
     {
+        if (mSimulation)
+            mSimulation->waitTillDone();
+        mSimulation = NULL;
+        mSimulationQueue = NULL;
+        mSolverQueue = NULL;
+
         mResourceSystem->removeResourceManager(mShapeManager.get());
 
         if (mWaterCollisionObject.get())
@@ -739,6 +914,8 @@ namespace MWPhysics
 
     bool PhysicsSystem::toggleDebugRendering()
     {
+        finishSimulation();
+
         mDebugDrawEnabled = !mDebugDrawEnabled;
 
         if (mDebugDrawEnabled && !mDebugDrawer.get())
@@ -938,44 +1115,69 @@ namespace MWPhysics
         const std::vector<const btCollisionObject*> mTargets;
     };
 
-    PhysicsSystem::RayResult PhysicsSystem::castRay(const osg::Vec3f &from, const osg::Vec3f &to, const MWWorld::ConstPtr& ignore, std::vector<MWWorld::Ptr> targets, int mask, int group) const
+    class ClosestNotMeSweepResultCallback : public btCollisionWorld::ClosestConvexResultCallback
     {
-        btVector3 btFrom = toBullet(from);
-        btVector3 btTo = toBullet(to);
-
-        const btCollisionObject* me = NULL;
-        std::vector<const btCollisionObject*> targetCollisionObjects;
+    public:
+        ClosestNotMeSweepResultCallback(const btCollisionObject* me, const btVector3& from, const btVector3& to)
+            : btCollisionWorld::ClosestConvexResultCallback(from, to)
+            , mMe(me)
+        {
+        }
 
-        if (!ignore.isEmpty())
+        virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
         {
-            const Actor* actor = getActor(ignore);
-            if (actor)
-                me = actor->getCollisionObject();
-            else
-            {
-                const Object* object = getObject(ignore);
-                if (object)
-                    me = object->getCollisionObject();
-            }
+            if (convexResult.m_hitCollisionObject == mMe)
+                return 1.f;
+            return btCollisionWorld::ClosestConvexResultCallback::addSingleResult(convexResult, normalInWorldSpace);
         }
+    private:
+        const btCollisionObject* mMe;
+    };
 
-        if (!targets.empty())
+    /// A ray or sphere sweep query with its Ptrs resolved to collision objects, so that it can run on any thread
+    struct ResolvedRayQuery
+    {
+        btVector3 mFrom;
+        btVector3 mTo;
+        const btCollisionObject* mMe;
+        /// Actors to filter for, only used for rays
+        std::vector<const btCollisionObject*> mTargets;
+        float mRadius;
+        int mMask;
+        int mGroup;
+    };
+
+    static PhysicsSystem::RayResult runRayQuery(const ResolvedRayQuery& query, const btCollisionWorld* collisionWorld)
+    {
+        PhysicsSystem::RayResult result;
+
+        if (query.mRadius > 0.f)
         {
-            for (std::vector<MWWorld::Ptr>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+            ClosestNotMeSweepResultCallback callback(query.mMe, query.mFrom, query.mTo);
+            callback.m_collisionFilterGroup = query.mGroup;
+            callback.m_collisionFilterMask = query.mMask;
+
+            btSphereShape shape(query.mRadius);
+            const btQuaternion btrot = btQuaternion::getIdentity();
+            collisionWorld->convexSweepTest(&shape, btTransform(btrot, query.mFrom), btTransform(btrot, query.mTo), callback);
+
+            result.mHit = callback.hasHit();
+            if (result.mHit)
             {
-                const Actor* actor = getActor(*it);
-                if (actor)
-                    targetCollisionObjects.push_back(actor->getCollisionObject());
+                result.mHitPos = toOsg(callback.m_hitPointWorld);
+                result.mHitNormal = toOsg(callback.m_hitNormalWorld);
+                if (PtrHolder* ptrHolder = static_cast<PtrHolder*>(callback.m_hitCollisionObject->getUserPointer()))
+                    result.mHitObject = ptrHolder->getPtr();
             }
+            return result;
         }
 
-        ClosestNotMeRayResultCallback resultCallback(me, targetCollisionObjects, btFrom, btTo);
-        resultCallback.m_collisionFilterGroup = group;
-        resultCallback.m_collisionFilterMask = mask;
+        ClosestNotMeRayResultCallback resultCallback(query.mMe, query.mTargets, query.mFrom, query.mTo);
+        resultCallback.m_collisionFilterGroup = query.mGroup;
+        resultCallback.m_collisionFilterMask = query.mMask;
 
-        mCollisionWorld->rayTest(btFrom, btTo, resultCallback);
+        collisionWorld->rayTest(query.mFrom, query.mTo, resultCallback);
 
-        RayResult result;
         result.mHit = resultCallback.hasHit();
         if (resultCallback.hasHit())
         {
@@ -987,6 +1189,114 @@ namespace MWPhysics
         return result;
     }
 
+    /// Runs every n-th query of a batch, starting with the given one
+    class RayQueryWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        RayQueryWorkItem(const std::vector<ResolvedRayQuery>& queries, std::vector<PhysicsSystem::RayResult>& results,
+                         size_t first, size_t stride, const btCollisionWorld* collisionWorld)
+            : mQueries(queries)
+            , mResults(results)
+            , mFirst(first)
+            , mStride(stride)
+            , mCollisionWorld(collisionWorld)
+        {
+        }
+
+        virtual void doWork()
+        {
+            for (size_t i=mFirst; i<mQueries.size(); i+=mStride)
+                mResults[i] = runRayQuery(mQueries[i], mCollisionWorld);
+        }
+
+    private:
+        const std::vector<ResolvedRayQuery>& mQueries;
+        std::vector<PhysicsSystem::RayResult>& mResults;
+        size_t mFirst;
+        size_t mStride;
+        const btCollisionWorld* mCollisionWorld;
+    };
+
+    /// Below this many queries per thread, handing a batch to the solver threads costs more than it saves
+    static const size_t sMinRayQueriesPerThread = 8;
+
+    static void runRayQueries(const std::vector<ResolvedRayQuery>& queries, std::vector<PhysicsSystem::RayResult>& results,
+                              const btCollisionWorld* collisionWorld, SceneUtil::WorkQueue* solverQueue, int numSolverThreads)
+    {
+        results.resize(queries.size());
+
+        const size_t numItems = solverQueue ? std::min(static_cast<size_t>(numSolverThreads), queries.size() / sMinRayQueriesPerThread) : 0;
+        if (numItems < 2)
+        {
+            for (size_t i=0; i<queries.size(); ++i)
+                results[i] = runRayQuery(queries[i], collisionWorld);
+            return;
+        }
+
+        std::vector<osg::ref_ptr<SceneUtil::WorkItem> > items;
+        for (size_t i=0; i<numItems; ++i)
+        {
+            items.push_back(new RayQueryWorkItem(queries, results, i, numItems, collisionWorld));
+            solverQueue->addWorkItem(items.back());
+        }
+        for (size_t i=0; i<items.size(); ++i)
+            items[i]->waitTillDone();
+    }
+
+    const btCollisionObject* PhysicsSystem::getCollisionObject(const MWWorld::ConstPtr& ptr) const
+    {
+        if (const Actor* actor = getActor(ptr))
+            return actor->getCollisionObject();
+        if (const Object* object = getObject(ptr))
+            return object->getCollisionObject();
+        return NULL;
+    }
+
+    PhysicsSystem::RayResult PhysicsSystem::castRay(const osg::Vec3f &from, const osg::Vec3f &to, const MWWorld::ConstPtr& ignore, std::vector<MWWorld::Ptr> targets, int mask, int group) const
+    {
+        ResolvedRayQuery query;
+        query.mFrom = toBullet(from);
+        query.mTo = toBullet(to);
+        query.mMe = ignore.isEmpty() ? NULL : getCollisionObject(ignore);
+        query.mRadius = 0.f;
+        query.mMask = mask;
+        query.mGroup = group;
+
+        for (std::vector<MWWorld::Ptr>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+        {
+            const Actor* actor = getActor(*it);
+            if (actor)
+                query.mTargets.push_back(actor->getCollisionObject());
+        }
+
+        return runRayQuery(query, mCollisionWorld);
+    }
+
+    PhysicsSystem::RayQuery::RayQuery()
+        : mRadius(0.f)
+        , mMask(CollisionType_World|CollisionType_HeightMap|CollisionType_Actor|CollisionType_Door)
+        , mGroup(0xff)
+    {
+    }
+
+    void PhysicsSystem::castRays(const std::vector<RayQuery>& queries, std::vector<RayResult>& results) const
+    {
+        // Look up the collision objects here, the queries themselves only read the collision world
+        std::vector<ResolvedRayQuery> resolved(queries.size());
+        for (size_t i=0; i<queries.size(); ++i)
+        {
+            const RayQuery& query = queries[i];
+            resolved[i].mFrom = toBullet(query.mFrom);
+            resolved[i].mTo = toBullet(query.mTo);
+            resolved[i].mMe = query.mIgnore.isEmpty() ? NULL : getCollisionObject(query.mIgnore);
+            resolved[i].mRadius = query.mRadius;
+            resolved[i].mMask = query.mMask;
+            resolved[i].mGroup = query.mGroup;
+        }
+
+        runRayQueries(resolved, results, mCollisionWorld, mSolverQueue.get(), mNumSolverThreads);
+    }
+
     PhysicsSystem::RayResult PhysicsSystem::castSphere(const osg::Vec3f &from, const osg::Vec3f &to, float radius)
     {
         btCollisionWorld::ClosestConvexResultCallback callback(toBullet(from), toBullet(to));
@@ -1027,6 +1337,39 @@ namespace MWPhysics
         return !result.mHit;
     }
 
+    void PhysicsSystem::getLinesOfSight(const std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> >& actorPairs, std::vector<bool>& results) const
+    {
+        std::vector<RayQuery> queries;
+        std::vector<size_t> queryIndices; // index of the query for each pair, or -1 if one of the actors has no collision
+        queries.reserve(actorPairs.size());
+        queryIndices.reserve(actorPairs.size());
+
+        for (std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> >::const_iterator it = actorPairs.begin(); it != actorPairs.end(); ++it)
+        {
+            const Actor* physactor1 = getActor(it->first);
+            const Actor* physactor2 = getActor(it->second);
+            if (!physactor1 || !physactor2)
+            {
+                queryIndices.push_back(static_cast<size_t>(-1));
+                continue;
+            }
+
+            RayQuery query;
+            query.mFrom = physactor1->getCollisionObjectPosition() + osg::Vec3f(0,0,physactor1->getHalfExtents().z() * 0.9); // eye level
+            query.mTo = physactor2->getCollisionObjectPosition() + osg::Vec3f(0,0,physactor2->getHalfExtents().z() * 0.9);
+            query.mMask = CollisionType_World|CollisionType_HeightMap|CollisionType_Door;
+            queryIndices.push_back(queries.size());
+            queries.push_back(query);
+        }
+
+        std::vector<RayResult> rayResults;
+        castRays(queries, rayResults);
+
+        results.resize(actorPairs.size());
+        for (size_t i=0; i<actorPairs.size(); ++i)
+            results[i] = queryIndices[i] != static_cast<size_t>(-1) && !rayResults[queryIndices[i]].mHit;
+    }
+
     bool PhysicsSystem::isOnGround(const MWWorld::Ptr &actor)
     {
         Actor* physactor = getActor(actor);
@@ -1119,6 +1462,8 @@ namespace MWPhysics
 
     osg::Vec3f PhysicsSystem::traceDown(const MWWorld::Ptr &ptr, const osg::Vec3f& position, float maxHeight)
     {
+        finishSimulation();
+
         ActorMap::iterator found = mActors.find(ptr);
         if (found ==  mActors.end())
             return ptr.getRefData().getPosition().asVec3();
@@ -1128,6 +1473,8 @@ namespace MWPhysics
 
     void PhysicsSystem::addHeightField (const float* heights, int x, int y, float triSize, float sqrtVerts, float minH, float maxH, const osg::Object* holdObject)
     {
+        finishSimulation();
+
         HeightField *heightfield = new HeightField(heights, x, y, triSize, sqrtVerts, minH, maxH, holdObject);
         mHeightFields[std::make_pair(x,y)] = heightfield;
 
@@ -1137,6 +1484,8 @@ namespace MWPhysics
 
     void PhysicsSystem::removeHeightField (int x, int y)
     {
+        finishSimulation();
+
         HeightFieldMap::iterator heightfield = mHeightFields.find(std::make_pair(x,y));
         if(heightfield != mHeightFields.end())
         {
@@ -1148,6 +1497,8 @@ namespace MWPhysics
 
     void PhysicsSystem::addObject (const MWWorld::Ptr& ptr, const std::string& mesh, int collisionType)
     {
+        finishSimulation();
+
         osg::ref_ptr<Resource::BulletShapeInstance> shapeInstance = mShapeManager->getInstance(mesh);
         if (!shapeInstance || !shapeInstance->getCollisionShape())
             return;
@@ -1164,6 +1515,8 @@ namespace MWPhysics
 
     void PhysicsSystem::remove(const MWWorld::Ptr &ptr)
     {
+        finishSimulation();
+
         ObjectMap::iterator found = mObjects.find(ptr);
         if (found != mObjects.end())
         {
@@ -1184,6 +1537,20 @@ namespace MWPhysics
             delete foundActor->second;
             mActors.erase(foundActor);
         }
+
+        // Results of an earlier simulation that were not picked up yet
+        discardMovementResults(ptr);
+    }
+
+    void PhysicsSystem::discardMovementResults(const MWWorld::Ptr &ptr)
+    {
+        for (PtrVelocityList::iterator it = mMovementResults.begin(); it != mMovementResults.end(); )
+        {
+            if (it->first == ptr)
+                it = mMovementResults.erase(it);
+            else
+                ++it;
+        }
     }
 
     void PhysicsSystem::updateCollisionMapPtr(CollisionMap& map, const MWWorld::Ptr &old, const MWWorld::Ptr &updated)
@@ -1204,6 +1571,8 @@ namespace MWPhysics
 
     void PhysicsSystem::updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &updated)
     {
+        finishSimulation();
+
         ObjectMap::iterator found = mObjects.find(old);
         if (found != mObjects.end())
         {
@@ -1223,10 +1592,18 @@ namespace MWPhysics
         }
 
         updateCollisionMapPtr(mStandingCollisions, old, updated);
+
+        for (PtrVelocityList::iterator it = mMovementResults.begin(); it != mMovementResults.end(); ++it)
+        {
+            if (it->first == old)
+                it->first = updated;
+        }
     }
 
     Actor *PhysicsSystem::getActor(const MWWorld::Ptr &ptr)
     {
+        finishSimulation();
+
         ActorMap::iterator found = mActors.find(ptr);
         if (found != mActors.end())
             return found->second;
@@ -1251,6 +1628,8 @@ namespace MWPhysics
 
     void PhysicsSystem::updateScale(const MWWorld::Ptr &ptr)
     {
+        finishSimulation();
+
         ObjectMap::iterator found = mObjects.find(ptr);
         if (found != mObjects.end())
         {
@@ -1270,6 +1649,8 @@ namespace MWPhysics
 
     void PhysicsSystem::updateRotation(const MWWorld::Ptr &ptr)
     {
+        finishSimulation();
+
         ObjectMap::iterator found = mObjects.find(ptr);
         if (found != mObjects.end())
         {
@@ -1291,6 +1672,11 @@ namespace MWPhysics
 
     void PhysicsSystem::updatePosition(const MWWorld::Ptr &ptr)
     {
+        finishSimulation();
+
+        // The result of the simulation was solved from the old position, World::doPhysics would move the Ptr back
+        discardMovementResults(ptr);
+
         ObjectMap::iterator found = mObjects.find(ptr);
         if (found != mObjects.end())
         {
@@ -1308,6 +1694,8 @@ namespace MWPhysics
     }
 
     void PhysicsSystem::addActor (const MWWorld::Ptr& ptr, const std::string& mesh) {
+        finishSimulation();
+
         osg::ref_ptr<const Resource::BulletShape> shape = mShapeManager->getShape(mesh);
         if (!shape)
             return;
@@ -1318,6 +1706,8 @@ namespace MWPhysics
 
     bool PhysicsSystem::toggleCollisionMode()
     {
+        finishSimulation();
+
         ActorMap::iterator found = mActors.find(MWMechanics::getPlayer());
         if (found != mActors.end())
         {
@@ -1348,22 +1738,37 @@ namespace MWPhysics
 
     void PhysicsSystem::clearQueuedMovement()
     {
+        finishSimulation();
+
         mMovementQueue.clear();
+        mMovementResults.clear();
         mStandingCollisions.clear();
     }
 
     const PtrVelocityList& PhysicsSystem::applyQueuedMovement(float dt)
     {
-        mMovementResults.clear();
+        if (mSimulationQueue)
+        {
+            // The results of the simulation started in the previous frame
+            finishSimulation();
+        }
+        else
+            mMovementResults.clear();
 
         mTimeAccum += dt;
-        const float physicsDt = 1.f/60.0f;
 
         const int maxAllowedSteps = 20;
-        int numSteps = mTimeAccum / (physicsDt);
+        int numSteps = mTimeAccum / (sPhysicsDt);
         numSteps = std::min(numSteps, maxAllowedSteps);
 
-        mTimeAccum -= numSteps * physicsDt;
+        mTimeAccum -= numSteps * sPhysicsDt;
+
+        if (mSimulationQueue)
+        {
+            // The queued movement is solved by startSimulation
+            mNumPendingSteps = numSteps;
+            return mMovementResults;
+        }
 
         if (numSteps)
         {
@@ -1371,7 +1776,72 @@ namespace MWPhysics
             mStandingCollisions.clear();
         }
 
+        std::vector<ActorFrameData> frameData;
+        prepareFrameData(frameData, numSteps);
+        const WorldFrameData worldData = prepareWorldFrameData();
+        const float interpolationFactor = mTimeAccum / sPhysicsDt;
+
+        if (mSolverQueue)
+        {
+            solveMovements(frameData, numSteps, sPhysicsDt, worldData, mCollisionWorld, mSolverQueue, mNumSolverThreads);
+            for (size_t i=0; i<frameData.size(); ++i)
+                applyMovement(frameData[i], numSteps, interpolationFactor);
+        }
+        else
+        {
+            // Actors that move later see the new positions of the actors that moved earlier
+            for (size_t i=0; i<frameData.size(); ++i)
+            {
+                solveMovement(frameData[i], numSteps, sPhysicsDt, worldData, mCollisionWorld);
+                applyMovement(frameData[i], numSteps, interpolationFactor);
+            }
+        }
+
+        return mMovementResults;
+    }
+
+    void PhysicsSystem::startSimulation()
+    {
+        if (!mSimulationQueue)
+            return;
+
+        finishSimulation();
+
+        mMovementResults.clear();
+
+        osg::ref_ptr<SimulationWorkItem> simulation (new SimulationWorkItem(mNumPendingSteps, sPhysicsDt, mTimeAccum / sPhysicsDt,
+                                                                            mCollisionWorld, mSolverQueue, mNumSolverThreads));
+        prepareFrameData(simulation->mFrameData, mNumPendingSteps);
+        simulation->mWorldData = prepareWorldFrameData();
+        mNumPendingSteps = 0;
+
+        mSimulation = simulation;
+        mSimulationQueue->addWorkItem(mSimulation);
+    }
+
+    void PhysicsSystem::finishSimulation()
+    {
+        if (!mSimulation)
+            return;
+
+        osg::ref_ptr<SimulationWorkItem> simulation = mSimulation;
+        mSimulation = NULL;
+        simulation->waitTillDone();
+
+        if (simulation->mNumSteps)
+        {
+            // Collision events should be available on every frame
+            mStandingCollisions.clear();
+        }
+
+        for (size_t i=0; i<simulation->mFrameData.size(); ++i)
+            applyMovement(simulation->mFrameData[i], simulation->mNumSteps, simulation->mInterpolationFactor);
+    }
+
+    void PhysicsSystem::prepareFrameData(std::vector<ActorFrameData>& frameData, int numSteps)
+    {
         const MWBase::World *world = MWBase::Environment::get().getWorld();
+        frameData.reserve(mMovementQueue.size());
         PtrVelocityList::iterator iter = mMovementQueue.begin();
         for(;iter != mMovementQueue.end();++iter)
         {
@@ -1379,20 +1849,22 @@ namespace MWPhysics
             if (foundActor == mActors.end()) // actor was already removed from the scene
                 continue;
             Actor* physicActor = foundActor->second;
+            const MWWorld::Ptr ptr = physicActor->getPtr();
 
             float waterlevel = -std::numeric_limits<float>::max();
-            const MWWorld::CellStore *cell = iter->first.getCell();
+            const MWWorld::CellStore *cell = ptr.getCell();
             if(cell->getCell()->hasWater())
                 waterlevel = cell->getWaterLevel();
 
-            const MWMechanics::MagicEffects& effects = iter->first.getClass().getCreatureStats(iter->first).getMagicEffects();
+            const MWMechanics::CreatureStats& stats = ptr.getClass().getCreatureStats(ptr);
+            const MWMechanics::MagicEffects& effects = stats.getMagicEffects();
 
             bool waterCollision = false;
             if (cell->getCell()->hasWater() && effects.get(ESM::MagicEffect::WaterWalking).getMagnitude())
             {
-                if (!world->isUnderwater(iter->first.getCell(), osg::Vec3f(iter->first.getRefData().getPosition().asVec3())))
+                if (!world->isUnderwater(ptr.getCell(), osg::Vec3f(ptr.getRefData().getPosition().asVec3())))
                     waterCollision = true;
-                else if (physicActor->getCollisionMode() && canMoveToWaterSurface(iter->first, waterlevel))
+                else if (physicActor->getCollisionMode() && canMoveToWaterSurface(ptr, waterlevel))
                 {
                     const osg::Vec3f actorPosition = physicActor->getPosition();
                     physicActor->setPosition(osg::Vec3f(actorPosition.x(), actorPosition.y(), waterlevel));
@@ -1401,42 +1873,88 @@ namespace MWPhysics
             }
             physicActor->setCanWaterWalk(waterCollision);
 
+            ActorFrameData data;
+            data.mPtr = ptr;
+            data.mActor = physicActor;
+            data.mMovement = iter->second;
+            data.mRefPosition = ptr.getRefData().getPosition();
+            data.mWaterlevel = waterlevel;
             // Slow fall reduces fall speed by a factor of (effect magnitude / 200)
-            float slowFall = 1.f - std::max(0.f, std::min(1.f, effects.get(ESM::MagicEffect::SlowFall).getMagnitude() * 0.005f));
+            data.mSlowFall = 1.f - std::max(0.f, std::min(1.f, effects.get(ESM::MagicEffect::SlowFall).getMagnitude() * 0.005f));
+            data.mIsFlying = world->isFlying(ptr);
+            data.mIsMobile = ptr.getClass().isMobile(ptr);
+            data.mIsDead = stats.isDead();
+            data.mIsPureWaterCreature = ptr.getClass().isPureWaterCreature(ptr);
+            data.mCollisionMode = physicActor->getCollisionMode();
+            data.mInertia = physicActor->getInertialForce();
+            data.mOnGround = physicActor->getOnGround();
+            data.mOnSlope = physicActor->getOnSlope();
+            data.mWalkingOnWater = physicActor->isWalkingOnWater();
+            data.mPosition = physicActor->getPosition();
+            data.mPreviousPosition = data.mPosition;
+            data.mPositionChanged = false;
+            frameData.push_back(data);
+
+            if (numSteps && data.mIsMobile && data.mCollisionMode)
+                ptr.getClass().getMovementSettings(ptr).mPosition[2] = 0;
+        }
 
-            osg::Vec3f position = physicActor->getPosition();
-            float oldHeight = position.z();
-            bool positionChanged = false;
-            for (int i=0; i<numSteps; ++i)
+        mMovementQueue.clear();
+    }
+
+    WorldFrameData PhysicsSystem::prepareWorldFrameData() const
+    {
+        const MWBase::World *world = MWBase::Environment::get().getWorld();
+        static const float fSwimHeightScale = world->getStore().get<ESM::GameSetting>().find("fSwimHeightScale")->getFloat();
+        static const float fStromWalkMult = world->getStore().get<ESM::GameSetting>().find("fStromWalkMult")->getFloat();
+
+        WorldFrameData data;
+        data.mIsInStorm = world->isInStorm();
+        data.mStormDirection = world->getStormDirection();
+        data.mSwimHeightScale = fSwimHeightScale;
+        data.mStormWalkMult = fStromWalkMult;
+        return data;
+    }
+
+    void PhysicsSystem::applyMovement(const ActorFrameData& data, int numSteps, float interpolationFactor)
+    {
+        Actor* physicActor = data.mActor;
+        const float oldHeight = physicActor->getPosition().z();
+        if (numSteps)
+        {
+            if (data.mIsMobile)
+                physicActor->setWalkingOnWater(data.mWalkingOnWater);
+            if (data.mIsMobile && data.mCollisionMode)
             {
-                position = MovementSolver::move(position, physicActor->getPtr(), physicActor, iter->second, physicsDt,
-                                                world->isFlying(iter->first),
-                                                waterlevel, slowFall, mCollisionWorld, mStandingCollisions);
-                if (position != physicActor->getPosition())
-                    positionChanged = true;
-                physicActor->setPosition(position); // always set even if unchanged to make sure interpolation is correct
+                physicActor->setInertialForce(data.mInertia);
+                physicActor->setOnGround(data.mOnGround);
+                physicActor->setOnSlope(data.mOnSlope);
             }
-            if (positionChanged)
-                mCollisionWorld->updateSingleAabb(physicActor->getCollisionObject());
 
-            float interpolationFactor = mTimeAccum / physicsDt;
-            osg::Vec3f interpolated = position * interpolationFactor + physicActor->getPreviousPosition() * (1.f - interpolationFactor);
+            // Always set even if unchanged to make sure interpolation is correct
+            physicActor->setPosition(data.mPreviousPosition);
+            physicActor->setPosition(data.mPosition);
+        }
+        if (data.mPositionChanged)
+            mCollisionWorld->updateSingleAabb(physicActor->getCollisionObject());
 
-            float heightDiff = position.z() - oldHeight;
+        if (!data.mStandingOn.isEmpty())
+            mStandingCollisions[data.mPtr] = data.mStandingOn;
 
-            if (heightDiff < 0)
-                iter->first.getClass().getCreatureStats(iter->first).addToFallHeight(-heightDiff);
+        osg::Vec3f interpolated = physicActor->getPosition() * interpolationFactor + physicActor->getPreviousPosition() * (1.f - interpolationFactor);
 
-            mMovementResults.push_back(std::make_pair(iter->first, interpolated));
-        }
+        float heightDiff = physicActor->getPosition().z() - oldHeight;
 
-        mMovementQueue.clear();
+        if (heightDiff < 0)
+            data.mPtr.getClass().getCreatureStats(data.mPtr).addToFallHeight(-heightDiff);
 
-        return mMovementResults;
+        mMovementResults.push_back(std::make_pair(data.mPtr, interpolated));
     }
 
     void PhysicsSystem::stepSimulation(float dt)
     {
+        finishSimulation();
+
         for (std::set<Object*>::iterator it = mAnimatedObjects.begin(); it != mAnimatedObjects.end(); ++it)
             (*it)->animateCollisionShapes(mCollisionWorld);
 
@@ -1485,6 +2003,8 @@ namespace MWPhysics
 
     void PhysicsSystem::disableWater()
     {
+        finishSimulation();
+
         if (mWaterEnabled)
         {
             mWaterEnabled = false;
@@ -1494,6 +2014,8 @@ namespace MWPhysics
 
     void PhysicsSystem::enableWater(float height)
     {
+        finishSimulation();
+
         if (!mWaterEnabled || mWaterHeight != height)
         {
             mWaterEnabled = true;
@@ -1504,6 +2026,8 @@ namespace MWPhysics
 
     void PhysicsSystem::setWaterHeight(float height)
     {
+        finishSimulation();
+
         if (mWaterHeight != height)
         {
             mWaterHeight = height;
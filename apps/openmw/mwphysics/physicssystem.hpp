@@ -32,6 +32,7 @@ namespace Resource
 namespace SceneUtil
 {
     class UnrefQueue;
+    class WorkQueue;
 }
 
 class btCollisionWorld;
@@ -48,6 +49,9 @@ namespace MWPhysics
     class HeightField;
     class Object;
     class Actor;
+    class SimulationWorkItem;
+    struct ActorFrameData;
+    struct WorldFrameData;
 
     class PhysicsSystem
     {
@@ -78,6 +82,8 @@ namespace MWPhysics
 
             void updateScale (const MWWorld::Ptr& ptr);
             void updateRotation (const MWWorld::Ptr& ptr);
+            /// Move the collision object to the position of the Ptr, e.g. after SetPos or a teleport.
+            /// @note Discards the result of a simulation that was started before the move, so it does not undo it.
             void updatePosition (const MWWorld::Ptr& ptr);
 
 
@@ -123,6 +129,28 @@ namespace MWPhysics
             /// Return true if actor1 can see actor2.
             bool getLineOfSight(const MWWorld::ConstPtr& actor1, const MWWorld::ConstPtr& actor2) const;
 
+            struct RayQuery
+            {
+                RayQuery();
+
+                osg::Vec3f mFrom;
+                osg::Vec3f mTo;
+                /// Optional, a Ptr to ignore in the list of results.
+                MWWorld::ConstPtr mIgnore;
+                /// If greater than zero, sweep a sphere of this radius instead of casting a ray.
+                float mRadius;
+                int mMask;
+                int mGroup;
+            };
+
+            /// Run a batch of ray casts and sphere sweeps, spread over the solver threads if there are any.
+            /// @param results Receives one result for each query, in the same order.
+            void castRays(const std::vector<RayQuery>& queries, std::vector<RayResult>& results) const;
+
+            /// Batch version of getLineOfSight().
+            /// @param results Receives for each pair whether the first actor can see the second one.
+            void getLinesOfSight(const std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> >& actorPairs, std::vector<bool>& results) const;
+
             bool isOnGround (const MWWorld::Ptr& actor);
 
             bool canMoveToWaterSurface (const MWWorld::ConstPtr &actor, const float waterlevel);
@@ -142,8 +170,16 @@ namespace MWPhysics
             void queueObjectMovement(const MWWorld::Ptr &ptr, const osg::Vec3f &velocity);
 
             /// Apply all queued movements, then clear the list.
+            /// @note With the [Physics] "solver threads" setting, the movements of the actors are solved in parallel.
+            /// @note With the [Physics] "async simulation" setting, the queued movements are solved by startSimulation instead,
+            /// and the returned results are the ones of the simulation started in the previous frame.
             const PtrVelocityList& applyQueuedMovement(float dt);
 
+            /// Solve the movements queued in this frame on a background thread, if the [Physics] "async simulation" setting is enabled.
+            /// Should be called once the frame's game logic is done, the simulation then runs while the frame is rendered.
+            /// @note Functions that change the collision world or the actors wait for the simulation to finish and apply its results first.
+            void startSimulation();
+
             /// Clear the queued movements list without applying.
             void clearQueuedMovement();
 
@@ -174,6 +210,22 @@ namespace MWPhysics
 
             void updateWater();
 
+            /// Get the collision object of an actor or object, or NULL if it has none
+            const btCollisionObject* getCollisionObject(const MWWorld::ConstPtr& ptr) const;
+
+            /// Consume the movement queue
+            void prepareFrameData(std::vector<ActorFrameData>& frameData, int numSteps);
+            WorldFrameData prepareWorldFrameData() const;
+
+            /// Move the actor to its solved position and add it to the movement results
+            void applyMovement(const ActorFrameData& data, int numSteps, float interpolationFactor);
+
+            /// Wait for the simulation started by startSimulation, if any, and apply its results
+            void finishSimulation();
+
+            /// Remove the Ptr from the results of the last simulation
+            void discardMovementResults(const MWWorld::Ptr& ptr);
+
             osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
 
             btBroadphaseInterface* mBroadphase;
@@ -210,6 +262,15 @@ namespace MWPhysics
 
             float mTimeAccum;
 
+            /// Worker threads for solving the actor movement, NULL to solve on the main thread
+            osg::ref_ptr<SceneUtil::WorkQueue> mSolverQueue;
+            int mNumSolverThreads;
+
+            /// Thread for the async simulation, NULL to simulate on the main thread
+            osg::ref_ptr<SceneUtil::WorkQueue> mSimulationQueue;
+            osg::ref_ptr<SimulationWorkItem> mSimulation;
+            int mNumPendingSteps;
+
             float mWaterHeight;
             bool mWaterEnabled;
 
@@ -266,6 +266,7 @@ namespace MWRender
         mHeight = mCellSize*(mMaxY-mMinY+1);
 
         mWorkItem = new CreateMapWorkItem(mWidth, mHeight, mMinX, mMinY, mMaxX, mMaxY, mCellSize, esmStore.get<ESM::Land>());
+        // Default priority, the map is waited for as soon as the player explores a cell (see ensureLoaded())
         mWorkQueue->addWorkItem(mWorkItem);
     }
 
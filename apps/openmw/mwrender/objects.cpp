@@ -5,11 +5,19 @@
 #include <osg/Group>
 #include <osg/UserDataContainer>
 
+#include <components/esm/loadstat.hpp>
+
+#include <components/resource/resourcesystem.hpp>
+#include <components/resource/scenemanager.hpp>
+
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
+#include <components/sceneutil/instancing.hpp>
+#include <components/sceneutil/lightmanager.hpp>
 
 #include "../mwworld/ptr.hpp"
 #include "../mwworld/class.hpp"
+#include "../mwworld/cellstore.hpp"
 
 #include "animation.hpp"
 #include "npcanimation.hpp"
@@ -21,7 +29,8 @@ namespace MWRender
 {
 
 Objects::Objects(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> rootNode, SceneUtil::UnrefQueue* unrefQueue)
-    : mRootNode(rootNode)
+    : mInstancing(false)
+    , mRootNode(rootNode)
     , mResourceSystem(resourceSystem)
     , mUnrefQueue(unrefQueue)
 {
@@ -30,6 +39,8 @@ Objects::Objects(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Gro
 Objects::~Objects()
 {
     mObjects.clear();
+    mInstances.clear();
+    mBatches.clear();
 
     for (CellMap::iterator iter = mCellSceneNodes.begin(); iter != mCellSceneNodes.end(); ++iter)
         iter->second->getParent(0)->removeChild(iter->second);
@@ -68,15 +79,77 @@ void Objects::insertBegin(const MWWorld::Ptr& ptr)
     ptr.getRefData().setBaseNode(insert);
 }
 
+void Objects::setInstancing(bool instancing)
+{
+    mInstancing = instancing;
+}
+
 void Objects::insertModel(const MWWorld::Ptr &ptr, const std::string &mesh, bool animated, bool allowLight)
 {
     insertBegin(ptr);
 
     osg::ref_ptr<ObjectAnimation> anim (new ObjectAnimation(ptr, mesh, mResourceSystem, animated, allowLight));
 
+    // Interiors are left out, their objects are lit by too many different lights to share a light list
+    if (mInstancing && !animated && ptr.getTypeName() == typeid(ESM::Static).name() && ptr.getCell()->getCell()->isExterior())
+        insertInstance(ptr, mesh);
+
     mObjects.insert(std::make_pair(ptr, anim));
 }
 
+void Objects::insertInstance(const MWWorld::Ptr &ptr, const std::string &mesh)
+{
+    osg::ref_ptr<const osg::Node> templateNode = mResourceSystem->getSceneManager()->getTemplate(mesh);
+    if (!SceneUtil::canInstance(*templateNode, ~Mask_UpdateVisitor))
+        return;
+
+    osg::ref_ptr<SceneUtil::InstanceBatch>& batch = mBatches[std::make_pair(ptr.getCell(), templateNode.get())];
+    if (!batch)
+    {
+        batch = new SceneUtil::InstanceBatch(templateNode, ~Mask_UpdateVisitor);
+        mResourceSystem->getSceneManager()->recreateShaders(batch, true);
+        // The batch is lit as a whole
+        batch->addCullCallback(new SceneUtil::LightListCallback);
+        mCellSceneNodes[ptr.getCell()]->addChild(batch);
+    }
+
+    SceneUtil::PositionAttitudeTransform* baseNode = ptr.getRefData().getBaseNode();
+    osg::Matrix matrix;
+    baseNode->computeLocalToWorldMatrix(matrix, NULL);
+    batch->addInstance(baseNode, matrix);
+
+    Instance& instance = mInstances[baseNode];
+    instance.mBatch = batch;
+    instance.mNodeMask = baseNode->getNodeMask();
+
+    // Keep the object itself for intersection tests, but do not draw it
+    baseNode->setNodeMask(Mask_Instanced);
+}
+
+void Objects::removeInstance(const MWWorld::Ptr &ptr)
+{
+    osg::Node* baseNode = ptr.getRefData().getBaseNode();
+    InstanceMap::iterator found = mInstances.find(baseNode);
+    if (found == mInstances.end())
+        return;
+
+    found->second.mBatch->removeInstance(baseNode);
+    baseNode->setNodeMask(found->second.mNodeMask);
+    mInstances.erase(found);
+}
+
+void Objects::updateTransform(const MWWorld::Ptr &ptr)
+{
+    SceneUtil::PositionAttitudeTransform* baseNode = ptr.getRefData().getBaseNode();
+    InstanceMap::iterator found = mInstances.find(baseNode);
+    if (found == mInstances.end())
+        return;
+
+    osg::Matrix matrix;
+    baseNode->computeLocalToWorldMatrix(matrix, NULL);
+    found->second.mBatch->updateInstance(baseNode, matrix);
+}
+
 void Objects::insertCreature(const MWWorld::Ptr &ptr, const std::string &mesh, bool weaponsShields)
 {
     insertBegin(ptr);
@@ -121,6 +194,8 @@ bool Objects::removeObject (const MWWorld::Ptr& ptr)
 
         mObjects.erase(iter);
 
+        removeInstance(ptr);
+
         if (ptr.getClass().isNpc())
         {
             MWWorld::InventoryStore& store = ptr.getClass().getInventoryStore(ptr);
@@ -147,6 +222,8 @@ void Objects::removeCell(const MWWorld::CellStore* store)
             if (mUnrefQueue.get())
                 mUnrefQueue->push(iter->second);
 
+            mInstances.erase(ptr.getRefData().getBaseNode());
+
             if (ptr.getClass().isNpc() && ptr.getRefData().getCustomData())
             {
                 MWWorld::InventoryStore& invStore = ptr.getClass().getInventoryStore(ptr);
@@ -160,6 +237,15 @@ void Objects::removeCell(const MWWorld::CellStore* store)
             ++iter;
     }
 
+    // The batches are removed along with the cell node
+    for (BatchMap::iterator batch = mBatches.begin(); batch != mBatches.end();)
+    {
+        if (batch->first.first == store)
+            mBatches.erase(batch++);
+        else
+            ++batch;
+    }
+
     CellMap::iterator cell = mCellSceneNodes.find(store);
     if(cell != mCellSceneNodes.end())
     {
@@ -176,6 +262,9 @@ void Objects::updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur)
     if (!objectNode)
         return;
 
+    // Draw the object by itself from now on, the batch belongs to the old cell
+    removeInstance(cur);
+
     MWWorld::CellStore *newCell = cur.getCell();
 
     osg::Group* cellnode;
@@ -13,6 +13,7 @@
 namespace osg
 {
     class Group;
+    class Node;
 }
 
 namespace Resource
@@ -28,6 +29,7 @@ namespace MWWorld
 namespace SceneUtil
 {
     class UnrefQueue;
+    class InstanceBatch;
 }
 
 namespace MWRender{
@@ -63,6 +65,22 @@ class Objects{
     CellMap mCellSceneNodes;
     PtrAnimationMap mObjects;
 
+    // <cell, scene template>
+    typedef std::map<std::pair<const MWWorld::CellStore*, const osg::Node*>, osg::ref_ptr<SceneUtil::InstanceBatch> > BatchMap;
+    BatchMap mBatches;
+
+    struct Instance
+    {
+        osg::ref_ptr<SceneUtil::InstanceBatch> mBatch;
+        unsigned int mNodeMask; ///< The node mask of the base node before it was hidden
+    };
+
+    // <base node of the object, batch drawing the object>
+    typedef std::map<const osg::Node*, Instance> InstanceMap;
+    InstanceMap mInstances;
+
+    bool mInstancing;
+
     osg::ref_ptr<osg::Group> mRootNode;
 
     Resource::ResourceSystem* mResourceSystem;
@@ -71,10 +89,20 @@ class Objects{
 
     void insertBegin(const MWWorld::Ptr& ptr);
 
+    /// Draw the object with the InstanceBatch of its cell and model, if the model can be instanced.
+    void insertInstance(const MWWorld::Ptr& ptr, const std::string& model);
+
+    /// Draw the object by itself again.
+    void removeInstance(const MWWorld::Ptr& ptr);
+
 public:
     Objects(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> rootNode, SceneUtil::UnrefQueue* unrefQueue);
     ~Objects();
 
+    /// Draw the static objects of exterior cells with one InstanceBatch per model and cell, rather than each by itself.
+    /// @note Only affects objects inserted afterwards.
+    void setInstancing(bool instancing);
+
     /// @param animated Attempt to load separate keyframes from a .kf file matching the model file?
     /// @param allowLight If false, no lights will be created, and particles systems will be removed.
     void insertModel(const MWWorld::Ptr& ptr, const std::string &model, bool animated=false, bool allowLight=true);
@@ -93,6 +121,9 @@ public:
     /// Updates containing cell for object rendering data
     void updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur);
 
+    /// Call after moving, rotating or scaling the base node of the object.
+    void updateTransform(const MWWorld::Ptr& ptr);
+
 private:
     void operator = (const Objects&);
     Objects(const Objects&);
@@ -32,6 +32,7 @@
 #include <components/sceneutil/workqueue.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
 #include <components/sceneutil/writescene.hpp>
+#include <components/sceneutil/riggeometry.hpp>
 
 #include <components/terrain/terraingrid.hpp>
 #include <components/terrain/quadtreeworld.hpp>
@@ -192,6 +193,7 @@ namespace MWRender
         resourceSystem->getSceneManager()->setNormalHeightMapPattern(Settings::Manager::getString("normal height map pattern", "Shaders"));
         resourceSystem->getSceneManager()->setAutoUseSpecularMaps(Settings::Manager::getBool("auto use object specular maps", "Shaders"));
         resourceSystem->getSceneManager()->setSpecularMapPattern(Settings::Manager::getString("specular map pattern", "Shaders"));
+        resourceSystem->getSceneManager()->setGpuSkinning(Settings::Manager::getBool("gpu skinning", "Shaders"));
 
         osg::ref_ptr<SceneUtil::LightManager> sceneRoot = new SceneUtil::LightManager;
         sceneRoot->setLightingMask(Mask_Lighting);
@@ -203,6 +205,14 @@ namespace MWRender
         mPathgrid.reset(new Pathgrid(mRootNode));
 
         mObjects.reset(new Objects(mResourceSystem, sceneRoot, mUnrefQueue.get()));
+        mObjects->setInstancing(Settings::Manager::getBool("instance statics", "Shaders"));
+
+        int skinningThreads = Settings::Manager::getInt("skinning threads", "General");
+        if (skinningThreads > 0)
+        {
+            mSkinningQueue = new SceneUtil::WorkQueue(skinningThreads);
+            SceneUtil::RigGeometry::setWorkQueue(mSkinningQueue.get());
+        }
 
         if (getenv("OPENMW_DONT_PRECOMPILE") == NULL)
             mViewer->setIncrementalCompileOperation(new osgUtil::IncrementalCompileOperation);
@@ -272,7 +282,7 @@ namespace MWRender
         mViewer->getCamera()->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
         mViewer->getCamera()->setCullingMode(cullingMode);
 
-        mViewer->getCamera()->setCullMask(~(Mask_UpdateVisitor|Mask_SimpleWater));
+        mViewer->getCamera()->setCullMask(~(Mask_UpdateVisitor|Mask_SimpleWater|Mask_Instanced));
 
         mNearClip = Settings::Manager::getFloat("near clip", "Camera");
         mViewDistance = Settings::Manager::getFloat("viewing distance", "Camera");
@@ -289,6 +299,12 @@ namespace MWRender
     {
         // let background loading thread finish before we delete anything else
         mWorkQueue = NULL;
+
+        if (mSkinningQueue)
+        {
+            SceneUtil::RigGeometry::setWorkQueue(NULL);
+            mSkinningQueue = NULL;
+        }
     }
 
     MWRender::Objects& RenderingManager::getObjects()
@@ -548,16 +564,19 @@ namespace MWRender
         }
 
         ptr.getRefData().getBaseNode()->setAttitude(rot);
+        mObjects->updateTransform(ptr);
     }
 
     void RenderingManager::moveObject(const MWWorld::Ptr &ptr, const osg::Vec3f &pos)
     {
         ptr.getRefData().getBaseNode()->setPosition(pos);
+        mObjects->updateTransform(ptr);
     }
 
     void RenderingManager::scaleObject(const MWWorld::Ptr &ptr, const osg::Vec3f &scale)
     {
         ptr.getRefData().getBaseNode()->setScale(scale);
+        mObjects->updateTransform(ptr);
 
         if (ptr == mCamera->getTrackingPtr()) // update height of camera
             mCamera->processViewChange();
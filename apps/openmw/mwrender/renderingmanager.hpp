@@ -221,6 +221,7 @@ namespace MWRender
 
         osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
         osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
+        osg::ref_ptr<SceneUtil::WorkQueue> mSkinningQueue;
 
         osg::ref_ptr<osg::Light> mSunLight;
 
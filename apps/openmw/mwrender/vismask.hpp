@@ -51,7 +51,11 @@ namespace MWRender
         Mask_PreCompile = (1<<16),
 
         // Set on a camera's cull mask to enable the LightManager
-        Mask_Lighting = (1<<17)
+        Mask_Lighting = (1<<17),
+
+        // Set on objects that are drawn by an InstanceBatch of their cell instead, so they are still updated and
+        // selectable through intersection tests, but not culled
+        Mask_Instanced = (1<<18)
     };
 
 }
@@ -74,10 +74,14 @@ namespace MWScript
 
                 virtual void execute (Interpreter::Runtime& runtime)
                 {
-                    std::string quest = runtime.getStringLiteral (runtime[0].mInteger);
+                    int literal = runtime[0].mInteger;
                     runtime.pop();
 
-                    int index = MWBase::Environment::get().getJournal()->getJournalIndex (quest);
+                    int handle = runtime.getJournalHandle (literal);
+
+                    int index = handle!=-1 ?
+                        MWBase::Environment::get().getJournal()->getLinkedJournalIndex (handle) :
+                        MWBase::Environment::get().getJournal()->getJournalIndex (runtime.getStringLiteral (literal));
 
                     runtime.push (index);
 
@@ -17,6 +17,7 @@
 #include "../mwbase/scriptmanager.hpp"
 #include "../mwbase/windowmanager.hpp"
 #include "../mwbase/inputmanager.hpp"
+#include "../mwbase/journal.hpp"
 
 #include "../mwworld/class.hpp"
 #include "../mwworld/cellstore.hpp"
@@ -244,6 +245,58 @@ namespace MWScript
         MWBase::Environment::get().getWorld()->setGlobalFloat (name, value);
     }
 
+    int InterpreterContext::getGlobalsRevision() const
+    {
+        return MWBase::Environment::get().getWorld()->getGlobalsRevision();
+    }
+
+    int InterpreterContext::getGlobalHandle (const std::string& name) const
+    {
+        return MWBase::Environment::get().getWorld()->getGlobalHandle (name);
+    }
+
+    int InterpreterContext::getJournalHandle (const std::string& id) const
+    {
+        // Only IDs of quests, otherwise every string literal of the script would get a handle
+        const ESM::Dialogue *dialogue =
+            MWBase::Environment::get().getWorld()->getStore().get<ESM::Dialogue>().search (id);
+
+        if (!dialogue || dialogue->mType!=ESM::Dialogue::Journal)
+            return -1;
+
+        return MWBase::Environment::get().getJournal()->getQuestHandle (id);
+    }
+
+    int InterpreterContext::getLinkedGlobalShort (int handle) const
+    {
+        return MWBase::Environment::get().getWorld()->getLinkedGlobalInt (handle);
+    }
+
+    int InterpreterContext::getLinkedGlobalLong (int handle) const
+    {
+        return MWBase::Environment::get().getWorld()->getLinkedGlobalInt (handle);
+    }
+
+    float InterpreterContext::getLinkedGlobalFloat (int handle) const
+    {
+        return MWBase::Environment::get().getWorld()->getLinkedGlobalFloat (handle);
+    }
+
+    void InterpreterContext::setLinkedGlobalShort (int handle, int value)
+    {
+        MWBase::Environment::get().getWorld()->setLinkedGlobalInt (handle, value);
+    }
+
+    void InterpreterContext::setLinkedGlobalLong (int handle, int value)
+    {
+        MWBase::Environment::get().getWorld()->setLinkedGlobalInt (handle, value);
+    }
+
+    void InterpreterContext::setLinkedGlobalFloat (int handle, float value)
+    {
+        MWBase::Environment::get().getWorld()->setLinkedGlobalFloat (handle, value);
+    }
+
     std::vector<std::string> InterpreterContext::getGlobals() const
     {
         std::vector<std::string> ids;
@@ -87,6 +87,24 @@ namespace MWScript
 
             virtual void setGlobalFloat (const std::string& name, float value);
 
+            virtual int getGlobalsRevision() const;
+
+            virtual int getGlobalHandle (const std::string& name) const;
+
+            virtual int getJournalHandle (const std::string& id) const;
+
+            virtual int getLinkedGlobalShort (int handle) const;
+
+            virtual int getLinkedGlobalLong (int handle) const;
+
+            virtual float getLinkedGlobalFloat (int handle) const;
+
+            virtual void setLinkedGlobalShort (int handle, int value);
+
+            virtual void setLinkedGlobalLong (int handle, int value);
+
+            virtual void setLinkedGlobalFloat (int handle, float value);
+
             virtual std::vector<std::string> getGlobals () const;
 
             virtual char getGlobalType (const std::string& name) const;
@@ -1,6 +1,8 @@
 #include "miscextensions.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <iomanip>
 
 #include <components/compiler/extensions.hpp>
 #include <components/compiler/opcodes.hpp>
@@ -36,6 +38,11 @@
 namespace
 {
 
+    bool compareScriptCosts(const MWBase::ScriptManager::ScriptCost& left, const MWBase::ScriptManager::ScriptCost& right)
+    {
+        return left.mTime > right.mTime;
+    }
+
     void addToLevList(ESM::LevelledListBase* list, const std::string& itemId, int level)
     {
         for (std::vector<ESM::LevelledListBase::LevelItem>::iterator it = list->mList.begin(); it != list->mList.end(); ++it)
@@ -1019,6 +1026,28 @@ namespace MWScript
             }
         };
 
+        class OpShowScriptCosts : public Interpreter::Opcode0
+        {
+            public:
+                virtual void execute (Interpreter::Runtime& runtime)
+                {
+                    std::vector<MWBase::ScriptManager::ScriptCost> costs;
+                    MWBase::Environment::get().getScriptManager()->getCosts (costs, true);
+
+                    const size_t count = std::min (costs.size(), static_cast<size_t> (10));
+                    std::partial_sort (costs.begin(), costs.begin()+count, costs.end(), compareScriptCosts);
+
+                    std::ostringstream str;
+                    str << "Most expensive scripts since the last report:" << std::fixed << std::setprecision (2);
+
+                    for (size_t i=0; i<count; ++i)
+                        str << std::endl << " " << costs[i].mName << ": " << costs[i].mTime << " ms in " << costs[i].mRuns
+                            << " runs, longest run " << costs[i].mMaxTime << " ms";
+
+                    runtime.getContext().report (str.str());
+                }
+        };
+
         class OpToggleGodMode : public Interpreter::Opcode0
         {
             public:
@@ -1359,6 +1388,7 @@ namespace MWScript
             interpreter.installSegment5 (Compiler::Misc::opcodeShowExplicit, new OpShow<ExplicitRef>);
             interpreter.installSegment5 (Compiler::Misc::opcodeToggleGodMode, new OpToggleGodMode);
             interpreter.installSegment5 (Compiler::Misc::opcodeToggleScripts, new OpToggleScripts);
+            interpreter.installSegment5 (Compiler::Misc::opcodeShowScriptCosts, new OpShowScriptCosts);
             interpreter.installSegment5 (Compiler::Misc::opcodeDisableLevitation, new OpEnableLevitation<false>);
             interpreter.installSegment5 (Compiler::Misc::opcodeEnableLevitation, new OpEnableLevitation<true>);
             interpreter.installSegment5 (Compiler::Misc::opcodeCast, new OpCast<ImplicitRef>);
@@ -0,0 +1,192 @@
+#include "scriptcache.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
+#include <components/esm/defs.hpp>
+
+namespace
+{
+    const int sCacheKeyRecord = ESM::FourCC<'C','K','E','Y'>::value;
+    const int sScriptRecord = ESM::FourCC<'C','S','C','R'>::value;
+
+    // Increase when the compiler output or the opcode numbers change
+    const int sCacheVersion = 1;
+
+    const char sLocalTypes[] = { 's', 'l', 'f' };
+    const char* sLocalNames[] = { "SHRT", "LONG", "FLOT" };
+}
+
+namespace MWScript
+{
+    ScriptCache::ScriptCache (const boost::filesystem::path& cacheFile, const MWWorld::ContentFileKey& key)
+    : mCacheFile (cacheFile), mKey (key), mChanged (false)
+    {}
+
+    void ScriptCache::load()
+    {
+        mScripts.clear();
+        mChanged = false;
+
+        if (!boost::filesystem::exists (mCacheFile))
+            return;
+
+        try
+        {
+            ESM::ESMReader reader;
+            reader.open (mCacheFile.string());
+
+            if (!reader.hasMoreRecs() || reader.getRecName().intval!=sCacheKeyRecord)
+                return;
+            reader.getRecHeader();
+
+            int version = 0;
+            reader.getHNT (version, "VERS");
+
+            if (version!=sCacheVersion || !mKey.matches (reader))
+                return;
+
+            std::map<std::string, Entry> scripts;
+
+            while (reader.hasMoreRecs())
+            {
+                if (reader.getRecName().intval!=sScriptRecord)
+                    throw std::runtime_error ("unexpected record");
+                reader.getRecHeader();
+
+                std::string name = reader.getHNString ("NAME");
+
+                Entry& entry = scripts[name];
+                reader.getHNT (entry.mHash, "HASH");
+
+                reader.getSubNameIs ("CODE");
+                reader.getSubHeader();
+                if (reader.getSubSize()==0 || reader.getSubSize()%sizeof (Interpreter::Type_Code))
+                    throw std::runtime_error ("invalid byte code size");
+                entry.mByteCode.resize (reader.getSubSize()/sizeof (Interpreter::Type_Code));
+                reader.getExact (&entry.mByteCode[0], reader.getSubSize());
+
+                while (reader.hasMoreSubs())
+                {
+                    reader.getSubName();
+
+                    int type = 0;
+                    while (type<3 && !(reader.retSubName()==sLocalNames[type]))
+                        ++type;
+                    if (type==3)
+                        throw std::runtime_error ("unexpected sub record");
+
+                    entry.mLocals.declare (sLocalTypes[type], reader.getHString());
+                }
+            }
+
+            mScripts.swap (scripts);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Ignoring invalid script cache " << mCacheFile.string() << ": " << e.what() << std::endl;
+        }
+    }
+
+    bool ScriptCache::get (const std::string& name, const std::string& source,
+        std::vector<Interpreter::Type_Code>& code, Compiler::Locals& locals) const
+    {
+        std::map<std::string, Entry>::const_iterator iter = mScripts.find (name);
+
+        if (iter==mScripts.end() || iter->second.mHash!=hash (source))
+            return false;
+
+        code = iter->second.mByteCode;
+        locals = iter->second.mLocals;
+        return true;
+    }
+
+    void ScriptCache::insert (const std::string& name, const std::string& source,
+        const std::vector<Interpreter::Type_Code>& code, const Compiler::Locals& locals)
+    {
+        if (code.empty())
+            return;
+
+        Entry& entry = mScripts[name];
+        entry.mHash = hash (source);
+        entry.mByteCode = code;
+        entry.mLocals = locals;
+        mChanged = true;
+    }
+
+    void ScriptCache::write()
+    {
+        if (!mChanged)
+            return;
+
+        const boost::filesystem::path tempFile = mCacheFile.string() + ".tmp";
+
+        try
+        {
+            if (mCacheFile.has_parent_path())
+                boost::filesystem::create_directories (mCacheFile.parent_path());
+
+            {
+                boost::filesystem::ofstream stream (tempFile, std::ios::binary);
+                if (!stream.is_open())
+                    throw std::runtime_error ("can't open " + tempFile.string());
+
+                ESM::ESMWriter writer;
+                writer.setFormat (0);
+                writer.save (stream);
+
+                writer.startRecord (sCacheKeyRecord);
+                writer.writeHNT ("VERS", sCacheVersion);
+                mKey.write (writer);
+                writer.endRecord (sCacheKeyRecord);
+
+                for (std::map<std::string, Entry>::const_iterator iter (mScripts.begin()); iter!=mScripts.end(); ++iter)
+                {
+                    writer.startRecord (sScriptRecord);
+                    writer.writeHNString ("NAME", iter->first);
+                    writer.writeHNT ("HASH", iter->second.mHash);
+                    writer.writeHNT ("CODE", iter->second.mByteCode[0],
+                        iter->second.mByteCode.size()*sizeof (Interpreter::Type_Code));
+
+                    for (int type=0; type<3; ++type)
+                    {
+                        const std::vector<std::string>& names = iter->second.mLocals.get (sLocalTypes[type]);
+                        for (std::vector<std::string>::const_iterator name (names.begin()); name!=names.end(); ++name)
+                            writer.writeHNString (sLocalNames[type], *name);
+                    }
+
+                    writer.endRecord (sScriptRecord);
+                }
+
+                writer.close();
+
+                if (!stream)
+                    throw std::runtime_error ("write error");
+            }
+
+            // Replace the old cache only once the new one is complete
+            boost::filesystem::rename (tempFile, mCacheFile);
+            mChanged = false;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write script cache " << mCacheFile.string() << ": " << e.what() << std::endl;
+            boost::system::error_code ec;
+            boost::filesystem::remove (tempFile, ec);
+        }
+    }
+
+    uint64_t ScriptCache::hash (const std::string& source)
+    {
+        // FNV-1a, the hash must not change between runs
+        uint64_t hash = 14695981039346656037ULL;
+        for (std::string::const_iterator iter (source.begin()); iter!=source.end(); ++iter)
+            hash = (hash ^ static_cast<unsigned char> (*iter)) * 1099511628211ULL;
+        return hash;
+    }
+}
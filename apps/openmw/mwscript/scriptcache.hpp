@@ -0,0 +1,62 @@
+#ifndef GAME_SCRIPT_SCRIPTCACHE_H
+#define GAME_SCRIPT_SCRIPTCACHE_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <components/compiler/locals.hpp>
+
+#include <components/interpreter/types.hpp>
+
+#include "../mwworld/contentfilekey.hpp"
+
+namespace MWScript
+{
+    /// \brief On-disk cache of compiled scripts, so scripts do not have to be compiled again on the next startup.
+    ///
+    /// Each script is stored with a hash of its source. The compiled code also depends on the
+    /// records it refers to, so the whole cache is discarded when the content files change.
+    class ScriptCache
+    {
+        public:
+
+            ScriptCache (const boost::filesystem::path& cacheFile, const MWWorld::ContentFileKey& key);
+
+            void load();
+            ///< Load the cache file. A cache that is missing, out of date or invalid is ignored.
+
+            bool get (const std::string& name, const std::string& source,
+                std::vector<Interpreter::Type_Code>& code, Compiler::Locals& locals) const;
+            ///< Look up the compiled script \a name.
+            /// \return false, if the script is not cached or was compiled from a different \a source.
+
+            void insert (const std::string& name, const std::string& source,
+                const std::vector<Interpreter::Type_Code>& code, const Compiler::Locals& locals);
+
+            void write();
+            ///< Replace the cache file, if any script was inserted since it was loaded.
+            /// \note Errors are reported but not fatal.
+
+        private:
+
+            struct Entry
+            {
+                uint64_t mHash;
+                std::vector<Interpreter::Type_Code> mByteCode;
+                Compiler::Locals mLocals;
+            };
+
+            static uint64_t hash (const std::string& source);
+
+            boost::filesystem::path mCacheFile;
+            MWWorld::ContentFileKey mKey;
+            std::map<std::string, Entry> mScripts;
+            bool mChanged;
+    };
+}
+
+#endif
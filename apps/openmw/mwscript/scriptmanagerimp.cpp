@@ -1,6 +1,7 @@
 #include "scriptmanagerimp.hpp"
 
 #include <cassert>
+#include <cfloat>
 #include <iostream>
 #include <sstream>
 #include <exception>
@@ -10,23 +11,275 @@
 
 #include <components/misc/stringops.hpp>
 
+#include <osg/Timer>
+
 #include <components/compiler/scanner.hpp>
 #include <components/compiler/context.hpp>
 #include <components/compiler/exception.hpp>
+#include <components/compiler/generator.hpp>
+#include <components/compiler/opcodes.hpp>
 #include <components/compiler/quickfileparser.hpp>
 
+#include <components/sceneutil/workqueue.hpp>
+
 #include "../mwworld/esmstore.hpp"
+#include "../mwworld/manualref.hpp"
+#include "../mwworld/class.hpp"
 
 #include "extensions.hpp"
+#include "scriptcache.hpp"
+
+namespace
+{
+    /// Does the byte code use the frame duration or events that are only reported for a single frame?
+    bool dependsOnFrameTime (const std::vector<Interpreter::Type_Code>& code)
+    {
+        static const Interpreter::Type_Code frameOpcodes[] =
+        {
+            Compiler::Generator::segment5 (50), // GetSecondsPassed
+            Compiler::Generator::segment5 (Compiler::Stats::opcodeOnKnockout),
+            Compiler::Generator::segment5 (Compiler::Stats::opcodeOnKnockoutExplicit),
+            // Scaled by the frame duration
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeRotate),
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeRotateExplicit),
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeRotateWorld),
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeRotateWorldExplicit),
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeMove),
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeMoveExplicit),
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeMoveWorld),
+            Compiler::Generator::segment5 (Compiler::Transformation::opcodeMoveWorldExplicit)
+        };
+        static const Interpreter::Type_Code* frameOpcodesEnd = frameOpcodes + sizeof (frameOpcodes) / sizeof (frameOpcodes[0]);
+
+        if (code.empty())
+            return false;
+
+        // Every instruction is a single word, the literals follow after the instructions
+        std::vector<Interpreter::Type_Code>::const_iterator begin = code.begin()+4;
+        std::vector<Interpreter::Type_Code>::const_iterator end = begin+code[0];
+
+        for (std::vector<Interpreter::Type_Code>::const_iterator iter (begin); iter!=end; ++iter)
+            if (std::find (frameOpcodes, frameOpcodesEnd, *iter)!=frameOpcodesEnd)
+                return true;
+
+        return false;
+    }
+
+    /// \brief Compiler context for compiling in a worker thread
+    ///
+    /// Only looks at the records loaded from the content files, which do not change while the game
+    /// is running. Records created during the game are not known, which is not a problem in practice,
+    /// because scripts can not refer to them by ID.
+    class PrecompileContext : public Compiler::Context
+    {
+            const MWWorld::ESMStore& mStore;
+            Compiler::ErrorHandler& mErrorHandler;
+            mutable std::map<std::string, Compiler::Locals> mLocals;
+
+            const Compiler::Locals& getLocals (const std::string& script) const
+            {
+                std::string name = Misc::StringUtils::lowerCase (script);
+
+                std::map<std::string, Compiler::Locals>::iterator iter = mLocals.find (name);
+
+                if (iter==mLocals.end())
+                {
+                    iter = mLocals.insert (std::make_pair (name, Compiler::Locals())).first;
+
+                    if (const ESM::Script *record = mStore.get<ESM::Script>().searchStatic (name))
+                    {
+                        std::istringstream stream (record->mScriptText);
+                        Compiler::QuickFileParser parser (mErrorHandler, *this, iter->second);
+                        Compiler::Scanner scanner (mErrorHandler, stream, getExtensions());
+                        scanner.scan (parser);
+                    }
+                }
+
+                return iter->second;
+            }
+
+        public:
+
+            PrecompileContext (const MWWorld::ESMStore& store, Compiler::ErrorHandler& errorHandler)
+            : mStore (store), mErrorHandler (errorHandler)
+            {}
+
+            virtual bool canDeclareLocals() const
+            {
+                return true;
+            }
+
+            virtual char getGlobalType (const std::string& name) const
+            {
+                const ESM::Global *global = mStore.get<ESM::Global>().searchStatic (name);
+
+                if (!global)
+                    return ' ';
+
+                switch (global->mValue.getType())
+                {
+                    case ESM::VT_Short: return 's';
+                    case ESM::VT_Long: return 'l';
+                    case ESM::VT_Float: return 'f';
+
+                    default: return ' ';
+                }
+            }
+
+            virtual std::pair<char, bool> getMemberType (const std::string& name, const std::string& id) const
+            {
+                std::string script;
+                bool reference = false;
+
+                if (const ESM::Script *scriptRecord = mStore.get<ESM::Script>().searchStatic (id))
+                {
+                    script = scriptRecord->mId;
+                }
+                else
+                {
+                    MWWorld::ManualRef ref (mStore, id, 1, true);
+
+                    script = ref.getPtr().getClass().getScript (ref.getPtr());
+                    reference = true;
+                }
+
+                char type = ' ';
+
+                if (!script.empty())
+                    type = getLocals (script).getType (Misc::StringUtils::lowerCase (name));
+
+                return std::make_pair (type, reference);
+            }
+
+            virtual bool isId (const std::string& name) const
+            {
+                return
+                    mStore.get<ESM::Activator>().searchStatic (name) ||
+                    mStore.get<ESM::Potion>().searchStatic (name) ||
+                    mStore.get<ESM::Apparatus>().searchStatic (name) ||
+                    mStore.get<ESM::Armor>().searchStatic (name) ||
+                    mStore.get<ESM::Book>().searchStatic (name) ||
+                    mStore.get<ESM::Clothing>().searchStatic (name) ||
+                    mStore.get<ESM::Container>().searchStatic (name) ||
+                    mStore.get<ESM::Creature>().searchStatic (name) ||
+                    mStore.get<ESM::Door>().searchStatic (name) ||
+                    mStore.get<ESM::Ingredient>().searchStatic (name) ||
+                    mStore.get<ESM::CreatureLevList>().searchStatic (name) ||
+                    mStore.get<ESM::ItemLevList>().searchStatic (name) ||
+                    mStore.get<ESM::Light>().searchStatic (name) ||
+                    mStore.get<ESM::Lockpick>().searchStatic (name) ||
+                    mStore.get<ESM::Miscellaneous>().searchStatic (name) ||
+                    mStore.get<ESM::NPC>().searchStatic (name) ||
+                    mStore.get<ESM::Probe>().searchStatic (name) ||
+                    mStore.get<ESM::Repair>().searchStatic (name) ||
+                    mStore.get<ESM::Static>().searchStatic (name) ||
+                    mStore.get<ESM::Weapon>().searchStatic (name) ||
+                    mStore.get<ESM::Script>().searchStatic (name);
+            }
+
+            virtual bool isJournalId (const std::string& name) const
+            {
+                const ESM::Dialogue *topic = mStore.get<ESM::Dialogue>().searchStatic (name);
+
+                return topic && topic->mType==ESM::Dialogue::Journal;
+            }
+    };
+}
 
 namespace MWScript
 {
+    /// \brief Worker thread item: compile scripts ahead of their first run
+    class PrecompileItem : public SceneUtil::WorkItem
+    {
+        public:
+
+            struct Script
+            {
+                std::string mName;
+                const ESM::Script *mRecord;
+                std::vector<Interpreter::Type_Code> mByteCode; ///< empty, if compiling failed
+                Compiler::Locals mLocals;
+            };
+
+            /// Constructor to be called from the main thread.
+            PrecompileItem (const std::vector<Script>& scripts, const MWWorld::ESMStore& store,
+                const Compiler::Extensions *extensions, int warningsMode)
+            : mScripts (scripts), mStore (store), mExtensions (extensions), mWarningsMode (warningsMode), mAbort (false)
+            {}
+
+            virtual void abort()
+            {
+                mAbort = true;
+            }
+
+            virtual void doWork()
+            {
+                // Scripts that fail to compile here are compiled again on their first run, which reports the errors.
+                // Warnings are handled the same way, so they are not lost either.
+                std::ostringstream messages;
+                Compiler::StreamErrorHandler errorHandler (messages);
+                errorHandler.setWarningsMode (mWarningsMode);
+
+                Compiler::StreamErrorHandler localsErrorHandler (messages);
+                PrecompileContext context (mStore, localsErrorHandler);
+                context.setExtensions (mExtensions);
+
+                Compiler::FileParser parser (errorHandler, context);
+
+                for (std::vector<Script>::iterator iter (mScripts.begin()); iter!=mScripts.end() && !mAbort; ++iter)
+                {
+                    parser.reset();
+                    errorHandler.reset();
+
+                    try
+                    {
+                        std::istringstream input (iter->mRecord->mScriptText);
+                        Compiler::Scanner scanner (errorHandler, input, context.getExtensions());
+                        scanner.scan (parser);
+
+                        if (errorHandler.isGood() && errorHandler.countWarnings()==0)
+                        {
+                            parser.getCode (iter->mByteCode);
+                            iter->mLocals = parser.getLocals();
+                        }
+                    }
+                    catch (const std::exception&)
+                    {
+                    }
+
+                    messages.str (std::string());
+                }
+            }
+
+            /// \note Only valid once the item is done.
+            const std::vector<Script>& getScripts() const
+            {
+                return mScripts;
+            }
+
+        private:
+
+            std::vector<Script> mScripts;
+            const MWWorld::ESMStore& mStore;
+            const Compiler::Extensions *mExtensions;
+            int mWarningsMode;
+
+            volatile bool mAbort;
+    };
+
+    ScriptManager::CompiledScript::CompiledScript (const std::vector<Interpreter::Type_Code>& code,
+        const Compiler::Locals& locals)
+    : mByteCode (code), mLocals (locals), mDependsOnFrameTime (::dependsOnFrameTime (code)),
+      mRuns (0), mTime (0), mMaxTime (0)
+    {}
+
     ScriptManager::ScriptManager (const MWWorld::ESMStore& store,
         Compiler::Context& compilerContext, int warningsMode,
-        const std::vector<std::string>& scriptBlacklist)
-    : mErrorHandler (std::cerr), mStore (store),
+        const std::vector<std::string>& scriptBlacklist,
+        ScriptCache *cache, SceneUtil::WorkQueue *workQueue)
+    : mErrorHandler (std::cerr), mWarningsMode (warningsMode), mStore (store),
       mCompilerContext (compilerContext), mParser (mErrorHandler, mCompilerContext),
-      mOpcodesInstalled (false), mGlobalScripts (store)
+      mOpcodesInstalled (false), mGlobalScripts (store), mCache (cache), mWorkQueue (workQueue)
     {
         mErrorHandler.setWarningsMode (warningsMode);
 
@@ -35,6 +288,29 @@ namespace MWScript
         std::transform (scriptBlacklist.begin(), scriptBlacklist.end(),
             mScriptBlacklist.begin(), Misc::StringUtils::lowerCase);
         std::sort (mScriptBlacklist.begin(), mScriptBlacklist.end());
+
+        if (mCache)
+            mCache->load();
+    }
+
+    ScriptManager::~ScriptManager()
+    {
+        if (mWorkQueue)
+            mWorkQueue->cancel (this);
+
+        for (std::vector<osg::ref_ptr<PrecompileItem> >::iterator iter (mPrecompileItems.begin());
+            iter!=mPrecompileItems.end(); ++iter)
+            (*iter)->abort();
+
+        for (std::vector<osg::ref_ptr<PrecompileItem> >::iterator iter (mPrecompileItems.begin());
+            iter!=mPrecompileItems.end(); ++iter)
+            (*iter)->waitTillDone();
+
+        if (mCache)
+        {
+            collectPrecompiled();
+            mCache->write();
+        }
     }
 
     bool ScriptManager::compile (const std::string& name)
@@ -44,6 +320,18 @@ namespace MWScript
 
         if (const ESM::Script *script = mStore.get<ESM::Script>().find (name))
         {
+            if (mCache)
+            {
+                std::vector<Interpreter::Type_Code> code;
+                Compiler::Locals locals;
+
+                if (mCache->get (script->mId, script->mScriptText, code, locals))
+                {
+                    mScripts.insert (std::make_pair (name, CompiledScript (code, locals)));
+                    return true;
+                }
+            }
+
             mErrorHandler.setContext(name);
 
             bool Success = true;
@@ -79,7 +367,10 @@ namespace MWScript
             {
                 std::vector<Interpreter::Type_Code> code;
                 mParser.getCode (code);
-                mScripts.insert (std::make_pair (name, std::make_pair (code, mParser.getLocals())));
+                mScripts.insert (std::make_pair (name, CompiledScript (code, mParser.getLocals())));
+
+                if (mCache)
+                    mCache->insert (script->mId, script->mScriptText, code, mParser.getLocals());
 
                 return true;
             }
@@ -90,25 +381,10 @@ namespace MWScript
 
     void ScriptManager::run (const std::string& name, Interpreter::Context& interpreterContext)
     {
-        // compile script
-        ScriptCollection::iterator iter = mScripts.find (name);
-
-        if (iter==mScripts.end())
-        {
-            if (!compile (name))
-            {
-                // failed -> ignore script from now on.
-                std::vector<Interpreter::Type_Code> empty;
-                mScripts.insert (std::make_pair (name, std::make_pair (empty, Compiler::Locals())));
-                return;
-            }
-
-            iter = mScripts.find (name);
-            assert (iter!=mScripts.end());
-        }
+        ScriptCollection::iterator iter = getCompiled (name);
 
         // execute script
-        if (!iter->second.first.empty())
+        if (!iter->second.mByteCode.empty())
             try
             {
                 if (!mOpcodesInstalled)
@@ -117,15 +393,81 @@ namespace MWScript
                     mOpcodesInstalled = true;
                 }
 
-                mInterpreter.run (&iter->second.first[0], iter->second.first.size(), interpreterContext);
+                osg::Timer_t start = osg::Timer::instance()->tick();
+
+                // Resolve global variables again when the content changed
+                if (!iter->second.mLinks.isLinked (interpreterContext))
+                    iter->second.mLinks.link (&iter->second.mByteCode[0], interpreterContext);
+
+                mInterpreter.run (&iter->second.mByteCode[0], iter->second.mByteCode.size(), interpreterContext,
+                    &iter->second.mLinks);
+
+                double time = osg::Timer::instance()->delta_m (start, osg::Timer::instance()->tick());
+                ++iter->second.mRuns;
+                iter->second.mTime += time;
+                iter->second.mMaxTime = std::max (iter->second.mMaxTime, time);
             }
             catch (const std::exception& e)
             {
                 std::cerr << "Execution of script " << name << " failed:" << std::endl;
                 std::cerr << e.what() << std::endl;
 
-                iter->second.first.clear(); // don't execute again.
+                iter->second.mByteCode.clear(); // don't execute again.
+            }
+    }
+
+    ScriptManager::ScriptCollection::iterator ScriptManager::getCompiled (const std::string& name)
+    {
+        ScriptCollection::iterator iter = mScripts.find (name);
+
+        if (iter==mScripts.end() && !mPrecompileItems.empty())
+        {
+            collectPrecompiled();
+            iter = mScripts.find (name);
+        }
+
+        if (iter==mScripts.end())
+        {
+            if (!compile (name))
+            {
+                // failed -> ignore script from now on.
+                std::vector<Interpreter::Type_Code> empty;
+                return mScripts.insert (std::make_pair (name, CompiledScript (empty, Compiler::Locals()))).first;
             }
+
+            iter = mScripts.find (name);
+            assert (iter!=mScripts.end());
+        }
+
+        return iter;
+    }
+
+    bool ScriptManager::dependsOnFrameTime (const std::string& name)
+    {
+        return getCompiled (name)->second.mDependsOnFrameTime;
+    }
+
+    void ScriptManager::getCosts (std::vector<ScriptCost>& costs, bool reset)
+    {
+        for (ScriptCollection::iterator iter (mScripts.begin()); iter!=mScripts.end(); ++iter)
+        {
+            if (!iter->second.mRuns)
+                continue;
+
+            ScriptCost cost;
+            cost.mName = iter->first;
+            cost.mRuns = iter->second.mRuns;
+            cost.mTime = iter->second.mTime;
+            cost.mMaxTime = iter->second.mMaxTime;
+            costs.push_back (cost);
+
+            if (reset)
+            {
+                iter->second.mRuns = 0;
+                iter->second.mTime = 0;
+                iter->second.mMaxTime = 0;
+            }
+        }
     }
 
     std::pair<int, int> ScriptManager::compileAll()
@@ -146,9 +488,88 @@ namespace MWScript
                     ++success;
             }
 
+        if (mCache)
+            mCache->write();
+
         return std::make_pair (count, success);
     }
 
+    void ScriptManager::precompile (const std::vector<std::string>& names)
+    {
+        if (!mWorkQueue)
+            return;
+
+        collectPrecompiled();
+
+        std::vector<PrecompileItem::Script> scripts;
+
+        for (std::vector<std::string>::const_iterator iter (names.begin()); iter!=names.end(); ++iter)
+        {
+            if (mScripts.find (*iter)!=mScripts.end() || mPrecompiling.find (*iter)!=mPrecompiling.end())
+                continue;
+
+            PrecompileItem::Script script;
+            script.mName = *iter;
+            script.mRecord = mStore.get<ESM::Script>().searchStatic (*iter);
+
+            if (!script.mRecord)
+                continue;
+
+            // Loading a cached script is cheap enough for the main thread
+            if (mCache && mCache->get (script.mRecord->mId, script.mRecord->mScriptText, script.mByteCode, script.mLocals))
+            {
+                mScripts.insert (std::make_pair (*iter, CompiledScript (script.mByteCode, script.mLocals)));
+                continue;
+            }
+
+            mPrecompiling.insert (*iter);
+            scripts.push_back (script);
+        }
+
+        if (scripts.empty())
+            return;
+
+        osg::ref_ptr<PrecompileItem> item (new PrecompileItem (scripts, mStore, mCompilerContext.getExtensions(),
+            mWarningsMode));
+
+        // Preloading the cells themselves is more important
+        item->setPriority (-FLT_MAX);
+        item->setKey (this);
+        mWorkQueue->addWorkItem (item);
+
+        mPrecompileItems.push_back (item);
+    }
+
+    void ScriptManager::collectPrecompiled()
+    {
+        for (std::vector<osg::ref_ptr<PrecompileItem> >::iterator iter (mPrecompileItems.begin());
+            iter!=mPrecompileItems.end();)
+        {
+            if (!(*iter)->isDone())
+            {
+                ++iter;
+                continue;
+            }
+
+            const std::vector<PrecompileItem::Script>& scripts = (*iter)->getScripts();
+
+            for (std::vector<PrecompileItem::Script>::const_iterator script (scripts.begin()); script!=scripts.end(); ++script)
+            {
+                mPrecompiling.erase (script->mName);
+
+                // Failed scripts are compiled again on their first run, to report the errors
+                if (script->mByteCode.empty())
+                    continue;
+
+                if (mScripts.insert (std::make_pair (script->mName, CompiledScript (script->mByteCode, script->mLocals))).second
+                    && mCache)
+                    mCache->insert (script->mRecord->mId, script->mRecord->mScriptText, script->mByteCode, script->mLocals);
+            }
+
+            iter = mPrecompileItems.erase (iter);
+        }
+    }
+
     const Compiler::Locals& ScriptManager::getLocals (const std::string& name)
     {
         std::string name2 = Misc::StringUtils::lowerCase (name);
@@ -157,7 +578,7 @@ namespace MWScript
             ScriptCollection::iterator iter = mScripts.find (name2);
 
             if (iter!=mScripts.end())
-                return iter->second.second;
+                return iter->second.mLocals;
         }
 
         {
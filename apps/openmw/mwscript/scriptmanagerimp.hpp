@@ -2,12 +2,17 @@
 #define GAME_SCRIPT_SCRIPTMANAGER_H
 
 #include <map>
+#include <memory>
+#include <set>
 #include <string>
 
+#include <osg/ref_ptr>
+
 #include <components/compiler/streamerrorhandler.hpp>
 #include <components/compiler/fileparser.hpp>
 
 #include <components/interpreter/interpreter.hpp>
+#include <components/interpreter/links.hpp>
 #include <components/interpreter/types.hpp>
 
 #include "../mwbase/scriptmanager.hpp"
@@ -30,30 +35,66 @@ namespace Interpreter
     class Interpreter;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace MWScript
 {
+    class ScriptCache;
+    class PrecompileItem;
+
     class ScriptManager : public MWBase::ScriptManager
     {
             Compiler::StreamErrorHandler mErrorHandler;
+            int mWarningsMode;
             const MWWorld::ESMStore& mStore;
             Compiler::Context& mCompilerContext;
             Compiler::FileParser mParser;
             Interpreter::Interpreter mInterpreter;
             bool mOpcodesInstalled;
 
-            typedef std::pair<std::vector<Interpreter::Type_Code>, Compiler::Locals> CompiledScript;
+            struct CompiledScript
+            {
+                std::vector<Interpreter::Type_Code> mByteCode;
+                Compiler::Locals mLocals;
+                Interpreter::Links mLinks; ///< linked on first run
+                bool mDependsOnFrameTime;
+
+                int mRuns; ///< since the costs were last reset
+                double mTime; ///< in milliseconds
+                double mMaxTime; ///< in milliseconds
+
+                CompiledScript (const std::vector<Interpreter::Type_Code>& code, const Compiler::Locals& locals);
+            };
+
             typedef std::map<std::string, CompiledScript> ScriptCollection;
 
             ScriptCollection mScripts;
             GlobalScripts mGlobalScripts;
             std::map<std::string, Compiler::Locals> mOtherLocals;
             std::vector<std::string> mScriptBlacklist;
+            std::unique_ptr<ScriptCache> mCache;
+            osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
+            std::vector<osg::ref_ptr<PrecompileItem> > mPrecompileItems;
+            std::set<std::string> mPrecompiling; ///< scripts waiting in mPrecompileItems
+
+            void collectPrecompiled();
+            ///< Take over the scripts of finished precompile items.
+
+            ScriptCollection::iterator getCompiled (const std::string& name);
+            ///< Compile the script first, if it is not compiled yet. A script that failed to compile has no byte code.
 
         public:
 
             ScriptManager (const MWWorld::ESMStore& store,
                 Compiler::Context& compilerContext, int warningsMode,
-                const std::vector<std::string>& scriptBlacklist);
+                const std::vector<std::string>& scriptBlacklist,
+                ScriptCache *cache = 0, SceneUtil::WorkQueue *workQueue = 0);
+            ///< Ownership of \a cache is transferred to *this. Scripts can only be precompiled with a \a workQueue.
+
+            virtual ~ScriptManager();
 
             virtual void run (const std::string& name, Interpreter::Context& interpreterContext);
             ///< Run the script with the given name (compile first, if not compiled yet)
@@ -66,6 +107,15 @@ namespace MWScript
             ///< Compile all scripts
             /// \return count, success
 
+            virtual void precompile (const std::vector<std::string>& names);
+            ///< Compile the given scripts in the background, for example the scripts of a cell that is being preloaded.
+
+            virtual bool dependsOnFrameTime (const std::string& name);
+            ///< Does the script need to run every frame? (compile first, if not compiled yet)
+
+            virtual void getCosts (std::vector<ScriptCost>& costs, bool reset);
+            ///< Return the run time of all scripts that ran since the last reset.
+
             virtual const Compiler::Locals& getLocals (const std::string& name);
             ///< Return locals for script \a name.
 
@@ -1,5 +1,6 @@
 #include "cellpreloader.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include <components/resource/scenemanager.hpp>
@@ -16,6 +17,7 @@
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
+#include "../mwbase/scriptmanager.hpp"
 
 #include "../mwrender/landmanager.hpp"
 
@@ -28,8 +30,9 @@ namespace MWWorld
 
     struct ListModelsVisitor
     {
-        ListModelsVisitor(std::vector<std::string>& out)
+        ListModelsVisitor(std::vector<std::string>& out, std::vector<std::string>* scripts)
             : mOut(out)
+            , mScripts(scripts)
         {
         }
 
@@ -37,10 +40,18 @@ namespace MWWorld
         {
             ptr.getClass().getModelsToPreload(ptr, mOut);
 
+            if (mScripts)
+            {
+                std::string script = ptr.getClass().getScript(ptr);
+                if (!script.empty())
+                    mScripts->push_back(script);
+            }
+
             return true;
         }
 
         std::vector<std::string>& mOut;
+        std::vector<std::string>* mScripts;
     };
 
     /// Worker thread item: preload models in a cell.
@@ -48,7 +59,7 @@ namespace MWWorld
     {
     public:
         /// Constructor to be called from the main thread.
-        PreloadItem(MWWorld::CellStore* cell, Resource::SceneManager* sceneManager, Resource::BulletShapeManager* bulletShapeManager, Resource::KeyframeManager* keyframeManager, Terrain::World* terrain, MWRender::LandManager* landManager, bool preloadInstances)
+        PreloadItem(MWWorld::CellStore* cell, Resource::SceneManager* sceneManager, Resource::BulletShapeManager* bulletShapeManager, Resource::KeyframeManager* keyframeManager, Terrain::World* terrain, MWRender::LandManager* landManager, bool preloadInstances, bool preloadScripts)
             : mIsExterior(cell->getCell()->isExterior())
             , mX(cell->getCell()->getGridX())
             , mY(cell->getCell()->getGridY())
@@ -58,27 +69,21 @@ namespace MWWorld
             , mTerrain(terrain)
             , mLandManager(landManager)
             , mPreloadInstances(preloadInstances)
+            , mPreloadScripts(preloadScripts)
+            , mStore(MWBase::Environment::get().getWorld()->getStore())
             , mAbort(false)
         {
             mTerrainView = mTerrain->createView();
 
-            ListModelsVisitor visitor (mMeshes);
+            ListModelsVisitor visitor (mMeshes, mPreloadScripts ? &mScripts : NULL);
             if (cell->getState() == MWWorld::CellStore::State_Loaded)
             {
                 cell->forEach(visitor);
             }
             else
             {
-                const std::vector<std::string>& objectIds = cell->getPreloadedIds();
-
-                // could possibly build the model list in the worker thread if we manage to make the Store thread safe
-                for (std::vector<std::string>::const_iterator it = objectIds.begin(); it != objectIds.end(); ++it)
-                {
-                    MWWorld::ManualRef ref(MWBase::Environment::get().getWorld()->getStore(), *it);
-                    std::string model = ref.getPtr().getClass().getModel(ref.getPtr());
-                    if (!model.empty())
-                        mMeshes.push_back(model);
-                }
+                // The models are looked up in the worker thread, the IDs are copied since the cell may get loaded meanwhile
+                mObjectIds = cell->getPreloadedIds();
             }
         }
 
@@ -90,6 +95,29 @@ namespace MWWorld
         /// Preload work to be called from the worker thread.
         virtual void doWork()
         {
+            // Preloaded IDs are always from content files, so they can be looked up in the read-only part of the store
+            for (std::vector<std::string>::const_iterator it = mObjectIds.begin(); it != mObjectIds.end() && !mAbort; ++it)
+            {
+                try
+                {
+                    MWWorld::ManualRef ref(mStore, *it, 1, true);
+                    std::string model = ref.getPtr().getClass().getModel(ref.getPtr());
+                    if (!model.empty())
+                        mMeshes.push_back(model);
+
+                    if (mPreloadScripts)
+                    {
+                        std::string script = ref.getPtr().getClass().getScript(ref.getPtr());
+                        if (!script.empty())
+                            mScripts.push_back(script);
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    // ignore error, same as below
+                }
+            }
+
             if (mIsExterior)
             {
                 try
@@ -145,6 +173,16 @@ namespace MWWorld
                     // error will be shown when visiting the cell
                 }
             }
+
+            std::sort(mScripts.begin(), mScripts.end());
+            mScripts.erase(std::unique(mScripts.begin(), mScripts.end()), mScripts.end());
+        }
+
+        /// Move the names of the scripts used by objects in the cell to \a out, to be called from the main thread once the item is done.
+        void takeScripts(std::vector<std::string>& out)
+        {
+            out.insert(out.end(), mScripts.begin(), mScripts.end());
+            mScripts.clear();
         }
 
     private:
@@ -153,12 +191,16 @@ namespace MWWorld
         int mX;
         int mY;
         MeshList mMeshes;
+        std::vector<std::string> mObjectIds;
+        std::vector<std::string> mScripts;
         Resource::SceneManager* mSceneManager;
         Resource::BulletShapeManager* mBulletShapeManager;
         Resource::KeyframeManager* mKeyframeManager;
         Terrain::World* mTerrain;
         MWRender::LandManager* mLandManager;
         bool mPreloadInstances;
+        bool mPreloadScripts;
+        const MWWorld::ESMStore& mStore;
 
         volatile bool mAbort;
 
@@ -197,6 +239,7 @@ namespace MWWorld
         , mMinCacheSize(0)
         , mMaxCacheSize(0)
         , mPreloadInstances(true)
+        , mPreloadScripts(false)
         , mLastResourceCacheUpdate(0.0)
     {
     }
@@ -225,7 +268,7 @@ namespace MWWorld
         mPreloadCells.clear();
     }
 
-    void CellPreloader::preload(CellStore *cell, double timestamp)
+    void CellPreloader::preload(CellStore *cell, double timestamp, float distance)
     {
         if (!mWorkQueue)
         {
@@ -263,14 +306,17 @@ namespace MWWorld
 
             if (oldestTimestamp + threshold < timestamp)
             {
-                oldestCell->second.mWorkItem->abort();
+                abort(oldestCell);
                 mPreloadCells.erase(oldestCell);
             }
             else
                 return;
         }
 
-        osg::ref_ptr<PreloadItem> item (new PreloadItem(cell, mResourceSystem->getSceneManager(), mBulletShapeManager, mResourceSystem->getKeyframeManager(), mTerrain, mLandManager, mPreloadInstances));
+        osg::ref_ptr<PreloadItem> item (new PreloadItem(cell, mResourceSystem->getSceneManager(), mBulletShapeManager, mResourceSystem->getKeyframeManager(), mTerrain, mLandManager, mPreloadInstances, mPreloadScripts));
+        // Nearer cells first, but behind the items of the default priority, e.g. the terrain around the player
+        item->setPriority(-distance);
+        item->setKey(cell);
         mWorkQueue->addWorkItem(item);
 
         mPreloadCells[cell] = PreloadEntry(timestamp, item);
@@ -284,8 +330,8 @@ namespace MWWorld
             // do the deletion in the background thread
             if (found->second.mWorkItem)
             {
-                found->second.mWorkItem->abort();
-                mUnrefQueue->push(mPreloadCells[cell].mWorkItem);
+                abort(found);
+                mUnrefQueue->push(found->second.mWorkItem);
             }
 
             mPreloadCells.erase(found);
@@ -298,7 +344,7 @@ namespace MWWorld
         {
             if (it->second.mWorkItem)
             {
-                it->second.mWorkItem->abort();
+                abort(it);
                 mUnrefQueue->push(it->second.mWorkItem);
             }
 
@@ -308,21 +354,30 @@ namespace MWWorld
 
     void CellPreloader::updateCache(double timestamp)
     {
+        std::vector<std::string> scripts;
+
         for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end();)
         {
             if (mPreloadCells.size() >= mMinCacheSize && it->second.mTimeStamp < timestamp - mExpiryDelay)
             {
                 if (it->second.mWorkItem)
                 {
-                    it->second.mWorkItem->abort();
+                    abort(it);
                     mUnrefQueue->push(it->second.mWorkItem);
                 }
                 mPreloadCells.erase(it++);
             }
             else
+            {
+                if (mPreloadScripts && it->second.mWorkItem->isDone())
+                    static_cast<PreloadItem*>(it->second.mWorkItem.get())->takeScripts(scripts);
                 ++it;
+            }
         }
 
+        if (!scripts.empty())
+            MWBase::Environment::get().getScriptManager()->precompile(scripts);
+
         if (timestamp - mLastResourceCacheUpdate > 1.0 && (!mUpdateCacheItem || mUpdateCacheItem->isDone()))
         {
             // the resource cache is cleared from the worker thread so that we're not holding up the main thread with delete operations
@@ -332,6 +387,13 @@ namespace MWWorld
         }
     }
 
+    void CellPreloader::abort(PreloadMap::iterator it)
+    {
+        // a stale preload that is still waiting in the queue would only hold up the preloads behind it
+        if (mWorkQueue->cancel(it->first) == 0)
+            it->second.mWorkItem->abort();
+    }
+
     void CellPreloader::setExpiryDelay(double expiryDelay)
     {
         mExpiryDelay = expiryDelay;
@@ -352,6 +414,11 @@ namespace MWWorld
         mPreloadInstances = preload;
     }
 
+    void CellPreloader::setPreloadScripts(bool preload)
+    {
+        mPreloadScripts = preload;
+    }
+
     unsigned int CellPreloader::getMaxCacheSize() const
     {
         return mMaxCacheSize;
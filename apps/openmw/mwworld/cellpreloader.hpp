@@ -39,8 +39,9 @@ namespace MWWorld
         ~CellPreloader();
 
         /// Ask a background thread to preload rendering meshes and collision shapes for objects in this cell.
+        /// @param distance Distance of the cell to the player, cells that are closer get preloaded first.
         /// @note The cell itself must be in State_Loaded or State_Preloaded.
-        void preload(MWWorld::CellStore* cell, double timestamp);
+        void preload(MWWorld::CellStore* cell, double timestamp, float distance=0.f);
 
         void notifyLoaded(MWWorld::CellStore* cell);
 
@@ -61,6 +62,9 @@ namespace MWWorld
         /// Enables the creation of instances in the preloading thread.
         void setPreloadInstances(bool preload);
 
+        /// Enables compiling the scripts of preloaded cells in the background.
+        void setPreloadScripts(bool preload);
+
         unsigned int getMaxCacheSize() const;
 
         void setWorkQueue(osg::ref_ptr<SceneUtil::WorkQueue> workQueue);
@@ -80,6 +84,7 @@ namespace MWWorld
         unsigned int mMinCacheSize;
         unsigned int mMaxCacheSize;
         bool mPreloadInstances;
+        bool mPreloadScripts;
 
         double mLastResourceCacheUpdate;
 
@@ -100,6 +105,9 @@ namespace MWWorld
         };
         typedef std::map<const MWWorld::CellStore*, PreloadEntry> PreloadMap;
 
+        /// Stop preloading the given cell, if it was not started yet remove it from the work queue altogether
+        void abort(PreloadMap::iterator it);
+
         // Cells that are currently being preloaded, or have already finished preloading
         PreloadMap mPreloadCells;
 
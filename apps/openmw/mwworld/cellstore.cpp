@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <algorithm>
+#include <memory>
+#include <unordered_set>
 
 #include <components/esm/cellstate.hpp>
 #include <components/esm/cellid.hpp>
@@ -27,6 +29,32 @@
 
 namespace
 {
+    typedef std::unordered_set<ESM::RefNum, ESM::RefNumHash> RefNumSet;
+
+    /// Index the references moved out of \a cell, so each reference can be checked in constant time
+    /// instead of searching the moved reference list.
+    void getMovedRefNums (const ESM::Cell& cell, RefNumSet& refNums)
+    {
+        refNums.reserve (cell.mMovedRefs.size());
+        for (ESM::MovedCellRefTracker::const_iterator it = cell.mMovedRefs.begin(); it != cell.mMovedRefs.end(); ++it)
+            refNums.insert (it->mRefNum);
+    }
+
+    /// Memory mapped readers can be shared, so the references can be decoded through a private
+    /// cursor into the already mapped block instead of re-seeking the reader shared by all cells.
+    /// \a privateReader is only created once a mapped reader is found, since a reader allocates its read buffer.
+    ESM::ESMReader& getRefReader (std::vector<ESM::ESMReader>& readers, int index, std::unique_ptr<ESM::ESMReader>& privateReader)
+    {
+        if (!readers.at (index).isMemoryMapped())
+            return readers[index];
+
+        if (!privateReader)
+            privateReader.reset (new ESM::ESMReader);
+
+        privateReader->openShared (readers[index]);
+        return *privateReader;
+    }
+
     template<typename T>
     MWWorld::Ptr searchInContainerList (MWWorld::CellRefList<T>& containerList, const std::string& id)
     {
@@ -46,22 +74,18 @@ namespace
     }
 
     template<typename T>
-    MWWorld::Ptr searchViaActorId (MWWorld::CellRefList<T>& actorList, int actorId,
-        MWWorld::CellStore *cell, const std::map<MWWorld::LiveCellRefBase*, MWWorld::CellStore*>& toIgnore)
+    void indexActors (MWWorld::CellRefList<T>& actorList, MWWorld::CellStore *cell,
+        const std::map<MWWorld::LiveCellRefBase*, MWWorld::CellStore*>& toIgnore, std::unordered_map<int, MWWorld::Ptr>& index)
     {
         for (typename MWWorld::CellRefList<T>::List::iterator iter (actorList.mList.begin());
              iter!=actorList.mList.end(); ++iter)
         {
-            MWWorld::Ptr actor (&*iter, cell);
-
             if (toIgnore.find(&*iter) != toIgnore.end())
                 continue;
 
-            if (actor.getClass().getCreatureStats (actor).matchesActorId (actorId) && actor.getRefData().getCount() > 0)
-                return actor;
+            MWWorld::Ptr actor (&*iter, cell);
+            index[actor.getClass().getCreatureStats (actor).getActorId()] = actor;
         }
-
-        return MWWorld::Ptr();
     }
 
     template<typename RecordType, typename T>
@@ -397,24 +421,21 @@ namespace MWWorld
         return searchVisitor.mFound;
     }
 
-    Ptr CellStore::searchViaActorId (int id)
+    void CellStore::indexActors (std::unordered_map<int, Ptr>& index)
     {
-        if (Ptr ptr = ::searchViaActorId (mNpcs, id, this, mMovedToAnotherCell))
-            return ptr;
+        if (mState != State_Loaded)
+            return;
 
-        if (Ptr ptr = ::searchViaActorId (mCreatures, id, this, mMovedToAnotherCell))
-            return ptr;
+        ::indexActors (mNpcs, this, mMovedToAnotherCell, index);
+        ::indexActors (mCreatures, this, mMovedToAnotherCell, index);
 
         for (MovedRefTracker::const_iterator it = mMovedHere.begin(); it != mMovedHere.end(); ++it)
         {
             MWWorld::Ptr actor (it->first, this);
             if (!actor.getClass().isActor())
                 continue;
-            if (actor.getClass().getCreatureStats (actor).matchesActorId (id) && actor.getRefData().getCount() > 0)
-                return actor;
+            index[actor.getClass().getCreatureStats (actor).getActorId()] = actor;
         }
-
-        return Ptr();
     }
 
     float CellStore::getWaterLevel() const
@@ -471,6 +492,12 @@ namespace MWWorld
         if (mCell->mContextList.empty())
             return; // this is a dynamically generated cell -> skipping.
 
+        RefNumSet movedRefs;
+        getMovedRefNums (*mCell, movedRefs);
+
+        // One private reader for all content files, created when the first one is memory mapped
+        std::unique_ptr<ESM::ESMReader> privateReader;
+
         // Load references from all plugins that do something with this cell.
         for (size_t i = 0; i < mCell->mContextList.size(); i++)
         {
@@ -478,23 +505,21 @@ namespace MWWorld
             {
                 // Reopen the ESM reader and seek to the right position.
                 int index = mCell->mContextList.at(i).index;
-                mCell->restore (esm[index], i);
+                ESM::ESMReader& reader = getRefReader (esm, index, privateReader);
+                mCell->restore (reader, i);
 
                 ESM::CellRef ref;
 
                 // Get each reference in turn
                 bool deleted = false;
-                while (mCell->getNextRef (esm[index], ref, deleted))
+                while (mCell->getNextRef (reader, ref, deleted))
                 {
                     if (deleted)
                         continue;
 
                     // Don't list reference if it was moved to a different cell.
-                    ESM::MovedCellRefTracker::const_iterator iter =
-                        std::find(mCell->mMovedRefs.begin(), mCell->mMovedRefs.end(), ref.mRefNum);
-                    if (iter != mCell->mMovedRefs.end()) {
+                    if (movedRefs.find (ref.mRefNum) != movedRefs.end())
                         continue;
-                    }
 
                     mIds.push_back (Misc::StringUtils::lowerCase (ref.mRefID));
                 }
@@ -527,7 +552,13 @@ namespace MWWorld
         if (mCell->mContextList.empty())
             return; // this is a dynamically generated cell -> skipping.
 
-        std::map<ESM::RefNum, std::string> refNumToID; // used to detect refID modifications
+        RefNumToIdMap refNumToID; // used to detect refID modifications
+
+        RefNumSet movedRefs;
+        getMovedRefNums (*mCell, movedRefs);
+
+        // One private reader for all content files, created when the first one is memory mapped
+        std::unique_ptr<ESM::ESMReader> privateReader;
 
         // Load references from all plugins that do something with this cell.
         for (size_t i = 0; i < mCell->mContextList.size(); i++)
@@ -536,21 +567,19 @@ namespace MWWorld
             {
                 // Reopen the ESM reader and seek to the right position.
                 int index = mCell->mContextList.at(i).index;
-                mCell->restore (esm[index], i);
+                ESM::ESMReader& reader = getRefReader (esm, index, privateReader);
+                mCell->restore (reader, i);
 
                 ESM::CellRef ref;
                 ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
 
                 // Get each reference in turn
                 bool deleted = false;
-                while(mCell->getNextRef(esm[index], ref, deleted))
+                while(mCell->getNextRef(reader, ref, deleted))
                 {
                     // Don't load reference if it was moved to a different cell.
-                    ESM::MovedCellRefTracker::const_iterator iter =
-                        std::find(mCell->mMovedRefs.begin(), mCell->mMovedRefs.end(), ref.mRefNum);
-                    if (iter != mCell->mMovedRefs.end()) {
+                    if (movedRefs.find (ref.mRefNum) != movedRefs.end())
                         continue;
-                    }
 
                     loadRef (ref, deleted, refNumToID);
                 }
@@ -598,13 +627,13 @@ namespace MWWorld
         return Ptr();
     }
 
-    void CellStore::loadRef (ESM::CellRef& ref, bool deleted, std::map<ESM::RefNum, std::string>& refNumToID)
+    void CellStore::loadRef (ESM::CellRef& ref, bool deleted, RefNumToIdMap& refNumToID)
     {
         Misc::StringUtils::lowerCaseInPlace (ref.mRefID);
 
         const MWWorld::ESMStore& store = mStore;
 
-        std::map<ESM::RefNum, std::string>::iterator it = refNumToID.find(ref.mRefNum);
+        RefNumToIdMap::iterator it = refNumToID.find(ref.mRefNum);
         if (it != refNumToID.end())
         {
             if (it->second != ref.mRefID)
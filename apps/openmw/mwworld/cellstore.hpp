@@ -7,6 +7,7 @@
 #include <typeinfo>
 #include <map>
 #include <memory>
+#include <unordered_map>
 
 #include "livecellref.hpp"
 #include "cellreflist.hpp"
@@ -227,8 +228,10 @@ namespace MWWorld
             /// containers.
             /// @note Does not trigger CellStore hasState flag.
 
-            Ptr searchViaActorId (int id);
-            ///< Will return an empty Ptr if cell is not loaded.
+            void indexActors (std::unordered_map<int, Ptr>& index);
+            ///< Add the actors in this cell to \a index, keyed by their actor ID. Actors that do not have
+            /// an ID yet get one assigned. Does nothing if the cell is not loaded.
+            /// @note Deleted actors are included, check the count of the found Ptr.
 
             float getWaterLevel() const;
 
@@ -387,7 +390,9 @@ namespace MWWorld
 
             void loadRefs();
 
-            void loadRef (ESM::CellRef& ref, bool deleted, std::map<ESM::RefNum, std::string>& refNumToID);
+            typedef std::unordered_map<ESM::RefNum, std::string, ESM::RefNumHash> RefNumToIdMap;
+
+            void loadRef (ESM::CellRef& ref, bool deleted, RefNumToIdMap& refNumToID);
             ///< Make case-adjustments to \a ref and insert it into the respective container.
             ///
             /// Invalid \a ref objects are silently dropped.
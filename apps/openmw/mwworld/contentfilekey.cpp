@@ -0,0 +1,68 @@
+#include "contentfilekey.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
+
+#include <components/files/collections.hpp>
+
+namespace MWWorld
+{
+
+    ContentFileKey::ContentFileKey(const Files::Collections& fileCollections, const std::vector<std::string>& contentFiles)
+    {
+        for (std::vector<std::string>::const_iterator it = contentFiles.begin(); it != contentFiles.end(); ++it)
+        {
+            const Files::MultiDirCollection& col = fileCollections.getCollection(boost::filesystem::path(*it).extension().string());
+            if (!col.doesExist(*it))
+            {
+                std::stringstream msg;
+                msg << "Failed loading " << *it << ": the content file does not exist";
+                throw std::runtime_error(msg.str());
+            }
+            const boost::filesystem::path path = col.getPath(*it);
+
+            ContentFile file;
+            file.mName = path.filename().string();
+            file.mSize = boost::filesystem::file_size(path);
+            file.mModified = boost::filesystem::last_write_time(path);
+            mContentFiles.push_back(file);
+        }
+    }
+
+    void ContentFileKey::write(ESM::ESMWriter& writer) const
+    {
+        writer.writeHNT("COUN", static_cast<int>(mContentFiles.size()));
+        for (std::vector<ContentFile>::const_iterator it = mContentFiles.begin(); it != mContentFiles.end(); ++it)
+        {
+            writer.writeHNString("NAME", it->mName);
+            writer.writeHNT("SIZE", it->mSize);
+            writer.writeHNT("MTIM", it->mModified);
+        }
+    }
+
+    bool ContentFileKey::matches(ESM::ESMReader& reader) const
+    {
+        int count = 0;
+        reader.getHNT(count, "COUN");
+        if (count != static_cast<int>(mContentFiles.size()))
+            return false;
+
+        for (std::vector<ContentFile>::const_iterator it = mContentFiles.begin(); it != mContentFiles.end(); ++it)
+        {
+            ContentFile file;
+            file.mName = reader.getHNString("NAME");
+            reader.getHNT(file.mSize, "SIZE");
+            reader.getHNT(file.mModified, "MTIM");
+
+            if (file.mName != it->mName || file.mSize != it->mSize || file.mModified != it->mModified)
+                return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,47 @@
+#ifndef GAME_MWWORLD_CONTENTFILEKEY_H
+#define GAME_MWWORLD_CONTENTFILEKEY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ESM
+{
+    class ESMReader;
+    class ESMWriter;
+}
+
+namespace Files
+{
+    class Collections;
+}
+
+namespace MWWorld
+{
+    /// @brief Identifies the content a cache was built from, by the names, sizes and modification times
+    /// of the content files in load order.
+    class ContentFileKey
+    {
+    public:
+        /// @note Throws if one of the content files does not exist.
+        ContentFileKey(const Files::Collections& fileCollections, const std::vector<std::string>& contentFiles);
+
+        void write(ESM::ESMWriter& writer) const;
+
+        /// Read a key written by write() from the current record.
+        /// @return Does it match this key?
+        bool matches(ESM::ESMReader& reader) const;
+
+    private:
+        struct ContentFile
+        {
+            std::string mName;
+            uint64_t mSize;
+            int64_t mModified;
+        };
+
+        std::vector<ContentFile> mContentFiles;
+    };
+}
+
+#endif
@@ -12,6 +12,7 @@ EsmLoader::EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& read
   , mEsm(readers)
   , mStore(store)
   , mEncoder(encoder)
+  , mWorkQueue(NULL)
 {
 }
 
@@ -25,7 +26,30 @@ void EsmLoader::load(const boost::filesystem::path& filepath, int& index)
   lEsm.setGlobalReaderList(&mEsm);
   lEsm.open(filepath.string());
   mEsm[index] = lEsm;
-  mStore.load(mEsm[index], &mListener);
+  // Queued records are read again by each work item, which is only cheap for memory mapped files
+  if (mWorkQueue && mEsm[index].isMemoryMapped())
+    mStore.queueLoad(mEsm[index], &mListener);
+  else
+  {
+    // The records queued from earlier content files have to be in the store before this file overrides them
+    if (mWorkQueue)
+      mStore.loadQueued(mEsm, mWorkQueue, &mListener);
+    mStore.load(mEsm[index], &mListener);
+  }
+}
+
+void EsmLoader::setWorkQueue(SceneUtil::WorkQueue* workQueue)
+{
+  mWorkQueue = workQueue;
+}
+
+void EsmLoader::finishLoading()
+{
+  if (!mWorkQueue)
+    return;
+
+  mListener.setLabel("");
+  mStore.loadQueued(mEsm, mWorkQueue, &mListener);
 }
 
 } /* namespace MWWorld */
@@ -15,6 +15,11 @@ namespace ESM
     class ESMReader;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace MWWorld
 {
 
@@ -27,10 +32,19 @@ struct EsmLoader : public ContentLoader
 
     void load(const boost::filesystem::path& filepath, int& index);
 
+    /// Decode content files concurrently on the given work queue. With a work queue set, load() only
+    /// scans memory mapped content files, and their records are loaded into the store by finishLoading().
+    /// Content files that can not be memory mapped are still loaded sequentially by load().
+    void setWorkQueue(SceneUtil::WorkQueue* workQueue);
+
+    /// Load all scanned content files, must be called after the last call to load().
+    void finishLoading();
+
     private:
       std::vector<ESM::ESMReader>& mEsm;
       MWWorld::ESMStore& mStore;
       ToUTF8::Utf8Encoder* mEncoder;
+      SceneUtil::WorkQueue* mWorkQueue;
 };
 
 } /* namespace MWWorld */
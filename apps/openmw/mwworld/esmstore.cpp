@@ -2,6 +2,8 @@
 
 #include <set>
 #include <iostream>
+#include <algorithm>
+#include <memory>
 
 #include <boost/filesystem/operations.hpp>
 
@@ -10,6 +12,10 @@
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
 
+#include <components/sceneutil/workqueue.hpp>
+
+#include <components/to_utf8/to_utf8.hpp>
+
 namespace MWWorld
 {
 
@@ -27,18 +33,54 @@ static bool isCacheableRecord(int id)
     return false;
 }
 
-void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
+static int getRecordGroup(int type)
 {
-    listener->setProgressRange(1000);
+    // INFO records belong to the preceding DIAL record, and pathgrids need to see the cells
+    // loaded before them, so these have to be loaded in order with their parent records.
+    if (type == ESM::REC_INFO)
+        return ESM::REC_DIAL;
+    if (type == ESM::REC_PGRD)
+        return ESM::REC_CELL;
+    return type;
+}
 
-    ESM::Dialogue *dialogue = 0;
+class LoadRecordGroupItem : public SceneUtil::WorkItem
+{
+public:
+    LoadRecordGroupItem(ESMStore& store, const std::vector<ESM::ESM_Context>& records,
+                        const std::vector<ESM::ESMReader>& readers, ToUTF8::FromType encoding, bool useEncoder)
+        : mStore(store)
+        , mRecords(records)
+        , mReaders(readers)
+        , mEncoder(useEncoder ? new ToUTF8::Utf8Encoder(encoding) : NULL)
+    {
+    }
 
-    // Land texture loading needs to use a separate internal store for each plugin.
-    // We set the number of plugins here to avoid continual resizes during loading,
-    // and so we can properly verify if valid plugin indices are being passed to the
-    // LandTexture Store retrieval methods.
-    mLandTextures.resize(esm.getGlobalReaderList()->size());
+    virtual void doWork()
+    {
+        try
+        {
+            // The encoder is not thread safe, so each work item needs its own
+            mStore.loadRecordGroup(mRecords, mReaders, mEncoder.get());
+        }
+        catch (std::exception& e)
+        {
+            mError = e.what();
+        }
+    }
+
+    const std::string& getError() const { return mError; }
 
+private:
+    ESMStore& mStore;
+    const std::vector<ESM::ESM_Context>& mRecords;
+    const std::vector<ESM::ESMReader>& mReaders;
+    std::unique_ptr<ToUTF8::Utf8Encoder> mEncoder;
+    std::string mError;
+};
+
+void ESMStore::resolveMasters(ESM::ESMReader &esm)
+{
     /// \todo Move this to somewhere else. ESMReader?
     // Cache parent esX files by tracking their indices in the global list of
     //  all files/readers used by the engine. This will greaty accelerate
@@ -66,6 +108,69 @@ void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
         }
         mast.index = index;
     }
+}
+
+ESM::Dialogue *ESMStore::loadRecord(ESM::ESMReader &esm, int type, ESM::Dialogue *dialogue)
+{
+    // Look up the record type.
+    std::map<int, StoreBase *>::iterator it = mStores.find(type);
+
+    if (it == mStores.end()) {
+        if (type == ESM::REC_INFO) {
+            if (dialogue)
+            {
+                dialogue->readInfo(esm, esm.getIndex() != 0);
+            }
+            else
+            {
+                std::cerr << "error: info record without dialog" << std::endl;
+                esm.skipRecord();
+            }
+        } else if (type == ESM::REC_MGEF) {
+            mMagicEffects.load (esm);
+        } else if (type == ESM::REC_SKIL) {
+            mSkills.load (esm);
+        }
+        else if (type==ESM::REC_FILT || type == ESM::REC_DBGP)
+        {
+            // ignore project file only records
+            esm.skipRecord();
+        }
+        else {
+            std::stringstream error;
+            error << "Unknown record: " << esm.getContext().recName.toString();
+            throw std::runtime_error(error.str());
+        }
+    } else {
+        RecordId id = it->second->load(esm);
+        if (id.mIsDeleted)
+        {
+            it->second->eraseStatic(id.mId);
+            return dialogue;
+        }
+
+        if (type==ESM::REC_DIAL) {
+            return const_cast<ESM::Dialogue*>(mDialogs.find(id.mId));
+        } else {
+            return 0;
+        }
+    }
+    return dialogue;
+}
+
+void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
+{
+    listener->setProgressRange(1000);
+
+    ESM::Dialogue *dialogue = 0;
+
+    // Land texture loading needs to use a separate internal store for each plugin.
+    // We set the number of plugins here to avoid continual resizes during loading,
+    // and so we can properly verify if valid plugin indices are being passed to the
+    // LandTexture Store retrieval methods.
+    mLandTextures.resize(esm.getGlobalReaderList()->size());
+
+    resolveMasters(esm);
 
     // Loop through all records
     while(esm.hasMoreRecs())
@@ -73,49 +178,210 @@ void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
         ESM::NAME n = esm.getRecName();
         esm.getRecHeader();
 
-        // Look up the record type.
-        std::map<int, StoreBase *>::iterator it = mStores.find(n.intval);
+        if (mSkipCachedRecords && isCachedRecord(n.intval))
+            esm.skipRecord();
+        else
+            dialogue = loadRecord(esm, n.intval, dialogue);
 
-        if (it == mStores.end()) {
-            if (n.intval == ESM::REC_INFO) {
-                if (dialogue)
-                {
-                    dialogue->readInfo(esm, esm.getIndex() != 0);
-                }
-                else
-                {
-                    std::cerr << "error: info record without dialog" << std::endl;
-                    esm.skipRecord();
-                }
-            } else if (n.intval == ESM::REC_MGEF) {
-                mMagicEffects.load (esm);
-            } else if (n.intval == ESM::REC_SKIL) {
-                mSkills.load (esm);
-            }
-            else if (n.intval==ESM::REC_FILT || n.intval == ESM::REC_DBGP)
-            {
-                // ignore project file only records
-                esm.skipRecord();
-            }
-            else {
-                std::stringstream error;
-                error << "Unknown record: " << n.toString();
-                throw std::runtime_error(error.str());
-            }
-        } else {
-            RecordId id = it->second->load(esm);
-            if (id.mIsDeleted)
-            {
-                it->second->eraseStatic(id.mId);
+        listener->setProgress(static_cast<size_t>(esm.getFileOffset() / (float)esm.getFileSize() * 1000));
+    }
+}
+
+void ESMStore::queueLoad(ESM::ESMReader &esm, Loading::Listener* listener)
+{
+    listener->setProgressRange(1000);
+
+    mLandTextures.resize(esm.getGlobalReaderList()->size());
+
+    resolveMasters(esm);
+
+    // Whether an INFO record would find its dialogue, see loadRecord()
+    bool inDialogue = false;
+
+    while(esm.hasMoreRecs())
+    {
+        // Queue the context from before the record header, so the record flags are read again when loading
+        ESM::ESM_Context context = esm.getContext();
+        ESM::NAME n = esm.getRecName();
+        esm.getRecHeader();
+
+        if (mSkipCachedRecords && isCachedRecord(n.intval))
+        {
+            // loaded from the record cache
+        }
+        else if (n.intval == ESM::REC_INFO && !inDialogue)
+        {
+            std::cerr << "error: info record without dialog" << std::endl;
+        }
+        else if (n.intval == ESM::REC_FILT || n.intval == ESM::REC_DBGP)
+        {
+            // ignore project file only records
+        }
+        else if (mStores.find(n.intval) != mStores.end() || n.intval == ESM::REC_INFO
+                 || n.intval == ESM::REC_MGEF || n.intval == ESM::REC_SKIL)
+        {
+            mQueuedRecords[getRecordGroup(n.intval)].push_back(context);
+        }
+        else
+        {
+            std::stringstream error;
+            error << "Unknown record: " << n.toString();
+            throw std::runtime_error(error.str());
+        }
+
+        if (n.intval == ESM::REC_DIAL)
+            inDialogue = true;
+        else if (n.intval != ESM::REC_INFO)
+            inDialogue = false;
+
+        esm.skipRecord();
+
+        listener->setProgress(static_cast<size_t>(esm.getFileOffset() / (float)esm.getFileSize() * 1000));
+    }
+}
+
+void ESMStore::loadRecordGroup(const std::vector<ESM::ESM_Context> &records, const std::vector<ESM::ESMReader> &readers,
+                               ToUTF8::Utf8Encoder *encoder)
+{
+    ESM::ESMReader esm;
+    int index = -1;
+    ESM::Dialogue *dialogue = 0;
+
+    for (std::vector<ESM::ESM_Context>::const_iterator it = records.begin(); it != records.end(); ++it)
+    {
+        if (it->index != index)
+        {
+            // Work on a copy, so each group reads from its own position in the file
+            index = it->index;
+            esm = readers.at(index);
+            esm.setEncoder(encoder);
+            dialogue = 0;
+        }
+
+        esm.restoreContext(*it);
+        ESM::NAME n = esm.getRecName();
+        esm.getRecHeader();
+
+        dialogue = loadRecord(esm, n.intval, dialogue);
+    }
+}
+
+void ESMStore::loadQueued(const std::vector<ESM::ESMReader> &readers, SceneUtil::WorkQueue* workQueue, Loading::Listener* listener)
+{
+    if (mQueuedRecords.empty())
+        return;
+
+    // Only the readers of queued records are copied, content files loaded by load() may be streamed
+    bool concurrent = workQueue != NULL && !readers.empty();
+    for (std::map<int, std::vector<ESM::ESM_Context> >::const_iterator it = mQueuedRecords.begin(); it != mQueuedRecords.end() && concurrent; ++it)
+    {
+        int index = -1;
+        for (std::vector<ESM::ESM_Context>::const_iterator context = it->second.begin(); context != it->second.end() && concurrent; ++context)
+        {
+            if (context->index == index)
                 continue;
-            }
+            index = context->index;
+            concurrent = index >= 0 && static_cast<size_t>(index) < readers.size() && readers[index].isMemoryMapped();
+        }
+    }
 
-            if (n.intval==ESM::REC_DIAL) {
-                dialogue = const_cast<ESM::Dialogue*>(mDialogs.find(id.mId));
-            } else {
-                dialogue = 0;
-            }
+    listener->setProgressRange(mQueuedRecords.size());
+    listener->setProgress(0);
+
+    if (!concurrent)
+    {
+        ToUTF8::Utf8Encoder* encoder = readers.empty() ? NULL : readers.front().getEncoder();
+        for (std::map<int, std::vector<ESM::ESM_Context> >::const_iterator it = mQueuedRecords.begin(); it != mQueuedRecords.end(); ++it)
+        {
+            loadRecordGroup(it->second, readers, encoder);
+            listener->increaseProgress();
         }
+        mQueuedRecords.clear();
+        return;
+    }
+
+    ToUTF8::Utf8Encoder* encoder = readers.front().getEncoder();
+
+    // Queue the largest groups first to keep all threads busy until the end
+    std::vector<std::pair<size_t, int> > groups;
+    for (std::map<int, std::vector<ESM::ESM_Context> >::const_iterator it = mQueuedRecords.begin(); it != mQueuedRecords.end(); ++it)
+        groups.push_back(std::make_pair(it->second.size(), it->first));
+    std::sort(groups.rbegin(), groups.rend());
+
+    std::vector<osg::ref_ptr<LoadRecordGroupItem> > items;
+    for (std::vector<std::pair<size_t, int> >::const_iterator it = groups.begin(); it != groups.end(); ++it)
+    {
+        osg::ref_ptr<LoadRecordGroupItem> item (new LoadRecordGroupItem(*this, mQueuedRecords[it->second], readers,
+            encoder ? encoder->getEncoding() : ToUTF8::WINDOWS_1252, encoder != NULL));
+        workQueue->addWorkItem(item);
+        items.push_back(item);
+    }
+
+    // Wait for all items before reporting errors, they reference the queued records
+    std::string error;
+    for (std::vector<osg::ref_ptr<LoadRecordGroupItem> >::const_iterator it = items.begin(); it != items.end(); ++it)
+    {
+        (*it)->waitTillDone();
+        if (error.empty())
+            error = (*it)->getError();
+        listener->increaseProgress();
+    }
+
+    mQueuedRecords.clear();
+
+    if (!error.empty())
+        throw std::runtime_error(error);
+}
+
+bool ESMStore::isCachedRecord(int type)
+{
+    return type != ESM::REC_CELL && type != ESM::REC_LAND && type != ESM::REC_PGRD && type != ESM::REC_LTEX
+        && type != ESM::REC_FILT && type != ESM::REC_DBGP;
+}
+
+void ESMStore::setSkipCachedRecords(bool skip)
+{
+    mSkipCachedRecords = skip;
+}
+
+void ESMStore::writeCache(ESM::ESMWriter& writer) const
+{
+    for (std::map<int, StoreBase *>::const_iterator it = mStores.begin(); it != mStores.end(); ++it)
+    {
+        if (isCachedRecord(it->first))
+            it->second->writeStatic(writer);
+    }
+
+    for (Store<ESM::MagicEffect>::iterator it = mMagicEffects.begin(); it != mMagicEffects.end(); ++it)
+    {
+        writer.startRecord(ESM::MagicEffect::sRecordId);
+        it->second.save(writer);
+        writer.endRecord(ESM::MagicEffect::sRecordId);
+    }
+
+    for (Store<ESM::Skill>::iterator it = mSkills.begin(); it != mSkills.end(); ++it)
+    {
+        writer.startRecord(ESM::Skill::sRecordId);
+        it->second.save(writer);
+        writer.endRecord(ESM::Skill::sRecordId);
+    }
+}
+
+void ESMStore::loadCache(ESM::ESMReader& esm, Loading::Listener* listener)
+{
+    listener->setProgressRange(1000);
+
+    ESM::Dialogue *dialogue = 0;
+    while(esm.hasMoreRecs())
+    {
+        ESM::NAME n = esm.getRecName();
+        esm.getRecHeader();
+
+        if (!isCachedRecord(n.intval))
+            esm.fail("Unexpected record in record cache");
+
+        dialogue = loadRecord(esm, n.intval, dialogue);
+
         listener->setProgress(static_cast<size_t>(esm.getFileOffset() / (float)esm.getFileSize() * 1000));
     }
 }
@@ -124,6 +390,11 @@ void ESMStore::setUp()
 {
     mIds.clear();
 
+    // Only the first call sees the content file records alone, later calls come after loading dynamic records.
+    // The static IDs may not be empty before the first call, see insertStatic().
+    const bool listStaticIds = !mStaticIdsListed;
+    mStaticIdsListed = true;
+
     std::map<int, StoreBase *>::iterator storeIt = mStores.begin();
     for (; storeIt != mStores.end(); ++storeIt) {
         storeIt->second->setUp();
@@ -134,7 +405,11 @@ void ESMStore::setUp()
             storeIt->second->listIdentifier(identifiers);
 
             for (std::vector<std::string>::const_iterator record = identifiers.begin(); record != identifiers.end(); ++record)
+            {
                 mIds[*record] = storeIt->first;
+                if (listStaticIds)
+                    mStaticIds[*record] = storeIt->first;
+            }
         }
     }
     mSkills.setUp();
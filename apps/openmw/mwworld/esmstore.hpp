@@ -12,8 +12,20 @@ namespace Loading
     class Listener;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
+namespace ToUTF8
+{
+    class Utf8Encoder;
+}
+
 namespace MWWorld
 {
+    class LoadRecordGroupItem;
+
     class ESMStore
     {
         Store<ESM::Activator>       mActivators;
@@ -68,12 +80,36 @@ namespace MWWorld
         // Lookup of all IDs. Makes looking up references faster. Just
         // maps the id name to the record type.
         std::map<std::string, int> mIds;
+
+        // Same as mIds, but restricted to the records loaded from the content files. Filled by the first setUp() and
+        // not modified by dynamic records afterwards, so it can be read concurrently (see findStatic()).
+        std::map<std::string, int> mStaticIds;
+        bool mStaticIdsListed;
+
         std::map<int, StoreBase *> mStores;
 
         ESM::NPC mPlayerTemplate;
 
         unsigned int mDynamicCount;
 
+        /// Record contexts queued by queueLoad(), grouped by the store they are loaded into.
+        /// Each group is kept in content file order.
+        std::map<int, std::vector<ESM::ESM_Context> > mQueuedRecords;
+
+        bool mSkipCachedRecords;
+
+        friend class LoadRecordGroupItem;
+
+        void resolveMasters(ESM::ESMReader &esm);
+
+        /// Load a single record into its store, the record header must have been read already.
+        /// @return The dialogue that following INFO records belong to.
+        ESM::Dialogue *loadRecord(ESM::ESMReader &esm, int type, ESM::Dialogue *dialogue);
+
+        /// Load a group of queued records, in order.
+        void loadRecordGroup(const std::vector<ESM::ESM_Context> &records, const std::vector<ESM::ESMReader> &readers,
+                             ToUTF8::Utf8Encoder *encoder);
+
     public:
         /// \todo replace with SharedIterator<StoreBase>
         typedef std::map<int, StoreBase *>::const_iterator iterator;
@@ -97,8 +133,24 @@ namespace MWWorld
             return it->second;
         }
 
+        /// Look up the given ID of a record loaded from the content files. Returns 0 if not found.
+        /// \note id must be in lower case.
+        /// \note Read-only concurrent mode: once setUp() has been called, findStatic() and Store::searchStatic() may be
+        /// used from worker threads (e.g. to prepare cells for loading), while the main thread keeps inserting
+        /// dynamic records. The content file records are not modified any more at that point.
+        int findStatic(const std::string &id) const
+        {
+            std::map<std::string, int>::const_iterator it = mStaticIds.find(id);
+            if (it == mStaticIds.end()) {
+                return 0;
+            }
+            return it->second;
+        }
+
         ESMStore()
-          : mDynamicCount(0)
+          : mStaticIdsListed(false)
+          , mDynamicCount(0)
+          , mSkipCachedRecords(false)
         {
             mStores[ESM::REC_ACTI] = &mActivators;
             mStores[ESM::REC_ALCH] = &mPotions;
@@ -160,6 +212,31 @@ namespace MWWorld
 
         void load(ESM::ESMReader &esm, Loading::Listener* listener);
 
+        /// Scan the records of a content file without decoding them. They are loaded by the next call
+        /// to loadQueued(), so the reader must be kept open until then.
+        void queueLoad(ESM::ESMReader &esm, Loading::Listener* listener);
+
+        /// Load all records queued by queueLoad(). Records belonging to different stores are decoded
+        /// concurrently on the work queue, while the records of each store are applied in content file
+        /// order, so overrides and deletions resolve the same way as with load().
+        /// @note Each work item reads through its own copy of the readers, which is only possible with
+        /// memory mapped readers. Otherwise, or without a work queue, the records are loaded on the calling thread,
+        /// which reads them a second time, so only queue the records of memory mapped readers.
+        void loadQueued(const std::vector<ESM::ESMReader> &readers, SceneUtil::WorkQueue* workQueue, Loading::Listener* listener);
+
+        /// Can the merged records of this type be stored in the record cache? Cells, lands, pathgrids and
+        /// land textures refer back to their content files, so they are always loaded from the content files.
+        static bool isCachedRecord(int type);
+
+        /// Skip records of cached types when loading content files, because they were loaded by loadCache().
+        void setSkipCachedRecords(bool skip);
+
+        /// Write the merged static records of all cached types. Must be called after setUp().
+        void writeCache(ESM::ESMWriter& writer) const;
+
+        /// Load records written by writeCache().
+        void loadCache(ESM::ESMReader& esm, Loading::Listener* listener);
+
         template <class T>
         const Store<T> &get() const {
             throw std::runtime_error("Storage for this type not exist");
@@ -221,6 +298,7 @@ namespace MWWorld
             for (iterator it = mStores.begin(); it != mStores.end(); ++it) {
                 if (it->second == &store) {
                     mIds[ptr->mId] = it->first;
+                    mStaticIds[ptr->mId] = it->first;
                 }
             }
             return ptr;
@@ -228,6 +306,8 @@ namespace MWWorld
 
         // This method must be called once, after loading all master/plugin files. This can only be done
         //  from the outside, so it must be public.
+        // It is called again after loading the dynamic records of a saved game, which does not affect the
+        //  content file records (see findStatic()).
         void setUp();
 
         int countSavedGameRecords() const;
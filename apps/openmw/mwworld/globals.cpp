@@ -31,27 +31,57 @@ namespace MWWorld
         return iter;
     }
 
+    Globals::Globals() : mRevision (0) {}
+
     void Globals::fill (const MWWorld::ESMStore& store)
     {
         mVariables.clear();
+        mValues.clear();
+        ++mRevision;
 
         const MWWorld::Store<ESM::Global>& globals = store.get<ESM::Global>();
 
         for (MWWorld::Store<ESM::Global>::iterator iter = globals.begin(); iter!=globals.end();
             ++iter)
         {
-            mVariables.insert (std::make_pair (Misc::StringUtils::lowerCase (iter->mId), *iter));
+            if (mVariables.insert (std::make_pair (Misc::StringUtils::lowerCase (iter->mId), static_cast<int> (mValues.size()))).second)
+                mValues.push_back (*iter);
         }
     }
 
     const ESM::Variant& Globals::operator[] (const std::string& name) const
     {
-        return find (Misc::StringUtils::lowerCase (name))->second.mValue;
+        return mValues[find (Misc::StringUtils::lowerCase (name))->second].mValue;
     }
 
     ESM::Variant& Globals::operator[] (const std::string& name)
     {
-        return find (Misc::StringUtils::lowerCase (name))->second.mValue;
+        return mValues[find (Misc::StringUtils::lowerCase (name))->second].mValue;
+    }
+
+    int Globals::getHandle (const std::string& name) const
+    {
+        Collection::const_iterator iter = mVariables.find (Misc::StringUtils::lowerCase (name));
+
+        if (iter==mVariables.end())
+            return -1;
+
+        return iter->second;
+    }
+
+    const ESM::Variant& Globals::operator[] (int handle) const
+    {
+        return mValues.at (handle).mValue;
+    }
+
+    ESM::Variant& Globals::operator[] (int handle)
+    {
+        return mValues.at (handle).mValue;
+    }
+
+    int Globals::getRevision() const
+    {
+        return mRevision;
     }
 
     char Globals::getType (const std::string& name) const
@@ -61,7 +91,7 @@ namespace MWWorld
         if (iter==mVariables.end())
             return ' ';
 
-        switch (iter->second.mValue.getType())
+        switch (mValues[iter->second].mValue.getType())
         {
             case ESM::VT_Short: return 's';
             case ESM::VT_Long: return 'l';
@@ -81,7 +111,7 @@ namespace MWWorld
         for (Collection::const_iterator iter (mVariables.begin()); iter!=mVariables.end(); ++iter)
         {
             writer.startRecord (ESM::REC_GLOB);
-            iter->second.save (writer);
+            mValues[iter->second].save (writer);
             writer.endRecord (ESM::REC_GLOB);
         }
     }
@@ -100,7 +130,7 @@ namespace MWWorld
 
             Collection::iterator iter = mVariables.find (global.mId);
             if (iter!=mVariables.end())
-                iter->second = global;
+                mValues[iter->second] = global;
 
             return true;
         }
@@ -29,9 +29,13 @@ namespace MWWorld
     {
         private:
 
-            typedef std::map<std::string, ESM::Global> Collection;
+            typedef std::map<std::string, int> Collection;
 
-            Collection mVariables; // type, value
+            Collection mVariables; // name, handle
+
+            std::vector<ESM::Global> mValues; // type, value; indexed by handle
+
+            int mRevision;
 
             Collection::const_iterator find (const std::string& name) const;
 
@@ -39,6 +43,8 @@ namespace MWWorld
 
         public:
 
+            Globals();
+
             const ESM::Variant& operator[] (const std::string& name) const;
 
             ESM::Variant& operator[] (const std::string& name);
@@ -46,6 +52,17 @@ namespace MWWorld
             char getType (const std::string& name) const;
             ///< If there is no global variable with this name, ' ' is returned.
 
+            int getHandle (const std::string& name) const;
+            ///< Return a handle for accessing variable \a name without searching for it (-1: no such
+            /// variable).
+
+            const ESM::Variant& operator[] (int handle) const;
+
+            ESM::Variant& operator[] (int handle);
+
+            int getRevision() const;
+            ///< Handles are invalidated when the revision changes.
+
             void fill (const MWWorld::ESMStore& store);
             ///< Replace variables with variables from \a store with default values.
 
@@ -61,7 +61,7 @@ namespace
 
 }
 
-MWWorld::LocalScripts::LocalScripts (const MWWorld::ESMStore& store) : mStore (store)
+MWWorld::LocalScripts::LocalScripts (const MWWorld::ESMStore& store) : mDeferred (mScripts), mStore (store)
 {
     mIter = mScripts.end();
 }
@@ -82,6 +82,11 @@ bool MWWorld::LocalScripts::getNext(std::pair<std::string, Ptr>& script)
     return false;
 }
 
+size_t MWWorld::LocalScripts::getSize() const
+{
+    return mScripts.size();
+}
+
 void MWWorld::LocalScripts::add (const std::string& scriptName, const Ptr& ptr)
 {
     if (const ESM::Script *script = mStore.get<ESM::Script>().search (scriptName))
@@ -127,6 +132,8 @@ void MWWorld::LocalScripts::addCell (CellStore *cell)
 void MWWorld::LocalScripts::clear()
 {
     mScripts.clear();
+    mIter = mScripts.end();
+    mDeferred.clear();
 }
 
 void MWWorld::LocalScripts::clearCell (CellStore *cell)
@@ -139,6 +146,7 @@ void MWWorld::LocalScripts::clearCell (CellStore *cell)
         {
             if (iter==mIter)
                ++mIter;
+            mDeferred.erase (iter);
 
             mScripts.erase (iter++);
         }
@@ -155,6 +163,7 @@ void MWWorld::LocalScripts::remove (RefData *ref)
         {
             if (iter==mIter)
                 ++mIter;
+            mDeferred.erase (iter);
 
             mScripts.erase (iter);
             break;
@@ -169,6 +178,7 @@ void MWWorld::LocalScripts::remove (const Ptr& ptr)
         {
             if (iter==mIter)
                 ++mIter;
+            mDeferred.erase (iter);
 
             mScripts.erase (iter);
             break;
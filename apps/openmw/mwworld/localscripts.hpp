@@ -5,6 +5,7 @@
 #include <string>
 
 #include "ptr.hpp"
+#include "roundrobin.hpp"
 
 namespace MWWorld
 {
@@ -17,6 +18,7 @@ namespace MWWorld
     {
             std::list<std::pair<std::string, Ptr> > mScripts;
             std::list<std::pair<std::string, Ptr> >::iterator mIter;
+            RoundRobin<std::pair<std::string, Ptr> > mDeferred;
             const MWWorld::ESMStore& mStore;
 
         public:
@@ -30,6 +32,16 @@ namespace MWWorld
             ///< Get next local script
             /// @return Did we get a script?
 
+            /// Start a second iteration, which continues after the last script run by the previous one and wraps around
+            /// at the end of the list. Runs scripts with \a function until \a isOverBudget returns true, see RoundRobin::visit().
+            template <class Function, class Predicate>
+            size_t runDeferred(Function& function, Predicate& isOverBudget, size_t maxDelay)
+            {
+                return mDeferred.visit(function, isOverBudget, maxDelay);
+            }
+
+            size_t getSize() const;
+
             void add (const std::string& scriptName, const Ptr& ptr);
             ///< Add script to collection of active local scripts.
 
@@ -6,9 +6,12 @@ namespace
 {
 
     template<typename T>
-    void create(const MWWorld::Store<T>& list, const std::string& name, boost::any& refValue, MWWorld::Ptr& ptrValue)
+    void create(const MWWorld::Store<T>& list, const std::string& name, boost::any& refValue, MWWorld::Ptr& ptrValue,
+                bool staticOnly)
     {
-        const T* base = list.find(name);
+        const T* base = staticOnly ? list.searchStatic(name) : list.find(name);
+        if (!base)
+            throw std::runtime_error(T::getRecordType() + " '" + name + "' not found");
 
         ESM::CellRef cellRef;
         cellRef.mRefNum.unset();
@@ -30,32 +33,32 @@ namespace
     }
 }
 
-MWWorld::ManualRef::ManualRef(const MWWorld::ESMStore& store, const std::string& name, const int count)
+MWWorld::ManualRef::ManualRef(const MWWorld::ESMStore& store, const std::string& name, const int count, bool staticOnly)
 {
     std::string lowerName = Misc::StringUtils::lowerCase(name);
-    switch (store.find(lowerName))
+    switch (staticOnly ? store.findStatic(lowerName) : store.find(lowerName))
     {
-    case ESM::REC_ACTI: create(store.get<ESM::Activator>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_ALCH: create(store.get<ESM::Potion>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_APPA: create(store.get<ESM::Apparatus>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_ARMO: create(store.get<ESM::Armor>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_BOOK: create(store.get<ESM::Book>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_CLOT: create(store.get<ESM::Clothing>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_CONT: create(store.get<ESM::Container>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_CREA: create(store.get<ESM::Creature>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_DOOR: create(store.get<ESM::Door>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_INGR: create(store.get<ESM::Ingredient>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_LEVC: create(store.get<ESM::CreatureLevList>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_LEVI: create(store.get<ESM::ItemLevList>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_LIGH: create(store.get<ESM::Light>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_LOCK: create(store.get<ESM::Lockpick>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_MISC: create(store.get<ESM::Miscellaneous>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_NPC_: create(store.get<ESM::NPC>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_PROB: create(store.get<ESM::Probe>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_REPA: create(store.get<ESM::Repair>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_STAT: create(store.get<ESM::Static>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_WEAP: create(store.get<ESM::Weapon>(), lowerName, mRef, mPtr); break;
-    case ESM::REC_BODY: create(store.get<ESM::BodyPart>(), lowerName, mRef, mPtr); break;
+    case ESM::REC_ACTI: create(store.get<ESM::Activator>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_ALCH: create(store.get<ESM::Potion>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_APPA: create(store.get<ESM::Apparatus>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_ARMO: create(store.get<ESM::Armor>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_BOOK: create(store.get<ESM::Book>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_CLOT: create(store.get<ESM::Clothing>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_CONT: create(store.get<ESM::Container>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_CREA: create(store.get<ESM::Creature>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_DOOR: create(store.get<ESM::Door>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_INGR: create(store.get<ESM::Ingredient>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_LEVC: create(store.get<ESM::CreatureLevList>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_LEVI: create(store.get<ESM::ItemLevList>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_LIGH: create(store.get<ESM::Light>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_LOCK: create(store.get<ESM::Lockpick>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_MISC: create(store.get<ESM::Miscellaneous>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_NPC_: create(store.get<ESM::NPC>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_PROB: create(store.get<ESM::Probe>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_REPA: create(store.get<ESM::Repair>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_STAT: create(store.get<ESM::Static>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_WEAP: create(store.get<ESM::Weapon>(), lowerName, mRef, mPtr, staticOnly); break;
+    case ESM::REC_BODY: create(store.get<ESM::BodyPart>(), lowerName, mRef, mPtr, staticOnly); break;
 
     case 0:
         throw std::logic_error("failed to create manual cell ref for " + lowerName + " (unknown ID)");
@@ -17,7 +17,9 @@ namespace MWWorld
             ManualRef& operator= (const ManualRef&);
 
         public:
-            ManualRef(const MWWorld::ESMStore& store, const std::string& name, const int count = 1);
+            /// @param staticOnly Only look at the records loaded from the content files. This makes the construction
+            /// thread safe, see ESMStore::findStatic().
+            ManualRef(const MWWorld::ESMStore& store, const std::string& name, const int count = 1, bool staticOnly = false);
 
             const Ptr& getPtr() const
             {
@@ -0,0 +1,146 @@
+#include "recordcache.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
+#include <components/esm/defs.hpp>
+
+#include <components/loadinglistener/loadinglistener.hpp>
+
+#include <components/to_utf8/to_utf8.hpp>
+
+#include "esmstore.hpp"
+
+namespace
+{
+    const int sCacheKeyRecord = ESM::FourCC<'C','K','E','Y'>::value;
+
+    // Increase when the layout of the cache or of any cached record changes
+    const int sCacheVersion = 2;
+}
+
+namespace MWWorld
+{
+
+    RecordCache::RecordCache(const boost::filesystem::path& cacheFile, const ContentFileKey& key, ToUTF8::Utf8Encoder* encoder)
+        : mCacheFile(cacheFile)
+        , mKey(key)
+        , mEncoder(encoder)
+    {
+    }
+
+    bool RecordCache::load(ESMStore& store, Loading::Listener* listener)
+    {
+        if (!boost::filesystem::exists(mCacheFile))
+            return false;
+
+        ESM::ESMReader reader;
+        reader.setEncoder(mEncoder);
+
+        try
+        {
+            reader.open(mCacheFile.string());
+
+            if (!reader.hasMoreRecs() || reader.getRecName().intval != sCacheKeyRecord)
+                return false;
+            reader.getRecHeader();
+
+            int version = 0;
+            reader.getHNT(version, "VERS");
+            int encoding = -1;
+            reader.getHNT(encoding, "ENCD");
+
+            if (version != sCacheVersion || encoding != (mEncoder ? mEncoder->getEncoding() : -1) || !mKey.matches(reader))
+                return false;
+
+            // Check the layout of the whole cache before the store is modified, so a truncated or otherwise
+            // damaged cache can still be ignored in favour of the content files
+            ESM::ESM_Context records = reader.getContext();
+            while (reader.hasMoreRecs())
+            {
+                ESM::NAME name = reader.getRecName();
+                reader.getRecHeader();
+                if (!ESMStore::isCachedRecord(name.intval))
+                    reader.fail("Unexpected record in record cache");
+                while (reader.hasMoreSubs())
+                {
+                    reader.getSubName();
+                    reader.skipHSub();
+                }
+            }
+            reader.restoreContext(records);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Ignoring invalid record cache " << mCacheFile.string() << ": " << e.what() << std::endl;
+            return false;
+        }
+
+        std::cout << "Loading record cache " << mCacheFile.string() << std::endl;
+
+        try
+        {
+            store.loadCache(reader, listener);
+        }
+        catch (std::exception&)
+        {
+            // A record that failed to decode despite the valid layout. The store was modified already,
+            // so we can't fall back to the content files any more. Remove the cache, so it will be rebuilt on the next startup.
+            reader.close();
+            boost::filesystem::remove(mCacheFile);
+            throw;
+        }
+
+        return true;
+    }
+
+    void RecordCache::write(const ESMStore& store)
+    {
+        const boost::filesystem::path tempFile = mCacheFile.string() + ".tmp";
+
+        try
+        {
+            if (mCacheFile.has_parent_path())
+                boost::filesystem::create_directories(mCacheFile.parent_path());
+
+            {
+                boost::filesystem::ofstream stream(tempFile, std::ios::binary);
+                if (!stream.is_open())
+                    throw std::runtime_error("can't open " + tempFile.string());
+
+                ESM::ESMWriter writer;
+                writer.setEncoder(mEncoder);
+                writer.setFormat(0);
+                writer.save(stream);
+
+                writer.startRecord(sCacheKeyRecord);
+                writer.writeHNT("VERS", sCacheVersion);
+                writer.writeHNT("ENCD", mEncoder ? static_cast<int>(mEncoder->getEncoding()) : -1);
+                mKey.write(writer);
+                writer.endRecord(sCacheKeyRecord);
+
+                store.writeCache(writer);
+
+                writer.close();
+
+                if (!stream)
+                    throw std::runtime_error("write error");
+            }
+
+            // Replace the old cache only once the new one is complete
+            boost::filesystem::rename(tempFile, mCacheFile);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Failed to write record cache " << mCacheFile.string() << ": " << e.what() << std::endl;
+            boost::system::error_code ec;
+            boost::filesystem::remove(tempFile, ec);
+        }
+    }
+
+}
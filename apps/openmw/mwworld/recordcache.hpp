@@ -0,0 +1,45 @@
+#ifndef GAME_MWWORLD_RECORDCACHE_H
+#define GAME_MWWORLD_RECORDCACHE_H
+
+#include <boost/filesystem/path.hpp>
+
+#include "contentfilekey.hpp"
+
+namespace ToUTF8
+{
+    class Utf8Encoder;
+}
+
+namespace Loading
+{
+    class Listener;
+}
+
+namespace MWWorld
+{
+    class ESMStore;
+
+    /// @brief On-disk snapshot of the merged records of an ESMStore, so the content files do not have to be
+    /// decoded again on the next startup. Only record types for which ESMStore::isCachedRecord() is true are cached.
+    /// @note The cache is keyed by the content files (see ContentFileKey), and is rebuilt automatically when any of them change.
+    class RecordCache
+    {
+    public:
+        RecordCache(const boost::filesystem::path& cacheFile, const ContentFileKey& key, ToUTF8::Utf8Encoder* encoder);
+
+        /// Load the cached records into the store.
+        /// @return false if the cache does not exist or is out of date, in which case the store is not modified.
+        bool load(ESMStore& store, Loading::Listener* listener);
+
+        /// Replace the cache by the merged records of the given store, must be called after ESMStore::setUp().
+        /// @note Errors are reported but not fatal, the cache will be rebuilt on the next startup.
+        void write(const ESMStore& store);
+
+    private:
+        boost::filesystem::path mCacheFile;
+        ContentFileKey mKey;
+        ToUTF8::Utf8Encoder* mEncoder;
+    };
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef GAME_MWWORLD_ROUNDROBIN_H
+#define GAME_MWWORLD_ROUNDROBIN_H
+
+#include <list>
+
+namespace MWWorld
+{
+    /// \brief Visits the elements of a list in turns, over several passes
+    ///
+    /// Each pass continues after the last element visited by the previous one and wraps around at the end
+    /// of the list, so elements that are skipped because a pass stopped early are first in line for the next one.
+    template <class T>
+    class RoundRobin
+    {
+            std::list<T>& mList;
+            typename std::list<T>::iterator mIter;
+            size_t mCount;
+
+        public:
+
+            RoundRobin (std::list<T>& list) : mList (list), mIter (list.end()), mCount (0) {}
+
+            /// Start a pass, which continues after the last element returned by getNext().
+            void start()
+            {
+                mCount = 0;
+            }
+
+            /// Get the next element, wrapping around at the end of the list.
+            /// @return false, once every element was returned since the call to start().
+            bool getNext (T& value)
+            {
+                if (mCount>=mList.size())
+                    return false;
+
+                if (mIter==mList.end())
+                    mIter = mList.begin();
+
+                value = *mIter++;
+                ++mCount;
+                return true;
+            }
+
+            /// Start a pass and call \a function on the elements until \a isOverBudget returns true, but
+            /// on enough elements that every element is visited at least once every \a maxDelay passes.
+            /// @return The number of elements visited.
+            template <class Function, class Predicate>
+            size_t visit (Function& function, Predicate& isOverBudget, size_t maxDelay)
+            {
+                const size_t minCount = (mList.size() + maxDelay - 1) / maxDelay;
+
+                start();
+                size_t count = 0;
+                T value;
+                while (getNext (value))
+                {
+                    ++count;
+                    function (value);
+
+                    if (count>=minCount && isOverBudget())
+                        break;
+                }
+                return count;
+            }
+
+            /// Must be called before \a iter is erased from the list.
+            void erase (typename std::list<T>::iterator iter)
+            {
+                if (iter==mIter)
+                    ++mIter;
+            }
+
+            /// Must be called after the list was cleared.
+            void clear()
+            {
+                mIter = mList.end();
+            }
+    };
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "scene.hpp"
 
+#include <cmath>
 #include <limits>
 #include <iostream>
 
@@ -8,6 +9,7 @@
 #include <components/settings/settings.hpp>
 #include <components/resource/resourcesystem.hpp>
 #include <components/resource/scenemanager.hpp>
+#include <components/resource/imagemanager.hpp>
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
@@ -252,6 +254,15 @@ namespace MWWorld
         MWBase::Environment::get().getWorld()->getLocalScripts().clearCell (*iter);
 
         MWBase::Environment::get().getSoundManager()->stopSound (*iter);
+
+        for (std::unordered_map<int, Ptr>::iterator it = mActorIds.begin(); it != mActorIds.end();)
+        {
+            if (it->second.getCell() == *iter)
+                it = mActorIds.erase(it);
+            else
+                ++it;
+        }
+
         mActiveCells.erase(*iter);
     }
 
@@ -296,6 +307,8 @@ namespace MWWorld
             /// \todo rescale depending on the state of a new GMST
             insertCell (*cell, true, loadingListener);
 
+            cell->indexActors(mActorIds);
+
             mRendering.addCell(cell);
             bool waterEnabled = cell->getCell()->hasWater() || cell->isExterior();
             float waterLevel = cell->getWaterLevel();
@@ -321,6 +334,7 @@ namespace MWWorld
         while (active!=mActiveCells.end())
             unloadCell (active++);
         assert(mActiveCells.empty());
+        mActorIds.clear();
         mCurrentCell = NULL;
 
         mPreloader->clear();
@@ -486,11 +500,14 @@ namespace MWWorld
         mPhysics->setUnrefQueue(rendering.getUnrefQueue());
 
         rendering.getResourceSystem()->setExpiryDelay(Settings::Manager::getFloat("cache expiry delay", "Cells"));
+        int textureCacheSize = std::max(0, Settings::Manager::getInt("texture cache size", "Cells"));
+        rendering.getResourceSystem()->getImageManager()->setMemoryBudget(static_cast<size_t>(textureCacheSize) * 1024 * 1024);
 
         mPreloader->setExpiryDelay(Settings::Manager::getFloat("preload cell expiry delay", "Cells"));
         mPreloader->setMinCacheSize(Settings::Manager::getInt("preload cell cache min", "Cells"));
         mPreloader->setMaxCacheSize(Settings::Manager::getInt("preload cell cache max", "Cells"));
         mPreloader->setPreloadInstances(Settings::Manager::getBool("preload instances", "Cells"));
+        mPreloader->setPreloadScripts(Settings::Manager::getBool("preload scripts", "Cells"));
     }
 
     Scene::~Scene()
@@ -606,6 +623,7 @@ namespace MWWorld
         {
             addObject(ptr, *mPhysics, mRendering);
             MWBase::Environment::get().getWorld()->scaleObject(ptr, ptr.getCellRef().getScale());
+            updateActorPtr(ptr);
         }
         catch (std::exception& e)
         {
@@ -637,12 +655,23 @@ namespace MWWorld
 
     Ptr Scene::searchPtrViaActorId (int actorId)
     {
-        for (CellStoreCollection::const_iterator iter (mActiveCells.begin());
-            iter!=mActiveCells.end(); ++iter)
-            if (Ptr ptr = (*iter)->searchViaActorId (actorId))
-                return ptr;
+        std::unordered_map<int, Ptr>::const_iterator found = mActorIds.find(actorId);
+        if (found == mActorIds.end())
+            return Ptr();
+
+        // The actor may have been deleted or moved to an inactive cell since it was indexed
+        const Ptr& ptr = found->second;
+        if (mActiveCells.find(ptr.getCell()) == mActiveCells.end() || ptr.getRefData().getCount() <= 0
+                || !ptr.getClass().getCreatureStats(ptr).matchesActorId(actorId))
+            return Ptr();
 
-        return Ptr();
+        return ptr;
+    }
+
+    void Scene::updateActorPtr (const Ptr& ptr)
+    {
+        if (ptr.getClass().isActor() && ptr.isInCell() && ptr != MWBase::Environment::get().getWorld()->getPlayerPtr())
+            mActorIds[ptr.getClass().getCreatureStats(ptr).getActorId()] = ptr;
     }
 
     class PreloadMeshItem : public SceneUtil::WorkItem
@@ -674,6 +703,7 @@ namespace MWWorld
         if (useAnim)
             mesh_ = Misc::ResourceHelpers::correctActorModelPath(mesh_, mRendering.getResourceSystem()->getVFS());
 
+        // Default priority, e.g. the effects of a spell being cast are needed before the cells being preloaded
         if (!mRendering.getResourceSystem()->getSceneManager()->checkLoaded(mesh_, mRendering.getReferenceTime()))
             mRendering.getWorkQueue()->addWorkItem(new PreloadMeshItem(mesh_, mRendering.getResourceSystem()->getSceneManager()));
     }
@@ -731,16 +761,17 @@ namespace MWWorld
 
             if (sqrDistToPlayer < mPreloadDistance*mPreloadDistance)
             {
+                float dist = std::sqrt(sqrDistToPlayer);
                 try
                 {
                     if (!door.getCellRef().getDestCell().empty())
-                        preloadCell(MWBase::Environment::get().getWorld()->getInterior(door.getCellRef().getDestCell()));
+                        preloadCell(MWBase::Environment::get().getWorld()->getInterior(door.getCellRef().getDestCell()), false, dist);
                     else
                     {
                         osg::Vec3f pos = door.getCellRef().getDoorDest().asVec3();
                         int x,y;
                         MWBase::Environment::get().getWorld()->positionToIndex (pos.x(), pos.y(), x, y);
-                        preloadCell(MWBase::Environment::get().getWorld()->getExterior(x,y), true);
+                        preloadCell(MWBase::Environment::get().getWorld()->getExterior(x,y), true, dist);
                         exteriorPositions.push_back(pos);
                     }
                 }
@@ -781,12 +812,12 @@ namespace MWWorld
                 float loadDist = 8192/2 + 8192 - mCellLoadingThreshold + mPreloadDistance;
 
                 if (dist < loadDist)
-                    preloadCell(MWBase::Environment::get().getWorld()->getExterior(cellX+dx, cellY+dy));
+                    preloadCell(MWBase::Environment::get().getWorld()->getExterior(cellX+dx, cellY+dy), false, dist);
             }
         }
     }
 
-    void Scene::preloadCell(CellStore *cell, bool preloadSurrounding)
+    void Scene::preloadCell(CellStore *cell, bool preloadSurrounding, float distance)
     {
         if (preloadSurrounding && cell->isExterior())
         {
@@ -797,14 +828,14 @@ namespace MWWorld
             {
                 for (int dy = -mHalfGridSize; dy <= mHalfGridSize; ++dy)
                 {
-                    mPreloader->preload(MWBase::Environment::get().getWorld()->getExterior(x+dx, y+dy), mRendering.getReferenceTime());
+                    mPreloader->preload(MWBase::Environment::get().getWorld()->getExterior(x+dx, y+dy), mRendering.getReferenceTime(), distance);
                     if (++numpreloaded >= mPreloader->getMaxCacheSize())
                         break;
                 }
             }
         }
         else
-            mPreloader->preload(cell, mRendering.getReferenceTime());
+            mPreloader->preload(cell, mRendering.getReferenceTime(), distance);
     }
 
     void Scene::preloadTerrain(const osg::Vec3f &pos)
@@ -858,14 +889,15 @@ namespace MWWorld
 
         for (std::vector<ESM::Transport::Dest>::const_iterator it = listVisitor.mList.begin(); it != listVisitor.mList.end(); ++it)
         {
+            // travel needs a dialogue first, so these are less urgent than any cell within reach
             if (!it->mCellName.empty())
-                preloadCell(MWBase::Environment::get().getWorld()->getInterior(it->mCellName));
+                preloadCell(MWBase::Environment::get().getWorld()->getInterior(it->mCellName), false, std::numeric_limits<float>::max());
             else
             {
                 osg::Vec3f pos = it->mPos.asVec3();
                 int x,y;
                 MWBase::Environment::get().getWorld()->positionToIndex( pos.x(), pos.y(), x, y);
-                preloadCell(MWBase::Environment::get().getWorld()->getExterior(x,y), true);
+                preloadCell(MWBase::Environment::get().getWorld()->getExterior(x,y), true, std::numeric_limits<float>::max());
                 exteriorPositions.push_back(pos);
             }
         }
@@ -6,6 +6,7 @@
 
 #include <set>
 #include <memory>
+#include <unordered_map>
 
 namespace osg
 {
@@ -70,6 +71,9 @@ namespace MWWorld
 
             osg::Vec3f mLastPlayerPos;
 
+            /// Actors of the active cells by actor ID, for searchPtrViaActorId
+            std::unordered_map<int, Ptr> mActorIds;
+
             void insertCell (CellStore &cell, bool rescale, Loading::Listener* loadingListener);
 
             // Load and unload cells as necessary to create a cell grid with "X" and "Y" in the center
@@ -88,7 +92,8 @@ namespace MWWorld
 
             ~Scene();
 
-            void preloadCell(MWWorld::CellStore* cell, bool preloadSurrounding=false);
+            /// @param distance Distance of the cell to the player, closer cells get preloaded first.
+            void preloadCell(MWWorld::CellStore* cell, bool preloadSurrounding=false, float distance=0.f);
             void preloadTerrain(const osg::Vec3f& pos);
 
             void unloadCell (CellStoreCollection::iterator iter);
@@ -133,6 +138,10 @@ namespace MWWorld
             bool isCellActive(const CellStore &cell);
 
             Ptr searchPtrViaActorId (int actorId);
+            ///< Search the active cells for an actor. Does not include the player.
+
+            void updateActorPtr (const Ptr& ptr);
+            ///< Update the Ptr found by searchPtrViaActorId for this actor, after it was created or moved to another cell.
 
             void preload(const std::string& mesh, bool useAnim=false);
     };
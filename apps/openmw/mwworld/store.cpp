@@ -30,6 +30,23 @@ namespace
         }
     };
 
+    /// The flags of the record header that are read back by the record's load(), see writeStatic()
+    template<typename T>
+    uint32_t getRecordFlags(const T&)
+    {
+        return 0;
+    }
+
+    uint32_t getRecordFlags(const ESM::NPC& npc)
+    {
+        return npc.mPersistent ? 0x0400 : 0;
+    }
+
+    uint32_t getRecordFlags(const ESM::Creature& creature)
+    {
+        return creature.mPersistent ? 0x0400 : 0;
+    }
+
     struct Compare
     {
         bool operator()(const ESM::Land *x, const ESM::Land *y) {
@@ -152,6 +169,19 @@ namespace MWWorld
         return 0;
     }
     template<typename T>
+    const T *Store<T>::searchStatic(const std::string &id) const
+    {
+        std::string idLower = Misc::StringUtils::lowerCase(id);
+
+        typename Static::const_iterator it = mStatic.find(idLower);
+
+        if (it != mStatic.end() && Misc::StringUtils::ciEqual(it->second.mId, id)) {
+            return &(it->second);
+        }
+
+        return 0;
+    }
+    template<typename T>
     bool Store<T>::isDynamic(const std::string &id) const
     {
         typename Dynamic::const_iterator dit = mDynamic.find(id);
@@ -330,6 +360,18 @@ namespace MWWorld
         }
     }
     template<typename T>
+    void Store<T>::writeStatic (ESM::ESMWriter& writer) const
+    {
+        // The static records are at the front of mShared, in load order
+        typename std::vector<T *>::const_iterator end = mShared.begin() + mStatic.size();
+        for (typename std::vector<T *>::const_iterator iter (mShared.begin()); iter!=end; ++iter)
+        {
+            writer.startRecord (T::sRecordId, getRecordFlags(**iter));
+            (*iter)->save (writer);
+            writer.endRecord (T::sRecordId);
+        }
+    }
+    template<typename T>
     RecordId Store<T>::read(ESM::ESMReader& reader)
     {
         T record;
@@ -1072,6 +1114,25 @@ namespace MWWorld
         return RecordId(dialogue.mId, isDeleted);
     }
 
+    template<>
+    void Store<ESM::Dialogue>::writeStatic(ESM::ESMWriter& writer) const
+    {
+        for (Static::const_iterator it = mStatic.begin(); it != mStatic.end(); ++it)
+        {
+            const ESM::Dialogue& dialogue = it->second;
+            writer.startRecord (ESM::Dialogue::sRecordId);
+            dialogue.save (writer);
+            writer.endRecord (ESM::Dialogue::sRecordId);
+
+            for (ESM::Dialogue::InfoContainer::const_iterator info = dialogue.mInfo.begin(); info != dialogue.mInfo.end(); ++info)
+            {
+                writer.startRecord (ESM::DialInfo::sRecordId);
+                info->save (writer);
+                writer.endRecord (ESM::DialInfo::sRecordId);
+            }
+        }
+    }
+
 }
 
 template class MWWorld::Store<ESM::Activator>;
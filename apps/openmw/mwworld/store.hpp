@@ -46,6 +46,9 @@ namespace MWWorld
 
         virtual void write (ESM::ESMWriter& writer, Loading::Listener& progress) const {}
 
+        virtual void writeStatic (ESM::ESMWriter& writer) const {}
+        ///< Write the records loaded from content files, in the order they were loaded
+
         virtual RecordId read (ESM::ESMReader& reader) { return RecordId(); }
         ///< Read into dynamic storage
     };
@@ -161,6 +164,11 @@ namespace MWWorld
 
         const T *search(const std::string &id) const;
 
+        /// Look up a record loaded from the content files, ignoring the dynamic records.
+        /// @note Unlike search(), this is safe to call from worker threads while the main thread inserts
+        /// dynamic records, see ESMStore::findStatic().
+        const T *searchStatic(const std::string &id) const;
+
         /**
          * Does the record with this ID come from the dynamic store?
          */
@@ -193,6 +201,7 @@ namespace MWWorld
 
         RecordId load(ESM::ESMReader &esm);
         void write(ESM::ESMWriter& writer, Loading::Listener& progress) const;
+        void writeStatic(ESM::ESMWriter& writer) const;
         RecordId read(ESM::ESMReader& reader);
     };
 
@@ -3,6 +3,8 @@
 #include <osg/Group>
 #include <osg/ComputeBoundsVisitor>
 
+#include <OpenThreads/Thread>
+
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
 #include <components/esm/cellid.hpp>
@@ -15,6 +17,9 @@
 #include <components/resource/resourcesystem.hpp>
 
 #include <components/sceneutil/positionattitudetransform.hpp>
+#include <components/sceneutil/workqueue.hpp>
+
+#include <components/settings/settings.hpp>
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/soundmanager.hpp"
@@ -56,6 +61,7 @@
 
 #include "contentloader.hpp"
 #include "esmloader.hpp"
+#include "recordcache.hpp"
 
 namespace
 {
@@ -147,7 +153,7 @@ namespace MWWorld
         const std::vector<std::string>& contentFiles,
         ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
         int activationDistanceOverride, const std::string& startCell, const std::string& startupScript,
-            const std::string& resourcePath, const std::string& userDataPath)
+            const std::string& resourcePath, const std::string& userDataPath, const std::string& cachePath)
     : mResourceSystem(resourceSystem), mFallback(fallbackMap), mPlayer (0), mLocalScripts (mStore),
       mSky (true), mCells (mStore, mEsm),
       mGodMode(false), mScriptsEnabled(true), mContentFiles (contentFiles), mUserDataPath(userDataPath),
@@ -174,8 +180,33 @@ namespace MWWorld
         gameContentLoader.addLoader(".omwaddon", &esmLoader);
         gameContentLoader.addLoader(".project", &esmLoader);
 
+        osg::ref_ptr<SceneUtil::WorkQueue> loadingQueue;
+        int loadingThreads = Settings::Manager::getInt("content loading threads", "General");
+        if (loadingThreads <= 0)
+            loadingThreads = OpenThreads::GetNumberOfProcessors();
+        if (loadingThreads > 1)
+        {
+            loadingQueue = new SceneUtil::WorkQueue(loadingThreads);
+            esmLoader.setWorkQueue(loadingQueue.get());
+        }
+
+        // Load the merged records from the cache if none of the content files changed since it was written,
+        // only cells and other records referring back to their content files are then read from the content files
+        bool useRecordCache = Settings::Manager::getBool("record cache", "General");
+        bool loadedRecordCache = false;
+        std::unique_ptr<RecordCache> recordCache;
+        if (useRecordCache)
+        {
+            recordCache.reset(new RecordCache(boost::filesystem::path(cachePath) / "records.cache",
+                ContentFileKey(fileCollections, contentFiles), encoder));
+            loadedRecordCache = recordCache->load(mStore, listener);
+            mStore.setSkipCachedRecords(loadedRecordCache);
+        }
+
         loadContentFiles(fileCollections, contentFiles, gameContentLoader);
 
+        esmLoader.finishLoading();
+
         listener->loadingOff();
 
         // insert records that may not be present in all versions of MW
@@ -185,6 +216,10 @@ namespace MWWorld
         fillGlobalVariables();
 
         mStore.setUp();
+
+        if (useRecordCache && !loadedRecordCache)
+            recordCache->write(mStore);
+
         mStore.movePlayerRecord();
 
         mSwimHeightScale = mStore.get<ESM::GameSetting>().find("fSwimHeightScale")->getFloat();
@@ -616,6 +651,41 @@ namespace MWWorld
         return mGlobalVariables.getType (name);
     }
 
+    int World::getGlobalHandle (const std::string& name) const
+    {
+        // Setting these has side effects, see setGlobalInt
+        std::string lowerCase = Misc::StringUtils::lowerCase (name);
+        if (lowerCase=="gamehour" || lowerCase=="day" || lowerCase=="month")
+            return -1;
+
+        return mGlobalVariables.getHandle (lowerCase);
+    }
+
+    int World::getGlobalsRevision() const
+    {
+        return mGlobalVariables.getRevision();
+    }
+
+    void World::setLinkedGlobalInt (int handle, int value)
+    {
+        mGlobalVariables[handle].setInteger (value);
+    }
+
+    void World::setLinkedGlobalFloat (int handle, float value)
+    {
+        mGlobalVariables[handle].setFloat (value);
+    }
+
+    int World::getLinkedGlobalInt (int handle) const
+    {
+        return mGlobalVariables[handle].getInteger();
+    }
+
+    float World::getLinkedGlobalFloat (int handle) const
+    {
+        return mGlobalVariables[handle].getFloat();
+    }
+
     std::string World::getCellName (const MWWorld::CellStore *cell) const
     {
         if (!cell)
@@ -1193,12 +1263,17 @@ namespace MWWorld
 
                     newPtr = currCell->moveTo(ptr, newCell);
                     newPtr.getRefData().setBaseNode(0);
+                    mWorldScene->updateActorPtr(newPtr);
                 }
                 else if (!currCellActive && !newCellActive)
+                {
                     newPtr = currCell->moveTo(ptr, newCell);
+                    mWorldScene->updateActorPtr(newPtr);
+                }
                 else // both cells active
                 {
                     newPtr = currCell->moveTo(ptr, newCell);
+                    mWorldScene->updateActorPtr(newPtr);
 
                     mRendering->updatePtr(ptr, newPtr);
                     MWBase::Environment::get().getSoundManager()->updatePtr (ptr, newPtr);
@@ -1224,6 +1299,7 @@ namespace MWWorld
             mRendering->moveObject(newPtr, vec);
             if (movePhysics)
                 mPhysics->updatePosition(newPtr);
+            MWBase::Environment::get().getMechanicsManager()->updatePosition(newPtr);
         }
         if (isPlayer)
         {
@@ -1637,6 +1713,10 @@ namespace MWWorld
             mSpellPreloadTimer = 0.1f;
             preloadSpells();
         }
+
+        // With async physics, solve the movement queued in this frame while the frame is rendered
+        if (!paused)
+            mPhysics->startSimulation();
     }
 
     void World::updatePlayer(bool paused)
@@ -2489,6 +2569,28 @@ namespace MWWorld
         return mPhysics->getLineOfSight(actor, targetActor);
     }
 
+    void World::getLOS(const std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> >& actorPairs, std::vector<bool>& out)
+    {
+        // Only ask the physics system about pairs that pass the checks of the single version
+        std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> > queries;
+        std::vector<size_t> queryIndices;
+        for (std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> >::const_iterator it = actorPairs.begin(); it != actorPairs.end(); ++it)
+        {
+            if (!it->first.getRefData().isEnabled() || !it->second.getRefData().isEnabled()
+                    || !it->first.getRefData().getBaseNode() || !it->second.getRefData().getBaseNode())
+                continue;
+            queryIndices.push_back(it - actorPairs.begin());
+            queries.push_back(*it);
+        }
+
+        std::vector<bool> results;
+        mPhysics->getLinesOfSight(queries, results);
+
+        out.assign(actorPairs.size(), false);
+        for (size_t i=0; i<queryIndices.size(); ++i)
+            out[queryIndices[i]] = results[i];
+    }
+
     float World::getDistToNearestRayHit(const osg::Vec3f& from, const osg::Vec3f& dir, float maxDist, bool includeWater)
     {
         osg::Vec3f to (dir);
@@ -188,7 +188,8 @@ namespace MWWorld
                 const Files::Collections& fileCollections,
                 const std::vector<std::string>& contentFiles,
                 ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
-                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath, const std::string& userDataPath);
+                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath, const std::string& userDataPath,
+                const std::string& cachePath);
 
             virtual ~World();
 
@@ -260,6 +261,25 @@ namespace MWWorld
             virtual char getGlobalVariableType (const std::string& name) const;
             ///< Return ' ', if there is no global variable with this name.
 
+            virtual int getGlobalHandle (const std::string& name) const;
+            ///< Return a handle for accessing global variable \a name without searching for it
+            /// (-1: no such variable, or it must be accessed by name).
+
+            virtual int getGlobalsRevision() const;
+            ///< Global variable handles are invalidated when the revision changes.
+
+            virtual void setLinkedGlobalInt (int handle, int value);
+            ///< Set value independently from real type.
+
+            virtual void setLinkedGlobalFloat (int handle, float value);
+            ///< Set value independently from real type.
+
+            virtual int getLinkedGlobalInt (int handle) const;
+            ///< Get value independently from real type.
+
+            virtual float getLinkedGlobalFloat (int handle) const;
+            ///< Get value independently from real type.
+
             virtual std::string getCellName (const MWWorld::CellStore *cell = 0) const;
             ///< Return name of the cell.
             ///
@@ -541,6 +561,9 @@ namespace MWWorld
             virtual bool getLOS(const MWWorld::ConstPtr& actor,const MWWorld::ConstPtr& targetActor);
             ///< get Line of Sight (morrowind stupid implementation)
 
+            virtual void getLOS(const std::vector<std::pair<MWWorld::ConstPtr, MWWorld::ConstPtr> >& actorPairs, std::vector<bool>& out);
+            ///< get Line of Sight for each pair of actors in one batch, \a out receives one entry per pair
+
             virtual float getDistToNearestRayHit(const osg::Vec3f& from, const osg::Vec3f& dir, float maxDist, bool includeWater = false);
 
             virtual void enableActorCollision(const MWWorld::Ptr& actor, bool enable);
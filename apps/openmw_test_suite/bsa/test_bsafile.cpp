@@ -0,0 +1,317 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <zlib.h>
+
+#include <components/bsa/bsa_file.hpp>
+#include <components/bsa/compressedbsafile.hpp>
+
+namespace
+{
+    const char* sArchiveName = "test_bsafile.bsa";
+    const int sFileCount = 1000;
+    const int sFileSize = 32 * 1024;
+
+    std::string getFileName(int index)
+    {
+        std::ostringstream stream;
+        stream << "meshes\\test\\file" << index << ".nif";
+        return stream.str();
+    }
+
+    char getFileByte(int index, int offset)
+    {
+        return static_cast<char>((index * 31 + offset) & 0xff);
+    }
+
+    void writeUInt(std::ostream& stream, uint32_t value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), 4);
+    }
+
+    void writeUInt64(std::ostream& stream, uint64_t value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), 8);
+    }
+
+    std::string getCompressedFileContent(int folder, int index)
+    {
+        std::ostringstream stream;
+        for (int i=0; i<100; ++i)
+            stream << "folder " << folder << " file " << index << " line " << i << "\n";
+        return stream.str();
+    }
+
+    /// Write a TES4 style archive with two folders of three files each. The middle file of each
+    /// folder toggles the default compression, see Bsa::CompressedBSAFile::readHeader for the layout.
+    void writeCompressedArchive(const std::string& filename, bool compressByDefault, bool embedNames)
+    {
+        const int folderCount = 2;
+        const int filesPerFolder = 3;
+        const int fileCount = folderCount * filesPerFolder;
+
+        std::vector<std::string> folderNames;
+        std::vector<std::string> fileNames;
+        std::string fileNameBlock;
+        size_t folderNameLength = 0;
+        for (int i=0; i<folderCount; ++i)
+        {
+            std::ostringstream folder;
+            folder << "textures\\folder" << i;
+            folderNames.push_back(folder.str());
+            folderNameLength += folderNames.back().size() + 1;
+
+            for (int j=0; j<filesPerFolder; ++j)
+            {
+                std::ostringstream file;
+                file << "file" << j << ".dds";
+                fileNames.push_back(file.str());
+                fileNameBlock += file.str();
+                fileNameBlock += '\0';
+            }
+        }
+
+        // Build the stored data of all files
+        std::vector<std::string> data;
+        for (int i=0; i<fileCount; ++i)
+        {
+            const int folder = i / filesPerFolder;
+            const int index = i % filesPerFolder;
+            const std::string content = getCompressedFileContent(folder, index);
+            const bool compressed = (index == 1) != compressByDefault;
+
+            std::string stored;
+            if (embedNames)
+            {
+                const std::string path = folderNames[folder] + "\\" + fileNames[i];
+                stored += static_cast<char>(path.size());
+                stored += path;
+            }
+
+            if (compressed)
+            {
+                uLongf length = compressBound(content.size());
+                std::vector<char> buffer(length);
+                compress(reinterpret_cast<Bytef*>(&buffer[0]), &length, reinterpret_cast<const Bytef*>(content.data()), content.size());
+                const uint32_t size = content.size();
+                stored.append(reinterpret_cast<const char*>(&size), 4);
+                stored.append(&buffer[0], length);
+            }
+            else
+                stored += content;
+
+            data.push_back(stored);
+        }
+
+        const size_t recordsSize = 36 + folderCount * 16 + folderCount + folderNameLength + fileCount * 16;
+        size_t dataOffset = recordsSize + fileNameBlock.size();
+
+        std::ofstream file(filename.c_str(), std::ios::binary);
+        file.write("BSA\0", 4);
+        writeUInt(file, 104);
+        writeUInt(file, 36);
+        writeUInt(file, 0x1 | 0x2 | (compressByDefault ? 0x4 : 0) | (embedNames ? 0x100 : 0));
+        writeUInt(file, folderCount);
+        writeUInt(file, fileCount);
+        writeUInt(file, folderNameLength);
+        writeUInt(file, fileNameBlock.size());
+        writeUInt(file, 0);
+
+        for (int i=0; i<folderCount; ++i)
+        {
+            writeUInt64(file, 0);
+            writeUInt(file, filesPerFolder);
+            writeUInt(file, 0);
+        }
+
+        for (int i=0; i<folderCount; ++i)
+        {
+            file.put(static_cast<char>(folderNames[i].size() + 1));
+            file.write(folderNames[i].c_str(), folderNames[i].size() + 1);
+
+            for (int j=0; j<filesPerFolder; ++j)
+            {
+                const int index = i * filesPerFolder + j;
+                writeUInt64(file, 0);
+                writeUInt(file, data[index].size() | (j == 1 ? 0x40000000 : 0));
+                writeUInt(file, dataOffset);
+                dataOffset += data[index].size();
+            }
+        }
+
+        file.write(fileNameBlock.data(), fileNameBlock.size());
+
+        for (int i=0; i<fileCount; ++i)
+            file.write(data[i].data(), data[i].size());
+    }
+
+    /// Write a TES3 style archive, see Bsa::BSAFile::readHeader for the layout
+    void writeArchive(const std::string& filename)
+    {
+        std::string names;
+        std::vector<uint32_t> nameOffsets;
+        for (int i=0; i<sFileCount; ++i)
+        {
+            nameOffsets.push_back(names.size());
+            names += getFileName(i);
+            names += '\0';
+        }
+
+        std::ofstream file(filename.c_str(), std::ios::binary);
+
+        writeUInt(file, 0x100);
+        writeUInt(file, 12*sFileCount + names.size());
+        writeUInt(file, sFileCount);
+
+        for (int i=0; i<sFileCount; ++i)
+        {
+            writeUInt(file, sFileSize);
+            writeUInt(file, i * sFileSize);
+        }
+        for (int i=0; i<sFileCount; ++i)
+            writeUInt(file, nameOffsets[i]);
+        file.write(names.data(), names.size());
+
+        // hash table, not used by the reader
+        for (int i=0; i<sFileCount; ++i)
+        {
+            writeUInt(file, 0);
+            writeUInt(file, 0);
+        }
+
+        std::vector<char> data(sFileSize);
+        for (int i=0; i<sFileCount; ++i)
+        {
+            for (int j=0; j<sFileSize; ++j)
+                data[j] = getFileByte(i, j);
+            file.write(&data[0], data.size());
+        }
+    }
+
+    typedef Files::IStreamPtr (*OpenFunction)(Bsa::BSAFile& bsa, const Bsa::BSAFile::FileStruct* file);
+
+    /// Read all files of the archive, returns false if any content does not match
+    bool readArchive(Bsa::BSAFile& bsa, OpenFunction open)
+    {
+        std::vector<char> data(sFileSize);
+        const Bsa::BSAFile::FileList& list = bsa.getList();
+        for (size_t i=0; i<list.size(); ++i)
+        {
+            Files::IStreamPtr stream = open(bsa, &list[i]);
+            stream->read(&data[0], data.size());
+            if (stream->gcount() != sFileSize)
+                return false;
+
+            int index = 0;
+            std::sscanf(list[i].name, "meshes\\test\\file%d.nif", &index);
+            if (data[0] != getFileByte(index, 0) || data[sFileSize-1] != getFileByte(index, sFileSize-1))
+                return false;
+        }
+        return true;
+    }
+
+    Files::IStreamPtr openArchiveFile(Bsa::BSAFile& bsa, const Bsa::BSAFile::FileStruct* file)
+    {
+        return bsa.getFile(file);
+    }
+
+    Files::IStreamPtr openConstrainedFile(Bsa::BSAFile& bsa, const Bsa::BSAFile::FileStruct* file)
+    {
+        return Files::openConstrainedFileStream(sArchiveName, file->offset, file->fileSize);
+    }
+}
+
+struct BSAFileTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        writeArchive(sArchiveName);
+        mFile.open(sArchiveName);
+    }
+
+    virtual void TearDown()
+    {
+        std::remove(sArchiveName);
+    }
+
+    Bsa::BSAFile mFile;
+};
+
+TEST_F(BSAFileTest, read_files)
+{
+    ASSERT_EQ(mFile.getList().size(), static_cast<size_t>(sFileCount));
+    EXPECT_TRUE(mFile.exists("MESHES\\TEST\\FILE5.NIF"));
+    EXPECT_FALSE(mFile.exists("meshes\\test\\file5.dds"));
+
+    Files::IStreamPtr stream = mFile.getFile("meshes\\test\\file5.nif");
+
+    stream->seekg(100);
+    EXPECT_EQ(stream->get(), std::char_traits<char>::to_int_type(getFileByte(5, 100)));
+
+    stream->seekg(-1, std::ios_base::end);
+    EXPECT_EQ(stream->get(), std::char_traits<char>::to_int_type(getFileByte(5, sFileSize-1)));
+    EXPECT_EQ(stream->get(), std::char_traits<char>::eof());
+
+    EXPECT_THROW(mFile.getFile("meshes\\test\\missing.nif"), std::runtime_error);
+}
+
+/// Read the whole archive through the archive's streams and through separate ConstrainedFileStreams,
+/// and measure the throughput of both.
+TEST_F(BSAFileTest, DISABLED_benchmark)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(readArchive(mFile, &openConstrainedFile));
+    std::chrono::steady_clock::duration streamTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(readArchive(mFile, &openArchiveFile));
+    std::chrono::steady_clock::duration archiveTime = std::chrono::steady_clock::now() - start;
+
+    RecordProperty("constrained_streams_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(streamTime).count()));
+    RecordProperty("archive_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(archiveTime).count()));
+    RecordProperty("memory_mapped", mFile.isMemoryMapped() ? "true" : "false");
+}
+
+/// Read both compressed and uncompressed files from TES4 style archives
+TEST(CompressedBSAFileTest, read_files)
+{
+    const char* archiveName = "test_compressedbsafile.bsa";
+
+    for (int i=0; i<4; ++i)
+    {
+        const bool compressByDefault = (i & 1) != 0;
+        const bool embedNames = (i & 2) != 0;
+        writeCompressedArchive(archiveName, compressByDefault, embedNames);
+
+        ASSERT_EQ(Bsa::BSAFile::detectVersion(archiveName), Bsa::BSAVER_COMPRESSED);
+
+        Bsa::CompressedBSAFile bsa;
+        bsa.open(archiveName);
+
+        ASSERT_EQ(bsa.getList().size(), 6u);
+        for (int folder=0; folder<2; ++folder)
+        {
+            for (int index=0; index<3; ++index)
+            {
+                std::ostringstream name;
+                name << "Textures\\Folder" << folder << "\\File" << index << ".dds";
+                ASSERT_TRUE(bsa.exists(name.str().c_str()));
+
+                Files::IStreamPtr stream = bsa.getFile(name.str().c_str());
+                std::string content((std::istreambuf_iterator<char>(*stream)), std::istreambuf_iterator<char>());
+                EXPECT_EQ(content, getCompressedFileContent(folder, index));
+            }
+        }
+
+        EXPECT_TRUE(bsa.isCompressed(&bsa.getList()[0]) == compressByDefault);
+        EXPECT_TRUE(bsa.isCompressed(&bsa.getList()[1]) != compressByDefault);
+    }
+
+    std::remove(archiveName);
+}
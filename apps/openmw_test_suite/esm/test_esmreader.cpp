@@ -0,0 +1,268 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
+#include <components/esm/loadstat.hpp>
+#include <components/esm/loadglob.hpp>
+
+namespace
+{
+    const int sPluginCount = 3;
+    const int sRecordsPerPlugin = 100;
+
+    const int sBenchmarkPluginCount = 20;
+    const int sBenchmarkRecordsPerPlugin = 5000;
+
+    std::string getPluginName(int index)
+    {
+        std::ostringstream stream;
+        stream << "test_esmreader_plugin" << index << ".esp";
+        return stream.str();
+    }
+
+    /// Write a synthetic plugin, every plugin overrides the records of the previous one
+    void writePlugin(const std::string& filename, int index, int numRecords)
+    {
+        std::ofstream file(filename.c_str(), std::ios::binary);
+
+        ESM::ESMWriter writer;
+        writer.setFormat(0);
+        writer.setRecordCount(numRecords + 1);
+        writer.save(file);
+
+        for (int i=0; i<numRecords; ++i)
+        {
+            ESM::Static record;
+            std::ostringstream id;
+            id << "static_" << i;
+            record.mId = id.str();
+            std::ostringstream model;
+            model << "meshes\\x\\plugin" << index << "_" << i << ".nif";
+            record.mModel = model.str();
+
+            writer.startRecord(ESM::Static::sRecordId);
+            record.save(writer);
+            writer.endRecord(ESM::Static::sRecordId);
+        }
+
+        ESM::Global global;
+        global.mId = "test_global";
+        global.mValue.setType(ESM::VT_Long);
+        global.mValue.setInteger(index);
+        writer.startRecord(ESM::Global::sRecordId);
+        global.save(writer);
+        writer.endRecord(ESM::Global::sRecordId);
+
+        writer.close();
+    }
+
+    /// Read all records of the given reader, returning a printout of their contents
+    std::string readPlugin(ESM::ESMReader& reader)
+    {
+        std::ostringstream result;
+        while (reader.hasMoreRecs())
+        {
+            ESM::NAME name = reader.getRecName();
+            reader.getRecHeader();
+            bool isDeleted = false;
+            if (name.intval == ESM::Static::sRecordId)
+            {
+                ESM::Static record;
+                record.load(reader, isDeleted);
+                result << record.mId << " " << record.mModel << "\n";
+            }
+            else if (name.intval == ESM::Global::sRecordId)
+            {
+                ESM::Global record;
+                record.load(reader, isDeleted);
+                result << record.mId << " " << record.mValue.getInteger() << "\n";
+            }
+            else
+                reader.skipRecord();
+        }
+        return result.str();
+    }
+}
+
+struct ESMReaderTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        createPlugins(sPluginCount, sRecordsPerPlugin);
+    }
+
+    virtual void TearDown()
+    {
+        removePlugins();
+    }
+
+    void createPlugins(int count, int recordsPerPlugin)
+    {
+        removePlugins();
+        for (int i=0; i<count; ++i)
+        {
+            mPlugins.push_back(getPluginName(i));
+            writePlugin(mPlugins.back(), i, recordsPerPlugin);
+        }
+    }
+
+    void removePlugins()
+    {
+        for (std::vector<std::string>::const_iterator it = mPlugins.begin(); it != mPlugins.end(); ++it)
+            std::remove(it->c_str());
+        mPlugins.clear();
+    }
+
+    std::vector<std::string> mPlugins;
+};
+
+/// Load a synthetic load order through both the stream and the memory mapped backend,
+/// make sure they produce identical results.
+TEST_F(ESMReaderTest, stream_and_mapped_backends)
+{
+    std::vector<std::string> streamResults;
+    for (std::vector<std::string>::const_iterator it = mPlugins.begin(); it != mPlugins.end(); ++it)
+    {
+        ESM::ESMReader reader;
+        reader.open(Files::openConstrainedFileStream(it->c_str()), *it);
+        ASSERT_FALSE(reader.isMemoryMapped());
+        streamResults.push_back(readPlugin(reader));
+    }
+
+    std::vector<std::string> mappedResults;
+    for (std::vector<std::string>::const_iterator it = mPlugins.begin(); it != mPlugins.end(); ++it)
+    {
+        Files::MemoryMappedFilePtr file = Files::openMemoryMappedFile(it->c_str());
+        ASSERT_TRUE(file.get() != NULL) << "can't map " << *it;
+        ESM::ESMReader reader;
+        reader.open(file, *it);
+        ASSERT_TRUE(reader.isMemoryMapped());
+        mappedResults.push_back(readPlugin(reader));
+    }
+
+    ASSERT_EQ(streamResults.size(), mappedResults.size());
+    for (size_t i=0; i<streamResults.size(); ++i)
+    {
+        EXPECT_FALSE(streamResults[i].empty());
+        EXPECT_EQ(streamResults[i], mappedResults[i]);
+    }
+}
+
+/// Read the plugins through a stream and through a memory mapping, and measure the time taken by both
+TEST_F(ESMReaderTest, DISABLED_benchmark)
+{
+    createPlugins(sBenchmarkPluginCount, sBenchmarkRecordsPerPlugin);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::vector<std::string>::const_iterator it = mPlugins.begin(); it != mPlugins.end(); ++it)
+    {
+        ESM::ESMReader reader;
+        reader.open(Files::openConstrainedFileStream(it->c_str()), *it);
+        readPlugin(reader);
+    }
+    std::chrono::steady_clock::duration streamTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (std::vector<std::string>::const_iterator it = mPlugins.begin(); it != mPlugins.end(); ++it)
+    {
+        ESM::ESMReader reader;
+        reader.open(*it);
+        readPlugin(reader);
+    }
+    std::chrono::steady_clock::duration mappedTime = std::chrono::steady_clock::now() - start;
+
+    RecordProperty("stream_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(streamTime).count()));
+    RecordProperty("mapped_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(mappedTime).count()));
+}
+
+/// Contexts saved from a mapped reader must restore to the same position
+TEST_F(ESMReaderTest, mapped_context_restore)
+{
+    ESM::ESMReader reader;
+    reader.open(mPlugins.front());
+
+    ASSERT_TRUE(reader.hasMoreRecs());
+    reader.getRecName();
+    reader.getRecHeader();
+    ESM::ESM_Context context = reader.getContext();
+
+    ESM::Static first;
+    bool isDeleted = false;
+    first.load(reader, isDeleted);
+
+    reader.restoreContext(context);
+    ESM::Static second;
+    second.load(reader, isDeleted);
+
+    EXPECT_EQ(first.mId, second.mId);
+    EXPECT_EQ(first.mModel, second.mModel);
+}
+
+/// Copies of a mapped reader share the mapping, but must read independently of the original
+TEST_F(ESMReaderTest, mapped_reader_copy)
+{
+    ESM::ESMReader reader;
+    reader.open(mPlugins.front());
+    ASSERT_TRUE(reader.isMemoryMapped());
+
+    ASSERT_TRUE(reader.hasMoreRecs());
+    reader.getRecName();
+    reader.getRecHeader();
+    ESM::ESM_Context context = reader.getContext();
+
+    ESM::ESMReader copy = reader;
+    ASSERT_TRUE(copy.isMemoryMapped());
+
+    ESM::Static first;
+    bool isDeleted = false;
+    first.load(copy, isDeleted);
+    EXPECT_EQ(context.filePos, reader.getFileOffset());
+
+    ESM::Static second;
+    second.load(reader, isDeleted);
+    EXPECT_EQ(first.mId, second.mId);
+    EXPECT_EQ(first.mModel, second.mModel);
+    EXPECT_EQ(copy.getFileOffset(), reader.getFileOffset());
+}
+
+/// Readers sharing the file of a mapped reader must read independently of it
+TEST_F(ESMReaderTest, mapped_reader_shared)
+{
+    ESM::ESMReader reader;
+    reader.setIndex(3);
+    reader.open(mPlugins.front());
+    ASSERT_TRUE(reader.isMemoryMapped());
+
+    ASSERT_TRUE(reader.hasMoreRecs());
+    reader.getRecName();
+    reader.getRecHeader();
+    ESM::ESM_Context context = reader.getContext();
+
+    ESM::ESMReader shared;
+    shared.openShared(reader);
+    ASSERT_TRUE(shared.isMemoryMapped());
+    EXPECT_EQ(reader.getIndex(), shared.getIndex());
+    EXPECT_EQ(reader.getRecordCount(), shared.getRecordCount());
+
+    shared.restoreContext(context);
+    ESM::Static first;
+    bool isDeleted = false;
+    first.load(shared, isDeleted);
+    EXPECT_EQ(context.filePos, reader.getFileOffset());
+
+    ESM::Static second;
+    second.load(reader, isDeleted);
+    EXPECT_EQ(first.mId, second.mId);
+    EXPECT_EQ(first.mModel, second.mModel);
+    EXPECT_EQ(shared.getFileOffset(), reader.getFileOffset());
+
+    ESM::ESMReader streamed;
+    streamed.open(Files::openConstrainedFileStream(mPlugins.front().c_str()), mPlugins.front());
+    EXPECT_THROW(shared.openShared(streamed), std::runtime_error);
+}
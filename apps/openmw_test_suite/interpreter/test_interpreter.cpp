@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <components/compiler/context.hpp>
+#include <components/compiler/exception.hpp>
+#include <components/compiler/extensions.hpp>
+#include <components/compiler/fileparser.hpp>
+#include <components/compiler/scanner.hpp>
+#include <components/compiler/streamerrorhandler.hpp>
+
+#include <components/interpreter/context.hpp>
+#include <components/interpreter/installopcodes.hpp>
+#include <components/interpreter/interpreter.hpp>
+#include <components/interpreter/links.hpp>
+#include <components/interpreter/opcodes.hpp>
+#include <components/interpreter/opcodetable.hpp>
+#include <components/interpreter/runtime.hpp>
+
+namespace
+{
+    /// Game specific opcodes start at 0x2000000, far away from the generic ones
+    const int sOpcodeGetStep = 0x2000400;
+
+    class OpGetStep : public Interpreter::Opcode0
+    {
+        public:
+
+            virtual void execute (Interpreter::Runtime& runtime)
+            {
+                runtime.push (static_cast<Interpreter::Type_Integer> (2));
+            }
+    };
+
+    class TestCompilerContext : public Compiler::Context
+    {
+        public:
+
+            virtual bool canDeclareLocals() const { return true; }
+            virtual char getGlobalType (const std::string& name) const { return name=="counter" ? 'l' : ' '; }
+            virtual std::pair<char, bool> getMemberType (const std::string& name, const std::string& id) const
+            {
+                return std::make_pair (' ', false);
+            }
+            virtual bool isId (const std::string& name) const { return false; }
+            virtual bool isJournalId (const std::string& name) const { return false; }
+    };
+
+    /// Only provides local variables and the global long "counter", which is all the scripts below need
+    class TestInterpreterContext : public Interpreter::Context
+    {
+            std::vector<int> mShorts;
+            std::vector<int> mLongs;
+            std::vector<float> mFloats;
+            int mCounter;
+
+            int& getCounter (const std::string& name)
+            {
+                ++mGlobalLookups;
+                if (name!="counter")
+                    throw std::runtime_error ("unknown global variable: " + name);
+                return mCounter;
+            }
+
+        public:
+
+            int mGlobalsRevision;
+            mutable int mGlobalLookups; ///< Accesses to global variables by name
+
+            TestInterpreterContext (const Compiler::Locals& locals)
+                : mShorts (locals.get ('s').size()), mLongs (locals.get ('l').size()), mFloats (locals.get ('f').size())
+                , mCounter (0), mGlobalsRevision (1), mGlobalLookups (0)
+            {}
+
+            virtual int getLocalShort (int index) const { return mShorts.at (index); }
+            virtual int getLocalLong (int index) const { return mLongs.at (index); }
+            virtual float getLocalFloat (int index) const { return mFloats.at (index); }
+            virtual void setLocalShort (int index, int value) { mShorts.at (index) = value; }
+            virtual void setLocalLong (int index, int value) { mLongs.at (index) = value; }
+            virtual void setLocalFloat (int index, float value) { mFloats.at (index) = value; }
+
+            virtual void messageBox (const std::string& message, const std::vector<std::string>& buttons) {}
+            virtual void report (const std::string& message) {}
+            virtual bool menuMode() { return false; }
+            virtual int getGlobalShort (const std::string& name) const { return const_cast<TestInterpreterContext*> (this)->getCounter (name); }
+            virtual int getGlobalLong (const std::string& name) const { return const_cast<TestInterpreterContext*> (this)->getCounter (name); }
+            virtual float getGlobalFloat (const std::string& name) const { return const_cast<TestInterpreterContext*> (this)->getCounter (name); }
+            virtual void setGlobalShort (const std::string& name, int value) { getCounter (name) = value; }
+            virtual void setGlobalLong (const std::string& name, int value) { getCounter (name) = value; }
+            virtual void setGlobalFloat (const std::string& name, float value) { getCounter (name) = static_cast<int> (value); }
+            virtual int getGlobalsRevision() const { return mGlobalsRevision; }
+            virtual int getGlobalHandle (const std::string& name) const { return name=="counter" ? 0 : -1; }
+            virtual int getJournalHandle (const std::string& id) const { return id=="a_quest" ? 0 : -1; }
+            virtual int getLinkedGlobalShort (int handle) const { return mCounter; }
+            virtual int getLinkedGlobalLong (int handle) const { return mCounter; }
+            virtual float getLinkedGlobalFloat (int handle) const { return mCounter; }
+            virtual void setLinkedGlobalShort (int handle, int value) { mCounter = value; }
+            virtual void setLinkedGlobalLong (int handle, int value) { mCounter = value; }
+            virtual void setLinkedGlobalFloat (int handle, float value) { mCounter = static_cast<int> (value); }
+            virtual std::vector<std::string> getGlobals () const { return std::vector<std::string>(); }
+            virtual char getGlobalType (const std::string& name) const { return ' '; }
+            virtual std::string getActionBinding (const std::string& action) const { return std::string(); }
+            virtual std::string getNPCName() const { return std::string(); }
+            virtual std::string getNPCRace() const { return std::string(); }
+            virtual std::string getNPCClass() const { return std::string(); }
+            virtual std::string getNPCFaction() const { return std::string(); }
+            virtual std::string getNPCRank() const { return std::string(); }
+            virtual std::string getPCName() const { return std::string(); }
+            virtual std::string getPCRace() const { return std::string(); }
+            virtual std::string getPCClass() const { return std::string(); }
+            virtual std::string getPCRank() const { return std::string(); }
+            virtual std::string getPCNextRank() const { return std::string(); }
+            virtual int getPCBounty() const { return 0; }
+            virtual std::string getCurrentCellName() const { return std::string(); }
+            virtual bool isScriptRunning (const std::string& name) const { return false; }
+            virtual void startScript (const std::string& name, const std::string& targetId = "") {}
+            virtual void stopScript (const std::string& name) {}
+            virtual float getDistance (const std::string& name, const std::string& id = "") const { return 0; }
+            virtual float getSecondsPassed() const { return 0; }
+            virtual bool isDisabled (const std::string& id = "") const { return false; }
+            virtual void enable (const std::string& id = "") {}
+            virtual void disable (const std::string& id = "") {}
+            virtual int getMemberShort (const std::string& id, const std::string& name, bool global) const { return 0; }
+            virtual int getMemberLong (const std::string& id, const std::string& name, bool global) const { return 0; }
+            virtual float getMemberFloat (const std::string& id, const std::string& name, bool global) const { return 0; }
+            virtual void setMemberShort (const std::string& id, const std::string& name, int value, bool global) {}
+            virtual void setMemberLong (const std::string& id, const std::string& name, int value, bool global) {}
+            virtual void setMemberFloat (const std::string& id, const std::string& name, float value, bool global) {}
+            virtual std::string getTargetId() const { return std::string(); }
+    };
+
+    const char* sLoopScript =
+        "begin loop\n"
+        "short i\n"
+        "long sum\n"
+        "float f\n"
+        "while ( i < 10000 )\n"
+        "    set sum to sum + i * getstep\n"
+        "    set f to f + 0.5\n"
+        "    if ( i == 5000 )\n"
+        "        set f to f - 1\n"
+        "    endif\n"
+        "    set i to i + 1\n"
+        "endwhile\n"
+        "end\n";
+
+    const char* sGlobalScript =
+        "begin globals\n"
+        "short i\n"
+        "messagebox \"start\"\n"
+        "while ( i < 100 )\n"
+        "    set counter to counter + getstep\n"
+        "    set i to i + 1\n"
+        "endwhile\n"
+        "end\n";
+}
+
+struct InterpreterTest : public ::testing::Test
+{
+protected:
+    InterpreterTest()
+        : mErrorHandler (std::cerr)
+        , mParser (mErrorHandler, mCompilerContext)
+    {
+        mExtensions.registerFunction ("getstep", 'l', "", sOpcodeGetStep);
+        mCompilerContext.setExtensions (&mExtensions);
+
+        Interpreter::installOpcodes (mInterpreter);
+        mInterpreter.installSegment5 (sOpcodeGetStep, new OpGetStep);
+    }
+
+    bool compile (const std::string& source)
+    {
+        mParser.reset();
+        std::istringstream input (source);
+        Compiler::Scanner scanner (mErrorHandler, input, mCompilerContext.getExtensions());
+        try
+        {
+            scanner.scan (mParser);
+        }
+        catch (const Compiler::SourceException&)
+        {
+            return false;
+        }
+        mCode.clear();
+        mParser.getCode (mCode);
+        return mErrorHandler.isGood();
+    }
+
+    Compiler::Extensions mExtensions;
+    TestCompilerContext mCompilerContext;
+    Compiler::StreamErrorHandler mErrorHandler;
+    Compiler::FileParser mParser;
+    Interpreter::Interpreter mInterpreter;
+    std::vector<Interpreter::Type_Code> mCode;
+};
+
+TEST_F(InterpreterTest, run_loop)
+{
+    ASSERT_TRUE(compile(sLoopScript));
+
+    TestInterpreterContext context (mParser.getLocals());
+    mInterpreter.run (&mCode[0], mCode.size(), context);
+
+    EXPECT_EQ(context.getLocalShort (mParser.getLocals().getIndex ("i")), 10000);
+    EXPECT_EQ(context.getLocalLong (mParser.getLocals().getIndex ("sum")), 99990000);
+    EXPECT_EQ(context.getLocalFloat (mParser.getLocals().getIndex ("f")), 4999.f);
+}
+
+TEST_F(InterpreterTest, unknown_opcode)
+{
+    Interpreter::Type_Code code[5] = { 1, 0, 0, 0, 0xc8000000 | 0x2000401 };
+
+    TestInterpreterContext context (mParser.getLocals());
+    EXPECT_THROW(mInterpreter.run (code, 5, context), std::runtime_error);
+}
+
+TEST_F(InterpreterTest, run_linked)
+{
+    ASSERT_TRUE(compile(sGlobalScript));
+
+    TestInterpreterContext context (mParser.getLocals());
+    mInterpreter.run (&mCode[0], mCode.size(), context);
+    EXPECT_EQ(context.getGlobalLong ("counter"), 200);
+    EXPECT_EQ(context.mGlobalLookups, 201);
+
+    Interpreter::Links links;
+    EXPECT_FALSE(links.isLinked (context));
+    links.link (&mCode[0], context);
+    ASSERT_TRUE(links.isLinked (context));
+
+    context.setLocalShort (mParser.getLocals().getIndex ("i"), 0);
+    context.mGlobalLookups = 0;
+    mInterpreter.run (&mCode[0], mCode.size(), context, &links);
+    EXPECT_EQ(context.mGlobalLookups, 0);
+    EXPECT_EQ(context.getGlobalLong ("counter"), 400);
+
+    // Changed content invalidates the handles
+    ++context.mGlobalsRevision;
+    EXPECT_FALSE(links.isLinked (context));
+}
+
+TEST_F(InterpreterTest, link_journal_handles)
+{
+    // Only the header, and the string literals "a_quest" and "message", padded to full words
+    Interpreter::Type_Code code[4 + 4] = { 0, 0, 0, 4 };
+    std::memcpy (&code[4], "a_quest\0message\0", 16);
+
+    TestInterpreterContext context (mParser.getLocals());
+    Interpreter::Links links;
+    links.link (code, context);
+
+    EXPECT_EQ(0, links.getJournalHandle (0));
+    EXPECT_EQ(-1, links.getJournalHandle (1));
+    EXPECT_EQ(-1, links.getGlobalHandle (0));
+
+    // The quest handles do not depend on the globals revision, but are resolved again with the global variables
+    ++context.mGlobalsRevision;
+    links.link (code, context);
+    EXPECT_EQ(0, links.getJournalHandle (0));
+}
+
+/// Run the loop script repeatedly and measure the time it took
+TEST_F(InterpreterTest, DISABLED_benchmark)
+{
+    ASSERT_TRUE(compile(sLoopScript));
+
+    const int runs = 100;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<runs; ++i)
+    {
+        TestInterpreterContext context (mParser.getLocals());
+        mInterpreter.run (&mCode[0], mCode.size(), context);
+    }
+    std::chrono::steady_clock::duration time = std::chrono::steady_clock::now() - start;
+
+    RecordProperty("ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(time).count()));
+}
+
+TEST(OpcodeTableTest, find)
+{
+    Interpreter::OpcodeTable<Interpreter::Opcode0> table;
+
+    Interpreter::Opcode0* low = new OpGetStep;
+    Interpreter::Opcode0* lower = new OpGetStep;
+    Interpreter::Opcode0* high = new OpGetStep;
+    table.install (10, low);
+    table.install (0x2000000, high);
+    table.install (3, lower);
+
+    EXPECT_EQ(table.find (10), low);
+    EXPECT_EQ(table.find (3), lower);
+    EXPECT_EQ(table.find (0x2000000), high);
+
+    EXPECT_TRUE(table.find (0) == 0);
+    EXPECT_TRUE(table.find (5) == 0);
+    EXPECT_TRUE(table.find (0x2000001) == 0);
+    EXPECT_TRUE(table.find (-1) == 0);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "apps/openmw/mwmechanics/spatialgrid.hpp"
+
+namespace
+{
+    osg::Vec3f getRandomPosition(float extent)
+    {
+        return osg::Vec3f((std::rand() / static_cast<float>(RAND_MAX) - 0.5f) * extent,
+                          (std::rand() / static_cast<float>(RAND_MAX) - 0.5f) * extent,
+                          (std::rand() / static_cast<float>(RAND_MAX)) * 1000.f);
+    }
+
+    void getObjectsInRange(const std::vector<osg::Vec3f>& positions, const osg::Vec3f& position, float radius, std::vector<int>& out)
+    {
+        for (size_t i=0; i<positions.size(); ++i)
+        {
+            if ((positions[i] - position).length2() <= radius*radius)
+                out.push_back(i);
+        }
+    }
+}
+
+struct SpatialGridTest : public ::testing::Test
+{
+protected:
+    SpatialGridTest()
+        : mGrid(2048.f)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        std::srand(42);
+        for (int i=0; i<500; ++i)
+        {
+            mPositions.push_back(getRandomPosition(8192.f * 3));
+            mGrid.insert(i, mPositions.back());
+        }
+    }
+
+    /// Compare the grid with a linear search
+    void checkRange(const osg::Vec3f& position, float radius)
+    {
+        std::vector<int> expected;
+        getObjectsInRange(mPositions, position, radius, expected);
+
+        std::vector<int> found;
+        mGrid.getObjectsInRange(position, radius, found);
+        std::sort(found.begin(), found.end());
+
+        EXPECT_EQ(found, expected);
+    }
+
+    MWMechanics::SpatialGrid<int> mGrid;
+    std::vector<osg::Vec3f> mPositions;
+};
+
+TEST_F(SpatialGridTest, range_query)
+{
+    EXPECT_EQ(mGrid.size(), 500u);
+
+    for (int i=0; i<100; ++i)
+    {
+        checkRange(getRandomPosition(8192.f * 4), 100.f);
+        checkRange(getRandomPosition(8192.f * 4), 2000.f);
+        checkRange(getRandomPosition(8192.f * 4), 7168.f);
+    }
+    checkRange(osg::Vec3f(), 1e6f);
+}
+
+TEST_F(SpatialGridTest, update)
+{
+    // Move half of the objects, and mark the others as removed by moving them far away
+    for (int i=0; i<500; ++i)
+    {
+        if (i % 2)
+        {
+            mPositions[i] = getRandomPosition(8192.f * 3);
+            mGrid.insert(i, mPositions[i]);
+        }
+        else
+        {
+            mPositions[i] = osg::Vec3f(1e9f, 1e9f, 0.f);
+            mGrid.remove(i);
+        }
+    }
+    EXPECT_EQ(mGrid.size(), 250u);
+
+    for (int i=0; i<100; ++i)
+        checkRange(getRandomPosition(8192.f * 4), 2000.f);
+
+    std::vector<int> found;
+    mGrid.replace(1, 1001);
+    mGrid.getObjectsInRange(mPositions[1], 0.f, found);
+    EXPECT_EQ(found, std::vector<int>(1, 1001));
+
+    mGrid.clear();
+    found.clear();
+    mGrid.getObjectsInRange(osg::Vec3f(), 1e6f, found);
+    EXPECT_TRUE(found.empty());
+}
+
+/// Query the surroundings of 500 actors, like the alarm and AI processing checks of a frame do,
+/// and measure the time taken by the grid and by a linear search.
+TEST_F(SpatialGridTest, DISABLED_benchmark)
+{
+    const int frames = 100;
+    const float radius = 2000.f;
+
+    size_t found = 0;
+    std::vector<int> out;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int frame=0; frame<frames; ++frame)
+    {
+        for (size_t i=0; i<mPositions.size(); ++i)
+        {
+            out.clear();
+            mGrid.getObjectsInRange(mPositions[i], radius, out);
+            found += out.size();
+        }
+    }
+    std::chrono::steady_clock::duration gridTime = std::chrono::steady_clock::now() - start;
+
+    size_t expected = 0;
+    start = std::chrono::steady_clock::now();
+    for (int frame=0; frame<frames; ++frame)
+    {
+        for (size_t i=0; i<mPositions.size(); ++i)
+        {
+            out.clear();
+            getObjectsInRange(mPositions, mPositions[i], radius, out);
+            expected += out.size();
+        }
+    }
+    std::chrono::steady_clock::duration linearTime = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(found, expected);
+
+    RecordProperty("grid_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(gridTime).count()));
+    RecordProperty("linear_search_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(linearTime).count()));
+}
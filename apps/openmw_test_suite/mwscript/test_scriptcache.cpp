@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <components/files/collections.hpp>
+
+#include "apps/openmw/mwscript/scriptcache.hpp"
+#include "apps/openmw/mwworld/contentfilekey.hpp"
+
+struct ScriptCacheTest : public ::testing::Test
+{
+protected:
+    ScriptCacheTest()
+        : mDirectory(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+    {
+        boost::filesystem::create_directories(mDirectory);
+        writeContentFile("content");
+
+        mCode.push_back(3);
+        mCode.push_back(1);
+        mCode.push_back(2);
+        mCode.push_back(0);
+
+        mLocals.declare('s', "foo");
+        mLocals.declare('f', "bar");
+    }
+
+    ~ScriptCacheTest()
+    {
+        boost::filesystem::remove_all(mDirectory);
+    }
+
+    void writeContentFile(const std::string& content)
+    {
+        boost::filesystem::ofstream stream(mDirectory / "test.esp", std::ios::binary);
+        stream << content;
+    }
+
+    MWWorld::ContentFileKey getKey() const
+    {
+        Files::PathContainer directories;
+        directories.push_back(mDirectory);
+        return MWWorld::ContentFileKey(Files::Collections(directories, true), std::vector<std::string>(1, "test.esp"));
+    }
+
+    boost::filesystem::path mDirectory;
+    std::vector<Interpreter::Type_Code> mCode;
+    Compiler::Locals mLocals;
+};
+
+TEST_F(ScriptCacheTest, write_and_load)
+{
+    const boost::filesystem::path cacheFile = mDirectory / "scripts.cache";
+
+    {
+        MWScript::ScriptCache cache(cacheFile, getKey());
+        cache.load();
+        cache.insert("script", "begin script\nend\n", mCode, mLocals);
+        cache.write();
+    }
+
+    MWScript::ScriptCache cache(cacheFile, getKey());
+    cache.load();
+
+    std::vector<Interpreter::Type_Code> code;
+    Compiler::Locals locals;
+    ASSERT_TRUE(cache.get("script", "begin script\nend\n", code, locals));
+    EXPECT_EQ(code, mCode);
+    EXPECT_EQ(locals.getType("foo"), 's');
+    EXPECT_EQ(locals.getType("bar"), 'f');
+    EXPECT_EQ(locals.getIndex("bar"), 0);
+
+    // changed source
+    EXPECT_FALSE(cache.get("script", "begin script\nreturn\nend\n", code, locals));
+    EXPECT_FALSE(cache.get("other", "begin script\nend\n", code, locals));
+}
+
+TEST_F(ScriptCacheTest, changed_content_files)
+{
+    const boost::filesystem::path cacheFile = mDirectory / "scripts.cache";
+
+    {
+        MWScript::ScriptCache cache(cacheFile, getKey());
+        cache.insert("script", "begin script\nend\n", mCode, mLocals);
+        cache.write();
+    }
+
+    writeContentFile("changed content");
+
+    MWScript::ScriptCache cache(cacheFile, getKey());
+    cache.load();
+
+    std::vector<Interpreter::Type_Code> code;
+    Compiler::Locals locals;
+    EXPECT_FALSE(cache.get("script", "begin script\nend\n", code, locals));
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "apps/openmw/mwworld/roundrobin.hpp"
+
+namespace
+{
+    struct Record
+    {
+        void operator()(int& value)
+        {
+            mVisited.push_back(value);
+        }
+
+        std::vector<int> mVisited;
+    };
+
+    /// Over budget once \a count elements were visited, like a time budget used up by the scripts that ran
+    struct OverBudgetAfter
+    {
+        OverBudgetAfter(const Record& record, size_t count)
+            : mRecord(record)
+            , mCount(count)
+        {
+        }
+
+        bool operator()() const
+        {
+            return mRecord.mVisited.size() >= mCount;
+        }
+
+        const Record& mRecord;
+        size_t mCount;
+    };
+}
+
+struct RoundRobinTest : public ::testing::Test
+{
+protected:
+    RoundRobinTest()
+        : mRoundRobin(mList)
+    {
+        for (int i=0; i<10; ++i)
+            mList.push_back(i);
+    }
+
+    /// Visit the elements that getNext() returns until \a count were returned or the pass ends
+    std::vector<int> getNext(size_t count)
+    {
+        std::vector<int> result;
+        int value = 0;
+        while (result.size() < count && mRoundRobin.getNext(value))
+            result.push_back(value);
+        return result;
+    }
+
+    void erase(int value)
+    {
+        std::list<int>::iterator found = std::find(mList.begin(), mList.end(), value);
+        mRoundRobin.erase(found);
+        mList.erase(found);
+    }
+
+    std::list<int> mList;
+    MWWorld::RoundRobin<int> mRoundRobin;
+};
+
+TEST_F(RoundRobinTest, pass_visits_every_element_once)
+{
+    mRoundRobin.start();
+    std::vector<int> visited = getNext(100);
+
+    ASSERT_EQ(10u, visited.size());
+    for (int i=0; i<10; ++i)
+        EXPECT_EQ(i, visited[i]);
+}
+
+TEST_F(RoundRobinTest, pass_continues_after_previous_pass)
+{
+    mRoundRobin.start();
+    getNext(4);
+
+    mRoundRobin.start();
+    std::vector<int> visited = getNext(100);
+
+    // Wraps around at the end, and stops before visiting an element twice
+    ASSERT_EQ(10u, visited.size());
+    EXPECT_EQ(4, visited.front());
+    EXPECT_EQ(9, visited[5]);
+    EXPECT_EQ(0, visited[6]);
+    EXPECT_EQ(3, visited.back());
+}
+
+TEST_F(RoundRobinTest, erase_next_element)
+{
+    mRoundRobin.start();
+    getNext(4);
+
+    erase(4);
+
+    mRoundRobin.start();
+    std::vector<int> visited = getNext(1);
+    ASSERT_EQ(1u, visited.size());
+    EXPECT_EQ(5, visited.front());
+}
+
+TEST_F(RoundRobinTest, erase_during_pass)
+{
+    mRoundRobin.start();
+    getNext(2);
+
+    erase(0);
+    erase(2);
+    erase(9);
+
+    // A pass visits as many elements as the list holds, the ones that were missed come first in the next pass
+    std::vector<int> visited = getNext(100);
+    ASSERT_EQ(5u, visited.size());
+    EXPECT_EQ(3, visited.front());
+    EXPECT_EQ(7, visited.back());
+
+    mRoundRobin.start();
+    visited = getNext(2);
+    ASSERT_EQ(2u, visited.size());
+    EXPECT_EQ(8, visited[0]);
+    EXPECT_EQ(1, visited[1]);
+}
+
+TEST_F(RoundRobinTest, erase_last_and_clear)
+{
+    mRoundRobin.start();
+    getNext(9);
+
+    erase(9);
+
+    mRoundRobin.start();
+    std::vector<int> visited = getNext(1);
+    ASSERT_EQ(1u, visited.size());
+    EXPECT_EQ(0, visited.front());
+
+    mList.clear();
+    mRoundRobin.clear();
+
+    mRoundRobin.start();
+    EXPECT_TRUE(getNext(1).empty());
+
+    mList.push_back(42);
+    mRoundRobin.start();
+    visited = getNext(100);
+    ASSERT_EQ(1u, visited.size());
+    EXPECT_EQ(42, visited.front());
+}
+
+TEST_F(RoundRobinTest, visit_until_over_budget)
+{
+    Record record;
+    OverBudgetAfter isOverBudget(record, 5);
+    EXPECT_EQ(5u, mRoundRobin.visit(record, isOverBudget, 4));
+
+    ASSERT_EQ(5u, record.mVisited.size());
+    EXPECT_EQ(0, record.mVisited.front());
+    EXPECT_EQ(4, record.mVisited.back());
+
+    // The next pass continues where the budget ran out
+    Record next;
+    OverBudgetAfter nextIsOverBudget(next, 5);
+    EXPECT_EQ(5u, mRoundRobin.visit(next, nextIsOverBudget, 4));
+    EXPECT_EQ(5, next.mVisited.front());
+}
+
+TEST_F(RoundRobinTest, visit_within_budget)
+{
+    Record record;
+    OverBudgetAfter isOverBudget(record, 100);
+    EXPECT_EQ(10u, mRoundRobin.visit(record, isOverBudget, 4));
+}
+
+TEST_F(RoundRobinTest, visit_minimum_over_budget)
+{
+    // Even when the budget is used up at once, every element is visited at least every maxDelay passes
+    const size_t maxDelay = 4;
+    std::vector<int> lastVisit(mList.size(), -1);
+    for (int pass=0; pass<20; ++pass)
+    {
+        Record record;
+        OverBudgetAfter isOverBudget(record, 0);
+        EXPECT_EQ(3u, mRoundRobin.visit(record, isOverBudget, maxDelay));
+
+        for (size_t i=0; i<record.mVisited.size(); ++i)
+            lastVisit[record.mVisited[i]] = pass;
+
+        if (pass >= static_cast<int>(maxDelay) - 1)
+        {
+            for (size_t i=0; i<lastVisit.size(); ++i)
+                EXPECT_GT(lastVisit[i], pass - static_cast<int>(maxDelay));
+        }
+    }
+}
+
+TEST_F(RoundRobinTest, visit_empty)
+{
+    mList.clear();
+    mRoundRobin.clear();
+
+    Record record;
+    OverBudgetAfter isOverBudget(record, 0);
+    EXPECT_EQ(0u, mRoundRobin.visit(record, isOverBudget, 4));
+    EXPECT_TRUE(record.mVisited.empty());
+}
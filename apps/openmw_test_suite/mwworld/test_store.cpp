@@ -1,13 +1,17 @@
 #include <gtest/gtest.h>
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
 
 #include <components/files/configurationmanager.hpp>
+#include <components/files/collections.hpp>
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
 #include <components/loadinglistener/loadinglistener.hpp>
+#include <components/sceneutil/workqueue.hpp>
 
 #include "apps/openmw/mwworld/esmstore.hpp"
+#include "apps/openmw/mwworld/recordcache.hpp"
 
 static Loading::Listener dummyListener;
 
@@ -313,3 +317,431 @@ TEST_F(StoreTest, overwrite_test)
 
     ASSERT_TRUE (overwrittenRec && overwrittenRec->mModel == "the_new_model");
 }
+
+/// Write records for the parallel load test, every second record is deleted if requested.
+template <typename T>
+void writeRecords(ESM::ESMWriter& writer, int fileIndex, int recordCount, bool deleteRecords)
+{
+    for (int i=0; i<recordCount; ++i)
+    {
+        T record;
+        record.blank();
+        std::ostringstream id;
+        id << "record_" << i;
+        record.mId = id.str();
+        std::ostringstream model;
+        model << "model_" << fileIndex;
+        record.mModel = model.str();
+
+        writer.startRecord(T::sRecordId);
+        record.save(writer, deleteRecords && i % 2 == 0);
+        writer.endRecord(T::sRecordId);
+    }
+}
+
+/// Write a topic for the parallel load test, every file appends its own responses to it.
+void writeDialogue(ESM::ESMWriter& writer, int fileIndex, int infoCount)
+{
+    ESM::Dialogue dialogue;
+    dialogue.blank();
+    dialogue.mId = "dialogue";
+    dialogue.mType = ESM::Dialogue::Topic;
+    writer.startRecord(ESM::Dialogue::sRecordId);
+    dialogue.save(writer);
+    writer.endRecord(ESM::Dialogue::sRecordId);
+
+    for (int i=0; i<infoCount; ++i)
+    {
+        ESM::DialInfo info;
+        info.blank();
+        std::ostringstream id, prev, next;
+        id << "info_" << fileIndex << "_" << i;
+        info.mId = id.str();
+        if (i > 0)
+            prev << "info_" << fileIndex << "_" << i-1;
+        else if (fileIndex > 0)
+            prev << "info_" << fileIndex-1 << "_" << infoCount-1;
+        info.mPrev = prev.str();
+        if (i+1 < infoCount)
+            next << "info_" << fileIndex << "_" << i+1;
+        info.mNext = next.str();
+        info.mResponse = info.mId;
+
+        writer.startRecord(ESM::DialInfo::sRecordId);
+        info.save(writer);
+        writer.endRecord(ESM::DialInfo::sRecordId);
+    }
+}
+
+/// Write an interior and an exterior cell for the parallel load test, which every file overrides.
+void writeCells(ESM::ESMWriter& writer, int fileIndex, int cellCount)
+{
+    for (int i=0; i<cellCount; ++i)
+    {
+        ESM::Cell interior;
+        interior.blank();
+        std::ostringstream name;
+        name << "cell_" << i;
+        interior.mName = name.str();
+        interior.mData.mFlags = ESM::Cell::Interior | ESM::Cell::HasWater;
+        interior.mWater = static_cast<float>(fileIndex);
+        writer.startRecord(ESM::Cell::sRecordId);
+        interior.save(writer);
+        writer.endRecord(ESM::Cell::sRecordId);
+
+        ESM::Cell exterior;
+        exterior.blank();
+        exterior.mData.mX = i;
+        std::ostringstream region;
+        region << "region_" << fileIndex;
+        exterior.mRegion = region.str();
+        writer.startRecord(ESM::Cell::sRecordId);
+        exterior.save(writer);
+        writer.endRecord(ESM::Cell::sRecordId);
+    }
+}
+
+template <typename T>
+void expectEqualStores(const MWWorld::ESMStore& expected, const MWWorld::ESMStore& actual)
+{
+    const MWWorld::Store<T>& expectedStore = expected.get<T>();
+    const MWWorld::Store<T>& actualStore = actual.get<T>();
+    ASSERT_EQ(expectedStore.getSize(), actualStore.getSize());
+
+    for (typename MWWorld::Store<T>::iterator it = expectedStore.begin(); it != expectedStore.end(); ++it)
+    {
+        const T* record = actualStore.search(it->mId);
+        ASSERT_TRUE(record != NULL);
+        EXPECT_EQ(it->mModel, record->mModel);
+    }
+}
+
+void expectEqualDialogue(const MWWorld::ESMStore& expected, const MWWorld::ESMStore& actual)
+{
+    const ESM::Dialogue* expectedDialogue = expected.get<ESM::Dialogue>().search("dialogue");
+    const ESM::Dialogue* actualDialogue = actual.get<ESM::Dialogue>().search("dialogue");
+    ASSERT_TRUE(expectedDialogue != NULL);
+    ASSERT_TRUE(actualDialogue != NULL);
+    ASSERT_EQ(expectedDialogue->mInfo.size(), actualDialogue->mInfo.size());
+
+    // The order of the responses depends on the order the files were merged in
+    ESM::Dialogue::InfoContainer::const_iterator actualInfo = actualDialogue->mInfo.begin();
+    for (ESM::Dialogue::InfoContainer::const_iterator it = expectedDialogue->mInfo.begin(); it != expectedDialogue->mInfo.end(); ++it, ++actualInfo)
+    {
+        EXPECT_EQ(it->mId, actualInfo->mId);
+        EXPECT_EQ(it->mResponse, actualInfo->mResponse);
+    }
+}
+
+void expectEqualCells(const MWWorld::ESMStore& expected, const MWWorld::ESMStore& actual, int cellCount)
+{
+    const MWWorld::Store<ESM::Cell>& expectedStore = expected.get<ESM::Cell>();
+    const MWWorld::Store<ESM::Cell>& actualStore = actual.get<ESM::Cell>();
+    ASSERT_EQ(expectedStore.getSize(), actualStore.getSize());
+
+    for (int i=0; i<cellCount; ++i)
+    {
+        std::ostringstream name;
+        name << "cell_" << i;
+        const ESM::Cell* expectedInterior = expectedStore.search(name.str());
+        const ESM::Cell* actualInterior = actualStore.search(name.str());
+        ASSERT_TRUE(expectedInterior != NULL);
+        ASSERT_TRUE(actualInterior != NULL);
+        EXPECT_EQ(expectedInterior->mWater, actualInterior->mWater);
+        EXPECT_EQ(expectedInterior->mContextList.size(), actualInterior->mContextList.size());
+
+        const ESM::Cell* expectedExterior = expectedStore.search(i, 0);
+        const ESM::Cell* actualExterior = actualStore.search(i, 0);
+        ASSERT_TRUE(expectedExterior != NULL);
+        ASSERT_TRUE(actualExterior != NULL);
+        EXPECT_EQ(expectedExterior->mRegion, actualExterior->mRegion);
+        EXPECT_EQ(expectedExterior->mContextList.size(), actualExterior->mContextList.size());
+    }
+}
+
+/// Tests that loading queued content files concurrently gives the same result as loading them one by one.
+TEST_F(StoreTest, parallel_load_test)
+{
+    const int fileCount = 4;
+    const int recordCount = 100;
+    const int cellCount = 10;
+
+    std::vector<std::string> files;
+    for (int i=0; i<fileCount; ++i)
+    {
+        std::ostringstream filename;
+        filename << "test_parallel_load" << i << ".esp";
+        files.push_back(filename.str());
+
+        // content files need to be on disk, so they can be memory mapped
+        boost::filesystem::ofstream stream;
+        stream.open(files.back(), std::ios::binary);
+
+        ESM::ESMWriter writer;
+        writer.setFormat(0);
+        writer.save(stream);
+        // the last plugin deletes some of the apparatus records the others have overwritten
+        writeRecords<ESM::Apparatus>(writer, i, recordCount, i == fileCount-1);
+        writeRecords<ESM::Static>(writer, i, recordCount, false);
+        writeRecords<ESM::NPC>(writer, i, recordCount, false);
+        writeDialogue(writer, i, recordCount);
+        writeCells(writer, i, cellCount);
+        writer.close();
+    }
+
+    std::vector<ESM::ESMReader> sequentialReaders(fileCount);
+    for (int i=0; i<fileCount; ++i)
+    {
+        ESM::ESMReader reader;
+        reader.setIndex(i);
+        reader.setGlobalReaderList(&sequentialReaders);
+        reader.open(files[i]);
+        sequentialReaders[i] = reader;
+        mEsmStore.load(sequentialReaders[i], &dummyListener);
+    }
+    mEsmStore.setUp();
+
+    MWWorld::ESMStore parallelStore;
+    std::vector<ESM::ESMReader> parallelReaders(fileCount);
+    for (int i=0; i<fileCount; ++i)
+    {
+        ESM::ESMReader reader;
+        reader.setIndex(i);
+        reader.setGlobalReaderList(&parallelReaders);
+        reader.open(files[i]);
+        parallelReaders[i] = reader;
+        parallelStore.queueLoad(parallelReaders[i], &dummyListener);
+    }
+    osg::ref_ptr<SceneUtil::WorkQueue> workQueue (new SceneUtil::WorkQueue(4));
+    parallelStore.loadQueued(parallelReaders, workQueue.get(), &dummyListener);
+    parallelStore.setUp();
+
+    ASSERT_EQ (mEsmStore.get<ESM::Apparatus>().getSize(), static_cast<size_t>(recordCount / 2));
+    expectEqualStores<ESM::Apparatus>(mEsmStore, parallelStore);
+    expectEqualStores<ESM::Static>(mEsmStore, parallelStore);
+    expectEqualStores<ESM::NPC>(mEsmStore, parallelStore);
+
+    ASSERT_EQ (mEsmStore.get<ESM::Dialogue>().search("dialogue")->mInfo.size(), static_cast<size_t>(fileCount * recordCount));
+    expectEqualDialogue(mEsmStore, parallelStore);
+
+    ASSERT_EQ (mEsmStore.get<ESM::Cell>().search("cell_0")->mContextList.size(), static_cast<size_t>(fileCount));
+    expectEqualCells(mEsmStore, parallelStore, cellCount);
+
+    // nothing left to load, and no readers to copy
+    MWWorld::ESMStore emptyStore;
+    emptyStore.loadQueued(std::vector<ESM::ESMReader>(), workQueue.get(), &dummyListener);
+
+    for (std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+        boost::filesystem::remove(*it);
+}
+
+/// Tests that the record cache reproduces the merged records of the content files.
+TEST_F(StoreTest, record_cache_test)
+{
+    typedef ESM::Apparatus RecordType;
+
+    RecordType record;
+    record.blank();
+    record.mId = "foobar";
+    record.mModel = "the_model";
+
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    Files::IStreamPtr file = getEsmFile(record, false);
+    reader.open(file, "filename");
+    mEsmStore.load(reader, &dummyListener);
+
+    // a plugin overwrites the record
+    record.mModel = "the_new_model";
+    file = getEsmFile(record, false);
+    reader.open(file, "filename");
+    mEsmStore.load(reader, &dummyListener);
+    mEsmStore.setUp();
+
+    std::stringstream* stream = new std::stringstream;
+    ESM::ESMWriter writer;
+    writer.setFormat(0);
+    writer.save(*stream);
+    mEsmStore.writeCache(writer);
+    writer.close();
+
+    MWWorld::ESMStore cachedStore;
+    reader.open(Files::IStreamPtr(stream), "cache");
+    cachedStore.loadCache(reader, &dummyListener);
+    cachedStore.setUp();
+
+    ASSERT_EQ (cachedStore.get<RecordType>().getSize(), 1u);
+    expectEqualStores<RecordType>(mEsmStore, cachedStore);
+
+    // cached records are skipped when loading the content files again
+    cachedStore.setSkipCachedRecords(true);
+    file = getEsmFile(record, true);
+    reader.open(file, "filename");
+    cachedStore.load(reader, &dummyListener);
+    cachedStore.setUp();
+
+    ASSERT_EQ (cachedStore.get<RecordType>().getSize(), 1u);
+}
+
+/// Tests that the record cache keeps the record flags the records are loaded with.
+TEST_F(StoreTest, record_cache_flags_test)
+{
+    ESM::ESMWriter writer;
+    std::stringstream* stream = new std::stringstream;
+    writer.setFormat(0);
+    writer.save(*stream);
+
+    ESM::NPC npc;
+    npc.blank();
+    npc.mId = "persistent_npc";
+    writer.startRecord(ESM::NPC::sRecordId, 0x0400);
+    npc.save(writer);
+    writer.endRecord(ESM::NPC::sRecordId);
+
+    npc.mId = "npc";
+    writer.startRecord(ESM::NPC::sRecordId);
+    npc.save(writer);
+    writer.endRecord(ESM::NPC::sRecordId);
+
+    ESM::Creature creature;
+    creature.blank();
+    creature.mId = "persistent_creature";
+    writer.startRecord(ESM::Creature::sRecordId, 0x0400);
+    creature.save(writer);
+    writer.endRecord(ESM::Creature::sRecordId);
+
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    reader.open(Files::IStreamPtr(stream), "filename");
+    mEsmStore.load(reader, &dummyListener);
+    mEsmStore.setUp();
+
+    ASSERT_TRUE (mEsmStore.get<ESM::NPC>().find("persistent_npc")->mPersistent);
+
+    stream = new std::stringstream;
+    writer.save(*stream);
+    mEsmStore.writeCache(writer);
+    writer.close();
+
+    MWWorld::ESMStore cachedStore;
+    reader.open(Files::IStreamPtr(stream), "cache");
+    cachedStore.loadCache(reader, &dummyListener);
+    cachedStore.setUp();
+
+    EXPECT_TRUE (cachedStore.get<ESM::NPC>().find("persistent_npc")->mPersistent);
+    EXPECT_FALSE (cachedStore.get<ESM::NPC>().find("npc")->mPersistent);
+    EXPECT_TRUE (cachedStore.get<ESM::Creature>().find("persistent_creature")->mPersistent);
+}
+
+/// Tests that a damaged record cache is ignored without modifying the store.
+TEST_F(StoreTest, record_cache_damaged_test)
+{
+    typedef ESM::Apparatus RecordType;
+
+    const int recordCount = 100;
+    std::stringstream* stream = new std::stringstream;
+    ESM::ESMWriter writer;
+    writer.setFormat(0);
+    writer.save(*stream);
+    writeRecords<RecordType>(writer, 0, recordCount, false);
+
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    reader.open(Files::IStreamPtr(stream), "filename");
+    mEsmStore.load(reader, &dummyListener);
+    mEsmStore.setUp();
+
+    const boost::filesystem::path cacheFile ("test_record_cache.cache");
+    Files::Collections collections (Files::PathContainer(), true);
+    MWWorld::RecordCache cache (cacheFile, MWWorld::ContentFileKey(collections, std::vector<std::string>()), NULL);
+    cache.write(mEsmStore);
+
+    MWWorld::ESMStore cachedStore;
+    ASSERT_TRUE (cache.load(cachedStore, &dummyListener));
+    ASSERT_EQ (cachedStore.get<RecordType>().getSize(), static_cast<size_t>(recordCount));
+
+    // the last records are cut off
+    boost::filesystem::resize_file(cacheFile, boost::filesystem::file_size(cacheFile) - 10);
+
+    MWWorld::ESMStore damagedStore;
+    EXPECT_FALSE (cache.load(damagedStore, &dummyListener));
+    EXPECT_EQ (damagedStore.get<RecordType>().getSize(), 0u);
+
+    boost::filesystem::remove(cacheFile);
+}
+
+/// Tests the read-only lookup of content file records
+TEST_F(StoreTest, static_lookup_test)
+{
+    typedef ESM::Apparatus RecordType;
+
+    RecordType record;
+    record.blank();
+    record.mId = "foobar";
+    record.mModel = "the_model";
+
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    Files::IStreamPtr file = getEsmFile(record, false);
+    reader.open(file, "filename");
+    mEsmStore.load(reader, &dummyListener);
+    mEsmStore.setUp();
+
+    const RecordType* dynamicRecord = mEsmStore.insert(record);
+    mEsmStore.setUp();
+
+    ASSERT_EQ (mEsmStore.find(Misc::StringUtils::lowerCase(dynamicRecord->mId)), static_cast<int>(RecordType::sRecordId));
+    ASSERT_EQ (mEsmStore.findStatic(Misc::StringUtils::lowerCase(dynamicRecord->mId)), 0);
+    ASSERT_EQ (mEsmStore.findStatic("foobar"), static_cast<int>(RecordType::sRecordId));
+
+    ASSERT_TRUE (mEsmStore.get<RecordType>().search(dynamicRecord->mId) == dynamicRecord);
+    ASSERT_TRUE (mEsmStore.get<RecordType>().searchStatic(dynamicRecord->mId) == NULL);
+    ASSERT_TRUE (mEsmStore.get<RecordType>().searchStatic("FooBar") != NULL);
+    ASSERT_EQ (mEsmStore.get<RecordType>().searchStatic("foobar")->mModel, "the_model");
+}
+
+/// Tests that records inserted before the first setUp() don't hide the content file records from the read-only lookup
+TEST_F(StoreTest, static_lookup_insert_test)
+{
+    typedef ESM::Apparatus RecordType;
+
+    RecordType record;
+    record.blank();
+    record.mId = "foobar";
+
+    ESM::ESMReader reader;
+    std::vector<ESM::ESMReader> readerList;
+    readerList.push_back(reader);
+    reader.setGlobalReaderList(&readerList);
+
+    Files::IStreamPtr file = getEsmFile(record, false);
+    reader.open(file, "filename");
+    mEsmStore.load(reader, &dummyListener);
+
+    // like the records inserted by World::ensureNeededRecords()
+    ESM::Static neededRecord;
+    neededRecord.blank();
+    neededRecord.mId = "needed_static";
+    mEsmStore.insertStatic(neededRecord);
+    mEsmStore.setUp();
+
+    ASSERT_EQ (mEsmStore.findStatic("foobar"), static_cast<int>(RecordType::sRecordId));
+    ASSERT_EQ (mEsmStore.findStatic("needed_static"), static_cast<int>(ESM::Static::sRecordId));
+
+    // the dynamic records of later calls are still not listed
+    const RecordType* dynamicRecord = mEsmStore.insert(record);
+    mEsmStore.setUp();
+    ASSERT_EQ (mEsmStore.findStatic(Misc::StringUtils::lowerCase(dynamicRecord->mId)), 0);
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <components/nif/nifstream.hpp>
+#include <components/nif/nifkey.hpp>
+
+namespace
+{
+    // Writes the bytes in little-endian order, regardless of the host
+    void writeUInt(std::ostream& stream, uint32_t value)
+    {
+        for (int i=0; i<4; ++i)
+            stream.put(static_cast<char>((value >> (i*8)) & 0xff));
+    }
+
+    void writeUShort(std::ostream& stream, uint16_t value)
+    {
+        stream.put(static_cast<char>(value & 0xff));
+        stream.put(static_cast<char>(value >> 8));
+    }
+
+    void writeFloat(std::ostream& stream, float value)
+    {
+        union {
+            float f;
+            uint32_t i;
+        } u;
+        u.f = value;
+        writeUInt(stream, u.i);
+    }
+
+    Nif::NIFStream makeStream(const std::string& data)
+    {
+        return Nif::NIFStream(NULL, Files::IStreamPtr(new std::istringstream(data)));
+    }
+}
+
+TEST(NifStreamTest, reads_little_endian_values)
+{
+    std::ostringstream data;
+    writeUShort(data, 0x1234);
+    writeUInt(data, 0x12345678);
+    writeFloat(data, 1.5f);
+
+    Nif::NIFStream nif = makeStream(data.str());
+    EXPECT_EQ(0x1234, nif.getUShort());
+    EXPECT_EQ(0x12345678u, nif.getUInt());
+    EXPECT_EQ(1.5f, nif.getFloat());
+}
+
+TEST(NifStreamTest, reads_arrays)
+{
+    std::ostringstream data;
+    for (int i=0; i<6; ++i)
+        writeFloat(data, i + 0.5f);
+    for (int i=0; i<3; ++i)
+        writeUShort(data, static_cast<uint16_t>(i * 1000));
+    // w, x, y, z
+    for (int i=0; i<4; ++i)
+        writeFloat(data, static_cast<float>(i));
+    writeUInt(data, 42);
+
+    Nif::NIFStream nif = makeStream(data.str());
+
+    std::vector<osg::Vec3f> vertices;
+    nif.getVector3s(vertices, 2);
+    ASSERT_EQ(2u, vertices.size());
+    EXPECT_EQ(osg::Vec3f(0.5f, 1.5f, 2.5f), vertices[0]);
+    EXPECT_EQ(osg::Vec3f(3.5f, 4.5f, 5.5f), vertices[1]);
+
+    std::vector<unsigned short> triangles;
+    nif.getUShorts(triangles, 3);
+    ASSERT_EQ(3u, triangles.size());
+    EXPECT_EQ(0, triangles[0]);
+    EXPECT_EQ(1000, triangles[1]);
+    EXPECT_EQ(2000, triangles[2]);
+
+    std::vector<osg::Quat> rotations;
+    nif.getQuaternions(rotations, 1);
+    ASSERT_EQ(1u, rotations.size());
+    EXPECT_EQ(0.0, rotations[0].w());
+    EXPECT_EQ(1.0, rotations[0].x());
+    EXPECT_EQ(2.0, rotations[0].y());
+    EXPECT_EQ(3.0, rotations[0].z());
+
+    std::vector<float> empty;
+    nif.getFloats(empty, 0);
+    EXPECT_TRUE(empty.empty());
+
+    EXPECT_EQ(42u, nif.getUInt());
+}
+
+TEST(NifStreamTest, reads_keys)
+{
+    std::ostringstream data;
+    writeUInt(data, 2);
+    writeUInt(data, Nif::QuaternionKeyMap::sTBCInterpolation);
+    for (int i=0; i<2; ++i)
+    {
+        writeFloat(data, i * 0.5f);
+        // w, x, y, z
+        writeFloat(data, 1.f);
+        writeFloat(data, 0.f);
+        writeFloat(data, 0.f);
+        writeFloat(data, static_cast<float>(i));
+        // tension, bias, continuity
+        for (int j=0; j<3; ++j)
+            writeFloat(data, 7.f);
+    }
+    writeUInt(data, 2);
+    writeUInt(data, Nif::Vector3KeyMap::sQuadraticInterpolation);
+    for (int i=0; i<2; ++i)
+    {
+        writeFloat(data, i * 2.f);
+        // value, forward and backward value
+        for (int j=0; j<9; ++j)
+            writeFloat(data, static_cast<float>(i * 9 + j));
+    }
+    writeUInt(data, 42);
+
+    Nif::NIFStream nif = makeStream(data.str());
+
+    Nif::QuaternionKeyMap rotations;
+    rotations.read(&nif);
+    ASSERT_EQ(2u, rotations.mKeys.size());
+    EXPECT_EQ(1.0, rotations.mKeys[0.5f].mValue.w());
+    EXPECT_EQ(1.0, rotations.mKeys[0.5f].mValue.z());
+
+    Nif::Vector3KeyMap translations;
+    translations.read(&nif);
+    ASSERT_EQ(2u, translations.mKeys.size());
+    EXPECT_EQ(osg::Vec3f(0.f, 1.f, 2.f), translations.mKeys[0.f].mValue);
+    EXPECT_EQ(osg::Vec3f(9.f, 10.f, 11.f), translations.mKeys[2.f].mValue);
+
+    EXPECT_EQ(42u, nif.getUInt());
+}
+
+TEST(NifStreamTest, reads_large_arrays_from_constrained_file)
+{
+    const char* fileName = "test_nifstream.nif";
+    const unsigned int numVertices = 5000;
+    {
+        std::ofstream file(fileName, std::ios::binary);
+        // Data before the constrained part
+        writeUInt(file, 1);
+        writeUShort(file, 7);
+        for (unsigned int i=0; i<numVertices*3; ++i)
+            writeFloat(file, static_cast<float>(i));
+        writeUInt(file, 42);
+    }
+
+    Nif::NIFStream nif(NULL, Files::openConstrainedFileStream(fileName, 4));
+    EXPECT_EQ(7, nif.getUShort());
+
+    std::vector<osg::Vec3f> vertices;
+    nif.getVector3s(vertices, numVertices);
+    ASSERT_EQ(numVertices, vertices.size());
+    for (unsigned int i=0; i<numVertices; ++i)
+        EXPECT_EQ(osg::Vec3f(i*3.f, i*3.f+1, i*3.f+2), vertices[i]);
+
+    EXPECT_EQ(42u, nif.getUInt());
+
+    std::remove(fileName);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <osg/Group>
+
+#include <components/resource/objectcache.hpp>
+
+struct ObjectCacheTest : public ::testing::Test
+{
+protected:
+    ObjectCacheTest()
+        : mCache(new Resource::ObjectCache)
+    {
+    }
+
+    osg::ref_ptr<Resource::ObjectCache> mCache;
+};
+
+TEST_F(ObjectCacheTest, lookup)
+{
+    mCache->addEntryToObjectCache("meshes\\a.nif", new osg::Group);
+    mCache->addEntryToObjectCache("meshes\\b.nif", new osg::Group);
+
+    EXPECT_EQ(mCache->getCacheSize(), 2u);
+    EXPECT_TRUE(mCache->getRefFromObjectCache("meshes\\a.nif").valid());
+    EXPECT_TRUE(mCache->getRefFromObjectCache("meshes\\b.nif").valid());
+    EXPECT_FALSE(mCache->getRefFromObjectCache("meshes\\c.nif").valid());
+
+    mCache->removeFromObjectCache("meshes\\a.nif");
+    EXPECT_FALSE(mCache->getRefFromObjectCache("meshes\\a.nif").valid());
+
+    Resource::ObjectCache::Stats stats = mCache->getStats();
+    EXPECT_EQ(stats._hits, 2u);
+    EXPECT_EQ(stats._misses, 2u);
+    EXPECT_EQ(mCache->getCacheSize(), 1u);
+}
+
+TEST_F(ObjectCacheTest, expiry)
+{
+    mCache->addEntryToObjectCache("a", new osg::Group, 1.0);
+    mCache->addEntryToObjectCache("b", new osg::Group, 1.0);
+    osg::ref_ptr<osg::Object> referenced = mCache->getRefFromObjectCache("b");
+
+    mCache->updateTimeStampOfObjectsInCacheWithExternalReferences(3.0);
+    mCache->removeExpiredObjectsInCache(2.0);
+
+    EXPECT_FALSE(mCache->getRefFromObjectCache("a").valid());
+    EXPECT_TRUE(mCache->getRefFromObjectCache("b").valid());
+    EXPECT_EQ(mCache->getStats()._evictions, 0u);
+}
+
+TEST_F(ObjectCacheTest, memory_budget)
+{
+    mCache->setMemoryBudget(300);
+    for (int i=0; i<4; ++i)
+        mCache->addEntryToObjectCache(std::string(1, 'a' + i), new osg::Group, 0.0, 100);
+    EXPECT_EQ(mCache->getStats()._size, 400u);
+
+    // "a" is the least recently used object but still referenced, "c" was used more recently than "b"
+    osg::ref_ptr<osg::Object> referenced = mCache->getRefFromObjectCache("a");
+    mCache->getRefFromObjectCache("c");
+
+    mCache->removeExpiredObjectsInCache(-1.0);
+
+    EXPECT_TRUE(mCache->getRefFromObjectCache("a").valid());
+    EXPECT_FALSE(mCache->getRefFromObjectCache("b").valid());
+    EXPECT_TRUE(mCache->getRefFromObjectCache("c").valid());
+    EXPECT_TRUE(mCache->getRefFromObjectCache("d").valid());
+
+    Resource::ObjectCache::Stats stats = mCache->getStats();
+    EXPECT_EQ(stats._evictions, 1u);
+    EXPECT_EQ(stats._size, 300u);
+}
@@ -0,0 +1,319 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/Image>
+#include <osg/MatrixTransform>
+#include <osg/Texture2D>
+
+#include <components/resource/imagemanager.hpp>
+#include <components/resource/scenecache.hpp>
+#include <components/nifosg/controller.hpp>
+#include <components/nifosg/userdata.hpp>
+#include <components/sceneutil/positionattitudetransform.hpp>
+#include <components/sceneutil/riggeometry.hpp>
+#include <components/vfs/archive.hpp>
+#include <components/vfs/manager.hpp>
+
+namespace
+{
+    uint64_t hashString(const std::string& content)
+    {
+        std::istringstream stream(content);
+        return Resource::SceneCache::hash(stream);
+    }
+
+    class TestFile : public VFS::File
+    {
+    public:
+        TestFile(const std::string& content)
+            : mContent(content)
+        {
+        }
+
+        virtual Files::IStreamPtr open()
+        {
+            return Files::IStreamPtr(new std::istringstream(mContent));
+        }
+
+    private:
+        std::string mContent;
+    };
+
+    class TestArchive : public VFS::Archive
+    {
+    public:
+        void addFile(const std::string& name, const std::string& content)
+        {
+            mFiles.insert(std::make_pair(name, TestFile(content)));
+        }
+
+        virtual void listResources(std::map<std::string, VFS::File*>& out, char (*normalize_function) (char))
+        {
+            for (std::map<std::string, TestFile>::iterator it = mFiles.begin(); it != mFiles.end(); ++it)
+            {
+                std::string name = it->first;
+                std::transform(name.begin(), name.end(), name.begin(), normalize_function);
+                out[name] = &it->second;
+            }
+        }
+
+    private:
+        std::map<std::string, TestFile> mFiles;
+    };
+
+    /// A 1x1 uncompressed TGA image
+    std::string createTga()
+    {
+        const unsigned char data[] = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 24, 0, 255, 0, 0 };
+        return std::string(reinterpret_cast<const char*>(data), sizeof(data));
+    }
+
+    /// A 1x1 uncompressed DDS image
+    std::string createDds()
+    {
+        const uint32_t header[31] = {
+            124, 0x100f, 1, 1, 4, 0, 0, // size, flags (caps, height, width, pitch, pixel format), height, width, pitch, depth, mipmaps
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            32, 0x41, 0, 32, 0xff0000, 0xff00, 0xff, 0xff000000, // pixel format: 32 bit RGB with alpha
+            0x1000, 0, 0, 0, 0 // caps: texture
+        };
+        const unsigned char pixel[4] = { 0, 0, 255, 255 };
+
+        std::string content = "DDS ";
+        content.append(reinterpret_cast<const char*>(header), sizeof(header));
+        content.append(reinterpret_cast<const char*>(pixel), sizeof(pixel));
+        return content;
+    }
+}
+
+struct SceneCacheTest : public ::testing::Test
+{
+protected:
+    SceneCacheTest()
+        : mDirectory(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+        , mCache(mDirectory, "options")
+    {
+    }
+
+    ~SceneCacheTest()
+    {
+        boost::filesystem::remove_all(mDirectory);
+    }
+
+    void writeEntry(const std::string& normalizedFilename, const std::string& content)
+    {
+        const boost::filesystem::path file = mDirectory / (normalizedFilename + ".osgb");
+        boost::filesystem::create_directories(file.parent_path());
+        boost::filesystem::ofstream stream(file, std::ios::binary);
+        stream << content;
+    }
+
+    osg::ref_ptr<osg::Group> createScene()
+    {
+        osg::ref_ptr<osg::Group> root (new osg::Group);
+        osg::ref_ptr<osg::MatrixTransform> transform (new osg::MatrixTransform(osg::Matrix::translate(1, 2, 3)));
+        transform->setName("transform");
+        root->addChild(transform);
+
+        osg::ref_ptr<osg::Geode> geode (new osg::Geode);
+        transform->addChild(geode);
+
+        osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+        osg::ref_ptr<osg::Vec3Array> vertices (new osg::Vec3Array);
+        vertices->push_back(osg::Vec3f(0, 0, 0));
+        vertices->push_back(osg::Vec3f(1, 0, 0));
+        vertices->push_back(osg::Vec3f(0, 1, 0));
+        geometry->setVertexArray(vertices);
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, 3));
+        geode->addDrawable(geometry);
+
+        return root;
+    }
+
+    osg::Geometry* getGeometry(osg::Group& scene)
+    {
+        return scene.getChild(0)->asGroup()->getChild(0)->asGeode()->getDrawable(0)->asGeometry();
+    }
+
+    /// Read the entry of meshes/a.nif with the textures of \a archive
+    /// @return The file name of the texture image, empty if there is none.
+    std::string readTextureFileName(TestArchive* archive)
+    {
+        VFS::Manager vfs (false);
+        vfs.addArchive(archive);
+        vfs.buildIndex();
+        Resource::ImageManager imageManager (&vfs);
+
+        osg::ref_ptr<osg::Node> node = mCache.read("meshes/a.nif", hashString("mesh"), &imageManager);
+        if (!node || !node->asGroup())
+            return std::string();
+
+        osg::StateSet* stateset = getGeometry(*node->asGroup())->getStateSet();
+        osg::Texture* texture = stateset ? dynamic_cast<osg::Texture*>(stateset->getTextureAttribute(0, osg::StateAttribute::TEXTURE)) : NULL;
+        if (!texture || !texture->getImage(0))
+            return std::string();
+        return texture->getImage(0)->getFileName();
+    }
+
+    boost::filesystem::path mDirectory;
+    Resource::SceneCache mCache;
+};
+
+TEST_F(SceneCacheTest, hash)
+{
+    EXPECT_EQ(hashString("mesh"), hashString("mesh"));
+    EXPECT_NE(hashString("mesh"), hashString("Mesh"));
+    EXPECT_NE(hashString(""), hashString("mesh"));
+
+    // Longer than the buffer used for reading
+    std::string large (10000, 'a');
+    std::string changed = large;
+    changed[9000] = 'b';
+    EXPECT_NE(hashString(large), hashString(changed));
+}
+
+TEST_F(SceneCacheTest, missing_entry)
+{
+    EXPECT_FALSE(mCache.read("meshes/a.nif", hashString("mesh"), NULL).valid());
+}
+
+TEST_F(SceneCacheTest, invalid_header)
+{
+    const uint64_t fileHash = hashString("mesh");
+
+    writeEntry("meshes/empty.nif", "");
+    EXPECT_FALSE(mCache.read("meshes/empty.nif", fileHash, NULL).valid());
+
+    writeEntry("meshes/magic.nif", std::string("OMWSCENX") + std::string(20, '\0'));
+    EXPECT_FALSE(mCache.read("meshes/magic.nif", fileHash, NULL).valid());
+
+    // The magic, but the header is cut off
+    writeEntry("meshes/truncated.nif", "OMWSCENE\x01");
+    EXPECT_FALSE(mCache.read("meshes/truncated.nif", fileHash, NULL).valid());
+}
+
+TEST_F(SceneCacheTest, write_and_read)
+{
+    const uint64_t fileHash = hashString("mesh");
+    mCache.write("meshes/a.nif", fileHash, *createScene());
+    EXPECT_TRUE(boost::filesystem::exists(mDirectory / "meshes/a.nif.osgb"));
+
+    osg::ref_ptr<osg::Node> node = mCache.read("meshes/a.nif", fileHash, NULL);
+    ASSERT_TRUE(node.valid());
+    ASSERT_TRUE(node->asGroup() != NULL);
+    ASSERT_EQ(1u, node->asGroup()->getNumChildren());
+    EXPECT_EQ("transform", node->asGroup()->getChild(0)->getName());
+    EXPECT_EQ(3u, getGeometry(*node->asGroup())->getVertexArray()->getNumElements());
+
+    // The entry is stored by file name
+    EXPECT_FALSE(mCache.read("meshes/b.nif", fileHash, NULL).valid());
+}
+
+TEST_F(SceneCacheTest, file_hash_mismatch)
+{
+    mCache.write("meshes/a.nif", hashString("mesh"), *createScene());
+
+    // The mesh file has changed since the entry was written
+    EXPECT_FALSE(mCache.read("meshes/a.nif", hashString("changed mesh"), NULL).valid());
+
+    // Replaced once the mesh is converted again
+    mCache.write("meshes/a.nif", hashString("changed mesh"), *createScene());
+    EXPECT_TRUE(mCache.read("meshes/a.nif", hashString("changed mesh"), NULL).valid());
+    EXPECT_FALSE(mCache.read("meshes/a.nif", hashString("mesh"), NULL).valid());
+}
+
+TEST_F(SceneCacheTest, options_mismatch)
+{
+    const uint64_t fileHash = hashString("mesh");
+    mCache.write("meshes/a.nif", fileHash, *createScene());
+
+    Resource::SceneCache otherOptions (mDirectory, "other options");
+    EXPECT_FALSE(otherOptions.read("meshes/a.nif", fileHash, NULL).valid());
+
+    Resource::SceneCache sameOptions (mDirectory, "options");
+    EXPECT_TRUE(sameOptions.read("meshes/a.nif", fileHash, NULL).valid());
+}
+
+TEST_F(SceneCacheTest, texture_replaced_after_write)
+{
+    // The file name as corrected by the NIF loader, when there was only the TGA
+    osg::ref_ptr<osg::Group> scene = createScene();
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->setFileName("textures/a.tga");
+    getGeometry(*scene)->getOrCreateStateSet()->setTextureAttribute(0, new osg::Texture2D(image));
+    mCache.write("meshes/a.nif", hashString("mesh"), *scene);
+
+    TestArchive* archive = new TestArchive;
+    archive->addFile("textures/a.tga", createTga());
+    EXPECT_EQ("textures/a.tga", readTextureFileName(archive));
+
+    // A DDS replacer is used, like when the NIF file is loaded
+    archive = new TestArchive;
+    archive->addFile("textures/a.tga", createTga());
+    archive->addFile("textures/a.dds", createDds());
+    EXPECT_EQ("textures/a.dds", readTextureFileName(archive));
+}
+
+TEST_F(SceneCacheTest, can_cache_plain_scene)
+{
+    osg::ref_ptr<osg::Group> scene = createScene();
+    EXPECT_TRUE(Resource::SceneCache::canCache(*scene));
+
+    // Textures are stored by the file names of their images
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->setFileName("textures/a.dds");
+    getGeometry(*scene)->getOrCreateStateSet()->setTextureAttribute(0, new osg::Texture2D(image));
+    EXPECT_TRUE(Resource::SceneCache::canCache(*scene));
+
+    // The user data of the NIF loader is stored as well
+    scene->getChild(0)->getOrCreateUserDataContainer()->addUserObject(new NifOsg::NodeUserData);
+    EXPECT_TRUE(Resource::SceneCache::canCache(*scene));
+}
+
+TEST_F(SceneCacheTest, can_cache_rejects_controllers)
+{
+    osg::ref_ptr<osg::Group> scene = createScene();
+    scene->getChild(0)->setUpdateCallback(new NifOsg::KeyframeController);
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+
+    scene = createScene();
+    getGeometry(*scene)->setUpdateCallback(new NifOsg::UVController);
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+
+    scene = createScene();
+    scene->getChild(0)->getOrCreateStateSet()->setUpdateCallback(new osg::StateSet::Callback);
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+
+    scene = createScene();
+    getGeometry(*scene)->setComputeBoundingBoxCallback(new osg::Drawable::ComputeBoundingBoxCallback);
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+}
+
+TEST_F(SceneCacheTest, can_cache_rejects_non_osg_classes)
+{
+    osg::ref_ptr<osg::Group> scene = createScene();
+    scene->addChild(new SceneUtil::PositionAttitudeTransform);
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+
+    scene = createScene();
+    scene->getChild(0)->asGroup()->getChild(0)->asGeode()->addDrawable(new SceneUtil::RigGeometry);
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+
+    // Other user data would be lost
+    scene = createScene();
+    scene->getChild(0)->setUserData(new osg::Image);
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+
+    // An image that was not read from a file
+    scene = createScene();
+    getGeometry(*scene)->getOrCreateStateSet()->setTextureAttribute(0, new osg::Texture2D(new osg::Image));
+    EXPECT_FALSE(Resource::SceneCache::canCache(*scene));
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/MatrixTransform>
+
+#include <components/sceneutil/instancing.hpp>
+#include <components/sceneutil/positionattitudetransform.hpp>
+
+namespace
+{
+    osg::ref_ptr<osg::Group> createTemplate()
+    {
+        osg::ref_ptr<osg::Group> root (new osg::Group);
+        osg::ref_ptr<osg::MatrixTransform> transform (new osg::MatrixTransform(osg::Matrix::translate(0, 0, 10)));
+        root->addChild(transform);
+
+        osg::ref_ptr<osg::Geode> geode (new osg::Geode);
+        transform->addChild(geode);
+
+        osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+        osg::ref_ptr<osg::Vec3Array> vertices (new osg::Vec3Array);
+        vertices->push_back(osg::Vec3f(0, 0, 0));
+        vertices->push_back(osg::Vec3f(1, 0, 0));
+        vertices->push_back(osg::Vec3f(0, 1, 0));
+        geometry->setVertexArray(vertices);
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, 3));
+        geode->addDrawable(geometry);
+
+        return root;
+    }
+
+    osg::Matrixf getInstanceMatrix(const osg::Geometry& geometry, unsigned int index)
+    {
+        osg::Matrixf matrix;
+        geometry.getStateSet()->getUniform("instanceMatrices")->getElement(index, matrix);
+        return matrix;
+    }
+}
+
+struct InstanceBatchTest : public ::testing::Test
+{
+protected:
+    InstanceBatchTest()
+        : mTemplate(createTemplate())
+        , mBatch(new SceneUtil::InstanceBatch(mTemplate, ~0u))
+    {
+    }
+
+    osg::Geometry* getGeometry(unsigned int set)
+    {
+        return static_cast<osg::Geometry*>(mBatch->getChild(set));
+    }
+
+    /// The transform of a copy as the shader sees it, including the transform of the Geometry within the template
+    osg::Matrixf getExpectedMatrix(const osg::Matrixf& matrix)
+    {
+        return osg::Matrixf::translate(0, 0, 10) * matrix;
+    }
+
+    osg::ref_ptr<osg::Group> mTemplate;
+    osg::ref_ptr<SceneUtil::InstanceBatch> mBatch;
+
+    // Stand-ins for the nodes of the objects drawn by the batch
+    int mKeys[SceneUtil::InstanceBatch::sMaxInstances + 1];
+};
+
+TEST_F(InstanceBatchTest, can_instance)
+{
+    EXPECT_TRUE(SceneUtil::canInstance(*mTemplate, ~0u));
+
+    osg::ref_ptr<osg::Group> scene = createTemplate();
+    scene->getChild(0)->setUpdateCallback(new osg::NodeCallback);
+    EXPECT_FALSE(SceneUtil::canInstance(*scene, ~0u));
+
+    scene = createTemplate();
+    scene->addChild(new SceneUtil::PositionAttitudeTransform);
+    EXPECT_FALSE(SceneUtil::canInstance(*scene, ~0u));
+
+    // Only drawn by some of the cameras
+    scene = createTemplate();
+    scene->getChild(0)->setNodeMask(0x1);
+    EXPECT_FALSE(SceneUtil::canInstance(*scene, ~0u));
+
+    // Unless the subgraph is not drawn at all
+    EXPECT_TRUE(SceneUtil::canInstance(*scene, ~0x1u));
+}
+
+TEST_F(InstanceBatchTest, empty_batch_is_hidden)
+{
+    mBatch->update();
+    ASSERT_EQ(1u, mBatch->getNumChildren());
+    EXPECT_EQ(0u, getGeometry(0)->getNodeMask());
+
+    mBatch->addInstance(&mKeys[0], osg::Matrixf());
+    mBatch->update();
+    EXPECT_EQ(~0u, getGeometry(0)->getNodeMask());
+
+    mBatch->removeInstance(&mKeys[0]);
+    mBatch->update();
+    EXPECT_EQ(0u, mBatch->getNumInstances());
+    EXPECT_EQ(0u, getGeometry(0)->getNodeMask());
+}
+
+TEST_F(InstanceBatchTest, remove_fills_gap_with_last)
+{
+    for (int i=0; i<3; ++i)
+        mBatch->addInstance(&mKeys[i], osg::Matrixf::translate(i * 100.f, 0, 0));
+    mBatch->update();
+
+    osg::Geometry* geometry = getGeometry(0);
+    EXPECT_EQ(3, geometry->getPrimitiveSet(0)->getNumInstances());
+    for (int i=0; i<3; ++i)
+        EXPECT_EQ(getExpectedMatrix(osg::Matrixf::translate(i * 100.f, 0, 0)), getInstanceMatrix(*geometry, i));
+
+    EXPECT_TRUE(mBatch->removeInstance(&mKeys[0]));
+    EXPECT_FALSE(mBatch->removeInstance(&mKeys[0]));
+    mBatch->update();
+
+    // The last copy moved to the front
+    EXPECT_EQ(2u, mBatch->getNumInstances());
+    EXPECT_EQ(2, geometry->getPrimitiveSet(0)->getNumInstances());
+    EXPECT_EQ(getExpectedMatrix(osg::Matrixf::translate(200.f, 0, 0)), getInstanceMatrix(*geometry, 0));
+    EXPECT_EQ(getExpectedMatrix(osg::Matrixf::translate(100.f, 0, 0)), getInstanceMatrix(*geometry, 1));
+
+    // The moved copy is still found by its key
+    EXPECT_TRUE(mBatch->updateInstance(&mKeys[2], osg::Matrixf::translate(300.f, 0, 0)));
+    mBatch->update();
+    EXPECT_EQ(getExpectedMatrix(osg::Matrixf::translate(300.f, 0, 0)), getInstanceMatrix(*geometry, 0));
+}
+
+TEST_F(InstanceBatchTest, more_copies_than_uniform_array)
+{
+    const unsigned int maxInstances = SceneUtil::InstanceBatch::sMaxInstances;
+    for (unsigned int i=0; i<=maxInstances; ++i)
+        mBatch->addInstance(&mKeys[i], osg::Matrixf::translate(static_cast<float>(i), 0, 0));
+    mBatch->update();
+
+    // A second set of Geometry draws the copy that did not fit
+    ASSERT_EQ(2u, mBatch->getNumChildren());
+    EXPECT_EQ(static_cast<int>(maxInstances), getGeometry(0)->getPrimitiveSet(0)->getNumInstances());
+    EXPECT_EQ(1, getGeometry(1)->getPrimitiveSet(0)->getNumInstances());
+    EXPECT_EQ(~0u, getGeometry(1)->getNodeMask());
+    EXPECT_EQ(getExpectedMatrix(osg::Matrixf::translate(static_cast<float>(maxInstances), 0, 0)), getInstanceMatrix(*getGeometry(1), 0));
+
+    // The sets share the vertex data, but not the number of copies
+    EXPECT_EQ(getGeometry(0)->getVertexArray(), getGeometry(1)->getVertexArray());
+    EXPECT_NE(getGeometry(0)->getPrimitiveSet(0), getGeometry(1)->getPrimitiveSet(0));
+
+    mBatch->removeInstance(&mKeys[0]);
+    mBatch->update();
+    EXPECT_EQ(1u, mBatch->getNumChildren());
+    EXPECT_EQ(static_cast<int>(maxInstances), getGeometry(0)->getPrimitiveSet(0)->getNumInstances());
+}
+
+TEST_F(InstanceBatchTest, bounds_follow_copies)
+{
+    mBatch->addInstance(&mKeys[0], osg::Matrixf());
+    mBatch->update();
+
+    osg::BoundingBox bounds = getGeometry(0)->getBoundingBox();
+    EXPECT_FLOAT_EQ(0.f, bounds.xMin());
+    EXPECT_FLOAT_EQ(1.f, bounds.xMax());
+    EXPECT_FLOAT_EQ(10.f, bounds.zMin());
+
+    EXPECT_TRUE(mBatch->updateInstance(&mKeys[0], osg::Matrixf::translate(100, 0, 0)));
+    EXPECT_FALSE(mBatch->updateInstance(&mKeys[1], osg::Matrixf()));
+    mBatch->update();
+
+    bounds = getGeometry(0)->getBoundingBox();
+    EXPECT_FLOAT_EQ(100.f, bounds.xMin());
+    EXPECT_FLOAT_EQ(101.f, bounds.xMax());
+    EXPECT_FLOAT_EQ(10.f, bounds.zMin());
+
+    // The bounds cover all copies
+    mBatch->addInstance(&mKeys[1], osg::Matrixf::translate(-50, 0, 0));
+    mBatch->update();
+
+    bounds = getGeometry(0)->getBoundingBox();
+    EXPECT_FLOAT_EQ(-50.f, bounds.xMin());
+    EXPECT_FLOAT_EQ(101.f, bounds.xMax());
+}
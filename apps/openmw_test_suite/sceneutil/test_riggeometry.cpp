@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include <osg/Geometry>
+
+#include <components/sceneutil/riggeometry.hpp>
+
+namespace
+{
+    std::string getBoneName(unsigned int index)
+    {
+        // Padded, so the bones are numbered in the order of the influence map
+        std::ostringstream stream;
+        stream << "bone" << (index < 10 ? "0" : "") << index;
+        return stream.str();
+    }
+
+    osg::Vec4f getAttribute(osg::Geometry& geometry, unsigned int attribute, unsigned int vertex)
+    {
+        osg::Vec4Array* array = dynamic_cast<osg::Vec4Array*>(geometry.getVertexAttribArray(attribute));
+        return array ? (*array)[vertex] : osg::Vec4f(-1, -1, -1, -1);
+    }
+}
+
+struct RigGeometryTest : public ::testing::Test
+{
+protected:
+    RigGeometryTest()
+        : mSource(new osg::Geometry)
+        , mInfluenceMap(new SceneUtil::RigGeometry::InfluenceMap)
+        , mRig(new SceneUtil::RigGeometry)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices (new osg::Vec3Array);
+        vertices->push_back(osg::Vec3f(0, 0, 0));
+        vertices->push_back(osg::Vec3f(1, 0, 0));
+        vertices->push_back(osg::Vec3f(0, 1, 0));
+        mSource->setVertexArray(vertices);
+
+        osg::ref_ptr<osg::Vec3Array> normals (new osg::Vec3Array(3));
+        mSource->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+        mSource->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, 3));
+    }
+
+    void addWeight(unsigned int bone, unsigned short vertex, float weight)
+    {
+        mInfluenceMap->mMap[getBoneName(bone)].mWeights[vertex] = weight;
+    }
+
+    /// Give the mesh \a numBones bones that all influence the first vertex
+    void addBones(unsigned int numBones)
+    {
+        for (unsigned int i=0; i<numBones; ++i)
+            addWeight(i, 0, 1.f / numBones);
+    }
+
+    bool setGpuSkinning()
+    {
+        mRig->setInfluenceMap(mInfluenceMap);
+        mRig->setSourceGeometry(mSource);
+        return mRig->setGpuSkinning();
+    }
+
+    osg::ref_ptr<osg::Geometry> mSource;
+    osg::ref_ptr<SceneUtil::RigGeometry::InfluenceMap> mInfluenceMap;
+    osg::ref_ptr<SceneUtil::RigGeometry> mRig;
+};
+
+TEST_F(RigGeometryTest, packs_bones_into_attributes)
+{
+    addWeight(0, 0, 1.f);
+    addWeight(0, 1, 0.25f);
+    addWeight(1, 1, 0.75f);
+    addWeight(1, 2, 1.f);
+
+    ASSERT_TRUE(setGpuSkinning());
+    EXPECT_TRUE(mRig->getGpuSkinning());
+
+    // The bone indices and weights are added to the source geometry, the unused influences have no weight
+    const unsigned int indices = SceneUtil::RigGeometry::BoneIndicesAttribute;
+    const unsigned int weights = SceneUtil::RigGeometry::BoneWeightsAttribute;
+    EXPECT_EQ(osg::Vec4f(0, 0, 0, 0), getAttribute(*mSource, indices, 0));
+    EXPECT_EQ(osg::Vec4f(1, 0, 0, 0), getAttribute(*mSource, weights, 0));
+    EXPECT_EQ(osg::Vec4f(0, 1, 0, 0), getAttribute(*mSource, indices, 1));
+    EXPECT_EQ(osg::Vec4f(0.25f, 0.75f, 0, 0), getAttribute(*mSource, weights, 1));
+    EXPECT_EQ(osg::Vec4f(1, 0, 0, 0), getAttribute(*mSource, indices, 2));
+    EXPECT_EQ(osg::Vec4f(1, 0, 0, 0), getAttribute(*mSource, weights, 2));
+
+    // The arrays are shared with the source geometry instead of being copied
+    EXPECT_EQ(mSource->getVertexArray(), mRig->getVertexArray());
+    EXPECT_EQ(mSource->getNormalArray(), mRig->getNormalArray());
+    EXPECT_EQ(mSource->getVertexAttribArray(indices), mRig->getVertexAttribArray(indices));
+
+    ASSERT_TRUE(mRig->getStateSet() != NULL);
+    osg::Uniform* boneMatrices = mRig->getStateSet()->getUniform("boneMatrices");
+    ASSERT_TRUE(boneMatrices != NULL);
+    EXPECT_EQ(mRig->getNumGpuBones(), boneMatrices->getNumElements());
+}
+
+TEST_F(RigGeometryTest, too_many_influences_per_vertex)
+{
+    addBones(5);
+
+    EXPECT_FALSE(setGpuSkinning());
+    EXPECT_FALSE(mRig->getGpuSkinning());
+
+    // The mesh is still skinned on the CPU, with its own copy of the vertices
+    EXPECT_TRUE(mSource->getVertexAttribArray(SceneUtil::RigGeometry::BoneIndicesAttribute) == NULL);
+    EXPECT_NE(mSource->getVertexArray(), mRig->getVertexArray());
+}
+
+TEST_F(RigGeometryTest, four_influences_per_vertex)
+{
+    addBones(4);
+
+    ASSERT_TRUE(setGpuSkinning());
+    EXPECT_EQ(osg::Vec4f(0, 1, 2, 3), getAttribute(*mSource, SceneUtil::RigGeometry::BoneIndicesAttribute, 0));
+}
+
+TEST_F(RigGeometryTest, too_many_bones)
+{
+    // Each bone influences a different vertex, so only the number of bones is over the limit
+    const unsigned int numBones = SceneUtil::RigGeometry::sMaxGpuBones + 1;
+    mSource->setVertexArray(new osg::Vec3Array(numBones));
+    mSource->setNormalArray(new osg::Vec3Array(numBones), osg::Array::BIND_PER_VERTEX);
+    for (unsigned int i=0; i<numBones; ++i)
+        addWeight(i, static_cast<unsigned short>(i), 1.f);
+
+    EXPECT_FALSE(setGpuSkinning());
+    EXPECT_FALSE(mRig->getGpuSkinning());
+    EXPECT_TRUE(mSource->getVertexAttribArray(SceneUtil::RigGeometry::BoneWeightsAttribute) == NULL);
+}
+
+TEST_F(RigGeometryTest, num_gpu_bones_is_rounded_up)
+{
+    EXPECT_EQ(16u, mRig->getNumGpuBones());
+
+    mRig->setInfluenceMap(mInfluenceMap);
+    EXPECT_EQ(16u, mRig->getNumGpuBones());
+
+    addBones(1);
+    EXPECT_EQ(16u, mRig->getNumGpuBones());
+
+    addBones(16);
+    EXPECT_EQ(16u, mRig->getNumGpuBones());
+
+    addBones(17);
+    EXPECT_EQ(32u, mRig->getNumGpuBones());
+
+    const unsigned int maxBones = SceneUtil::RigGeometry::sMaxGpuBones;
+    addBones(maxBones);
+    EXPECT_EQ(maxBones, mRig->getNumGpuBones());
+}
+
+TEST_F(RigGeometryTest, copy_has_own_bone_matrices)
+{
+    addWeight(0, 0, 1.f);
+    addWeight(1, 1, 1.f);
+    ASSERT_TRUE(setGpuSkinning());
+
+    osg::ref_ptr<SceneUtil::RigGeometry> copy (new SceneUtil::RigGeometry(*mRig, osg::CopyOp::SHALLOW_COPY));
+    EXPECT_TRUE(copy->getGpuSkinning());
+
+    ASSERT_TRUE(copy->getStateSet() != NULL);
+    osg::Uniform* boneMatrices = mRig->getStateSet()->getUniform("boneMatrices");
+    osg::Uniform* copiedBoneMatrices = copy->getStateSet()->getUniform("boneMatrices");
+    ASSERT_TRUE(copiedBoneMatrices != NULL);
+    EXPECT_NE(boneMatrices, copiedBoneMatrices);
+    EXPECT_NE(mRig->getStateSet(), copy->getStateSet());
+    EXPECT_EQ(boneMatrices->getNumElements(), copiedBoneMatrices->getNumElements());
+
+    // The vertex data is still shared
+    EXPECT_EQ(mRig->getVertexArray(), copy->getVertexArray());
+    EXPECT_EQ(mSource->getVertexAttribArray(SceneUtil::RigGeometry::BoneIndicesAttribute),
+              copy->getVertexAttribArray(SceneUtil::RigGeometry::BoneIndicesAttribute));
+}
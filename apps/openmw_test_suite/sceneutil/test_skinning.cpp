@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <osg/Timer>
+
+#include <components/sceneutil/skinning.hpp>
+
+namespace
+{
+    /// A mesh in the size of a character's body, with its vertices split into groups like the groups of a RigGeometry
+    struct ReferenceMesh
+    {
+        ReferenceMesh()
+            : mSeed(1)
+        {
+            const unsigned int numVertices = 6000;
+            const unsigned int numGroups = 40;
+
+            for (unsigned int i=0; i<numVertices; ++i)
+            {
+                mPositions.push_back(osg::Vec3f(random(), random(), random()) * 100.f);
+                osg::Vec3f normal (random(), random(), random());
+                normal.normalize();
+                mNormals.push_back(normal);
+                mTangents.push_back(osg::Vec4f(normal.y(), -normal.x(), 0.f, random() < 0.f ? -1.f : 1.f));
+            }
+
+            mGroups.resize(numGroups);
+            for (unsigned int i=0; i<numVertices; ++i)
+                mGroups[i % numGroups].push_back(static_cast<unsigned short>(i));
+
+            for (unsigned int i=0; i<numGroups; ++i)
+            {
+                osg::Matrixf matrix;
+                float* m = matrix.ptr();
+                for (int j=0; j<12; ++j)
+                    m[j] = random();
+                m[3] = m[7] = m[11] = 0.f;
+                m[12] = random() * 50.f;
+                m[13] = random() * 50.f;
+                m[14] = random() * 50.f;
+                m[15] = 1.f;
+                mMatrices.push_back(matrix);
+            }
+        }
+
+        /// @return A number in [-1, 1), the same on every platform
+        float random()
+        {
+            mSeed = mSeed * 1103515245u + 12345u;
+            return static_cast<float>((mSeed >> 8) & 0xffff) / 32768.f - 1.f;
+        }
+
+        void skin(std::vector<osg::Vec3f>& positions, std::vector<osg::Vec3f>& normals, std::vector<osg::Vec4f>& tangents) const
+        {
+            for (unsigned int i=0; i<mGroups.size(); ++i)
+                SceneUtil::skinVertices(mMatrices[i], &mGroups[i][0], mGroups[i].size(), &mPositions[0], &positions[0],
+                                        &mNormals[0], &normals[0], &mTangents[0], &tangents[0]);
+        }
+
+        /// The scalar transforms that RigGeometry used before
+        void skinReference(std::vector<osg::Vec3f>& positions, std::vector<osg::Vec3f>& normals, std::vector<osg::Vec4f>& tangents) const
+        {
+            for (unsigned int i=0; i<mGroups.size(); ++i)
+            {
+                const osg::Matrixf& matrix = mMatrices[i];
+                for (std::vector<unsigned short>::const_iterator it = mGroups[i].begin(); it != mGroups[i].end(); ++it)
+                {
+                    unsigned short vertex = *it;
+                    positions[vertex] = matrix.preMult(mPositions[vertex]);
+                    normals[vertex] = osg::Matrixf::transform3x3(mNormals[vertex], matrix);
+                    const osg::Vec4f& tangent = mTangents[vertex];
+                    tangents[vertex] = osg::Vec4f(osg::Matrixf::transform3x3(osg::Vec3f(tangent.x(), tangent.y(), tangent.z()), matrix), tangent.w());
+                }
+            }
+        }
+
+        unsigned int mSeed;
+        std::vector<osg::Vec3f> mPositions;
+        std::vector<osg::Vec3f> mNormals;
+        std::vector<osg::Vec4f> mTangents;
+        std::vector<std::vector<unsigned short> > mGroups;
+        std::vector<osg::Matrixf> mMatrices;
+    };
+
+    void expectNear(const osg::Vec3f& expected, const osg::Vec3f& value)
+    {
+        EXPECT_NEAR(expected.x(), value.x(), 1e-3f);
+        EXPECT_NEAR(expected.y(), value.y(), 1e-3f);
+        EXPECT_NEAR(expected.z(), value.z(), 1e-3f);
+    }
+}
+
+TEST(SkinningTest, matches_scalar_transform)
+{
+    ReferenceMesh mesh;
+    const unsigned int numVertices = mesh.mPositions.size();
+
+    std::vector<osg::Vec3f> positions (numVertices), normals (numVertices);
+    std::vector<osg::Vec4f> tangents (numVertices);
+    mesh.skin(positions, normals, tangents);
+
+    std::vector<osg::Vec3f> expectedPositions (numVertices), expectedNormals (numVertices);
+    std::vector<osg::Vec4f> expectedTangents (numVertices);
+    mesh.skinReference(expectedPositions, expectedNormals, expectedTangents);
+
+    for (unsigned int i=0; i<numVertices; ++i)
+    {
+        expectNear(expectedPositions[i], positions[i]);
+        expectNear(expectedNormals[i], normals[i]);
+        expectNear(osg::Vec3f(expectedTangents[i].x(), expectedTangents[i].y(), expectedTangents[i].z()),
+                   osg::Vec3f(tangents[i].x(), tangents[i].y(), tangents[i].z()));
+        EXPECT_EQ(expectedTangents[i].w(), tangents[i].w());
+    }
+}
+
+TEST(SkinningTest, skips_missing_normals_and_tangents)
+{
+    ReferenceMesh mesh;
+    const unsigned int numVertices = mesh.mPositions.size();
+
+    std::vector<osg::Vec3f> positions (numVertices);
+    SceneUtil::skinVertices(mesh.mMatrices[0], &mesh.mGroups[0][0], mesh.mGroups[0].size(), &mesh.mPositions[0], &positions[0],
+                            NULL, NULL, NULL, NULL);
+
+    for (std::vector<unsigned short>::const_iterator it = mesh.mGroups[0].begin(); it != mesh.mGroups[0].end(); ++it)
+        expectNear(mesh.mMatrices[0].preMult(mesh.mPositions[*it]), positions[*it]);
+
+    // Vertices outside of the group are untouched
+    EXPECT_EQ(osg::Vec3f(), positions[1]);
+}
+
+/// Skin the reference mesh with the scalar loop and with skinVertices(), and measure the time taken by both
+TEST(SkinningTest, DISABLED_benchmark)
+{
+    ReferenceMesh mesh;
+    const unsigned int numVertices = mesh.mPositions.size();
+    const int numRuns = 2000;
+
+    std::vector<osg::Vec3f> positions (numVertices), normals (numVertices);
+    std::vector<osg::Vec4f> tangents (numVertices);
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for (int i=0; i<numRuns; ++i)
+        mesh.skinReference(positions, normals, tangents);
+    double reference = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+    start = osg::Timer::instance()->tick();
+    for (int i=0; i<numRuns; ++i)
+        mesh.skin(positions, normals, tangents);
+    double skinning = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+    RecordProperty("scalar_ms", static_cast<int>(reference));
+    RecordProperty("skinVertices_ms", static_cast<int>(skinning));
+}
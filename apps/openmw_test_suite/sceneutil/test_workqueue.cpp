@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <components/sceneutil/workqueue.hpp>
+
+namespace
+{
+    /// Keeps the work thread busy until released, so that the following items stay in the queue
+    class BlockingItem : public SceneUtil::WorkItem
+    {
+    public:
+        BlockingItem()
+            : mReleased(false)
+        {
+        }
+
+        virtual void doWork()
+        {
+            while (!mReleased)
+                OpenThreads::Thread::microSleep(100);
+        }
+
+        void release()
+        {
+            mReleased = true;
+        }
+
+    private:
+        volatile bool mReleased;
+    };
+
+    class OrderItem : public SceneUtil::WorkItem
+    {
+    public:
+        OrderItem(int id, std::vector<int>& order)
+            : mId(id)
+            , mOrder(order)
+            , mAborted(false)
+        {
+        }
+
+        virtual void doWork()
+        {
+            mOrder.push_back(mId);
+        }
+
+        virtual void abort()
+        {
+            mAborted = true;
+        }
+
+        int mId;
+        std::vector<int>& mOrder;
+        bool mAborted;
+    };
+}
+
+struct WorkQueueTest : public ::testing::Test
+{
+protected:
+    WorkQueueTest()
+        : mQueue(new SceneUtil::WorkQueue(1))
+        , mBlocker(new BlockingItem)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        mQueue->addWorkItem(mBlocker);
+        while (mQueue->getNumItems() > 0)
+            OpenThreads::Thread::microSleep(100);
+    }
+
+    osg::ref_ptr<OrderItem> addItem(int id, float priority, bool front=false, const void* key=NULL)
+    {
+        osg::ref_ptr<OrderItem> item (new OrderItem(id, mOrder));
+        item->setPriority(priority);
+        item->setKey(key);
+        mQueue->addWorkItem(item, front);
+        return item;
+    }
+
+    osg::ref_ptr<SceneUtil::WorkQueue> mQueue;
+    osg::ref_ptr<BlockingItem> mBlocker;
+    std::vector<int> mOrder;
+};
+
+TEST_F(WorkQueueTest, priority_order)
+{
+    addItem(0, 0.f);
+    addItem(1, -2.f);
+    addItem(2, 1.f);
+    addItem(3, 0.f);
+    addItem(4, 0.f, true);
+    addItem(5, -1.f, true);
+    osg::ref_ptr<OrderItem> last = addItem(6, -2.f);
+    EXPECT_EQ(mQueue->getNumItems(), 7u);
+
+    mBlocker->release();
+    last->waitTillDone();
+
+    const int expected[] = {2, 4, 0, 3, 5, 1, 6};
+    EXPECT_EQ(mOrder, std::vector<int>(expected, expected + 7));
+
+    SceneUtil::WorkQueue::Stats stats = mQueue->resetStats();
+    EXPECT_EQ(stats.mStarted, 8u);
+    EXPECT_EQ(stats.mCancelled, 0u);
+    EXPECT_GE(stats.mMaxLatency * stats.mStarted, stats.mTotalLatency);
+
+    EXPECT_EQ(mQueue->resetStats().mStarted, 0u);
+}
+
+TEST_F(WorkQueueTest, cancel)
+{
+    int keyA = 0, keyB = 0;
+    osg::ref_ptr<OrderItem> a0 = addItem(0, 0.f, false, &keyA);
+    addItem(1, 0.f, false, &keyB);
+    osg::ref_ptr<OrderItem> a1 = addItem(2, 1.f, false, &keyA);
+    osg::ref_ptr<OrderItem> last = addItem(3, -1.f);
+
+    EXPECT_EQ(mQueue->cancel(&keyA), 2u);
+    EXPECT_EQ(mQueue->cancel(&keyA), 0u);
+    EXPECT_EQ(mQueue->getNumItems(), 2u);
+    EXPECT_TRUE(a0->isDone() && a0->mAborted);
+    EXPECT_TRUE(a1->isDone() && a1->mAborted);
+
+    mBlocker->release();
+    last->waitTillDone();
+
+    const int expected[] = {1, 3};
+    EXPECT_EQ(mOrder, std::vector<int>(expected, expected + 2));
+    EXPECT_EQ(mQueue->resetStats().mCancelled, 2u);
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+#include <components/vfs/manager.hpp>
+#include <components/vfs/archive.hpp>
+
+namespace
+{
+    const int sFileCount = 100000;
+
+    class TestFile : public VFS::File
+    {
+    public:
+        TestFile(const std::string& content)
+            : mContent(content)
+        {
+        }
+
+        virtual Files::IStreamPtr open()
+        {
+            return Files::IStreamPtr(new std::istringstream(mContent));
+        }
+
+    private:
+        std::string mContent;
+    };
+
+    /// Archive with a synthetic directory layout similar to a large texture pack
+    class TestArchive : public VFS::Archive
+    {
+    public:
+        TestArchive()
+        {
+            for (int i=0; i<sFileCount; ++i)
+            {
+                std::ostringstream name;
+                name << "Textures\\Pack" << (i % 50) << "\\TX_Object_" << i << ".dds";
+                mNames.push_back(name.str());
+                mFiles.push_back(TestFile(mNames.back()));
+            }
+        }
+
+        virtual void listResources(std::map<std::string, VFS::File*>& out, char (*normalize_function) (char))
+        {
+            for (size_t i=0; i<mNames.size(); ++i)
+            {
+                std::string name = mNames[i];
+                std::transform(name.begin(), name.end(), name.begin(), normalize_function);
+                out[name] = &mFiles[i];
+            }
+        }
+
+        std::vector<std::string> mNames;
+        std::vector<TestFile> mFiles;
+    };
+}
+
+struct VFSManagerTest : public ::testing::Test
+{
+protected:
+    VFSManagerTest()
+        : mManager(false)
+        , mArchive(new TestArchive)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        mManager.addArchive(mArchive);
+        mManager.buildIndex();
+    }
+
+    VFS::Manager mManager;
+    TestArchive* mArchive;
+};
+
+TEST_F(VFSManagerTest, lookup)
+{
+    EXPECT_EQ(mManager.getIndex().size(), static_cast<size_t>(sFileCount));
+
+    EXPECT_TRUE(mManager.exists("textures/pack3/tx_object_3.dds"));
+    EXPECT_TRUE(mManager.exists("TEXTURES\\PACK3\\TX_OBJECT_3.DDS"));
+    EXPECT_FALSE(mManager.exists("textures/pack3/tx_object_4.dds"));
+    EXPECT_FALSE(mManager.exists("textures/pack3/tx_object_3.dd"));
+    EXPECT_FALSE(mManager.exists(""));
+    EXPECT_FALSE(mManager.exists(std::string(1000, 'a')));
+
+    std::string content;
+    *mManager.get("Textures/Pack7/TX_Object_7.dds") >> content;
+    EXPECT_EQ(content, "Textures\\Pack7\\TX_Object_7.dds");
+
+    *mManager.getNormalized("textures/pack8/tx_object_8.dds") >> content;
+    EXPECT_EQ(content, "Textures\\Pack8\\TX_Object_8.dds");
+
+    EXPECT_THROW(mManager.get("textures/missing.dds"), std::runtime_error);
+    EXPECT_THROW(mManager.getNormalized("Textures/Pack8/TX_Object_8.dds"), std::runtime_error);
+}
+
+TEST_F(VFSManagerTest, strict_lookup)
+{
+    VFS::Manager manager(true);
+    manager.addArchive(new TestArchive);
+    manager.buildIndex();
+
+    EXPECT_TRUE(manager.exists("Textures/Pack3/TX_Object_3.dds"));
+    EXPECT_TRUE(manager.exists("Textures\\Pack3\\TX_Object_3.dds"));
+    EXPECT_FALSE(manager.exists("textures/pack3/tx_object_3.dds"));
+}
+
+/// Measure the lookup throughput of the index, compared to a search through the ordered index.
+TEST_F(VFSManagerTest, DISABLED_benchmark)
+{
+    const int lookups = 1000000;
+    const std::vector<std::string>& names = mArchive->mNames;
+
+    int found = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<lookups; ++i)
+        found += mManager.exists(names[(static_cast<size_t>(i) * 7919) % names.size()]);
+    std::chrono::steady_clock::duration indexTime = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(found, lookups);
+
+    found = 0;
+    const std::map<std::string, VFS::File*>& index = mManager.getIndex();
+    start = std::chrono::steady_clock::now();
+    for (int i=0; i<lookups; ++i)
+    {
+        std::string normalized = names[(static_cast<size_t>(i) * 7919) % names.size()];
+        mManager.normalizeFilename(normalized);
+        found += index.find(normalized) != index.end();
+    }
+    std::chrono::steady_clock::duration mapTime = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(found, lookups);
+
+    RecordProperty("hash_index_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(indexTime).count()));
+    RecordProperty("ordered_index_ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(mapTime).count()));
+}
@@ -147,6 +147,23 @@ void BSAFile::readHeader()
     isLoaded = true;
 }
 
+BsaVersion BSAFile::detectVersion(const std::string &filePath)
+{
+    namespace bfs = boost::filesystem;
+    bfs::ifstream input(bfs::path(filePath), std::ios_base::binary);
+
+    uint32_t head = 0;
+    input.read(reinterpret_cast<char*>(&head), 4);
+    if (input.gcount() != 4)
+        return BSAVER_UNKNOWN;
+
+    if (head == BSAVER_UNCOMPRESSED)
+        return BSAVER_UNCOMPRESSED;
+    if (head == BSAVER_COMPRESSED)
+        return BSAVER_COMPRESSED;
+    return BSAVER_UNKNOWN;
+}
+
 /// Get the index of a given file name, or -1 if not found
 int BSAFile::getIndex(const char *str) const
 {
@@ -164,6 +181,9 @@ void BSAFile::open(const string &file)
 {
     filename = file;
     readHeader();
+
+    // Map the archive once, instead of reopening it for every file
+    mappedFile = Files::openMemoryMappedFile(filename.c_str());
 }
 
 Files::IStreamPtr BSAFile::getFile(const char *file)
@@ -173,12 +193,13 @@ Files::IStreamPtr BSAFile::getFile(const char *file)
     if(i == -1)
         fail("File not found: " + string(file));
 
-    const FileStruct &fs = files[i];
-
-    return Files::openConstrainedFileStream (filename.c_str (), fs.offset, fs.fileSize);
+    return getFile(&files[i]);
 }
 
 Files::IStreamPtr BSAFile::getFile(const FileStruct *file)
 {
+    if (mappedFile)
+        return Files::openMemoryMappedFileStream (mappedFile, file->offset, file->fileSize);
+
     return Files::openConstrainedFileStream (filename.c_str (), file->offset, file->fileSize);
 }
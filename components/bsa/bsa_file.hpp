@@ -32,11 +32,19 @@
 #include <components/misc/stringops.hpp>
 
 #include <components/files/constrainedfilestream.hpp>
+#include <components/files/memorymappedfile.hpp>
 
 
 namespace Bsa
 {
 
+enum BsaVersion
+{
+    BSAVER_UNKNOWN = 0x0,
+    BSAVER_UNCOMPRESSED = 0x100,
+    BSAVER_COMPRESSED = 0x415342 // B, S, A
+};
+
 /**
    This class is used to read "Bethesda Archive Files", or BSAs.
  */
@@ -56,7 +64,7 @@ public:
     };
     typedef std::vector<FileStruct> FileList;
 
-private:
+protected:
     /// Table of files in this archive
     FileList files;
 
@@ -69,6 +77,9 @@ private:
     /// Used for error messages
     std::string filename;
 
+    /// Mapping of the whole archive shared by all opened files, empty if mapping is not supported
+    Files::MemoryMappedFilePtr mappedFile;
+
     /// Case insensitive string comparison
     struct iltstr
     {
@@ -87,7 +98,7 @@ private:
     void fail(const std::string &msg);
 
     /// Read header information from the input source
-    void readHeader();
+    virtual void readHeader();
 
     /// Get the index of a given file name, or -1 if not found
     /// @note Thread safe.
@@ -103,6 +114,11 @@ public:
       : isLoaded(false)
     { }
 
+    virtual ~BSAFile() {}
+
+    /// Detect the archive layout of the given file, returns BSAVER_UNKNOWN if it is not an archive.
+    static BsaVersion detectVersion(const std::string &filePath);
+
     /// Open an archive file.
     void open(const std::string &file);
 
@@ -124,7 +140,12 @@ public:
     /** Open a file contained in the archive.
      * @note Thread safe.
     */
-    Files::IStreamPtr getFile(const FileStruct* file);
+    virtual Files::IStreamPtr getFile(const FileStruct* file);
+
+    /// Are the files read from a memory mapping of the archive? Otherwise each file opens its own
+    /// ConstrainedFileStream.
+    bool isMemoryMapped() const
+    { return mappedFile.get() != NULL; }
 
     /// Get a list of all files
     /// @note Thread safe.
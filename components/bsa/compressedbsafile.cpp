@@ -0,0 +1,263 @@
+#include "compressedbsafile.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include <zlib.h>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <components/files/memorystream.hpp>
+
+namespace
+{
+    /// IMemStream over a buffer of decompressed data that it owns
+    class DecompressedStream : public Files::IMemStream
+    {
+    public:
+        DecompressedStream(const std::shared_ptr<std::vector<char> >& buffer)
+            : Files::MemBuf(buffer->empty() ? NULL : &(*buffer)[0], buffer->size())
+            , Files::IMemStream(buffer->empty() ? NULL : &(*buffer)[0], buffer->size())
+            , mBuffer(buffer)
+        {
+        }
+
+    private:
+        std::shared_ptr<std::vector<char> > mBuffer;
+    };
+
+    template<typename T>
+    void readValue(std::istream& input, T& value)
+    {
+        input.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+}
+
+namespace Bsa
+{
+
+void CompressedBSAFile::readHeader()
+{
+    /*
+     * The layout of a compressed archive is as follows:
+     *
+     * - 36 bytes header, contains 9 ints:
+     *         id - "BSA\0"
+     *         version - 103 (TES4) or 104 (FO3, TES5)
+     *         offset of the folder records, always 36
+     *         archive flags, see ArchiveFlags
+     *         number of folders
+     *         number of files
+     *         total length of the folder names
+     *         total length of the file names
+     *         content flags, we ignore this
+     *
+     * - 16 bytes*numfolders folder records, each record contains:
+     *         hash (8 bytes)
+     *         number of files in the folder
+     *         offset of the folder's file records, we ignore this since they follow in order
+     *
+     * - for each folder:
+     *         folder name, prefixed by its length and null-terminated
+     *         16 bytes*numfiles file records, each record contains:
+     *             hash (8 bytes)
+     *             file size, the high bits are flags (see FileSizeFlags)
+     *             offset of the file data from the beginning of the archive
+     *
+     * - file name buffer, a null-terminated name for each file in the order of the file records
+     *
+     * - The rest of the archive is file data. If file names are embedded, the data of each file starts
+     *   with its full path prefixed by its length. Compressed files start with their uncompressed size,
+     *   followed by the zlib stream.
+     */
+    assert(!isLoaded);
+
+    namespace bfs = boost::filesystem;
+    bfs::ifstream input(bfs::path(filename), std::ios_base::binary);
+
+    // Total archive size
+    std::streamoff fsize = 0;
+    if(input.seekg(0, std::ios_base::end))
+    {
+        fsize = input.tellg();
+        input.seekg(0);
+    }
+
+    if(fsize < 36)
+        fail("File too small to be a valid BSA archive");
+
+    uint32_t head[9];
+    input.read(reinterpret_cast<char*>(head), 36);
+
+    if(head[0] != static_cast<uint32_t>(BSAVER_COMPRESSED))
+        fail("Unrecognized compressed BSA header");
+
+    const uint32_t version = head[1];
+    if(version == 105)
+        fail("Version 105 archives use LZ4 compression, which is not supported");
+    if(version != 103 && version != 104)
+        fail("Unrecognized compressed BSA version");
+
+    const uint32_t archiveFlags = head[3];
+    const size_t folderCount = head[4];
+    const size_t fileCount = head[5];
+    const size_t totalFileNameLength = head[7];
+
+    if(!(archiveFlags & ArchiveFlag_FolderNames) || !(archiveFlags & ArchiveFlag_FileNames))
+        fail("Archives without folder or file names are not supported");
+
+    mCompressedByDefault = (archiveFlags & ArchiveFlag_Compress) != 0;
+    mEmbeddedFileNames = version == 104 && (archiveFlags & ArchiveFlag_EmbedFileNames);
+
+    // Each folder and file record takes up 16 bytes, so this is a cheap sanity check before allocating anything
+    if((folderCount + fileCount) * 16 + totalFileNameLength > unsigned(fsize - 36))
+        fail("Directory information larger than entire archive");
+
+    input.seekg(head[2]);
+
+    std::vector<uint32_t> folderFileCounts(folderCount);
+    for(size_t i=0;i<folderCount;i++)
+    {
+        uint64_t hash;
+        uint32_t offset;
+        readValue(input, hash);
+        readValue(input, folderFileCounts[i]);
+        readValue(input, offset);
+    }
+
+    std::vector<std::string> folderNames;
+    std::vector<size_t> fileFolders;
+    std::vector<uint32_t> sizes;
+    std::vector<uint32_t> offsets;
+    for(size_t i=0;i<folderCount;i++)
+    {
+        uint8_t length = 0;
+        readValue(input, length);
+        std::vector<char> name(length + 1, '\0');
+        input.read(&name[0], length);
+        folderNames.push_back(&name[0]);
+
+        for(uint32_t j=0;j<folderFileCounts[i];j++)
+        {
+            uint64_t hash;
+            uint32_t size, offset;
+            readValue(input, hash);
+            readValue(input, size);
+            readValue(input, offset);
+
+            fileFolders.push_back(i);
+            sizes.push_back(size);
+            offsets.push_back(offset);
+        }
+    }
+
+    if(!input || sizes.size() != fileCount)
+        fail("Invalid folder records");
+
+    std::vector<char> fileNames(totalFileNameLength + 1, '\0');
+    input.read(&fileNames[0], totalFileNameLength);
+    if(!input)
+        fail("Invalid file name table");
+
+    // Build the full paths of all files, the file table points into this buffer
+    std::vector<size_t> nameOffsets(fileCount);
+    stringBuf.clear();
+    size_t fileNameOffset = 0;
+    for(size_t i=0;i<fileCount;i++)
+    {
+        if(fileNameOffset >= totalFileNameLength)
+            fail("Invalid file name table");
+        const char* fileName = &fileNames[fileNameOffset];
+        const size_t fileNameLength = std::strlen(fileName);
+        fileNameOffset += fileNameLength + 1;
+
+        nameOffsets[i] = stringBuf.size();
+        const std::string& folderName = folderNames[fileFolders[i]];
+        stringBuf.insert(stringBuf.end(), folderName.begin(), folderName.end());
+        if(!folderName.empty())
+            stringBuf.push_back('\\');
+        stringBuf.insert(stringBuf.end(), fileName, fileName + fileNameLength);
+        stringBuf.push_back('\0');
+    }
+
+    files.resize(fileCount);
+    mCompressed.resize(fileCount);
+    for(size_t i=0;i<fileCount;i++)
+    {
+        FileStruct &fs = files[i];
+        fs.fileSize = sizes[i] & ~(FileSizeFlag_ToggleCompress | FileSizeFlag_Checked);
+        fs.offset = offsets[i];
+        fs.name = &stringBuf[nameOffsets[i]];
+
+        if(fs.offset + static_cast<std::streamoff>(fs.fileSize) > fsize)
+            fail("Archive contains offsets outside itself");
+
+        mCompressed[i] = ((sizes[i] & FileSizeFlag_ToggleCompress) != 0) != mCompressedByDefault;
+
+        lookup[fs.name] = i;
+    }
+
+    isLoaded = true;
+}
+
+bool CompressedBSAFile::isCompressed(const FileStruct *file) const
+{
+    return mCompressed[file - &files[0]];
+}
+
+Files::IStreamPtr CompressedBSAFile::getFile(const FileStruct *file)
+{
+    // Read the stored data straight from the mapping if possible
+    std::vector<char> storedBuffer;
+    const char* stored = NULL;
+    if (mappedFile)
+        stored = mappedFile->data() + file->offset;
+    else
+    {
+        storedBuffer.resize(file->fileSize);
+        Files::IStreamPtr stream = Files::openConstrainedFileStream(filename.c_str(), file->offset, file->fileSize);
+        stream->read(storedBuffer.empty() ? NULL : &storedBuffer[0], storedBuffer.size());
+        if (stream->gcount() != static_cast<std::streamsize>(storedBuffer.size()))
+            fail("Failed to read " + std::string(file->name));
+        stored = storedBuffer.empty() ? NULL : &storedBuffer[0];
+    }
+
+    size_t start = 0;
+    if (mEmbeddedFileNames)
+    {
+        if (file->fileSize < 1 || file->fileSize < 1u + static_cast<uint8_t>(stored[0]))
+            fail("Invalid embedded file name for " + std::string(file->name));
+        start = 1 + static_cast<uint8_t>(stored[0]);
+    }
+
+    if (!isCompressed(file))
+    {
+        if (mappedFile)
+            return Files::openMemoryMappedFileStream(mappedFile, file->offset + start, file->fileSize - start);
+
+        std::shared_ptr<std::vector<char> > buffer(new std::vector<char>(stored + start, stored + file->fileSize));
+        return Files::IStreamPtr(new DecompressedStream(buffer));
+    }
+
+    if (file->fileSize < start + 4)
+        fail("Invalid compressed file " + std::string(file->name));
+
+    uint32_t uncompressedSize;
+    std::memcpy(&uncompressedSize, stored + start, 4);
+    start += 4;
+
+    std::shared_ptr<std::vector<char> > buffer(new std::vector<char>(uncompressedSize));
+    uLongf destLength = uncompressedSize;
+    if (uncompressedSize > 0)
+    {
+        int result = uncompress(reinterpret_cast<Bytef*>(&(*buffer)[0]), &destLength,
+                                reinterpret_cast<const Bytef*>(stored + start), file->fileSize - start);
+        if (result != Z_OK || destLength != uncompressedSize)
+            fail("Failed to decompress " + std::string(file->name));
+    }
+
+    return Files::IStreamPtr(new DecompressedStream(buffer));
+}
+
+}
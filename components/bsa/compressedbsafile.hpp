@@ -0,0 +1,60 @@
+#ifndef BSA_COMPRESSED_BSA_FILE_H
+#define BSA_COMPRESSED_BSA_FILE_H
+
+#include <components/bsa/bsa_file.hpp>
+
+namespace Bsa
+{
+
+/**
+   Reader for the archive layout introduced with TES4 (version 103 and 104), in which
+   files may be stored zlib compressed. Files are decompressed by the thread opening them.
+ */
+class CompressedBSAFile : public BSAFile
+{
+public:
+    CompressedBSAFile()
+      : mCompressedByDefault(false)
+      , mEmbeddedFileNames(false)
+    { }
+
+    /// Is the given file stored compressed?
+    bool isCompressed(const FileStruct* file) const;
+
+    using BSAFile::getFile;
+
+    /** Open a file contained in the archive, decompressing it if necessary.
+     * @note Thread safe.
+    */
+    virtual Files::IStreamPtr getFile(const FileStruct* file);
+
+private:
+    enum ArchiveFlags
+    {
+        ArchiveFlag_FolderNames = 0x1,
+        ArchiveFlag_FileNames = 0x2,
+        ArchiveFlag_Compress = 0x4,
+        ArchiveFlag_EmbedFileNames = 0x100
+    };
+
+    enum FileSizeFlags
+    {
+        FileSizeFlag_ToggleCompress = 0x40000000,
+        FileSizeFlag_Checked = 0x80000000
+    };
+
+    /// Per file compression state, same order as the file table
+    std::vector<bool> mCompressed;
+
+    bool mCompressedByDefault;
+
+    /// Does the data of each file start with its full path?
+    bool mEmbeddedFileNames;
+
+    /// Read header information from the input source
+    virtual void readHeader();
+};
+
+}
+
+#endif
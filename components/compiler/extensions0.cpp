@@ -305,6 +305,7 @@ namespace Compiler
             extensions.registerInstruction("tgm", "", opcodeToggleGodMode);
             extensions.registerInstruction("togglegodmode", "", opcodeToggleGodMode);
             extensions.registerInstruction("togglescripts", "", opcodeToggleScripts);
+            extensions.registerInstruction("showscriptcosts", "", opcodeShowScriptCosts);
             extensions.registerInstruction ("disablelevitation", "", opcodeDisableLevitation);
             extensions.registerInstruction ("enablelevitation", "", opcodeEnableLevitation);
             extensions.registerFunction ("getpcinjail", 'l', "", opcodeGetPcInJail);
@@ -280,6 +280,7 @@ namespace Compiler
         const int opcodeShowExplicit = 0x2000305;
         const int opcodeToggleGodMode = 0x200021f;
         const int opcodeToggleScripts = 0x2000301;
+        const int opcodeShowScriptCosts = 0x2000306;
         const int opcodeDisableLevitation = 0x2000220;
         const int opcodeEnableLevitation = 0x2000221;
         const int opcodeCast = 0x2000227;
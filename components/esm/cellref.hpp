@@ -1,6 +1,7 @@
 #ifndef OPENMW_ESM_CELLREF_H
 #define OPENMW_ESM_CELLREF_H
 
+#include <cstddef>
 #include <string>
 
 #include "defs.hpp"
@@ -114,6 +115,15 @@ namespace ESM
 
     bool operator== (const RefNum& left, const RefNum& right);
     bool operator< (const RefNum& left, const RefNum& right);
+
+    /// Hash function for using RefNum as key of an unordered container.
+    struct RefNumHash
+    {
+        std::size_t operator() (const RefNum& refNum) const
+        {
+            return static_cast<std::size_t>(refNum.mIndex) ^ (static_cast<std::size_t>(refNum.mContentFile) << 24);
+        }
+    };
 }
 
 #endif
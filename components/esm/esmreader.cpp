@@ -15,13 +15,14 @@ using namespace Misc;
 ESM_Context ESMReader::getContext()
 {
     // Update the file position before returning
-    mCtx.filePos = mEsm->tellg();
+    mCtx.filePos = getFileOffset();
     return mCtx;
 }
 
 ESMReader::ESMReader()
     : mIdx(0)
     , mRecordFlags(0)
+    , mMappedPos(0)
     , mBuffer(50*1024)
     , mGlobalReaderList(NULL)
     , mEncoder(NULL)
@@ -44,12 +45,14 @@ void ESMReader::restoreContext(const ESM_Context &rc)
     mCtx = rc;
 
     // Make sure we seek to the right place
-    mEsm->seekg(mCtx.filePos);
+    seek(mCtx.filePos);
 }
 
 void ESMReader::close()
 {
     mEsm.reset();
+    mMappedFile.reset();
+    mMappedPos = 0;
     mCtx.filename.clear();
     mCtx.leftFile = 0;
     mCtx.leftRec = 0;
@@ -69,15 +72,38 @@ void ESMReader::openRaw(Files::IStreamPtr _esm, const std::string& name)
     mEsm->seekg(0, mEsm->beg);
 }
 
-void ESMReader::openRaw(const std::string& filename)
+void ESMReader::openRaw(Files::MemoryMappedFilePtr file, const std::string &name)
 {
-    openRaw(Files::openConstrainedFileStream(filename.c_str()), filename);
+    close();
+    mMappedFile = file;
+    mMappedPos = 0;
+    mCtx.filename = name;
+    mCtx.leftFile = mFileSize = mMappedFile->size();
 }
 
-void ESMReader::open(Files::IStreamPtr _esm, const std::string &name)
+void ESMReader::openShared(const ESMReader &reader)
 {
-    openRaw(_esm, name);
+    if (!reader.isMemoryMapped())
+        throw std::runtime_error("Can't share the file of a reader that is not memory mapped");
 
+    openRaw(reader.mMappedFile, reader.mCtx.filename);
+    mHeader = reader.mHeader;
+    setIndex(reader.mIdx);
+    mGlobalReaderList = reader.mGlobalReaderList;
+    mEncoder = reader.mEncoder;
+}
+
+void ESMReader::openRaw(const std::string& filename)
+{
+    Files::MemoryMappedFilePtr mapped = Files::openMemoryMappedFile(filename.c_str());
+    if (mapped)
+        openRaw(mapped, filename);
+    else
+        openRaw(Files::openConstrainedFileStream(filename.c_str()), filename);
+}
+
+void ESMReader::loadHeader()
+{
     if (getRecName() != "TES3")
         fail("Not a valid Morrowind file");
 
@@ -86,9 +112,22 @@ void ESMReader::open(Files::IStreamPtr _esm, const std::string &name)
     mHeader.load (*this);
 }
 
+void ESMReader::open(Files::IStreamPtr _esm, const std::string &name)
+{
+    openRaw(_esm, name);
+    loadHeader();
+}
+
+void ESMReader::open(Files::MemoryMappedFilePtr file, const std::string &name)
+{
+    openRaw(file, name);
+    loadHeader();
+}
+
 void ESMReader::open(const std::string &file)
 {
-    open (Files::openConstrainedFileStream (file.c_str ()), file);
+    openRaw(file);
+    loadHeader();
 }
 
 int64_t ESMReader::getHNLong(const char *name)
@@ -315,6 +354,15 @@ void ESMReader::getRecHeader(uint32_t &flags)
 
 void ESMReader::getExact(void*x, int size)
 {
+    if (mMappedFile)
+    {
+        if (size < 0 || mMappedPos + size > mFileSize)
+            fail("Read error: unexpected end of file");
+        memcpy(x, mMappedFile->data() + mMappedPos, size);
+        mMappedPos += size;
+        return;
+    }
+
     try
     {
         mEsm->read((char*)x, size);
@@ -327,18 +375,30 @@ void ESMReader::getExact(void*x, int size)
 
 std::string ESMReader::getString(int size)
 {
-    size_t s = size;
-    if (mBuffer.size() <= s)
-        // Add some extra padding to reduce the chance of having to resize
-        // again later.
-        mBuffer.resize(3*s);
-
-    // And make sure the string is zero terminated
-    mBuffer[s] = 0;
-
-    // read ESM data
-    char *ptr = &mBuffer[0];
-    getExact(ptr, size);
+    const char *ptr;
+    if (mMappedFile)
+    {
+        // Read the string straight out of the mapped region
+        if (size < 0 || mMappedPos + size > mFileSize)
+            fail("Read error: unexpected end of file");
+        ptr = mMappedFile->data() + mMappedPos;
+        mMappedPos += size;
+    }
+    else
+    {
+        size_t s = size;
+        if (mBuffer.size() <= s)
+            // Add some extra padding to reduce the chance of having to resize
+            // again later.
+            mBuffer.resize(3*s);
+
+        // And make sure the string is zero terminated
+        mBuffer[s] = 0;
+
+        // read ESM data
+        getExact(&mBuffer[0], size);
+        ptr = &mBuffer[0];
+    }
 
     size = strnlen(ptr, size);
 
@@ -359,8 +419,8 @@ void ESMReader::fail(const std::string &msg)
     ss << "\n  File: " << mCtx.filename;
     ss << "\n  Record: " << mCtx.recName.toString();
     ss << "\n  Subrecord: " << mCtx.subName.toString();
-    if (mEsm.get())
-        ss << "\n  Offset: 0x" << hex << mEsm->tellg();
+    if (mEsm.get() || mMappedFile.get())
+        ss << "\n  Offset: 0x" << hex << getFileOffset();
     throw std::runtime_error(ss.str());
 }
 
@@ -371,12 +431,22 @@ void ESMReader::setEncoder(ToUTF8::Utf8Encoder* encoder)
 
 size_t ESMReader::getFileOffset()
 {
+    if (mMappedFile)
+        return mMappedPos;
     return mEsm->tellg();
 }
 
+void ESMReader::seek(size_t pos)
+{
+    if (mMappedFile)
+        mMappedPos = pos;
+    else
+        mEsm->seekg(pos);
+}
+
 void ESMReader::skip(int bytes)
 {
-    mEsm->seekg(getFileOffset()+bytes);
+    seek(getFileOffset()+bytes);
 }
 
 }
@@ -8,6 +8,7 @@
 #include <sstream>
 
 #include <components/files/constrainedfilestream.hpp>
+#include <components/files/memorymappedfile.hpp>
 
 #include <components/misc/stringops.hpp>
 
@@ -69,10 +70,27 @@ public:
   /// currently open file first, if any.
   void open(Files::IStreamPtr _esm, const std::string &name);
 
+  /// Raw opening of a memory mapped file. Subrecords are read straight from the mapped
+  /// region rather than through a stream buffer.
+  void openRaw(Files::MemoryMappedFilePtr file, const std::string &name);
+
+  /// Load ES file from a memory mapped file, parses the header.
+  void open(Files::MemoryMappedFilePtr file, const std::string &name);
+
+  /// Open the given file, memory mapping it if possible and falling back to a
+  /// ConstrainedFileStream otherwise.
   void open(const std::string &file);
 
   void openRaw(const std::string &filename);
 
+  /// Read the memory mapped file of another reader, from a position of its own. Unlike a copy
+  /// of the reader, this does not copy its read buffer.
+  /// @note \a reader must be memory mapped.
+  void openShared(const ESMReader &reader);
+
+  /// Is the currently open file read from a memory mapping?
+  bool isMemoryMapped() const { return mMappedFile.get() != NULL; }
+
   /// Get the current position in the file. Make sure that the file has been opened!
   size_t getFileOffset();
 
@@ -263,14 +281,24 @@ public:
   /// Sets font encoder for ESM strings
   void setEncoder(ToUTF8::Utf8Encoder* encoder);
 
+  ToUTF8::Utf8Encoder* getEncoder() const { return mEncoder; }
+
   /// Get record flags of last record
   unsigned int getRecordFlags() { return mRecordFlags; }
 
   size_t getFileSize() const { return mFileSize; }
 
 private:
+  void loadHeader();
+
+  void seek(size_t pos);
+
   Files::IStreamPtr mEsm;
 
+  // Only one of mEsm and mMappedFile is in use at any time
+  Files::MemoryMappedFilePtr mMappedFile;
+  size_t mMappedPos;
+
   ESM_Context mCtx;
 
   unsigned int mRecordFlags;
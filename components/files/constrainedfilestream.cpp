@@ -53,6 +53,29 @@ namespace Files
             return traits_type::to_int_type(*gptr());
         }
 
+        virtual std::streamsize xsgetn(char_type* s, std::streamsize count)
+        {
+            // Whatever is left in the buffer first
+            std::streamsize got = std::min(count, static_cast<std::streamsize>(egptr() - gptr()));
+            std::copy(gptr(), gptr() + got, s);
+            gbump(static_cast<int>(got));
+
+            if (count - got < static_cast<std::streamsize>(sBufferSize))
+                return got + std::streambuf::xsgetn(s + got, count - got);
+
+            // Large blocks, e.g. the vertex arrays of a NIF file, are read straight into the destination
+            size_t toRead = std::min((mOrigin+mSize)-(mFile.tell()), static_cast<size_t>(count - got));
+            while (toRead > 0)
+            {
+                size_t read = mFile.read(s + got, toRead);
+                if (read == 0)
+                    break;
+                got += read;
+                toRead -= read;
+            }
+            return got;
+        }
+
         virtual pos_type seekoff(off_type offset, std::ios_base::seekdir whence, std::ios_base::openmode mode)
         {
             if((mode&std::ios_base::out) || !(mode&std::ios_base::in))
@@ -0,0 +1,196 @@
+#include "memorymappedfile.hpp"
+
+#include <stdexcept>
+
+#include "memorystream.hpp"
+
+#if FILE_API == FILE_API_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+namespace Files
+{
+
+    /// IMemStream that holds on to the mapping it reads from
+    class MemoryMappedFileStream : public IMemStream
+    {
+    public:
+        MemoryMappedFileStream(const MemoryMappedFilePtr& file, size_t start, size_t length)
+            : MemBuf(file->data() + start, length)
+            , IMemStream(file->data() + start, length)
+            , mFile(file)
+        {
+        }
+
+    private:
+        MemoryMappedFilePtr mFile;
+    };
+
+#if FILE_API == FILE_API_POSIX
+
+    MemoryMappedFile::MemoryMappedFile()
+        : mData(NULL)
+        , mSize(0)
+    {
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        close();
+    }
+
+    bool MemoryMappedFile::open(const char* filename)
+    {
+        close();
+
+#ifdef O_BINARY
+        static const int openFlags = O_RDONLY | O_BINARY;
+#else
+        static const int openFlags = O_RDONLY;
+#endif
+
+        int fd = ::open(filename, openFlags, 0);
+        if (fd == -1)
+            return false;
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void* data = ::mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+
+        if (data == MAP_FAILED)
+            return false;
+
+        mData = static_cast<const char*>(data);
+        mSize = static_cast<size_t>(info.st_size);
+        mFilename = filename;
+        return true;
+    }
+
+    void MemoryMappedFile::close()
+    {
+        if (mData != NULL)
+            ::munmap(const_cast<char*>(mData), mSize);
+        mData = NULL;
+        mSize = 0;
+        mFilename.clear();
+    }
+
+#elif FILE_API == FILE_API_WIN32
+
+    MemoryMappedFile::MemoryMappedFile()
+        : mData(NULL)
+        , mSize(0)
+        , mFileHandle(INVALID_HANDLE_VALUE)
+        , mMappingHandle(NULL)
+    {
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        close();
+    }
+
+    bool MemoryMappedFile::open(const char* filename)
+    {
+        close();
+
+        mFileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        if (mFileHandle == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(mFileHandle, &fileSize) || fileSize.QuadPart <= 0)
+        {
+            close();
+            return false;
+        }
+
+        mMappingHandle = CreateFileMappingA(mFileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mMappingHandle == NULL)
+        {
+            close();
+            return false;
+        }
+
+        const void* data = MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (data == NULL)
+        {
+            close();
+            return false;
+        }
+
+        mData = static_cast<const char*>(data);
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+        mFilename = filename;
+        return true;
+    }
+
+    void MemoryMappedFile::close()
+    {
+        if (mData != NULL)
+            UnmapViewOfFile(mData);
+        if (mMappingHandle != NULL)
+            CloseHandle(mMappingHandle);
+        if (mFileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(mFileHandle);
+
+        mData = NULL;
+        mSize = 0;
+        mMappingHandle = NULL;
+        mFileHandle = INVALID_HANDLE_VALUE;
+        mFilename.clear();
+    }
+
+#else
+
+    MemoryMappedFile::MemoryMappedFile()
+        : mData(NULL)
+        , mSize(0)
+    {
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+    }
+
+    bool MemoryMappedFile::open(const char* filename)
+    {
+        // Not supported with the stdio file API
+        return false;
+    }
+
+    void MemoryMappedFile::close()
+    {
+    }
+
+#endif
+
+    MemoryMappedFilePtr openMemoryMappedFile(const char* filename)
+    {
+        MemoryMappedFilePtr file(new MemoryMappedFile);
+        if (!file->open(filename))
+            file.reset();
+        return file;
+    }
+
+    IStreamPtr openMemoryMappedFileStream(const MemoryMappedFilePtr& file, size_t start, size_t length)
+    {
+        if (start > file->size() || length > file->size() - start)
+            throw std::runtime_error("Region outside of mapped file " + file->getFilename());
+
+        return IStreamPtr(new MemoryMappedFileStream(file, start, length));
+    }
+
+}
@@ -0,0 +1,61 @@
+#ifndef OPENMW_COMPONENTS_FILES_MEMORYMAPPEDFILE_H
+#define OPENMW_COMPONENTS_FILES_MEMORYMAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "lowlevelfile.hpp"
+#include "constrainedfilestream.hpp"
+
+namespace Files
+{
+
+    /// @brief Read-only mapping of an entire file into the address space.
+    /// @note Mapping is not available with the stdio file API. Callers are expected to fall back to
+    /// a ConstrainedFileStream when open() fails.
+    class MemoryMappedFile
+    {
+    public:
+        MemoryMappedFile();
+        ~MemoryMappedFile();
+
+        /// Map the given file. Returns false if the file could not be mapped.
+        bool open(const char* filename);
+
+        void close();
+
+        bool isOpen() const { return mData != NULL; }
+
+        const char* data() const { return mData; }
+
+        size_t size() const { return mSize; }
+
+        const std::string& getFilename() const { return mFilename; }
+
+    private:
+        MemoryMappedFile(const MemoryMappedFile&);
+        MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+        const char* mData;
+        size_t mSize;
+        std::string mFilename;
+
+#if FILE_API == FILE_API_WIN32
+        HANDLE mFileHandle;
+        HANDLE mMappingHandle;
+#endif
+    };
+
+    typedef std::shared_ptr<MemoryMappedFile> MemoryMappedFilePtr;
+
+    /// Map the given file, returns an empty pointer if mapping failed or is not supported on this platform.
+    MemoryMappedFilePtr openMemoryMappedFile(const char* filename);
+
+    /// Open a stream reading straight from the given region of a mapped file, without copying it into a buffer first.
+    /// The stream keeps the mapping alive. Separate streams over the same mapping may be read concurrently.
+    IStreamPtr openMemoryMappedFileStream(const MemoryMappedFilePtr& file, size_t start, size_t length);
+
+}
+
+#endif
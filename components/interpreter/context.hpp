@@ -1,6 +1,7 @@
 #ifndef INTERPRETER_CONTEXT_H_INCLUDED
 #define INTERPRETER_CONTEXT_H_INCLUDED
 
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -49,6 +50,30 @@ namespace Interpreter
 
             virtual void setGlobalFloat (const std::string& name, float value) = 0;
 
+            virtual int getGlobalsRevision() const { return 0; }
+            ///< Global variable handles obtained with a different revision must not be used.
+
+            virtual int getGlobalHandle (const std::string& name) const { return -1; }
+            ///< Return a handle for accessing global variable \a name without searching for it
+            /// (-1: no such variable, or handles are not supported).
+
+            virtual int getJournalHandle (const std::string& id) const { return -1; }
+            ///< Return a handle for getting the journal index of quest \a id without searching for it
+            /// (-1: not a quest, or handles are not supported). Unlike global variable handles, these do not
+            /// depend on the globals revision.
+
+            virtual int getLinkedGlobalShort (int handle) const { return unsupportedHandle(); }
+
+            virtual int getLinkedGlobalLong (int handle) const { return unsupportedHandle(); }
+
+            virtual float getLinkedGlobalFloat (int handle) const { return unsupportedHandle(); }
+
+            virtual void setLinkedGlobalShort (int handle, int value) { unsupportedHandle(); }
+
+            virtual void setLinkedGlobalLong (int handle, int value) { unsupportedHandle(); }
+
+            virtual void setLinkedGlobalFloat (int handle, float value) { unsupportedHandle(); }
+
             virtual std::vector<std::string> getGlobals () const = 0;
 
             virtual char getGlobalType (const std::string& name) const = 0;
@@ -110,6 +135,13 @@ namespace Interpreter
                 = 0;
 
             virtual std::string getTargetId() const = 0;
+
+        private:
+
+            static int unsupportedHandle()
+            {
+                throw std::logic_error ("global variable handles are not supported by this context");
+            }
     };
 }
 
@@ -1,29 +1,26 @@
 #ifndef INTERPRETER_INTERPRETER_H_INCLUDED
 #define INTERPRETER_INTERPRETER_H_INCLUDED
 
-#include <map>
 #include <stack>
 
+#include "opcodes.hpp"
+#include "opcodetable.hpp"
 #include "runtime.hpp"
 #include "types.hpp"
 
 namespace Interpreter
 {
-    class Opcode0;
-    class Opcode1;
-    class Opcode2;
-
     class Interpreter
     {
             std::stack<Runtime> mCallstack;
             bool mRunning;
             Runtime mRuntime;
-            std::map<int, Opcode1 *> mSegment0;
-            std::map<int, Opcode2 *> mSegment1;
-            std::map<int, Opcode1 *> mSegment2;
-            std::map<int, Opcode1 *> mSegment3;
-            std::map<int, Opcode2 *> mSegment4;
-            std::map<int, Opcode0 *> mSegment5;
+            OpcodeTable<Opcode1> mSegment0;
+            OpcodeTable<Opcode2> mSegment1;
+            OpcodeTable<Opcode1> mSegment2;
+            OpcodeTable<Opcode1> mSegment3;
+            OpcodeTable<Opcode2> mSegment4;
+            OpcodeTable<Opcode0> mSegment5;
 
             // not implemented
             Interpreter (const Interpreter&);
@@ -63,7 +60,8 @@ namespace Interpreter
             void installSegment5 (int code, Opcode0 *opcode);
             ///< ownership of \a opcode is transferred to *this.
 
-            void run (const Type_Code *code, int codeSize, Context& context);
+            void run (const Type_Code *code, int codeSize, Context& context, const Links *links = 0);
+            ///< \a links is optional, see Links.
     };
 }
 
@@ -0,0 +1,56 @@
+#include "links.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include "context.hpp"
+
+namespace Interpreter
+{
+    Links::Links() : mGlobalsRevision (0), mLinked (false) {}
+
+    void Links::link (const Type_Code *code, const Context& context)
+    {
+        mStringLiteralOffsets.clear();
+        mGlobalHandles.clear();
+        mJournalHandles.clear();
+
+        const char *literalBlock =
+            reinterpret_cast<const char *> (code + 4 + code[0] + code[1] + code[2]);
+        const int size = static_cast<int> (code[3]) * 4;
+
+        // The block is padded with 0s to a full word, which decodes as a few extra empty literals
+        for (int offset = 0; offset<size; offset += std::strlen (literalBlock+offset) + 1)
+        {
+            mStringLiteralOffsets.push_back (offset);
+            mGlobalHandles.push_back (context.getGlobalHandle (literalBlock+offset));
+            mJournalHandles.push_back (context.getJournalHandle (literalBlock+offset));
+        }
+
+        mGlobalsRevision = context.getGlobalsRevision();
+        mLinked = true;
+    }
+
+    bool Links::isLinked (const Context& context) const
+    {
+        return mLinked && mGlobalsRevision==context.getGlobalsRevision();
+    }
+
+    int Links::getStringLiteralOffset (int index) const
+    {
+        assert (index>=0 && index<static_cast<int> (mStringLiteralOffsets.size()));
+        return mStringLiteralOffsets[index];
+    }
+
+    int Links::getGlobalHandle (int index) const
+    {
+        assert (index>=0 && index<static_cast<int> (mGlobalHandles.size()));
+        return mGlobalHandles[index];
+    }
+
+    int Links::getJournalHandle (int index) const
+    {
+        assert (index>=0 && index<static_cast<int> (mJournalHandles.size()));
+        return mJournalHandles[index];
+    }
+}
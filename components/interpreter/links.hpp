@@ -0,0 +1,47 @@
+#ifndef INTERPRETER_LINKS_H_INCLUDED
+#define INTERPRETER_LINKS_H_INCLUDED
+
+#include <vector>
+
+#include "types.hpp"
+
+namespace Interpreter
+{
+    class Context;
+
+    /// \brief Data resolved from a compiled script ahead of running it
+    ///
+    /// Lets the opcodes access string literals, global variables and journal indices by index
+    /// instead of searching for them. The global variable handles depend on the loaded content and
+    /// must be resolved again once the context reports a new globals revision (see isLinked).
+    class Links
+    {
+            std::vector<int> mStringLiteralOffsets;
+            std::vector<int> mGlobalHandles;
+            std::vector<int> mJournalHandles;
+            int mGlobalsRevision;
+            bool mLinked;
+
+        public:
+
+            Links();
+
+            void link (const Type_Code *code, const Context& context);
+            ///< Decode the string literals of \a code and resolve the global variables and quests they name.
+
+            bool isLinked (const Context& context) const;
+            ///< Is the data still valid for running a script with \a context?
+
+            int getStringLiteralOffset (int index) const;
+            ///< Return offset of string literal \a index from the start of the string literal block.
+
+            int getGlobalHandle (int index) const;
+            ///< Return handle of the global variable named by string literal \a index (-1: not a
+            /// global variable).
+
+            int getJournalHandle (int index) const;
+            ///< Return handle of the quest named by string literal \a index (-1: not a quest).
+    };
+}
+
+#endif
@@ -122,9 +122,11 @@ namespace Interpreter
                 Type_Integer data = runtime[0].mInteger;
                 int index = runtime[1].mInteger;
 
-                std::string name = runtime.getStringLiteral (index);
-
-                runtime.getContext().setGlobalShort (name, data);
+                int handle = runtime.getGlobalHandle (index);
+                if (handle!=-1)
+                    runtime.getContext().setLinkedGlobalShort (handle, data);
+                else
+                    runtime.getContext().setGlobalShort (runtime.getStringLiteral (index), data);
 
                 runtime.pop();
                 runtime.pop();
@@ -140,9 +142,11 @@ namespace Interpreter
                 Type_Integer data = runtime[0].mInteger;
                 int index = runtime[1].mInteger;
 
-                std::string name = runtime.getStringLiteral (index);
-
-                runtime.getContext().setGlobalLong (name, data);
+                int handle = runtime.getGlobalHandle (index);
+                if (handle!=-1)
+                    runtime.getContext().setLinkedGlobalLong (handle, data);
+                else
+                    runtime.getContext().setGlobalLong (runtime.getStringLiteral (index), data);
 
                 runtime.pop();
                 runtime.pop();
@@ -158,9 +162,11 @@ namespace Interpreter
                 Type_Float data = runtime[0].mFloat;
                 int index = runtime[1].mInteger;
 
-                std::string name = runtime.getStringLiteral (index);
-
-                runtime.getContext().setGlobalFloat (name, data);
+                int handle = runtime.getGlobalHandle (index);
+                if (handle!=-1)
+                    runtime.getContext().setLinkedGlobalFloat (handle, data);
+                else
+                    runtime.getContext().setGlobalFloat (runtime.getStringLiteral (index), data);
 
                 runtime.pop();
                 runtime.pop();
@@ -174,8 +180,9 @@ namespace Interpreter
             virtual void execute (Runtime& runtime)
             {
                 int index = runtime[0].mInteger;
-                std::string name = runtime.getStringLiteral (index);
-                Type_Integer value = runtime.getContext().getGlobalShort (name);
+                int handle = runtime.getGlobalHandle (index);
+                Type_Integer value = handle!=-1 ? runtime.getContext().getLinkedGlobalShort (handle)
+                    : runtime.getContext().getGlobalShort (runtime.getStringLiteral (index));
                 runtime[0].mInteger = value;
             }
     };
@@ -187,8 +194,9 @@ namespace Interpreter
             virtual void execute (Runtime& runtime)
             {
                 int index = runtime[0].mInteger;
-                std::string name = runtime.getStringLiteral (index);
-                Type_Integer value = runtime.getContext().getGlobalLong (name);
+                int handle = runtime.getGlobalHandle (index);
+                Type_Integer value = handle!=-1 ? runtime.getContext().getLinkedGlobalLong (handle)
+                    : runtime.getContext().getGlobalLong (runtime.getStringLiteral (index));
                 runtime[0].mInteger = value;
             }
     };
@@ -200,8 +208,9 @@ namespace Interpreter
             virtual void execute (Runtime& runtime)
             {
                 int index = runtime[0].mInteger;
-                std::string name = runtime.getStringLiteral (index);
-                Type_Float value = runtime.getContext().getGlobalFloat (name);
+                int handle = runtime.getGlobalHandle (index);
+                Type_Float value = handle!=-1 ? runtime.getContext().getLinkedGlobalFloat (handle)
+                    : runtime.getContext().getGlobalFloat (runtime.getStringLiteral (index));
                 runtime[0].mFloat = value;
             }
     };
@@ -0,0 +1,97 @@
+#ifndef INTERPRETER_OPCODETABLE_H_INCLUDED
+#define INTERPRETER_OPCODETABLE_H_INCLUDED
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace Interpreter
+{
+    /// \brief Opcodes of one code segment, for dispatch without a search.
+    ///
+    /// Opcodes are numbered in a few contiguous ranges that can be far apart (e.g. the generic
+    /// opcodes start at 0, the game specific ones at 0x2000000). Each range is stored in an array
+    /// indexed by the opcode minus the start of the range, so a lookup is one range check per range.
+    template<typename T>
+    class OpcodeTable
+    {
+        public:
+
+            OpcodeTable() {}
+
+            ~OpcodeTable()
+            {
+                for (typename std::vector<Range>::iterator iter (mRanges.begin()); iter!=mRanges.end(); ++iter)
+                    for (typename std::vector<T *>::iterator opcode (iter->mOpcodes.begin()); opcode!=iter->mOpcodes.end(); ++opcode)
+                        delete *opcode;
+            }
+
+            void install (int code, T *opcode)
+            ///< ownership of \a opcode is transferred to *this.
+            {
+                assert (!find (code));
+
+                Range *range = 0;
+                for (typename std::vector<Range>::iterator iter (mRanges.begin()); iter!=mRanges.end(); ++iter)
+                {
+                    if (code>=iter->mFirst-sMaxGap && code<iter->mFirst+static_cast<int> (iter->mOpcodes.size())+sMaxGap)
+                    {
+                        range = &*iter;
+                        break;
+                    }
+                }
+
+                if (!range)
+                {
+                    mRanges.push_back (Range());
+                    range = &mRanges.back();
+                    range->mFirst = code;
+                }
+
+                if (code<range->mFirst)
+                {
+                    range->mOpcodes.insert (range->mOpcodes.begin(), range->mFirst-code, static_cast<T *> (0));
+                    range->mFirst = code;
+                }
+
+                std::size_t index = code - range->mFirst;
+                if (index>=range->mOpcodes.size())
+                    range->mOpcodes.resize (index+1, static_cast<T *> (0));
+
+                range->mOpcodes[index] = opcode;
+            }
+
+            T *find (int code) const
+            ///< \return 0, if no opcode is installed for \a code.
+            {
+                for (typename std::vector<Range>::const_iterator iter (mRanges.begin()); iter!=mRanges.end(); ++iter)
+                {
+                    // Ranges may overlap after growing towards each other, so keep looking on an empty slot
+                    std::size_t index = static_cast<std::size_t> (code - iter->mFirst);
+                    if (index<iter->mOpcodes.size() && iter->mOpcodes[index])
+                        return iter->mOpcodes[index];
+                }
+
+                return 0;
+            }
+
+        private:
+
+            // not implemented
+            OpcodeTable (const OpcodeTable&);
+            OpcodeTable& operator= (const OpcodeTable&);
+
+            /// Largest number of unused slots between two opcodes of the same range
+            static const int sMaxGap = 256;
+
+            struct Range
+            {
+                int mFirst;
+                std::vector<T *> mOpcodes;
+            };
+
+            std::vector<Range> mRanges;
+    };
+}
+
+#endif
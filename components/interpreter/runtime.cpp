@@ -4,9 +4,11 @@
 #include <cassert>
 #include <cstring>
 
+#include "links.hpp"
+
 namespace Interpreter
 {
-    Runtime::Runtime() : mContext (0), mCode (0), mCodeSize(0), mPC (0) {}
+    Runtime::Runtime() : mContext (0), mCode (0), mCodeSize(0), mPC (0), mLinks (0) {}
 
     int Runtime::getPC() const
     {
@@ -38,6 +40,9 @@ namespace Interpreter
         const char *literalBlock =
             reinterpret_cast<const char *> (mCode + 4 + mCode[0] + mCode[1] + mCode[2]);
 
+        if (mLinks)
+            return literalBlock + mLinks->getStringLiteralOffset (index);
+
         int offset = 0;
 
         for (; index; --index)
@@ -49,7 +54,17 @@ namespace Interpreter
         return literalBlock+offset;
     }
 
-    void Runtime::configure (const Type_Code *code, int codeSize, Context& context)
+    int Runtime::getGlobalHandle (int index) const
+    {
+        return mLinks ? mLinks->getGlobalHandle (index) : -1;
+    }
+
+    int Runtime::getJournalHandle (int index) const
+    {
+        return mLinks ? mLinks->getJournalHandle (index) : -1;
+    }
+
+    void Runtime::configure (const Type_Code *code, int codeSize, Context& context, const Links *links)
     {
         clear();
 
@@ -57,6 +72,7 @@ namespace Interpreter
         mCode = code;
         mCodeSize = codeSize;
         mPC = 0;
+        mLinks = links;
     }
 
     void Runtime::clear()
@@ -64,6 +80,7 @@ namespace Interpreter
         mContext = 0;
         mCode = 0;
         mCodeSize = 0;
+        mLinks = 0;
         mStack.clear();
     }
 
@@ -9,6 +9,7 @@
 namespace Interpreter
 {
     class Context;
+    class Links;
 
     /// Runtime data and engine interface
 
@@ -18,6 +19,7 @@ namespace Interpreter
             const Type_Code *mCode;
             int mCodeSize;
             int mPC;
+            const Links *mLinks;
             std::vector<Data> mStack;
 
         public:
@@ -33,9 +35,18 @@ namespace Interpreter
 
             std::string getStringLiteral (int index) const;
 
-            void configure (const Type_Code *code, int codeSize, Context& context);
-            ///< \a context and \a code must exist as least until either configure, clear or
-            /// the destructor is called. \a codeSize is given in 32-bit words.
+            int getGlobalHandle (int index) const;
+            ///< Return handle of the global variable named by string literal \a index (-1: not
+            /// linked, look the variable up by name).
+
+            int getJournalHandle (int index) const;
+            ///< Return handle of the quest named by string literal \a index (-1: not linked, look
+            /// the quest up by name).
+
+            void configure (const Type_Code *code, int codeSize, Context& context, const Links *links = 0);
+            ///< \a context, \a code and \a links must exist as least until either configure, clear or
+            /// the destructor is called. \a codeSize is given in 32-bit words. \a links is optional and
+            /// must have been linked for \a code and \a context.
 
             void clear();
 
@@ -31,7 +31,41 @@ typedef KeyT<osg::Vec3f> Vector3Key;
 typedef KeyT<osg::Vec4f> Vector4Key;
 typedef KeyT<osg::Quat> QuaternionKey;
 
-template<typename T, T (NIFStream::*getValue)()>
+/// The number of floats a key value is stored in, and how to get the value from them
+template<typename T>
+struct KeyValueTraits;
+
+template<>
+struct KeyValueTraits<float> {
+    static const size_t sNumFloats = 1;
+    static const size_t sNumQuadraticValues = 3;
+    static float get(const float* data) { return data[0]; }
+};
+
+template<>
+struct KeyValueTraits<osg::Vec3f> {
+    static const size_t sNumFloats = 3;
+    static const size_t sNumQuadraticValues = 3;
+    static osg::Vec3f get(const float* data) { return osg::Vec3f(data[0], data[1], data[2]); }
+};
+
+template<>
+struct KeyValueTraits<osg::Vec4f> {
+    static const size_t sNumFloats = 4;
+    static const size_t sNumQuadraticValues = 3;
+    static osg::Vec4f get(const float* data) { return osg::Vec4f(data[0], data[1], data[2], data[3]); }
+};
+
+template<>
+struct KeyValueTraits<osg::Quat> {
+    static const size_t sNumFloats = 4;
+    // Quaternion keys have no forward and backward values
+    static const size_t sNumQuadraticValues = 1;
+    // stored as w, x, y, z
+    static osg::Quat get(const float* data) { return osg::Quat(data[1], data[2], data[3], data[0]); }
+};
+
+template<typename T>
 struct KeyMapT {
     typedef std::map< float, KeyT<T> > MapType;
 
@@ -63,36 +97,14 @@ struct KeyMapT {
 
         mInterpolationType = nif->getUInt();
 
-        KeyT<T> key;
-        NIFStream &nifReference = *nif;
-
         if(mInterpolationType == sLinearInterpolation)
-        {
-            for(size_t i = 0;i < count;i++)
-            {
-                float time = nif->getFloat();
-                readValue(nifReference, key);
-                mKeys[time] = key;
-            }
-        }
+            readKeys(nif, count, 0);
+        // Skips mForwardValue and mBackwardValue
         else if(mInterpolationType == sQuadraticInterpolation)
-        {
-            for(size_t i = 0;i < count;i++)
-            {
-                float time = nif->getFloat();
-                readQuadratic(nifReference, key);
-                mKeys[time] = key;
-            }
-        }
+            readKeys(nif, count, (Traits::sNumQuadraticValues-1) * Traits::sNumFloats);
+        // Skips mTension, mBias and mContinuity
         else if(mInterpolationType == sTBCInterpolation)
-        {
-            for(size_t i = 0;i < count;i++)
-            {
-                float time = nif->getFloat();
-                readTBC(nifReference, key);
-                mKeys[time] = key;
-            }
-        }
+            readKeys(nif, count, 3);
         //XYZ keys aren't actually read here.
         //data.hpp sees that the last type read was sXYZInterpolation and:
         //    Eats a floating point number, then
@@ -123,36 +135,29 @@ struct KeyMapT {
     }
 
 private:
-    static void readValue(NIFStream &nif, KeyT<T> &key)
-    {
-        key.mValue = (nif.*getValue)();
-    }
+    typedef KeyValueTraits<T> Traits;
 
-    template <typename U>
-    static void readQuadratic(NIFStream &nif, KeyT<U> &key)
+    /// Read all keys in one block. Each key is stored as its time, its value and the given number of floats we don't use yet.
+    void readKeys(NIFStream *nif, size_t count, size_t numUnusedFloats)
     {
-        readValue(nif, key);
-        /*key.mForwardValue = */(nif.*getValue)();
-        /*key.mBackwardValue = */(nif.*getValue)();
-    }
+        const size_t keySize = 1 + Traits::sNumFloats + numUnusedFloats;
 
-    static void readQuadratic(NIFStream &nif, KeyT<osg::Quat> &key)
-    {
-        readValue(nif, key);
-    }
+        std::vector<float> data;
+        nif->getFloats(data, count * keySize);
 
-    static void readTBC(NIFStream &nif, KeyT<T> &key)
-    {
-        readValue(nif, key);
-        /*key.mTension = */nif.getFloat();
-        /*key.mBias = */nif.getFloat();
-        /*key.mContinuity = */nif.getFloat();
+        KeyT<T> key;
+        for(size_t i = 0;i < count;i++)
+        {
+            const float* keyData = &data[i * keySize];
+            key.mValue = Traits::get(keyData + 1);
+            mKeys[keyData[0]] = key;
+        }
     }
 };
-typedef KeyMapT<float,&NIFStream::getFloat> FloatKeyMap;
-typedef KeyMapT<osg::Vec3f,&NIFStream::getVector3> Vector3KeyMap;
-typedef KeyMapT<osg::Vec4f,&NIFStream::getVector4> Vector4KeyMap;
-typedef KeyMapT<osg::Quat,&NIFStream::getQuaternion> QuaternionKeyMap;
+typedef KeyMapT<float> FloatKeyMap;
+typedef KeyMapT<osg::Vec3f> Vector3KeyMap;
+typedef KeyMapT<osg::Vec4f> Vector4KeyMap;
+typedef KeyMapT<osg::Quat> QuaternionKeyMap;
 
 typedef std::shared_ptr<FloatKeyMap> FloatKeyMapPtr;
 typedef std::shared_ptr<Vector3KeyMap> Vector3KeyMapPtr;
@@ -1,7 +1,27 @@
 #include "nifstream.hpp"
+
+#include <algorithm>
+
 //For error reporting
 #include "niffile.hpp"
 
+namespace
+{
+    bool isLittleEndianHost()
+    {
+        const uint16_t value = 1;
+        return *reinterpret_cast<const uint8_t*>(&value) == 1;
+    }
+
+    const bool sLittleEndianHost = isLittleEndianHost();
+
+    // The arrays are read as a block of floats, so the vector types must not have any padding
+    static_assert(sizeof(osg::Vec2f) == 2*sizeof(float), "osg::Vec2f is not packed");
+    static_assert(sizeof(osg::Vec3f) == 3*sizeof(float), "osg::Vec3f is not packed");
+    static_assert(sizeof(osg::Vec4f) == 4*sizeof(float), "osg::Vec4f is not packed");
+    static_assert(sizeof(float) == 4 && sizeof(unsigned short) == 2, "Unexpected size of float or unsigned short");
+}
+
 namespace Nif
 {
 
@@ -14,65 +34,66 @@ uint8_t NIFStream::read_byte()
 }
 uint16_t NIFStream::read_le16()
 {
-    uint8_t buffer[2];
-    inp->read((char*)buffer, 2);
-    return buffer[0] | (buffer[1]<<8);
+    uint16_t value;
+    readLittleEndianBuffer(&value, 1, sizeof(value));
+    return value;
 }
 uint32_t NIFStream::read_le32()
 {
-    uint8_t buffer[4];
-    inp->read((char*)buffer, 4);
-    return buffer[0] | (buffer[1]<<8) | (buffer[2]<<16) | (buffer[3]<<24);
+    uint32_t value;
+    readLittleEndianBuffer(&value, 1, sizeof(value));
+    return value;
 }
 float NIFStream::read_le32f()
 {
-    union {
-        uint32_t i;
-        float f;
-    } u = { read_le32() };
-    return u.f;
+    float value;
+    readLittleEndianBuffer(&value, 1, sizeof(value));
+    return value;
+}
+
+void NIFStream::readLittleEndianBuffer(void* dest, size_t numValues, size_t valueSize)
+{
+    char* bytes = static_cast<char*>(dest);
+    inp->read(bytes, numValues * valueSize);
+
+    if (sLittleEndianHost)
+        return;
+
+    for (size_t i = 0; i < numValues; ++i)
+        std::reverse(bytes + i * valueSize, bytes + (i+1) * valueSize);
 }
 
 //Public functions
 osg::Vec2f NIFStream::getVector2()
 {
     osg::Vec2f vec;
-    for(size_t i = 0;i < 2;i++)
-        vec._v[i] = getFloat();
+    readLittleEndianBuffer(vec._v, 2, sizeof(float));
     return vec;
 }
 osg::Vec3f NIFStream::getVector3()
 {
     osg::Vec3f vec;
-    for(size_t i = 0;i < 3;i++)
-        vec._v[i] = getFloat();
+    readLittleEndianBuffer(vec._v, 3, sizeof(float));
     return vec;
 }
 osg::Vec4f NIFStream::getVector4()
 {
     osg::Vec4f vec;
-    for(size_t i = 0;i < 4;i++)
-        vec._v[i] = getFloat();
+    readLittleEndianBuffer(vec._v, 4, sizeof(float));
     return vec;
 }
 Matrix3 NIFStream::getMatrix3()
 {
     Matrix3 mat;
-    for(size_t i = 0;i < 3;i++)
-    {
-        for(size_t j = 0;j < 3;j++)
-            mat.mValues[i][j] = getFloat();
-    }
+    readLittleEndianBuffer(mat.mValues, 9, sizeof(float));
     return mat;
 }
 osg::Quat NIFStream::getQuaternion()
 {
-    osg::Quat quat;
-    quat.w() = getFloat();
-    quat.x() = getFloat();
-    quat.y() = getFloat();
-    quat.z() = getFloat();
-    return quat;
+    float values[4];
+    readLittleEndianBuffer(values, 4, sizeof(float));
+    // stored as w, x, y, z
+    return osg::Quat(values[1], values[2], values[3], values[0]);
 }
 Transformation NIFStream::getTrafo()
 {
@@ -103,41 +124,46 @@ std::string NIFStream::getVersionString()
     return result;
 }
 
+// The arrays are read in one block rather than value by value, they make up most of a NIF file
 void NIFStream::getUShorts(std::vector<unsigned short> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getUShort();
+    if (size)
+        readLittleEndianBuffer(&vec[0], size, sizeof(unsigned short));
 }
 void NIFStream::getFloats(std::vector<float> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getFloat();
+    if (size)
+        readLittleEndianBuffer(&vec[0], size, sizeof(float));
 }
 void NIFStream::getVector2s(std::vector<osg::Vec2f> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getVector2();
+    if (size)
+        readLittleEndianBuffer(vec[0]._v, size*2, sizeof(float));
 }
 void NIFStream::getVector3s(std::vector<osg::Vec3f> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getVector3();
+    if (size)
+        readLittleEndianBuffer(vec[0]._v, size*3, sizeof(float));
 }
 void NIFStream::getVector4s(std::vector<osg::Vec4f> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getVector4();
+    if (size)
+        readLittleEndianBuffer(vec[0]._v, size*4, sizeof(float));
 }
 void NIFStream::getQuaternions(std::vector<osg::Quat> &quat, size_t size)
 {
+    // osg::Quat stores doubles, so read the floats into a buffer first
+    std::vector<float> values;
+    getFloats(values, size*4);
+
     quat.resize(size);
-    for(size_t i = 0;i < quat.size();i++)
-        quat[i] = getQuaternion();
+    for(size_t i = 0;i < size;i++)
+        quat[i] = osg::Quat(values[i*4+1], values[i*4+2], values[i*4+3], values[i*4]);
 }
 
 }
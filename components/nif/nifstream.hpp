@@ -31,6 +31,9 @@ class NIFStream {
     uint32_t read_le32();
     float read_le32f();
 
+    /// Read an array of little-endian numbers of 2 or 4 bytes in one block, and convert them to the byte order of the host
+    void readLittleEndianBuffer(void* dest, size_t numValues, size_t valueSize);
+
 public:
 
     NIFFile * const file;
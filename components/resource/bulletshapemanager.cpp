@@ -192,7 +192,7 @@ void BulletShapeManager::updateCache(double referenceTime)
 
 void BulletShapeManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
 {
-    stats->setAttribute(frameNumber, "Shape", mCache->getCacheSize());
+    reportCacheStats(frameNumber, stats, "Shape");
     stats->setAttribute(frameNumber, "Shape Instance", mInstanceCache->getCacheSize());
 }
 
@@ -131,7 +131,7 @@ namespace Resource
                 return mWarningImage;
             }
 
-            mCache->addEntryToObjectCache(normalized, image);
+            mCache->addEntryToObjectCache(normalized, image, 0.0, image->getTotalSizeInBytesIncludingMipmaps());
             return image;
         }
     }
@@ -143,7 +143,7 @@ namespace Resource
 
     void ImageManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
     {
-        stats->setAttribute(frameNumber, "Image", mCache->getCacheSize());
+        reportCacheStats(frameNumber, stats, "Image");
     }
 
 }
@@ -36,7 +36,7 @@ namespace Resource
 
     void KeyframeManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
     {
-        stats->setAttribute(frameNumber, "Keyframe", mCache->getCacheSize());
+        reportCacheStats(frameNumber, stats, "Keyframe");
     }
 
 
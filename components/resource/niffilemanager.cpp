@@ -58,7 +58,7 @@ namespace Resource
 
     void NifFileManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
     {
-        stats->setAttribute(frameNumber, "Nif", mCache->getCacheSize());
+        reportCacheStats(frameNumber, stats, "Nif");
     }
 
 }
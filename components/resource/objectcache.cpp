@@ -16,6 +16,9 @@
 #include <osg/Object>
 #include <osg/Node>
 
+#include <algorithm>
+#include <vector>
+
 namespace Resource
 {
 
@@ -24,7 +27,8 @@ namespace Resource
 // ObjectCache
 //
 ObjectCache::ObjectCache():
-    osg::Referenced(true)
+    osg::Referenced(true),
+    _memoryBudget(0)
 {
 }
 
@@ -32,30 +36,58 @@ ObjectCache::~ObjectCache()
 {
 }
 
-void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp)
+ObjectCache::Stats::Stats():
+    _hits(0),
+    _misses(0),
+    _evictions(0),
+    _size(0)
+{
+}
+
+ObjectCache::Shard& ObjectCache::getShard(const std::string& fileName)
+{
+    return _shards[std::hash<std::string>()(fileName) % NumShards];
+}
+
+void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, size_t size)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[filename]=ObjectTimeStampPair(object,timestamp);
+    Shard& shard = getShard(filename);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    ObjectCacheEntry& entry = shard._objectCache[filename];
+    shard._size += size - entry._size;
+    entry._object = object;
+    entry._timeStamp = timestamp;
+    entry._size = size;
+    entry._lastUsed = ++_useCounter;
 }
 
 osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+    if (itr!=shard._objectCache.end())
     {
-        return itr->second.first;
+        ++shard._hits;
+        itr->second._lastUsed = ++_useCounter;
+        return itr->second._object;
+    }
+    else
+    {
+        ++shard._misses;
+        return 0;
     }
-    else return 0;
 }
 
 bool ObjectCache::checkInObjectCache(const std::string &fileName, double timeStamp)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+    if (itr!=shard._objectCache.end())
     {
-        itr->second.second = timeStamp;
+        itr->second._timeStamp = timeStamp;
+        itr->second._lastUsed = ++_useCounter;
         return true;
     }
     else return false;
@@ -63,97 +95,204 @@ bool ObjectCache::checkInObjectCache(const std::string &fileName, double timeSta
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(ObjectCacheMap::iterator itr=shard._objectCache.begin();
+            itr!=shard._objectCache.end();
+            ++itr)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            // if ref count is greater the 1 the object has an external reference.
+            if (itr->second._object.valid() && itr->second._object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                itr->second._timeStamp = referenceTime;
+            }
         }
     }
 }
 
+namespace
+{
+    struct EvictionCandidate
+    {
+        unsigned int mLastUsed;
+        unsigned int mShard;
+        std::string mName;
+
+        bool operator<(const EvictionCandidate& other) const
+        {
+            return mLastUsed < other.mLastUsed;
+        }
+    };
+}
+
 void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
     std::vector<osg::ref_ptr<osg::Object> > objectsToRemove;
 
+    size_t totalSize = 0;
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
 
         // Remove expired entries from object cache
-        ObjectCacheMap::iterator oitr = _objectCache.begin();
-        while(oitr != _objectCache.end())
+        ObjectCacheMap::iterator oitr = shard._objectCache.begin();
+        while(oitr != shard._objectCache.end())
         {
-            if (oitr->second.second<=expiryTime)
+            if (oitr->second._timeStamp<=expiryTime)
             {
-                objectsToRemove.push_back(oitr->second.first);
-                _objectCache.erase(oitr++);
+                objectsToRemove.push_back(oitr->second._object);
+                shard._size -= oitr->second._size;
+                oitr = shard._objectCache.erase(oitr);
             }
             else
             {
                 ++oitr;
             }
         }
+        totalSize += shard._size;
+    }
+
+    if (_memoryBudget > 0 && totalSize > _memoryBudget)
+    {
+        // Collect the objects that only the cache refers to, removing an object that is still in use would not free any memory.
+        std::vector<EvictionCandidate> candidates;
+        for (unsigned int i=0; i<NumShards; ++i)
+        {
+            Shard& shard = _shards[i];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+            for (ObjectCacheMap::iterator itr = shard._objectCache.begin(); itr != shard._objectCache.end(); ++itr)
+            {
+                if (itr->second._size > 0 && itr->second._object.valid() && itr->second._object->referenceCount() == 1)
+                {
+                    EvictionCandidate candidate;
+                    candidate.mLastUsed = itr->second._lastUsed;
+                    candidate.mShard = i;
+                    candidate.mName = itr->first;
+                    candidates.push_back(candidate);
+                }
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+
+        for (std::vector<EvictionCandidate>::const_iterator it = candidates.begin(); it != candidates.end() && totalSize > _memoryBudget; ++it)
+        {
+            Shard& shard = _shards[it->mShard];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+            ObjectCacheMap::iterator itr = shard._objectCache.find(it->mName);
+            // the object may have been looked up again in the meantime
+            if (itr == shard._objectCache.end() || itr->second._lastUsed != it->mLastUsed
+                    || !itr->second._object.valid() || itr->second._object->referenceCount() != 1)
+                continue;
+
+            objectsToRemove.push_back(itr->second._object);
+            shard._size -= itr->second._size;
+            totalSize -= itr->second._size;
+            shard._objectCache.erase(itr);
+            ++_evictions;
+        }
     }
 
     // note, actual unref happens outside of the lock
     objectsToRemove.clear();
 }
 
+void ObjectCache::setMemoryBudget(size_t bytes)
+{
+    _memoryBudget = bytes;
+}
+
 void ObjectCache::removeFromObjectCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+    if (itr!=shard._objectCache.end())
+    {
+        shard._size -= itr->second._size;
+        shard._objectCache.erase(itr);
+    }
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        shard._objectCache.clear();
+        shard._size = 0;
+    }
 }
 
 void ObjectCache::releaseGLObjects(osg::State* state)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        osg::Object* object = itr->second.first.get();
-        object->releaseGLObjects(state);
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+            itr != shard._objectCache.end();
+            ++itr)
+        {
+            osg::Object* object = itr->second._object.get();
+            object->releaseGLObjects(state);
+        }
     }
 }
 
 void ObjectCache::accept(osg::NodeVisitor &nv)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        osg::Object* object = itr->second.first.get();
-        if (object)
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+            itr != shard._objectCache.end();
+            ++itr)
         {
-            osg::Node* node = dynamic_cast<osg::Node*>(object);
-            if (node)
-                node->accept(nv);
+            osg::Object* object = itr->second._object.get();
+            if (object)
+            {
+                osg::Node* node = dynamic_cast<osg::Node*>(object);
+                if (node)
+                    node->accept(nv);
+            }
         }
     }
 }
 
 unsigned int ObjectCache::getCacheSize() const
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    return _objectCache.size();
+    unsigned int size = 0;
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        size += _shards[i]._objectCache.size();
+    }
+    return size;
+}
+
+ObjectCache::Stats ObjectCache::getStats() const
+{
+    Stats stats;
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        stats._hits += _shards[i]._hits;
+        stats._misses += _shards[i]._misses;
+        stats._size += _shards[i]._size;
+    }
+    stats._evictions = _evictions;
+    return stats;
 }
 
 }
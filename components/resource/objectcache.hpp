@@ -1,5 +1,6 @@
 // Resource ObjectCache for OpenMW, forked from osgDB ObjectCache by Robert Osfield, see copyright notice below.
 // The main change from the upstream version is that removeExpiredObjectsInCache no longer keeps a lock while the unref happens.
+// The cache is also split into shards that are locked separately, and can be limited to a memory budget.
 
 /* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
  *
@@ -20,8 +21,12 @@
 #include <osg/Referenced>
 #include <osg/ref_ptr>
 
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
 #include <string>
-#include <map>
+#include <unordered_map>
 
 namespace osg
 {
@@ -49,14 +54,21 @@ class ObjectCache : public osg::Referenced
         /** Removed object in the cache which have a time stamp at or before the specified expiry time.
           * This would typically be called once per frame by applications which are doing database paging,
           * and need to prune objects that are no longer required, and called after the a called
-          * after the call to updateTimeStampOfObjectsInCacheWithExternalReferences(expirtyTime).*/
+          * after the call to updateTimeStampOfObjectsInCacheWithExternalReferences(expirtyTime).
+          * If the cache is over its memory budget afterwards, the least recently used objects without
+          * external references are removed as well, until the cache fits into the budget again.*/
         void removeExpiredObjectsInCache(double expiryTime);
 
+        /** Set the number of bytes the objects in the cache may take up, 0 (the default) for no limit.
+          * Only objects that were added with a size count towards the budget.*/
+        void setMemoryBudget(size_t bytes);
+
         /** Remove all objects in the cache regardless of having external references or expiry times.*/
         void clear();
 
-        /** Add a filename,object,timestamp triple to the Registry::ObjectCache.*/
-        void addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp = 0.0);
+        /** Add a filename,object,timestamp triple to the Registry::ObjectCache.
+          * The size is the memory used by the object in bytes, if known.*/
+        void addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp = 0.0, size_t size = 0);
 
         /** Remove Object from cache.*/
         void removeFromObjectCache(const std::string& fileName);
@@ -77,23 +89,70 @@ class ObjectCache : public osg::Referenced
         template <class Functor>
         void call(Functor& f)
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-            for (ObjectCacheMap::iterator it = _objectCache.begin(); it != _objectCache.end(); ++it)
-                f(it->second.first.get());
+            for (unsigned int i=0; i<NumShards; ++i)
+            {
+                Shard& shard = _shards[i];
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+                for (ObjectCacheMap::iterator it = shard._objectCache.begin(); it != shard._objectCache.end(); ++it)
+                    f(it->second._object.get());
+            }
         }
 
         /** Get the number of objects in the cache. */
         unsigned int getCacheSize() const;
 
+        struct Stats
+        {
+            Stats();
+
+            /** Number of lookups through getRefFromObjectCache that found an object, and that did not.*/
+            unsigned int _hits;
+            unsigned int _misses;
+            /** Number of objects removed to stay within the memory budget.*/
+            unsigned int _evictions;
+            /** Memory used by the objects in the cache in bytes, as far as their size is known.*/
+            size_t _size;
+        };
+
+        /** Get the statistics collected since the cache was created.*/
+        Stats getStats() const;
+
     protected:
 
         virtual ~ObjectCache();
 
-        typedef std::pair<osg::ref_ptr<osg::Object>, double >           ObjectTimeStampPair;
-        typedef std::map<std::string, ObjectTimeStampPair >             ObjectCacheMap;
+        struct ObjectCacheEntry
+        {
+            ObjectCacheEntry() : _timeStamp(0.0), _size(0), _lastUsed(0) {}
+
+            osg::ref_ptr<osg::Object>   _object;
+            double                      _timeStamp;
+            size_t                      _size;
+            /** Value of the cache's use counter at the last lookup, for the least recently used order.*/
+            unsigned int                _lastUsed;
+        };
+
+        typedef std::unordered_map<std::string, ObjectCacheEntry >      ObjectCacheMap;
+
+        struct Shard
+        {
+            Shard() : _hits(0), _misses(0), _size(0) {}
+
+            ObjectCacheMap                      _objectCache;
+            mutable OpenThreads::Mutex          _mutex;
+            unsigned int                        _hits;
+            unsigned int                        _misses;
+            size_t                              _size;
+        };
+
+        enum { NumShards = 16 };
+
+        Shard& getShard(const std::string& fileName);
 
-        ObjectCacheMap                          _objectCache;
-        mutable OpenThreads::Mutex              _objectCacheMutex;
+        Shard                                   _shards[NumShards];
+        OpenThreads::Atomic                     _useCounter;
+        OpenThreads::Atomic                     _evictions;
+        size_t                                  _memoryBudget;
 
 };
 
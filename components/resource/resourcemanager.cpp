@@ -1,5 +1,7 @@
 #include "resourcemanager.hpp"
 
+#include <osg/Stats>
+
 #include "objectcache.hpp"
 
 namespace Resource
@@ -28,9 +30,23 @@ namespace Resource
         mExpiryDelay = expiryDelay;
     }
 
+    void ResourceManager::setMemoryBudget(size_t bytes)
+    {
+        mCache->setMemoryBudget(bytes);
+    }
+
     const VFS::Manager* ResourceManager::getVFS() const
     {
         return mVFS;
     }
 
+    void ResourceManager::reportCacheStats(unsigned int frameNumber, osg::Stats *stats, const std::string &name) const
+    {
+        ObjectCache::Stats cacheStats = mCache->getStats();
+        stats->setAttribute(frameNumber, name, mCache->getCacheSize());
+        stats->setAttribute(frameNumber, name + " Hit", cacheStats._hits);
+        stats->setAttribute(frameNumber, name + " Miss", cacheStats._misses);
+        stats->setAttribute(frameNumber, name + " Evicted", cacheStats._evictions);
+    }
+
 }
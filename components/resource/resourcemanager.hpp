@@ -3,6 +3,9 @@
 
 #include <osg/ref_ptr>
 
+#include <cstddef>
+#include <string>
+
 namespace VFS
 {
     class Manager;
@@ -31,11 +34,19 @@ namespace Resource
         /// How long to keep objects in cache after no longer being referenced.
         void setExpiryDelay (double expiryDelay);
 
+        /// How many bytes the cached objects may take up, 0 for no limit. Only applies to objects of a known size.
+        /// @note Objects that are still referenced are kept regardless.
+        void setMemoryBudget (size_t bytes);
+
         const VFS::Manager* getVFS() const;
 
         virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const {}
 
     protected:
+        /// Report the number of cached objects under the given name, and the cache's hit, miss and eviction counts
+        /// as "<name> Hit", "<name> Miss" and "<name> Evicted".
+        void reportCacheStats(unsigned int frameNumber, osg::Stats* stats, const std::string& name) const;
+
         const VFS::Manager* mVFS;
         osg::ref_ptr<Resource::ObjectCache> mCache;
         double mExpiryDelay;
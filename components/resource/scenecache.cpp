@@ -0,0 +1,314 @@
+#include "scenecache.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <osg/Node>
+#include <osg/Drawable>
+#include <osg/Texture>
+#include <osg/UserDataContainer>
+
+#include <osgDB/Registry>
+
+#include <components/misc/resourcehelpers.hpp>
+#include <components/nifosg/userdata.hpp>
+#include <components/sceneutil/serialize.hpp>
+
+#include "imagemanager.hpp"
+
+namespace
+{
+    const char sMagic[8] = { 'O', 'M', 'W', 'S', 'C', 'E', 'N', 'E' };
+
+    /// @brief Callback to read the textures of an entry from the VFS.
+    /// @note The file names were corrected when the mesh was converted, for the textures that existed then.
+    class ImageReadCallback : public osgDB::ReadFileCallback
+    {
+    public:
+        ImageReadCallback(Resource::ImageManager* imageMgr)
+            : mImageManager(imageMgr)
+        {
+        }
+
+        virtual osgDB::ReaderWriter::ReadResult readImage(const std::string& filename, const osgDB::Options* options)
+        {
+            try
+            {
+                std::string corrected = Misc::ResourceHelpers::correctTexturePath(filename, mImageManager->getVFS());
+                return osgDB::ReaderWriter::ReadResult(mImageManager->getImage(corrected), osgDB::ReaderWriter::ReadResult::FILE_LOADED);
+            }
+            catch (std::exception& e)
+            {
+                return osgDB::ReaderWriter::ReadResult(e.what());
+            }
+        }
+
+    private:
+        Resource::ImageManager* mImageManager;
+    };
+
+    // Increase when the NIF loader or the optimizer change the scenes they create
+    const uint32_t sCacheVersion = 1;
+
+    // FNV-1a, the hash must not change between runs
+    const uint64_t sHashBasis = 14695981039346656037ULL;
+
+    uint64_t hashBytes(uint64_t hash, const char* data, size_t size)
+    {
+        for (size_t i=0; i<size; ++i)
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+        return hash;
+    }
+
+    template <class T>
+    void writeValue(std::ostream& stream, T value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    bool readValue(std::istream& stream, T& value)
+    {
+        return !!stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    bool isOsgClass(const osg::Object& object)
+    {
+        return std::strcmp(object.libraryName(), "osg") == 0;
+    }
+
+    /// Looks for anything in the scene that the osg serializers can not store, or that would be lost when reading it back.
+    class CanCacheVisitor : public osg::NodeVisitor
+    {
+    public:
+        CanCacheVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mCanCache(true)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            // e.g. Skeleton, LightSource or a particle system updater
+            if (!isOsgClass(node) || !checkNode(node))
+            {
+                mCanCache = false;
+                return;
+            }
+
+            traverse(node);
+        }
+
+        virtual void apply(osg::Drawable& drawable)
+        {
+            // e.g. RigGeometry, MorphGeometry or ParticleSystem
+            if (!isOsgClass(drawable) || std::strcmp(drawable.className(), "Geometry") != 0 || !checkNode(drawable)
+                    || drawable.getComputeBoundingBoxCallback() || drawable.getDrawCallback())
+                mCanCache = false;
+        }
+
+        bool checkNode(osg::Node& node)
+        {
+            // Controllers and other callbacks are not serialized
+            if (node.getUpdateCallback() || node.getCullCallback() || node.getEventCallback())
+                return false;
+
+            if (const osg::UserDataContainer* userData = node.getUserDataContainer())
+            {
+                if (userData->getUserData())
+                    return false;
+                for (unsigned int i=0; i<userData->getNumUserObjects(); ++i)
+                {
+                    if (!dynamic_cast<const NifOsg::NodeUserData*>(userData->getUserObject(i)))
+                        return false;
+                }
+            }
+
+            return checkStateSet(node.getStateSet());
+        }
+
+        bool checkStateSet(const osg::StateSet* stateset)
+        {
+            if (!stateset)
+                return true;
+
+            if (stateset->getUpdateCallback() || stateset->getEventCallback())
+                return false;
+
+            const osg::StateSet::AttributeList& attributes = stateset->getAttributeList();
+            for (osg::StateSet::AttributeList::const_iterator it = attributes.begin(); it != attributes.end(); ++it)
+            {
+                if (!checkAttribute(*it->second.first))
+                    return false;
+            }
+
+            const osg::StateSet::TextureAttributeList& texAttributes = stateset->getTextureAttributeList();
+            for (unsigned int unit=0; unit<texAttributes.size(); ++unit)
+            {
+                for (osg::StateSet::AttributeList::const_iterator it = texAttributes[unit].begin(); it != texAttributes[unit].end(); ++it)
+                {
+                    if (!checkAttribute(*it->second.first))
+                        return false;
+                }
+            }
+
+            const osg::StateSet::UniformList& uniforms = stateset->getUniformList();
+            for (osg::StateSet::UniformList::const_iterator it = uniforms.begin(); it != uniforms.end(); ++it)
+            {
+                if (it->second.first->getUpdateCallback() || it->second.first->getEventCallback())
+                    return false;
+            }
+            return true;
+        }
+
+        bool checkAttribute(const osg::StateAttribute& attribute)
+        {
+            if (!isOsgClass(attribute) || attribute.getUpdateCallback() || attribute.getEventCallback())
+                return false;
+
+            // The images are stored by file name only, and read through the ImageManager again
+            if (const osg::Texture* texture = attribute.asTexture())
+            {
+                for (unsigned int i=0; i<texture->getNumImages(); ++i)
+                {
+                    if (!texture->getImage(i) || texture->getImage(i)->getFileName().empty())
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        bool mCanCache;
+    };
+}
+
+namespace Resource
+{
+
+    SceneCache::SceneCache(const boost::filesystem::path& directory, const std::string& options)
+        : mDirectory(directory)
+        , mOptionsHash(hashBytes(sHashBasis, options.data(), options.size()))
+    {
+        SceneUtil::registerSceneSerializers();
+    }
+
+    osg::ref_ptr<osg::Node> SceneCache::read(const std::string& normalizedFilename, uint64_t fileHash, ImageManager* imageManager) const
+    {
+        const boost::filesystem::path cacheFile = getCacheFile(normalizedFilename);
+
+        try
+        {
+            boost::filesystem::ifstream stream(cacheFile, std::ios::binary);
+            if (!stream.is_open())
+                return NULL;
+
+            char magic[sizeof(sMagic)];
+            uint32_t version = 0;
+            uint64_t entryFileHash = 0;
+            uint64_t entryOptionsHash = 0;
+            if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, sMagic, sizeof(magic)) != 0
+                    || !readValue(stream, version) || !readValue(stream, entryFileHash) || !readValue(stream, entryOptionsHash))
+                throw std::runtime_error("invalid header");
+
+            // Outdated, the entry is replaced once the mesh has been converted again
+            if (version != sCacheVersion || entryFileHash != fileHash || entryOptionsHash != mOptionsHash
+                    || !SceneUtil::canSerializeGeometry())
+                return NULL;
+
+            osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+            if (!reader)
+                throw std::runtime_error("no readerwriter for 'osgb' found");
+
+            osg::ref_ptr<osgDB::Options> options (new osgDB::Options);
+            if (imageManager)
+                options->setReadFileCallback(new ImageReadCallback(imageManager));
+
+            osgDB::ReaderWriter::ReadResult result = reader->readNode(stream, options);
+            if (!result.success() || !result.getNode())
+                throw std::runtime_error(result.message());
+
+            return result.getNode();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Ignoring invalid scene cache " << cacheFile.string() << ": " << e.what() << std::endl;
+            return NULL;
+        }
+    }
+
+    void SceneCache::write(const std::string& normalizedFilename, uint64_t fileHash, const osg::Node& node) const
+    {
+        if (!SceneUtil::canSerializeGeometry())
+            return;
+
+        const boost::filesystem::path cacheFile = getCacheFile(normalizedFilename);
+        // The same mesh may be converted by several threads at once
+        const boost::filesystem::path tempFile = boost::filesystem::unique_path(cacheFile.string() + ".%%%%%%%%.tmp");
+
+        try
+        {
+            osgDB::ReaderWriter* writer = osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+            if (!writer)
+                throw std::runtime_error("no readerwriter for 'osgb' found");
+
+            boost::filesystem::create_directories(cacheFile.parent_path());
+
+            {
+                boost::filesystem::ofstream stream(tempFile, std::ios::binary);
+                if (!stream.is_open())
+                    throw std::runtime_error("can't open " + tempFile.string());
+
+                stream.write(sMagic, sizeof(sMagic));
+                writeValue(stream, sCacheVersion);
+                writeValue(stream, fileHash);
+                writeValue(stream, mOptionsHash);
+
+                osg::ref_ptr<osgDB::Options> options (new osgDB::Options);
+                options->setPluginStringData("WriteImageHint", "UseExternal");
+
+                osgDB::ReaderWriter::WriteResult result = writer->writeNode(node, stream, options);
+                if (!result.success())
+                    throw std::runtime_error(result.message());
+
+                if (!stream)
+                    throw std::runtime_error("write error");
+            }
+
+            // Replace the old entry only once the new one is complete
+            boost::filesystem::rename(tempFile, cacheFile);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write scene cache " << cacheFile.string() << ": " << e.what() << std::endl;
+            boost::system::error_code ec;
+            boost::filesystem::remove(tempFile, ec);
+        }
+    }
+
+    bool SceneCache::canCache(osg::Node& node)
+    {
+        CanCacheVisitor visitor;
+        node.accept(visitor);
+        return visitor.mCanCache;
+    }
+
+    uint64_t SceneCache::hash(std::istream& stream)
+    {
+        uint64_t hash = sHashBasis;
+        char buffer[4096];
+        while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+            hash = hashBytes(hash, buffer, static_cast<size_t>(stream.gcount()));
+        return hash;
+    }
+
+    boost::filesystem::path SceneCache::getCacheFile(const std::string& normalizedFilename) const
+    {
+        // Mirrors the VFS, e.g. meshes/f/furn_chair_01.nif.osgb
+        return mDirectory / (normalizedFilename + ".osgb");
+    }
+
+}
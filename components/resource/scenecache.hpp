@@ -0,0 +1,61 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_SCENECACHE_H
+#define OPENMW_COMPONENTS_RESOURCE_SCENECACHE_H
+
+#include <string>
+#include <istream>
+#include <stdint.h>
+
+#include <boost/filesystem/path.hpp>
+
+#include <osg/ref_ptr>
+
+namespace osg
+{
+    class Node;
+}
+
+
+namespace Resource
+{
+    class ImageManager;
+
+    /// @brief Stores converted and optimized scene templates on disk, so they can be loaded on the next run without
+    /// parsing and optimizing the mesh file again.
+    /// @par An entry is only used if the mesh file and the conversion options are the same as when the entry was written.
+    /// Entries are stored in the osgb format, using the serializers of SceneUtil::registerSceneSerializers.
+    /// @note Only scenes made of plain osg nodes, geometry and state can be stored, see canCache().
+    /// @note May be used from any thread.
+    class SceneCache
+    {
+    public:
+        /// @param directory Where the entries are stored, created when needed.
+        /// @param options Anything besides the mesh file that affects the converted scene, e.g. the optimizer options.
+        SceneCache(const boost::filesystem::path& directory, const std::string& options);
+
+        /// @param fileHash Hash of the mesh file, see hash().
+        /// @param imageManager Reads the textures, may be NULL if the scene has none. The stored texture file names
+        /// are corrected again, so textures added or replaced since the entry was written are used.
+        /// @return The cached scene, or NULL if there is no valid entry for this mesh file.
+        osg::ref_ptr<osg::Node> read(const std::string& normalizedFilename, uint64_t fileHash, ImageManager* imageManager) const;
+
+        /// Store the scene, replacing an existing entry. Failures are reported, but not thrown.
+        /// @note Textures are stored as the file names of their images, not as image data.
+        void write(const std::string& normalizedFilename, uint64_t fileHash, const osg::Node& node) const;
+
+        /// @return True if the scene can be stored and read back in full, i.e. it has no callbacks, no skinned, morphed or
+        /// particle geometry, and only textures with images that were read from a file.
+        static bool canCache(osg::Node& node);
+
+        /// Hash of the content of a mesh file, used to detect changed meshes. Reads the stream to the end.
+        static uint64_t hash(std::istream& stream);
+
+    private:
+        boost::filesystem::path getCacheFile(const std::string& normalizedFilename) const;
+
+        boost::filesystem::path mDirectory;
+        uint64_t mOptionsHash;
+    };
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "scenemanager.hpp"
 
 #include <iostream>
+#include <sstream>
 #include <cstdlib>
 
 #include <osg/Node>
@@ -32,6 +33,7 @@
 #include "niffilemanager.hpp"
 #include "objectcache.hpp"
 #include "multiobjectcache.hpp"
+#include "scenecache.hpp"
 
 namespace
 {
@@ -213,6 +215,7 @@ namespace Resource
         , mForcePerPixelLighting(false)
         , mAutoUseNormalMaps(false)
         , mAutoUseSpecularMaps(false)
+        , mGpuSkinning(false)
         , mInstanceCache(new MultiObjectCache)
         , mSharedStateManager(new SharedStateManager)
         , mImageManager(imageManager)
@@ -235,12 +238,14 @@ namespace Resource
         return mForceShaders;
     }
 
-    void SceneManager::recreateShaders(osg::ref_ptr<osg::Node> node)
+    void SceneManager::recreateShaders(osg::ref_ptr<osg::Node> node, bool instancing)
     {
         Shader::ShaderVisitor shaderVisitor(*mShaderManager.get(), *mImageManager, "objects_vertex.glsl", "objects_fragment.glsl");
         shaderVisitor.setForceShaders(mForceShaders);
         shaderVisitor.setClampLighting(mClampLighting);
         shaderVisitor.setForcePerPixelLighting(mForcePerPixelLighting);
+        shaderVisitor.setGpuSkinning(mGpuSkinning);
+        shaderVisitor.setInstancing(instancing);
         shaderVisitor.setAllowedToModifyStateSets(false);
         node->accept(shaderVisitor);
     }
@@ -290,6 +295,11 @@ namespace Resource
         mSpecularMapPattern = pattern;
     }
 
+    void SceneManager::setGpuSkinning(bool gpuSkinning)
+    {
+        mGpuSkinning = gpuSkinning;
+    }
+
     SceneManager::~SceneManager()
     {
         // this has to be defined in the .cpp file as we can't delete incomplete types
@@ -466,6 +476,56 @@ namespace Resource
         return options;
     }
 
+    void SceneManager::setSceneCacheDirectory(const std::string &directory)
+    {
+        // Anything that changes the converted scene besides the NIF file itself
+        std::ostringstream options;
+        options << "optimize " << getOptimizationOptions() << " markers " << NifOsg::Loader::getShowMarkers();
+
+        mSceneCache.reset(new SceneCache(directory, options.str()));
+    }
+
+    void SceneManager::optimize(osg::ref_ptr<osg::Node> node)
+    {
+        SceneUtil::Optimizer optimizer;
+        optimizer.setIsOperationPermissibleForObjectCallback(new CanOptimizeCallback);
+
+        static const unsigned int options = getOptimizationOptions();
+
+        optimizer.optimize(node, options);
+    }
+
+    osg::ref_ptr<osg::Node> SceneManager::loadCached(Files::IStreamPtr file, const std::string &normalizedFilename, bool &optimized)
+    {
+        // The NIF file is read through the NifFileManager, so the stream is only needed for the hash
+        const uint64_t fileHash = SceneCache::hash(*file);
+
+        osg::ref_ptr<osg::Node> loaded = mSceneCache->read(normalizedFilename, fileHash, mImageManager);
+        if (loaded)
+        {
+            optimized = true;
+            return loaded;
+        }
+
+        loaded = load(file, normalizedFilename, mImageManager, mNifFileManager);
+
+        if (SceneCache::canCache(*loaded))
+        {
+            // The cache entry is stored before the shaders are added, so it does not depend on the shader settings.
+            // Share the state within this scene only so the optimizer can still merge geometry.
+            osg::ref_ptr<osgDB::SharedStateManager> sharedStateManager (new osgDB::SharedStateManager);
+            sharedStateManager->share(loaded.get());
+
+            if (canOptimize(normalizedFilename))
+                optimize(loaded);
+            optimized = true;
+
+            mSceneCache->write(normalizedFilename, fileHash, *loaded);
+        }
+
+        return loaded;
+    }
+
     osg::ref_ptr<const osg::Node> SceneManager::getTemplate(const std::string &name)
     {
         std::string normalized = name;
@@ -477,11 +537,15 @@ namespace Resource
         else
         {
             osg::ref_ptr<osg::Node> loaded;
+            bool optimized = false;
             try
             {
                 Files::IStreamPtr file = mVFS->get(normalized);
 
-                loaded = load(file, normalized, mImageManager, mNifFileManager);
+                if (mSceneCache && getFileExtension(normalized) == "nif")
+                    loaded = loadCached(file, normalized, optimized);
+                else
+                    loaded = load(file, normalized, mImageManager, mNifFileManager);
             }
             catch (std::exception& e)
             {
@@ -518,6 +582,7 @@ namespace Resource
             shaderVisitor.setNormalHeightMapPattern(mNormalHeightMapPattern);
             shaderVisitor.setAutoUseSpecularMaps(mAutoUseSpecularMaps);
             shaderVisitor.setSpecularMapPattern(mSpecularMapPattern);
+            shaderVisitor.setGpuSkinning(mGpuSkinning);
             loaded->accept(shaderVisitor);
 
             // share state
@@ -527,15 +592,8 @@ namespace Resource
             mSharedStateManager->share(loaded.get());
             mSharedStateMutex.unlock();
 
-            if (canOptimize(normalized))
-            {
-                SceneUtil::Optimizer optimizer;
-                optimizer.setIsOperationPermissibleForObjectCallback(new CanOptimizeCallback);
-
-                static const unsigned int options = getOptimizationOptions();
-
-                optimizer.optimize(loaded, options);
-            }
+            if (!optimized && canOptimize(normalized))
+                optimize(loaded);
 
             if (mIncrementalCompileOperation)
                 mIncrementalCompileOperation->add(loaded);
@@ -723,7 +781,7 @@ namespace Resource
             stats->setAttribute(frameNumber, "StateSet", mSharedStateManager->getNumSharedStateSets());
         }
 
-        stats->setAttribute(frameNumber, "Node", mCache->getCacheSize());
+        reportCacheStats(frameNumber, stats, "Node");
         stats->setAttribute(frameNumber, "Node Instance", mInstanceCache->getCacheSize());
     }
 
@@ -9,6 +9,8 @@
 #include <osg/Node>
 #include <osg/Texture>
 
+#include <components/files/constrainedfilestream.hpp>
+
 #include "resourcemanager.hpp"
 
 namespace Resource
@@ -16,6 +18,7 @@ namespace Resource
     class ImageManager;
     class NifFileManager;
     class SharedStateManager;
+    class SceneCache;
 }
 
 namespace osgUtil
@@ -49,7 +52,8 @@ namespace Resource
         Shader::ShaderManager& getShaderManager();
 
         /// Re-create shaders for this node, need to call this if texture stages or vertex color mode have changed.
-        void recreateShaders(osg::ref_ptr<osg::Node> node);
+        /// @param instancing Use the instancing shader, for the Geometry of a SceneUtil::InstanceBatch.
+        void recreateShaders(osg::ref_ptr<osg::Node> node, bool instancing=false);
 
         /// @see ShaderVisitor::setForceShaders
         void setForceShaders(bool force);
@@ -76,8 +80,16 @@ namespace Resource
 
         void setSpecularMapPattern(const std::string& pattern);
 
+        /// @see ShaderVisitor::setGpuSkinning
+        void setGpuSkinning(bool gpuSkinning);
+
         void setShaderPath(const std::string& path);
 
+        /// Store converted NIF files in the given directory, so that later runs can load them without parsing and optimizing them again.
+        /// @note Only scenes that the SceneCache can store in full are cached, others are converted on every run.
+        /// @note Must be called before loading any scenes.
+        void setSceneCacheDirectory(const std::string& directory);
+
         /// Check if a given scene is loaded and if so, update its usage timestamp to prevent it from being unloaded
         bool checkLoaded(const std::string& name, double referenceTime);
 
@@ -147,6 +159,12 @@ namespace Resource
 
     private:
 
+        /// Load the given NIF file through the scene cache, converting and caching it if there is no valid cache entry.
+        /// @param optimized Set to true if the returned scene has been optimized already.
+        osg::ref_ptr<osg::Node> loadCached(Files::IStreamPtr file, const std::string& normalizedFilename, bool& optimized);
+
+        void optimize(osg::ref_ptr<osg::Node> node);
+
         std::unique_ptr<Shader::ShaderManager> mShaderManager;
         bool mForceShaders;
         bool mClampLighting;
@@ -156,6 +174,9 @@ namespace Resource
         std::string mNormalHeightMapPattern;
         bool mAutoUseSpecularMaps;
         std::string mSpecularMapPattern;
+        bool mGpuSkinning;
+
+        std::unique_ptr<SceneCache> mSceneCache;
 
         osg::ref_ptr<MultiObjectCache> mInstanceCache;
 
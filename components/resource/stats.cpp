@@ -259,49 +259,63 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase *viewer)
         _resourceStatsChildNum = _switch->getNumChildren();
         _switch->addChild(group, false);
 
-        const char* statNames[] = {"Compiling", "WorkQueue", "WorkThread", "", "Texture", "StateSet", "Node", "Node Instance", "Shape", "Shape Instance", "Image", "Nif", "Keyframe", "", "Terrain Chunk", "Terrain Texture", "Land", "Composite", "", "UnrefQueue"};
+        const char* statNames[] = {"Compiling", "WorkQueue", "WorkThread", "WorkDone", "WorkCancelled", "WorkLatency", "", "Texture", "StateSet", "Node", "Node Instance", "Shape", "Shape Instance", "Image", "Nif", "Keyframe", "", "Terrain Chunk", "Terrain Texture", "Land", "Composite", "", "UnrefQueue"};
 
-        int numLines = sizeof(statNames) / sizeof(statNames[0]);
+        // The cache usage reported by ResourceManager::reportCacheStats(), shown left of the resource counts
+        const char* cacheStatNames[] = {"Node Hit", "Node Miss", "Node Evicted", "", "Image Hit", "Image Miss", "Image Evicted", "", "Nif Hit", "Nif Miss", "Nif Evicted", "", "Shape Hit", "Shape Miss", "Shape Evicted"};
 
-        group->addChild(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
-                                                        10 * _characterSize + 2 * backgroundMargin,
-                                                        numLines * _characterSize + 2 * backgroundMargin,
-                                                        backgroundColor));
+        std::vector<std::vector<std::string> > columns;
+        columns.push_back(std::vector<std::string>(statNames, statNames + sizeof(statNames) / sizeof(statNames[0])));
+        columns.push_back(std::vector<std::string>(cacheStatNames, cacheStatNames + sizeof(cacheStatNames) / sizeof(cacheStatNames[0])));
 
-        osg::ref_ptr<osgText::Text> staticText = new osgText::Text;
-        group->addChild( staticText.get() );
-        staticText->setColor(staticTextColor);
-        staticText->setFont(_font);
-        staticText->setCharacterSize(_characterSize);
-        staticText->setPosition(pos);
+        const float columnWidth = 15 * _characterSize + 4 * backgroundMargin + 2 * backgroundSpacing;
 
-        std::ostringstream viewStr;
-        viewStr.clear();
-        viewStr.setf(std::ios::left, std::ios::adjustfield);
-        viewStr.width(14);
-        for (size_t i = 0; i<sizeof(statNames)/sizeof(statNames[0]); ++i)
+        for (size_t column = 0; column < columns.size(); ++column)
         {
-            viewStr << statNames[i] << std::endl;
-        }
+            const std::vector<std::string>& names = columns[column];
+            int numLines = names.size();
+            osg::Vec3 columnPos = pos - osg::Vec3(column * columnWidth, 0.f, 0.f);
+
+            group->addChild(createBackgroundRectangle(columnPos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
+                                                            10 * _characterSize + 2 * backgroundMargin,
+                                                            numLines * _characterSize + 2 * backgroundMargin,
+                                                            backgroundColor));
+
+            osg::ref_ptr<osgText::Text> staticText = new osgText::Text;
+            group->addChild( staticText.get() );
+            staticText->setColor(staticTextColor);
+            staticText->setFont(_font);
+            staticText->setCharacterSize(_characterSize);
+            staticText->setPosition(columnPos);
+
+            std::ostringstream viewStr;
+            viewStr.clear();
+            viewStr.setf(std::ios::left, std::ios::adjustfield);
+            viewStr.width(14);
+            for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+            {
+                viewStr << *it << std::endl;
+            }
 
-        staticText->setText(viewStr.str());
+            staticText->setText(viewStr.str());
 
-        pos.x() += 10 * _characterSize + 2 * backgroundMargin + backgroundSpacing;
+            columnPos.x() += 10 * _characterSize + 2 * backgroundMargin + backgroundSpacing;
 
-        group->addChild(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
-                                                        5 * _characterSize + 2 * backgroundMargin,
-                                                        numLines * _characterSize + 2 * backgroundMargin,
-                                                        backgroundColor));
+            group->addChild(createBackgroundRectangle(columnPos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
+                                                            5 * _characterSize + 2 * backgroundMargin,
+                                                            numLines * _characterSize + 2 * backgroundMargin,
+                                                            backgroundColor));
 
-        osg::ref_ptr<osgText::Text> statsText = new osgText::Text;
-        group->addChild( statsText.get() );
+            osg::ref_ptr<osgText::Text> statsText = new osgText::Text;
+            group->addChild( statsText.get() );
 
-        statsText->setColor(dynamicTextColor);
-        statsText->setFont(_font);
-        statsText->setCharacterSize(_characterSize);
-        statsText->setPosition(pos);
-        statsText->setText("");
-        statsText->setDrawCallback(new ResourceStatsTextDrawCallback(viewer->getViewerStats(), std::vector<std::string>(statNames, statNames + numLines)));
+            statsText->setColor(dynamicTextColor);
+            statsText->setFont(_font);
+            statsText->setCharacterSize(_characterSize);
+            statsText->setPosition(columnPos);
+            statsText->setText("");
+            statsText->setDrawCallback(new ResourceStatsTextDrawCallback(viewer->getViewerStats(), names));
+        }
     }
 }
 
@@ -0,0 +1,272 @@
+#include "instancing.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <osg/Geometry>
+#include <osg/Transform>
+
+#include <osgUtil/IntersectionVisitor>
+
+namespace
+{
+
+    bool isOsgClass(const osg::Object& object, const char* className)
+    {
+        return std::strcmp(object.libraryName(), "osg") == 0 && std::strcmp(object.className(), className) == 0;
+    }
+
+    class CanInstanceVisitor : public osg::NodeVisitor
+    {
+    public:
+        CanInstanceVisitor(unsigned int traversalMask)
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mCanInstance(true)
+        {
+            setTraversalMask(traversalMask);
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (!(isOsgClass(node, "Group") || isOsgClass(node, "MatrixTransform") || isOsgClass(node, "Geode"))
+                    || !checkNode(node))
+            {
+                mCanInstance = false;
+                return;
+            }
+
+            traverse(node);
+        }
+
+        virtual void apply(osg::Drawable& drawable)
+        {
+            if (!isOsgClass(drawable, "Geometry") || !checkNode(drawable)
+                    || drawable.getComputeBoundingBoxCallback() || drawable.getDrawCallback())
+                mCanInstance = false;
+        }
+
+        bool checkNode(osg::Node& node)
+        {
+            // Only drawn by some of the cameras
+            if (node.getNodeMask() != ~0u)
+                return false;
+
+            if (node.getUpdateCallback() || node.getEventCallback() || node.getCullCallback())
+                return false;
+
+            const osg::StateSet* stateset = node.getStateSet();
+            return !stateset || (!stateset->getUpdateCallback() && !stateset->getEventCallback());
+        }
+
+        bool mCanInstance;
+    };
+
+    /// Collects the Geometry of a template, with the transform and state it is drawn with.
+    class CollectGeometryVisitor : public osg::NodeVisitor
+    {
+    public:
+        CollectGeometryVisitor(unsigned int traversalMask)
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+        {
+            setTraversalMask(traversalMask);
+        }
+
+        virtual void apply(osg::Geometry& geometry)
+        {
+            const osg::NodePath& path = getNodePath();
+
+            // The state inherited from the parents, the template is flattened
+            osg::ref_ptr<osg::StateSet> stateset (new osg::StateSet);
+            for (osg::NodePath::const_iterator it = path.begin(); it != path.end(); ++it)
+            {
+                if ((*it)->getStateSet())
+                    stateset->merge(*(*it)->getStateSet());
+            }
+
+            mGeometry.push_back(&geometry);
+            mMatrices.push_back(osg::computeLocalToWorld(path));
+            mStateSets.push_back(stateset);
+        }
+
+        std::vector<osg::ref_ptr<const osg::Geometry> > mGeometry;
+        std::vector<osg::Matrixf> mMatrices;
+        std::vector<osg::ref_ptr<osg::StateSet> > mStateSets;
+    };
+
+    class InstanceBoundsCallback : public osg::Drawable::ComputeBoundingBoxCallback
+    {
+    public:
+        virtual osg::BoundingBox computeBound(const osg::Drawable&) const
+        {
+            return mBounds;
+        }
+
+        osg::BoundingBox mBounds;
+    };
+
+    class UpdateInstancesCallback : public osg::NodeCallback
+    {
+    public:
+        virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+        {
+            static_cast<SceneUtil::InstanceBatch*>(node)->update();
+            traverse(node, nv);
+        }
+    };
+
+}
+
+namespace SceneUtil
+{
+
+    bool canInstance(const osg::Node& templateNode, unsigned int traversalMask)
+    {
+        CanInstanceVisitor visitor(traversalMask);
+        const_cast<osg::Node&>(templateNode).accept(visitor); // no const version of NodeVisitor
+        return visitor.mCanInstance;
+    }
+
+    InstanceBatch::InstanceBatch(const osg::Node* templateNode, unsigned int traversalMask)
+        : mTemplate(templateNode)
+        , mDirty(true)
+    {
+        CollectGeometryVisitor visitor(traversalMask);
+        const_cast<osg::Node*>(templateNode)->accept(visitor);
+
+        mParts = visitor.mGeometry;
+        mPartMatrices = visitor.mMatrices;
+
+        // The first set of copies, any further sets are copied from these so they share the shaders
+        for (unsigned int i=0; i<mParts.size(); ++i)
+            addChild(createGeometry(*mParts[i], *visitor.mStateSets[i]));
+
+        setDataVariance(osg::Object::DYNAMIC);
+        setUpdateCallback(new UpdateInstancesCallback);
+    }
+
+    osg::ref_ptr<osg::Geometry> InstanceBatch::createGeometry(const osg::Geometry &geometry, const osg::StateSet& stateset)
+    {
+        osg::ref_ptr<osg::Geometry> copy (new osg::Geometry(geometry, osg::CopyOp::SHALLOW_COPY));
+        for (unsigned int i=0; i<copy->getNumPrimitiveSets(); ++i)
+            copy->setPrimitiveSet(i, osg::clone(copy->getPrimitiveSet(i), osg::CopyOp::SHALLOW_COPY));
+
+        // Display lists would record the number of copies
+        copy->setUseDisplayList(false);
+        copy->setUseVertexBufferObjects(true);
+        copy->setDataVariance(osg::Object::DYNAMIC);
+        copy->setComputeBoundingBoxCallback(new InstanceBoundsCallback);
+
+        osg::ref_ptr<osg::StateSet> instanceStateSet (new osg::StateSet(stateset, osg::CopyOp::SHALLOW_COPY));
+        osg::ref_ptr<osg::Uniform> matrices (new osg::Uniform(osg::Uniform::FLOAT_MAT4, "instanceMatrices", sMaxInstances));
+        for (unsigned int i=0; i<sMaxInstances; ++i)
+            matrices->setElement(i, osg::Matrixf());
+        matrices->setDataVariance(osg::Object::DYNAMIC);
+        instanceStateSet->addUniform(matrices);
+        instanceStateSet->setDataVariance(osg::Object::DYNAMIC);
+        copy->setStateSet(instanceStateSet);
+
+        return copy;
+    }
+
+    void InstanceBatch::addInstance(const void *key, const osg::Matrixf &matrix)
+    {
+        mKeys.push_back(key);
+        mMatrices.push_back(matrix);
+        mDirty = true;
+    }
+
+    bool InstanceBatch::updateInstance(const void *key, const osg::Matrixf &matrix)
+    {
+        std::vector<const void*>::iterator found = std::find(mKeys.begin(), mKeys.end(), key);
+        if (found == mKeys.end())
+            return false;
+
+        mMatrices[found - mKeys.begin()] = matrix;
+        mDirty = true;
+        return true;
+    }
+
+    bool InstanceBatch::removeInstance(const void *key)
+    {
+        std::vector<const void*>::iterator found = std::find(mKeys.begin(), mKeys.end(), key);
+        if (found == mKeys.end())
+            return false;
+
+        // The order of the copies does not matter, so fill the gap with the last one
+        size_t index = found - mKeys.begin();
+        mKeys[index] = mKeys.back();
+        mMatrices[index] = mMatrices.back();
+        mKeys.pop_back();
+        mMatrices.pop_back();
+        mDirty = true;
+        return true;
+    }
+
+    unsigned int InstanceBatch::getNumInstances() const
+    {
+        return mKeys.size();
+    }
+
+    void InstanceBatch::update()
+    {
+        if (!mDirty || mParts.empty())
+            return;
+        mDirty = false;
+
+        const unsigned int numParts = mParts.size();
+        const unsigned int numMatrices = mMatrices.size();
+        const unsigned int numSets = std::max(1u, (numMatrices + sMaxInstances - 1) / sMaxInstances);
+
+        while (getNumChildren() < numSets * numParts)
+        {
+            const osg::Geometry* first = static_cast<osg::Geometry*>(getChild(getNumChildren() % numParts));
+            addChild(createGeometry(*first, *first->getStateSet()));
+        }
+        if (getNumChildren() > numSets * numParts)
+            removeChildren(numSets * numParts, getNumChildren() - numSets * numParts);
+
+        for (unsigned int set=0; set<numSets; ++set)
+        {
+            const unsigned int begin = set * sMaxInstances;
+            const unsigned int count = begin < numMatrices ? std::min(numMatrices - begin, static_cast<unsigned int>(sMaxInstances)) : 0;
+
+            for (unsigned int part=0; part<numParts; ++part)
+            {
+                osg::Geometry* geometry = static_cast<osg::Geometry*>(getChild(set * numParts + part));
+
+                // A primitive set with 0 copies would be drawn once, without instancing
+                geometry->setNodeMask(count ? ~0u : 0u);
+                if (!count)
+                    continue;
+
+                for (unsigned int i=0; i<geometry->getNumPrimitiveSets(); ++i)
+                    geometry->getPrimitiveSet(i)->setNumInstances(count);
+
+                osg::Uniform* matrices = geometry->getStateSet()->getUniform("instanceMatrices");
+                InstanceBoundsCallback* bounds = static_cast<InstanceBoundsCallback*>(geometry->getComputeBoundingBoxCallback());
+                bounds->mBounds.init();
+
+                const osg::BoundingBox& partBounds = mParts[part]->getBoundingBox();
+                for (unsigned int i=0; i<count; ++i)
+                {
+                    osg::Matrixf matrix = mPartMatrices[part] * mMatrices[begin + i];
+                    matrices->setElement(i, matrix);
+
+                    for (unsigned int corner=0; corner<8; ++corner)
+                        bounds->mBounds.expandBy(partBounds.corner(corner) * matrix);
+                }
+
+                geometry->dirtyBound();
+            }
+        }
+    }
+
+    void InstanceBatch::traverse(osg::NodeVisitor &nv)
+    {
+        if (dynamic_cast<osgUtil::IntersectionVisitor*>(&nv))
+            return;
+
+        osg::Group::traverse(nv);
+    }
+
+}
@@ -0,0 +1,72 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_INSTANCING_H
+#define OPENMW_COMPONENTS_SCENEUTIL_INSTANCING_H
+
+#include <vector>
+
+#include <osg/Group>
+#include <osg/Matrixf>
+
+namespace osg
+{
+    class Geometry;
+}
+
+namespace SceneUtil
+{
+
+    /// @return True if the given scene template can be drawn by an InstanceBatch, i.e. it is made of plain groups,
+    /// transforms and Geometry without any callbacks, so it looks the same in every frame.
+    /// @param traversalMask Subgraphs excluded by this mask are not drawn, e.g. hidden collision shapes.
+    bool canInstance(const osg::Node& templateNode, unsigned int traversalMask);
+
+    /// @brief Draws many copies of a static scene template using hardware instancing. Each Geometry of the template
+    /// is drawn once for up to sMaxInstances copies, with the transforms of the copies in the uniform array "instanceMatrices".
+    /// @par Copies are identified by a key, e.g. the node of the object a copy stands in for. Changes to the copies are
+    /// applied in the next update traversal.
+    /// @note The Geometry of the batch needs the instancing shader, see Shader::ShaderVisitor::setInstancing.
+    /// @note The batch is ignored by intersection visitors, as the copies are only transformed in the shader.
+    /// @note Only use with templates accepted by canInstance().
+    class InstanceBatch : public osg::Group
+    {
+    public:
+        /// Number of copies drawn per draw call, i.e. the size of the uniform array.
+        static const unsigned int sMaxInstances = 64;
+
+        InstanceBatch(const osg::Node* templateNode, unsigned int traversalMask);
+
+        /// @param matrix The transform of the copy, relative to the batch.
+        void addInstance(const void* key, const osg::Matrixf& matrix);
+
+        /// @return Was the copy found?
+        bool updateInstance(const void* key, const osg::Matrixf& matrix);
+
+        /// @return Was the copy found?
+        bool removeInstance(const void* key);
+
+        unsigned int getNumInstances() const;
+
+        /// Apply the changes to the copies now, rather than in the next update traversal.
+        /// @note Not thread safe, the batch must not be drawn at the same time.
+        void update();
+
+        virtual void traverse(osg::NodeVisitor& nv);
+
+    private:
+        /// @return A copy of the Geometry that shares its data but not its primitive sets, as those hold the number of copies drawn.
+        osg::ref_ptr<osg::Geometry> createGeometry(const osg::Geometry& geometry, const osg::StateSet& stateset);
+
+        osg::ref_ptr<const osg::Node> mTemplate;
+
+        // The Geometry of the template and its transform within the template
+        std::vector<osg::ref_ptr<const osg::Geometry> > mParts;
+        std::vector<osg::Matrixf> mPartMatrices;
+
+        std::vector<const void*> mKeys;
+        std::vector<osg::Matrixf> mMatrices;
+
+        bool mDirty;
+    };
+
+}
+
+#endif
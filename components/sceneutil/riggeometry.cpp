@@ -1,15 +1,48 @@
 #include "riggeometry.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <cstdlib>
 
 #include "skeleton.hpp"
+#include "skinning.hpp"
 #include "util.hpp"
+#include "workqueue.hpp"
 
 namespace SceneUtil
 {
 
+class SkinningWorkItem : public WorkItem
+{
+public:
+    /// @note The RigGeometry waits for the item to be done before it is deleted.
+    SkinningWorkItem(RigGeometry* rig)
+        : mRig(rig)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mRig->skin();
+    }
+
+private:
+    RigGeometry* mRig;
+};
+
+WorkQueue* RigGeometry::sWorkQueue = NULL;
+
+void RigGeometry::setWorkQueue(WorkQueue* workQueue)
+{
+    sWorkQueue = workQueue;
+}
+
+WorkQueue* RigGeometry::getWorkQueue()
+{
+    return sWorkQueue;
+}
+
 class UpdateRigBounds : public osg::Drawable::UpdateCallback
 {
 public:
@@ -65,6 +98,7 @@ public:
 
 RigGeometry::RigGeometry()
     : mSkeleton(NULL)
+    , mGpuSkinning(false)
     , mLastFrameNumber(0)
     , mBoundsFirstFrame(true)
 {
@@ -79,10 +113,25 @@ RigGeometry::RigGeometry(const RigGeometry &copy, const osg::CopyOp &copyop)
     : osg::Geometry(copy, copyop)
     , mSkeleton(NULL)
     , mInfluenceMap(copy.mInfluenceMap)
+    , mGpuSkinning(copy.mGpuSkinning)
     , mLastFrameNumber(0)
     , mBoundsFirstFrame(true)
 {
     setSourceGeometry(copy.mSourceGeometry);
+
+    // The copied StateSet has the program, but the bone matrices must not be shared
+    if (mGpuSkinning)
+        createBoneMatrices();
+}
+
+RigGeometry::~RigGeometry()
+{
+    // Without a queue, the work threads are gone and the item will never be done
+    if (mSkinning && sWorkQueue)
+    {
+        sWorkQueue->cancel(this);
+        mSkinning->waitTillDone();
+    }
 }
 
 void RigGeometry::setSourceGeometry(osg::ref_ptr<osg::Geometry> sourceGeometry)
@@ -91,7 +140,8 @@ void RigGeometry::setSourceGeometry(osg::ref_ptr<osg::Geometry> sourceGeometry)
 
     osg::Geometry& from = *sourceGeometry;
 
-    if (from.getStateSet())
+    // With GPU skinning, we have our own StateSet for the bone matrices
+    if (from.getStateSet() && !mGpuSkinning)
         setStateSet(from.getStateSet());
 
     // shallow copy primitive sets & vertex attributes that we will not modify
@@ -108,6 +158,15 @@ void RigGeometry::setSourceGeometry(osg::ref_ptr<osg::Geometry> sourceGeometry)
 
     setVertexAttribArrayList(from.getVertexAttribArrayList());
 
+    if (mGpuSkinning)
+    {
+        // skinned in the vertex shader, so the source arrays are never modified
+        setVertexArray(from.getVertexArray());
+        setNormalArray(from.getNormalArray(), osg::Array::BIND_PER_VERTEX);
+        mSourceTangents = NULL;
+        return;
+    }
+
     // vertices and normals are modified every frame, so we need to deep copy them.
     // assign a dedicated VBO to make sure that modifications don't interfere with source geometry's VBO.
     osg::ref_ptr<osg::VertexBufferObject> vbo (new osg::VertexBufferObject);
@@ -147,6 +206,86 @@ osg::ref_ptr<osg::Geometry> RigGeometry::getSourceGeometry()
     return mSourceGeometry;
 }
 
+bool RigGeometry::setGpuSkinning()
+{
+    if (mGpuSkinning)
+        return true;
+
+    // Must be decided before the bones are looked up in the skeleton
+    if (mSkeleton || !mInfluenceMap || !mSourceGeometry || !mSourceGeometry->getVertexArray()
+            || mInfluenceMap->mMap.size() > sMaxGpuBones)
+        return false;
+
+    const unsigned int numVertices = mSourceGeometry->getVertexArray()->getNumElements();
+    osg::ref_ptr<osg::Vec4Array> boneIndices (new osg::Vec4Array(numVertices));
+    osg::ref_ptr<osg::Vec4Array> boneWeights (new osg::Vec4Array(numVertices));
+    std::vector<unsigned char> numInfluences (numVertices, 0);
+
+    // The bones are numbered in the order of the influence map, see initFromParentSkeleton
+    unsigned int boneIndex = 0;
+    for (std::map<std::string, BoneInfluence>::const_iterator it = mInfluenceMap->mMap.begin(); it != mInfluenceMap->mMap.end(); ++it, ++boneIndex)
+    {
+        const std::map<unsigned short, float>& weights = it->second.mWeights;
+        for (std::map<unsigned short, float>::const_iterator weightIt = weights.begin(); weightIt != weights.end(); ++weightIt)
+        {
+            const unsigned short vertex = weightIt->first;
+            if (vertex >= numVertices)
+                continue;
+            if (numInfluences[vertex] == 4)
+                return false;
+
+            (*boneIndices)[vertex][numInfluences[vertex]] = static_cast<float>(boneIndex);
+            (*boneWeights)[vertex][numInfluences[vertex]] = weightIt->second;
+            ++numInfluences[vertex];
+        }
+    }
+
+    mSourceGeometry->setVertexAttribArray(BoneIndicesAttribute, boneIndices, osg::Array::BIND_PER_VERTEX);
+    mSourceGeometry->setVertexAttribArray(BoneWeightsAttribute, boneWeights, osg::Array::BIND_PER_VERTEX);
+
+    mGpuSkinning = true;
+    setSourceGeometry(mSourceGeometry);
+    createBoneMatrices();
+    return true;
+}
+
+bool RigGeometry::getGpuSkinning() const
+{
+    return mGpuSkinning;
+}
+
+unsigned int RigGeometry::getNumGpuBones() const
+{
+    unsigned int numBones = mInfluenceMap ? mInfluenceMap->mMap.size() : 0;
+    return std::max(16u, (numBones + 15) / 16 * 16);
+}
+
+void RigGeometry::createBoneMatrices()
+{
+    mBoneMatrices = new osg::Uniform(osg::Uniform::FLOAT_MAT4, "boneMatrices", getNumGpuBones());
+    for (unsigned int i=0; i<mBoneMatrices->getNumElements(); ++i)
+        mBoneMatrices->setElement(i, osg::Matrixf());
+
+    osg::ref_ptr<osg::StateSet> stateset = getStateSet() ? new osg::StateSet(*getStateSet(), osg::CopyOp::SHALLOW_COPY) : new osg::StateSet;
+    stateset->addUniform(mBoneMatrices);
+    setStateSet(stateset);
+}
+
+void RigGeometry::updateBoneMatrices()
+{
+    for (unsigned int i=0; i<mGpuBones.size(); ++i)
+    {
+        Bone* bone = mGpuBones[i].first;
+        if (!bone)
+            continue;
+
+        osg::Matrixf matrix = mGpuBones[i].second * bone->mMatrixInSkeletonSpace;
+        if (mGeomToSkelMatrix)
+            matrix *= (*mGeomToSkelMatrix);
+        mBoneMatrices->setElement(i, matrix);
+    }
+}
+
 bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
 {
     const osg::NodePath& path = nv->getNodePath();
@@ -174,9 +313,19 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
 
     typedef std::map<unsigned short, std::vector<BoneWeight> > Vertex2BoneMap;
     Vertex2BoneMap vertex2BoneMap;
+    mGpuBones.clear();
     for (std::map<std::string, BoneInfluence>::const_iterator it = mInfluenceMap->mMap.begin(); it != mInfluenceMap->mMap.end(); ++it)
     {
         Bone* bone = mSkeleton->getBone(it->first);
+
+        if (mGpuSkinning)
+        {
+            mGpuBones.push_back(std::make_pair(bone, it->second.mInvBindMatrix));
+            // Vertices do not move with a missing bone, like on the CPU
+            if (!bone)
+                mBoneMatrices->setElement(mGpuBones.size()-1, osg::Matrixf(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0));
+        }
+
         if (!bone)
         {
             std::cerr << "Error: RigGeometry did not find bone " << it->first << std::endl;
@@ -185,6 +334,9 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
 
         mBoneSphereMap[bone] = it->second.mBoundSphere;
 
+        if (mGpuSkinning)
+            continue;
+
         const BoneInfluence& bi = it->second;
 
         const std::map<unsigned short, float>& weights = it->second.mWeights;
@@ -198,11 +350,34 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
         }
     }
 
+    if (mGpuSkinning)
+        return true;
+
+    typedef std::map<std::vector<BoneWeight>, std::vector<unsigned short> > Bone2VertexMap;
+    Bone2VertexMap bone2VertexMap;
     for (Vertex2BoneMap::iterator it = vertex2BoneMap.begin(); it != vertex2BoneMap.end(); ++it)
     {
-        mBone2VertexMap[it->second].push_back(it->first);
+        bone2VertexMap[it->second].push_back(it->first);
     }
 
+    // Store the groups in flat arrays, that are walked linearly when skinning
+    mVertexGroups.clear();
+    mBoneWeights.clear();
+    mVertices.clear();
+    for (Bone2VertexMap::const_iterator it = bone2VertexMap.begin(); it != bone2VertexMap.end(); ++it)
+    {
+        VertexGroup group;
+        group.mFirstWeight = mBoneWeights.size();
+        group.mNumWeights = it->first.size();
+        group.mFirstVertex = mVertices.size();
+        group.mNumVertices = it->second.size();
+        mVertexGroups.push_back(group);
+
+        mBoneWeights.insert(mBoneWeights.end(), it->first.begin(), it->first.end());
+        mVertices.insert(mVertices.end(), it->second.begin(), it->second.end());
+    }
+    mGroupMatrices.resize(mVertexGroups.size());
+
     return true;
 }
 
@@ -247,46 +422,70 @@ void RigGeometry::update(osg::NodeVisitor* nv)
 
     mSkeleton->updateBoneMatrices(nv->getTraversalNumber());
 
-    // skinning
-    osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getVertexArray());
-    osg::Vec3Array* normalSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getNormalArray());
-    osg::Vec4Array* tangentSrc = mSourceTangents;
+    if (mGpuSkinning)
+    {
+        updateBoneMatrices();
+        return;
+    }
 
-    osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(getVertexArray());
-    osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(getNormalArray());
-    osg::Vec4Array* tangentDst = static_cast<osg::Vec4Array*>(getTexCoordArray(7));
+    // The previous frame's skinning is normally finished when the geometry is drawn
+    if (mSkinning)
+    {
+        mSkinning->waitTillDone();
+        mSkinning = NULL;
+    }
 
-    for (Bone2VertexMap::const_iterator it = mBone2VertexMap.begin(); it != mBone2VertexMap.end(); ++it)
+    // The bone matrices are shared with the other RigGeometries of the skeleton, so they are only read here
+    for (unsigned int i=0; i<mVertexGroups.size(); ++i)
     {
-        osg::Matrixf resultMat  (0, 0, 0, 0,
-                                0, 0, 0, 0,
-                                0, 0, 0, 0,
-                                0, 0, 0, 1);
+        const VertexGroup& group = mVertexGroups[i];
+
+        osg::Matrixf& resultMat = mGroupMatrices[i];
+        resultMat.set(0, 0, 0, 0,
+                      0, 0, 0, 0,
+                      0, 0, 0, 0,
+                      0, 0, 0, 1);
 
-        for (std::vector<BoneWeight>::const_iterator weightIt = it->first.begin(); weightIt != it->first.end(); ++weightIt)
+        for (unsigned int j=group.mFirstWeight; j<group.mFirstWeight+group.mNumWeights; ++j)
         {
-            Bone* bone = weightIt->first.first;
-            const osg::Matrix& invBindMatrix = weightIt->first.second;
-            float weight = weightIt->second;
+            const BoneWeight& boneWeight = mBoneWeights[j];
+            Bone* bone = boneWeight.first.first;
+            const osg::Matrix& invBindMatrix = boneWeight.first.second;
+            float weight = boneWeight.second;
             const osg::Matrixf& boneMatrix = bone->mMatrixInSkeletonSpace;
             accumulateMatrix(invBindMatrix, boneMatrix, weight, resultMat);
         }
         if (mGeomToSkelMatrix)
             resultMat *= (*mGeomToSkelMatrix);
+    }
 
-        for (std::vector<unsigned short>::const_iterator vertexIt = it->second.begin(); vertexIt != it->second.end(); ++vertexIt)
-        {
-            unsigned short vertex = *vertexIt;
-            (*positionDst)[vertex] = resultMat.preMult((*positionSrc)[vertex]);
-            if (normalDst)
-                (*normalDst)[vertex] = osg::Matrix::transform3x3((*normalSrc)[vertex], resultMat);
-            if (tangentDst)
-            {
-                osg::Vec4f srcTangent = (*tangentSrc)[vertex];
-                osg::Vec3f transformedTangent = osg::Matrix::transform3x3(osg::Vec3f(srcTangent.x(), srcTangent.y(), srcTangent.z()), resultMat);
-                (*tangentDst)[vertex] = osg::Vec4f(transformedTangent, srcTangent.w());
-            }
-        }
+    if (sWorkQueue)
+    {
+        mSkinning = new SkinningWorkItem(this);
+        mSkinning->setKey(this);
+        sWorkQueue->addWorkItem(mSkinning);
+    }
+    else
+        skin();
+}
+
+void RigGeometry::skin()
+{
+    const osg::Vec3Array* positionSrc = static_cast<const osg::Vec3Array*>(mSourceGeometry->getVertexArray());
+    const osg::Vec3Array* normalSrc = static_cast<const osg::Vec3Array*>(mSourceGeometry->getNormalArray());
+    const osg::Vec4Array* tangentSrc = mSourceTangents;
+
+    osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(getVertexArray());
+    osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(getNormalArray());
+    osg::Vec4Array* tangentDst = static_cast<osg::Vec4Array*>(getTexCoordArray(7));
+
+    for (unsigned int i=0; i<mVertexGroups.size(); ++i)
+    {
+        const VertexGroup& group = mVertexGroups[i];
+        skinVertices(mGroupMatrices[i], &mVertices[group.mFirstVertex], group.mNumVertices,
+                     &positionSrc->front(), &positionDst->front(),
+                     normalDst ? &normalSrc->front() : NULL, normalDst ? &normalDst->front() : NULL,
+                     tangentDst ? &tangentSrc->front() : NULL, tangentDst ? &tangentDst->front() : NULL);
     }
 
     positionDst->dirty();
@@ -296,6 +495,14 @@ void RigGeometry::update(osg::NodeVisitor* nv)
         tangentDst->dirty();
 }
 
+void RigGeometry::drawImplementation(osg::RenderInfo& renderInfo) const
+{
+    if (mSkinning)
+        mSkinning->waitTillDone();
+
+    osg::Geometry::drawImplementation(renderInfo);
+}
+
 void RigGeometry::updateBounds(osg::NodeVisitor *nv)
 {
     if (!mSkeleton)
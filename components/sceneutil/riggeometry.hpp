@@ -9,6 +9,8 @@ namespace SceneUtil
 
     class Skeleton;
     class Bone;
+    class WorkQueue;
+    class SkinningWorkItem;
 
     /// @brief Mesh skinning implementation.
     /// @note A RigGeometry may be attached directly to a Skeleton, or somewhere below a Skeleton.
@@ -45,13 +47,59 @@ namespace SceneUtil
 
         osg::ref_ptr<osg::Geometry> getSourceGeometry();
 
+        /// Vertex attribute locations of the bone indices and weights for skinning in the vertex shader.
+        /// These are not used by the fixed function arrays.
+        enum SkinningAttribute
+        {
+            BoneIndicesAttribute = 6,
+            BoneWeightsAttribute = 7
+        };
+
+        /// The largest number of bones a mesh may have to be skinned in the vertex shader.
+        static const unsigned int sMaxGpuBones = 64;
+
+        /// Skin the vertices in the vertex shader instead of on the CPU, so the vertex arrays are shared with the
+        /// source geometry and never uploaded again. Adds the bone indices and weights to the source geometry as vertex attributes.
+        /// Each frame only the bone matrices are updated, in a uniform of this RigGeometry's own StateSet.
+        /// @note The StateSet needs a program created with the "skinning" define, see Shader::ShaderVisitor.
+        /// @note Must be called before the influence map is used, i.e. before the first update.
+        /// @return false if the mesh has more than sMaxGpuBones bones or a vertex with more than 4 bones,
+        /// then it is still skinned on the CPU.
+        bool setGpuSkinning();
+
+        bool getGpuSkinning() const;
+
+        /// Size of the bone matrix array the vertex shader has to declare. Rounded up to limit the number of shader variants.
+        unsigned int getNumGpuBones() const;
+
         // Called automatically by our CullCallback
         void update(osg::NodeVisitor* nv);
 
         // Called automatically by our UpdateCallback
         void updateBounds(osg::NodeVisitor* nv);
 
+        /// Waits for the skinning of this frame before drawing.
+        virtual void drawImplementation(osg::RenderInfo& renderInfo) const;
+
+        /// Set the queue to skin the vertices of all RigGeometries on, so that multiple characters are skinned in parallel
+        /// while the cull traversal goes on. The skinning is finished before the RigGeometry is drawn.
+        /// Default: NULL, skin the vertices during the cull traversal.
+        /// @note The caller must keep the queue alive until it is unset again.
+        static void setWorkQueue(WorkQueue* workQueue);
+
+        static WorkQueue* getWorkQueue();
+
+    protected:
+        virtual ~RigGeometry();
+
     private:
+        friend class SkinningWorkItem;
+
+        /// Transform the vertices by the matrices in mGroupMatrices.
+        void skin();
+
+        static WorkQueue* sWorkQueue;
+
         osg::ref_ptr<osg::Geometry> mSourceGeometry;
         osg::ref_ptr<osg::Vec4Array> mSourceTangents;
         Skeleton* mSkeleton;
@@ -64,11 +112,37 @@ namespace SceneUtil
 
         typedef std::pair<BoneBindMatrixPair, float> BoneWeight;
 
-        typedef std::vector<unsigned short> VertexList;
+        /// Vertices that are influenced by the same bones with the same weights, so they share one skinning matrix.
+        struct VertexGroup
+        {
+            /// Range in mBoneWeights
+            unsigned int mFirstWeight;
+            unsigned int mNumWeights;
+            /// Range in mVertices
+            unsigned int mFirstVertex;
+            unsigned int mNumVertices;
+        };
+
+        std::vector<VertexGroup> mVertexGroups;
+        std::vector<BoneWeight> mBoneWeights;
+        std::vector<unsigned short> mVertices;
+
+        /// The skinning matrix of each vertex group for the current frame.
+        std::vector<osg::Matrixf> mGroupMatrices;
+
+        /// The skinning of the current frame, if it is done on the WorkQueue.
+        osg::ref_ptr<SkinningWorkItem> mSkinning;
+
+        /// Give this RigGeometry its own StateSet with a new bone matrix uniform.
+        void createBoneMatrices();
 
-        typedef std::map<std::vector<BoneWeight>, VertexList> Bone2VertexMap;
+        /// Set the bone matrix uniform from the bones of the skeleton.
+        void updateBoneMatrices();
 
-        Bone2VertexMap mBone2VertexMap;
+        bool mGpuSkinning;
+        osg::ref_ptr<osg::Uniform> mBoneMatrices;
+        /// The bone of each element of mBoneMatrices and its inverse bind matrix. NULL for bones that are missing in the skeleton.
+        std::vector<BoneBindMatrixPair> mGpuBones;
 
         typedef std::map<Bone*, osg::BoundingSpheref> BoneSphereMap;
 
@@ -3,6 +3,8 @@
 #include <osgDB/ObjectWrapper>
 #include <osgDB/Registry>
 
+#include <components/nifosg/userdata.hpp>
+
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/skeleton.hpp>
 #include <components/sceneutil/riggeometry.hpp>
@@ -73,6 +75,41 @@ public:
     }
 };
 
+static bool checkNodeUserData(const NifOsg::NodeUserData& data)
+{
+    return true;
+}
+
+static bool readNodeUserData(osgDB::InputStream& is, NifOsg::NodeUserData& data)
+{
+    is >> data.mIndex >> data.mScale;
+    for (int i=0; i<3; ++i)
+        for (int j=0; j<3; ++j)
+            is >> data.mRotationScale.mValues[i][j];
+    return true;
+}
+
+static bool writeNodeUserData(osgDB::OutputStream& os, const NifOsg::NodeUserData& data)
+{
+    os << data.mIndex << data.mScale;
+    for (int i=0; i<3; ++i)
+        for (int j=0; j<3; ++j)
+            os << data.mRotationScale.mValues[i][j];
+    os << std::endl;
+    return true;
+}
+
+class NodeUserDataSerializer : public osgDB::ObjectWrapper
+{
+public:
+    NodeUserDataSerializer()
+        : osgDB::ObjectWrapper(createInstanceFunc<NifOsg::NodeUserData>, "NifOsg::NodeUserData", "osg::Object NifOsg::NodeUserData")
+    {
+        addSerializer( new osgDB::UserSerializer<NifOsg::NodeUserData>(
+            "Data", &checkNodeUserData, &readNodeUserData, &writeNodeUserData), osgDB::BaseSerializer::RW_USER );
+    }
+};
+
 osgDB::ObjectWrapper* makeDummySerializer(const std::string& classname)
 {
     return new osgDB::ObjectWrapper(createInstanceFunc<osg::DummyObject>, classname, "osg::Object");
@@ -87,7 +124,9 @@ public:
     }
 };
 
-void registerSerializers()
+static bool sGeometryReplaced = false;
+
+void registerSceneSerializers()
 {
     static bool done = false;
     if (!done)
@@ -99,10 +138,30 @@ void registerSerializers()
         mgr->addWrapper(new RigGeometrySerializer);
         mgr->addWrapper(new LightManagerSerializer);
         mgr->addWrapper(new CameraRelativeTransformSerializer);
+        mgr->addWrapper(new NodeUserDataSerializer);
+
+        done = true;
+    }
+}
+
+bool canSerializeGeometry()
+{
+    return !sGeometryReplaced;
+}
+
+void registerSerializers()
+{
+    static bool done = false;
+    if (!done)
+    {
+        registerSceneSerializers();
+
+        osgDB::ObjectWrapperManager* mgr = osgDB::Registry::instance()->getObjectWrapperManager();
 
         // Don't serialize Geometry data as we are more interested in the overall structure rather than tons of vertex data that would make the file large and hard to read.
         mgr->removeWrapper(mgr->findWrapper("osg::Geometry"));
         mgr->addWrapper(new GeometrySerializer);
+        sGeometryReplaced = true;
 
         // ignore the below for now to avoid warning spam
         const char* ignore[] = {
@@ -114,7 +173,6 @@ void registerSerializers()
             "SceneUtil::UpdateRigGeometry",
             "SceneUtil::LightSource",
             "SceneUtil::StateSetUpdater",
-            "NifOsg::NodeUserData",
             "NifOsg::FlipController",
             "NifOsg::KeyframeController",
             "NifOsg::TextKeyMapHolder",
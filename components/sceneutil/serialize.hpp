@@ -5,8 +5,15 @@ namespace SceneUtil
 {
 
     /// Register osg node serializers for certain SceneUtil classes if not already done so
+    /// @note Replaces the osg::Geometry serializer with one that skips the vertex data, so scenes can not be stored in full afterwards.
     void registerSerializers();
 
+    /// Register the serializers needed to store scenes in full and read them back, e.g. for the scene cache, if not already done so.
+    void registerSceneSerializers();
+
+    /// @return False if registerSerializers() replaced the osg::Geometry serializer.
+    bool canSerializeGeometry();
+
 }
 
 #endif
@@ -0,0 +1,108 @@
+#include "skinning.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OPENMW_SKINNING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace SceneUtil
+{
+
+#ifdef OPENMW_SKINNING_SSE
+
+    namespace
+    {
+        inline __m128 transformDirection(const __m128* rows, float x, float y, float z)
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), rows[0]), _mm_mul_ps(_mm_set1_ps(y), rows[1])),
+                              _mm_mul_ps(_mm_set1_ps(z), rows[2]));
+        }
+
+        inline void store(__m128 value, float* dst)
+        {
+            // Only write 3 floats, the array continues with the next vertex
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst), value);
+            _mm_store_ss(dst+2, _mm_movehl_ps(value, value));
+        }
+    }
+
+    void skinVertices(const osg::Matrixf& matrix, const unsigned short* vertices, unsigned int numVertices,
+                      const osg::Vec3f* positionSrc, osg::Vec3f* positionDst,
+                      const osg::Vec3f* normalSrc, osg::Vec3f* normalDst,
+                      const osg::Vec4f* tangentSrc, osg::Vec4f* tangentDst)
+    {
+        const float* m = matrix.ptr();
+        __m128 rows[4];
+        for (int i=0; i<4; ++i)
+            rows[i] = _mm_loadu_ps(m + i*4);
+
+        for (unsigned int i=0; i<numVertices; ++i)
+        {
+            const unsigned short vertex = vertices[i];
+
+            const osg::Vec3f& position = positionSrc[vertex];
+            store(_mm_add_ps(transformDirection(rows, position.x(), position.y(), position.z()), rows[3]), positionDst[vertex].ptr());
+
+            if (normalDst)
+            {
+                const osg::Vec3f& normal = normalSrc[vertex];
+                store(transformDirection(rows, normal.x(), normal.y(), normal.z()), normalDst[vertex].ptr());
+            }
+
+            if (tangentDst)
+            {
+                const osg::Vec4f& tangent = tangentSrc[vertex];
+                store(transformDirection(rows, tangent.x(), tangent.y(), tangent.z()), tangentDst[vertex].ptr());
+                tangentDst[vertex].w() = tangent.w();
+            }
+        }
+    }
+
+#else
+
+    namespace
+    {
+        inline void transformDirection(const float* m, float x, float y, float z, float* dst)
+        {
+            dst[0] = x*m[0] + y*m[4] + z*m[8];
+            dst[1] = x*m[1] + y*m[5] + z*m[9];
+            dst[2] = x*m[2] + y*m[6] + z*m[10];
+        }
+    }
+
+    void skinVertices(const osg::Matrixf& matrix, const unsigned short* vertices, unsigned int numVertices,
+                      const osg::Vec3f* positionSrc, osg::Vec3f* positionDst,
+                      const osg::Vec3f* normalSrc, osg::Vec3f* normalDst,
+                      const osg::Vec4f* tangentSrc, osg::Vec4f* tangentDst)
+    {
+        const float* m = matrix.ptr();
+
+        for (unsigned int i=0; i<numVertices; ++i)
+        {
+            const unsigned short vertex = vertices[i];
+
+            const osg::Vec3f& position = positionSrc[vertex];
+            float* dst = positionDst[vertex].ptr();
+            transformDirection(m, position.x(), position.y(), position.z(), dst);
+            dst[0] += m[12];
+            dst[1] += m[13];
+            dst[2] += m[14];
+
+            if (normalDst)
+            {
+                const osg::Vec3f& normal = normalSrc[vertex];
+                transformDirection(m, normal.x(), normal.y(), normal.z(), normalDst[vertex].ptr());
+            }
+
+            if (tangentDst)
+            {
+                const osg::Vec4f& tangent = tangentSrc[vertex];
+                transformDirection(m, tangent.x(), tangent.y(), tangent.z(), tangentDst[vertex].ptr());
+                tangentDst[vertex].w() = tangent.w();
+            }
+        }
+    }
+
+#endif
+
+}
@@ -0,0 +1,23 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_SKINNING_H
+#define OPENMW_COMPONENTS_SCENEUTIL_SKINNING_H
+
+#include <osg/Matrixf>
+#include <osg/Vec3f>
+#include <osg/Vec4f>
+
+namespace SceneUtil
+{
+
+    /// @brief Transform the given vertices of a skinned mesh by their skinning matrix, in one pass over positions, normals and tangents.
+    /// Positions are transformed as points, normals and tangents as directions. The w component of the tangents is kept.
+    /// @param vertices Indices of the vertices to transform, all of them are influenced by the same bones with the same weights.
+    /// @param normalSrc, normalDst, tangentSrc, tangentDst May be NULL to skip the normals or tangents.
+    /// @note The matrix must be affine, i.e. its last column must be (0, 0, 0, 1). Uses SSE where available.
+    void skinVertices(const osg::Matrixf& matrix, const unsigned short* vertices, unsigned int numVertices,
+                      const osg::Vec3f* positionSrc, osg::Vec3f* positionDst,
+                      const osg::Vec3f* normalSrc, osg::Vec3f* normalDst,
+                      const osg::Vec4f* tangentSrc, osg::Vec4f* tangentDst);
+
+}
+
+#endif
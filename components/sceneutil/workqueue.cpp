@@ -1,5 +1,6 @@
 #include "workqueue.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 namespace SceneUtil
@@ -27,6 +28,9 @@ void WorkItem::signalDone()
 }
 
 WorkItem::WorkItem()
+    : mPriority(0.f)
+    , mKey(NULL)
+    , mQueuedTick(0)
 {
 }
 
@@ -39,6 +43,35 @@ bool WorkItem::isDone() const
     return (mDone > 0);
 }
 
+void WorkItem::setPriority(float priority)
+{
+    mPriority = priority;
+}
+
+float WorkItem::getPriority() const
+{
+    return mPriority;
+}
+
+void WorkItem::setKey(const void *key)
+{
+    mKey = key;
+}
+
+const void* WorkItem::getKey() const
+{
+    return mKey;
+}
+
+WorkQueue::Stats::Stats()
+    : mCompleted(0)
+    , mCancelled(0)
+    , mMaxLatency(0.0)
+    , mTotalLatency(0.0)
+    , mStarted(0)
+{
+}
+
 WorkQueue::WorkQueue(int workerThreads)
     : mIsReleased(false)
 {
@@ -75,11 +108,27 @@ void WorkQueue::addWorkItem(osg::ref_ptr<WorkItem> item, bool front)
         return;
     }
 
+    item->mQueuedTick = osg::Timer::instance()->tick();
+
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+
+    // The queue is sorted by descending priority, so search for the first item that should come after the new one.
+    // Queues are short, and most items are added with the default priority, for which the search from the back is instant.
+    const float priority = item->getPriority();
+    std::deque<osg::ref_ptr<WorkItem> >::iterator it;
     if (front)
-        mQueue.push_front(item);
+    {
+        it = mQueue.begin();
+        while (it != mQueue.end() && (*it)->getPriority() > priority)
+            ++it;
+    }
     else
-        mQueue.push_back(item);
+    {
+        it = mQueue.end();
+        while (it != mQueue.begin() && (*(it-1))->getPriority() < priority)
+            --it;
+    }
+    mQueue.insert(it, item);
     mCondition.signal();
 }
 
@@ -94,12 +143,58 @@ osg::ref_ptr<WorkItem> WorkQueue::removeWorkItem()
     {
         osg::ref_ptr<WorkItem> item = mQueue.front();
         mQueue.pop_front();
+
+        double latency = osg::Timer::instance()->delta_s(item->mQueuedTick, osg::Timer::instance()->tick());
+        mStats.mMaxLatency = std::max(mStats.mMaxLatency, latency);
+        mStats.mTotalLatency += latency;
+        ++mStats.mStarted;
         return item;
     }
     else
         return NULL;
 }
 
+unsigned int WorkQueue::cancel(const void *key)
+{
+    std::vector<osg::ref_ptr<WorkItem> > cancelled;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        for (std::deque<osg::ref_ptr<WorkItem> >::iterator it = mQueue.begin(); it != mQueue.end();)
+        {
+            if ((*it)->getKey() == key)
+            {
+                cancelled.push_back(*it);
+                it = mQueue.erase(it);
+            }
+            else
+                ++it;
+        }
+        mStats.mCancelled += cancelled.size();
+    }
+
+    // Wake up anyone waiting on the items outside of the lock, they may add new items in response
+    for (std::vector<osg::ref_ptr<WorkItem> >::iterator it = cancelled.begin(); it != cancelled.end(); ++it)
+    {
+        (*it)->abort();
+        (*it)->signalDone();
+    }
+    return cancelled.size();
+}
+
+void WorkQueue::itemCompleted()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    ++mStats.mCompleted;
+}
+
+WorkQueue::Stats WorkQueue::resetStats()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+    Stats stats = mStats;
+    mStats = Stats();
+    return stats;
+}
+
 unsigned int WorkQueue::getNumItems() const
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
@@ -132,6 +227,7 @@ void WorkThread::run()
         mActive = true;
         item->doWork();
         item->signalDone();
+        mWorkQueue->itemCompleted();
         mActive = false;
     }
 }
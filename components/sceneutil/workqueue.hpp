@@ -8,6 +8,7 @@
 
 #include <osg/Referenced>
 #include <osg/ref_ptr>
+#include <osg/Timer>
 
 #include <queue>
 
@@ -34,26 +35,48 @@ namespace SceneUtil
         /// Set abort flag in order to return from doWork() as soon as possible. May not be respected by all WorkItems.
         virtual void abort() {}
 
+        /// Items with a higher priority are taken from the queue first. The default priority is 0.
+        /// @par The engine's queue orders its items as follows: items the main thread may soon wait for, and short
+        /// housekeeping items such as unreferencing, keep the default priority. Cell preloads follow with the negative
+        /// distance to the cell, and background work that is not needed any time soon, e.g. script compilation, uses -FLT_MAX.
+        /// @note Must be set before the item is added to a WorkQueue.
+        void setPriority(float priority);
+        float getPriority() const;
+
+        /// Set the key that identifies this item for WorkQueue::cancel. The default key is NULL.
+        /// @note Must be set before the item is added to a WorkQueue.
+        void setKey(const void* key);
+        const void* getKey() const;
+
     protected:
         OpenThreads::Atomic mDone;
         OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
+
+    private:
+        friend class WorkQueue;
+
+        float mPriority;
+        const void* mKey;
+
+        /// When the item was added to a queue, used for the latency statistics.
+        osg::Timer_t mQueuedTick;
     };
 
     class WorkThread;
 
     /// @brief A work queue that users can push work items onto, to be completed by one or more background threads.
-    /// @note Work items will be processed in the order that they were given in, however
-    /// if multiple work threads are involved then it is possible for a later item to complete before earlier items.
+    /// @note Work items will be processed in the order of their priority, and items of the same priority in the order that they were given in.
+    /// If multiple work threads are involved then it is possible for a later item to complete before earlier items.
     class WorkQueue : public osg::Referenced
     {
     public:
         WorkQueue(int numWorkerThreads=1);
         ~WorkQueue();
 
-        /// Add a new work item to the back of the queue.
+        /// Add a new work item behind the queued items of the same or a higher priority.
         /// @par The work item's waitTillDone() method may be used by the caller to wait until the work is complete.
-        /// @param front If true, add item to the front of the queue. If false (default), add to the back.
+        /// @param front If true, add item in front of the queued items of the same priority. If false (default), add behind them.
         void addWorkItem(osg::ref_ptr<WorkItem> item, bool front=false);
 
         /// Get the next work item from the front of the queue. If the queue is empty, waits until a new item is added.
@@ -61,14 +84,43 @@ namespace SceneUtil
         /// @par Used internally by the WorkThread.
         osg::ref_ptr<WorkItem> removeWorkItem();
 
+        /// Remove all queued items with the given key from the queue, without running them.
+        /// The removed items are aborted and marked as done. Items already being worked on are not affected.
+        /// @return The number of removed items.
+        unsigned int cancel(const void* key);
+
         unsigned int getNumItems() const;
 
         unsigned int getNumActiveThreads() const;
 
+        struct Stats
+        {
+            Stats();
+
+            /// Number of items that were completed.
+            unsigned int mCompleted;
+            /// Number of items that were cancelled before being worked on.
+            unsigned int mCancelled;
+            /// Longest and summed up time in seconds that the started items were waiting in the queue.
+            double mMaxLatency;
+            double mTotalLatency;
+            /// Number of items that were started, the divisor for an average latency.
+            unsigned int mStarted;
+        };
+
+        /// Get the statistics collected since the previous call, and start collecting anew.
+        Stats resetStats();
+
     private:
+        /// Used by the WorkThread once an item is done.
+        void itemCompleted();
+        friend class WorkThread;
+
         bool mIsReleased;
         std::deque<osg::ref_ptr<WorkItem> > mQueue;
 
+        Stats mStats;
+
         mutable OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
 
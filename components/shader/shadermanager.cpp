@@ -11,6 +11,8 @@
 #include <boost/filesystem/fstream.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <components/sceneutil/riggeometry.hpp>
+
 namespace Shader
 {
 
@@ -153,6 +155,9 @@ namespace Shader
             osg::ref_ptr<osg::Program> program (new osg::Program);
             program->addShader(vertexShader);
             program->addShader(fragmentShader);
+            // Fixed locations, the skinning attributes are set on the geometry by RigGeometry
+            program->addBindAttribLocation("boneIndices", SceneUtil::RigGeometry::BoneIndicesAttribute);
+            program->addBindAttribLocation("boneWeights", SceneUtil::RigGeometry::BoneWeightsAttribute);
             found = mPrograms.insert(std::make_pair(std::make_pair(vertexShader, fragmentShader), program)).first;
         }
         return found->second;
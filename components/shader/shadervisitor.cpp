@@ -1,5 +1,6 @@
 #include "shadervisitor.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include <osg/Texture>
@@ -13,6 +14,7 @@
 #include <components/resource/imagemanager.hpp>
 #include <components/vfs/manager.hpp>
 #include <components/sceneutil/riggeometry.hpp>
+#include <components/sceneutil/instancing.hpp>
 
 #include "shadermanager.hpp"
 
@@ -42,6 +44,8 @@ namespace Shader
         , mAllowedToModifyStateSets(true)
         , mAutoUseNormalMaps(false)
         , mAutoUseSpecularMaps(false)
+        , mGpuSkinning(false)
+        , mInstancing(false)
         , mShaderManager(shaderManager)
         , mImageManager(imageManager)
         , mDefaultVsTemplate(defaultVsTemplate)
@@ -244,7 +248,7 @@ namespace Shader
         mRequirements.pop_back();
     }
 
-    void ShaderVisitor::createProgram(const ShaderRequirements &reqs, osg::Node& node)
+    void ShaderVisitor::createProgram(const ShaderRequirements &reqs, osg::Node& node, unsigned int skinningBones)
     {
         osg::StateSet* writableStateSet = NULL;
         if (mAllowedToModifyStateSets)
@@ -288,6 +292,12 @@ namespace Shader
 
         defineMap["parallax"] = reqs.mNormalHeight ? "1" : "0";
 
+        defineMap["skinning"] = skinningBones ? "1" : "0";
+        defineMap["skinningBones"] = std::to_string(std::max(skinningBones, 1u));
+
+        defineMap["instancing"] = mInstancing ? "1" : "0";
+        defineMap["instancingCount"] = std::to_string(SceneUtil::InstanceBatch::sMaxInstances);
+
         osg::ref_ptr<osg::Shader> vertexShader (mShaderManager.getShader(mDefaultVsTemplate, defineMap, osg::Shader::VERTEX));
         osg::ref_ptr<osg::Shader> fragmentShader (mShaderManager.getShader(mDefaultFsTemplate, defineMap, osg::Shader::FRAGMENT));
 
@@ -315,13 +325,16 @@ namespace Shader
         {
             const ShaderRequirements& reqs = mRequirements.back();
 
-            bool useShader = reqs.mShaderRequired || mForceShaders;
+            SceneUtil::RigGeometry* rig = dynamic_cast<SceneUtil::RigGeometry*>(&geometry);
+            // The skinning shader is needed regardless of the other requirements
+            bool gpuSkinning = rig && (rig->getGpuSkinning() || (mGpuSkinning && mAllowedToModifyStateSets && rig->setGpuSkinning()));
+
+            bool useShader = reqs.mShaderRequired || mForceShaders || gpuSkinning || mInstancing;
             bool generateTangents = reqs.mTexStageRequiringTangents != -1;
 
             if (mAllowedToModifyStateSets && (useShader || generateTangents))
             {
                 osg::ref_ptr<osg::Geometry> sourceGeometry = &geometry;
-                SceneUtil::RigGeometry* rig = dynamic_cast<SceneUtil::RigGeometry*>(&geometry);
                 if (rig)
                     sourceGeometry = rig->getSourceGeometry();
 
@@ -352,7 +365,7 @@ namespace Shader
 
             // TODO: find a better place for the stateset
             if (useShader)
-                createProgram(reqs, geometry);
+                createProgram(reqs, geometry, gpuSkinning ? rig->getNumGpuBones() : 0);
         }
 
         if (needPop)
@@ -412,4 +425,14 @@ namespace Shader
         mSpecularMapPattern = pattern;
     }
 
+    void ShaderVisitor::setGpuSkinning(bool gpuSkinning)
+    {
+        mGpuSkinning = gpuSkinning;
+    }
+
+    void ShaderVisitor::setInstancing(bool instancing)
+    {
+        mInstancing = instancing;
+    }
+
 }
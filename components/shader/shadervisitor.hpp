@@ -45,6 +45,13 @@ namespace Shader
 
         void setSpecularMapPattern(const std::string& pattern);
 
+        /// Skin RigGeometries in the vertex shader where possible, see SceneUtil::RigGeometry::setGpuSkinning.
+        /// @note Requires that we are allowed to modify StateSets, otherwise only RigGeometries already skinned on the GPU get a skinning shader.
+        void setGpuSkinning(bool gpuSkinning);
+
+        /// Use the instancing shader for all Geometry, e.g. the Geometry of a SceneUtil::InstanceBatch.
+        void setInstancing(bool instancing);
+
         virtual void apply(osg::Node& node);
 
         virtual void apply(osg::Drawable& drawable);
@@ -68,6 +75,10 @@ namespace Shader
         bool mAutoUseSpecularMaps;
         std::string mSpecularMapPattern;
 
+        bool mGpuSkinning;
+
+        bool mInstancing;
+
         ShaderManager& mShaderManager;
         Resource::ImageManager& mImageManager;
 
@@ -95,7 +106,8 @@ namespace Shader
         std::string mDefaultVsTemplate;
         std::string mDefaultFsTemplate;
 
-        void createProgram(const ShaderRequirements& reqs, osg::Node& node);
+        /// @param skinningBones Size of the bone matrix array of a RigGeometry skinned in the vertex shader, 0 for no skinning.
+        void createProgram(const ShaderRequirements& reqs, osg::Node& node, unsigned int skinningBones = 0);
     };
 
 }
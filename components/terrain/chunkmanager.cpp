@@ -52,7 +52,7 @@ osg::ref_ptr<osg::Node> ChunkManager::getChunk(float size, const osg::Vec2f &cen
 
 void ChunkManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
 {
-    stats->setAttribute(frameNumber, "Terrain Chunk", mCache->getCacheSize());
+    reportCacheStats(frameNumber, stats, "Terrain Chunk");
 }
 
 void ChunkManager::setCullingActive(bool active)
@@ -27,6 +27,8 @@ namespace ToUTF8
         public:
             Utf8Encoder(FromType sourceEncoding);
 
+            FromType getEncoding() const { return mEncoding; }
+
             // Convert to UTF8 from the previously given code page.
             std::string getUtf8(const char *input, size_t size);
             inline std::string getUtf8(const std::string &str)
@@ -49,6 +51,7 @@ namespace ToUTF8
 
             std::vector<char> mOutput;
             signed char* translationArray;
+            FromType mEncoding;
     };
 }
 
@@ -1,17 +1,24 @@
 #include "bsaarchive.hpp"
 
+#include <components/bsa/compressedbsafile.hpp>
+
 namespace VFS
 {
 
 
 BsaArchive::BsaArchive(const std::string &filename)
 {
-    mFile.open(filename);
+    if (Bsa::BSAFile::detectVersion(filename) == Bsa::BSAVER_COMPRESSED)
+        mFile.reset(new Bsa::CompressedBSAFile);
+    else
+        mFile.reset(new Bsa::BSAFile);
+
+    mFile->open(filename);
 
-    const Bsa::BSAFile::FileList &filelist = mFile.getList();
+    const Bsa::BSAFile::FileList &filelist = mFile->getList();
     for(Bsa::BSAFile::FileList::const_iterator it = filelist.begin();it != filelist.end();++it)
     {
-        mResources.push_back(BsaArchiveFile(&*it, &mFile));
+        mResources.push_back(BsaArchiveFile(&*it, mFile.get()));
     }
 }
 
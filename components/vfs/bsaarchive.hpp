@@ -3,6 +3,8 @@
 
 #include "archive.hpp"
 
+#include <memory>
+
 #include <components/bsa/bsa_file.hpp>
 
 namespace VFS
@@ -27,7 +29,7 @@ namespace VFS
         virtual void listResources(std::map<std::string, File*>& out, char (*normalize_function) (char));
 
     private:
-        Bsa::BSAFile mFile;
+        std::unique_ptr<Bsa::BSAFile> mFile;
 
         std::vector<BsaArchiveFile> mResources;
     };
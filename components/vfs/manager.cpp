@@ -26,6 +26,26 @@ namespace
         std::transform(path.begin(), path.end(), path.begin(), normalize_char);
     }
 
+    // FNV-1a
+    const size_t sHashBasis = static_cast<size_t>(2166136261u);
+    const size_t sHashPrime = 16777619u;
+
+    inline size_t hash_char(size_t hash, char ch)
+    {
+        return (hash ^ static_cast<unsigned char>(ch)) * sHashPrime;
+    }
+
+    size_t hash_name(const char* name, size_t size)
+    {
+        size_t hash = sHashBasis;
+        for (size_t i=0; i<size; ++i)
+            hash = hash_char(hash, name[i]);
+        return hash;
+    }
+
+    // Names up to this length are normalized on the stack
+    const size_t sMaxStackName = 512;
+
 }
 
 namespace VFS
@@ -55,30 +75,92 @@ namespace VFS
 
         for (std::vector<Archive*>::const_iterator it = mArchives.begin(); it != mArchives.end(); ++it)
             (*it)->listResources(mIndex, mStrict ? &strict_normalize_char : &nonstrict_normalize_char);
+
+        size_t size = 16;
+        while (size < mIndex.size() * 2)
+            size *= 2;
+
+        HashEntry empty;
+        empty.mHash = 0;
+        empty.mName = NULL;
+        empty.mFile = NULL;
+        mHashIndex.assign(size, empty);
+
+        const size_t mask = size - 1;
+        for (std::map<std::string, File*>::const_iterator it = mIndex.begin(); it != mIndex.end(); ++it)
+        {
+            const size_t hash = hash_name(it->first.data(), it->first.size());
+            size_t slot = hash & mask;
+            while (mHashIndex[slot].mFile)
+                slot = (slot + 1) & mask;
+
+            mHashIndex[slot].mHash = hash;
+            mHashIndex[slot].mName = &it->first;
+            mHashIndex[slot].mFile = it->second;
+        }
     }
 
-    Files::IStreamPtr Manager::get(const std::string &name) const
+    File* Manager::findNormalized(const char *name, size_t size, size_t hash) const
+    {
+        if (mHashIndex.empty())
+            return NULL;
+
+        const size_t mask = mHashIndex.size() - 1;
+        for (size_t slot = hash & mask; mHashIndex[slot].mFile; slot = (slot + 1) & mask)
+        {
+            const HashEntry& entry = mHashIndex[slot];
+            if (entry.mHash == hash && entry.mName->size() == size && entry.mName->compare(0, size, name, size) == 0)
+                return entry.mFile;
+        }
+        return NULL;
+    }
+
+    File* Manager::find(const std::string &name) const
     {
-        std::string normalized = name;
-        normalize_path(normalized, mStrict);
+        if (name.size() > sMaxStackName)
+        {
+            std::string normalized = name;
+            normalize_path(normalized, mStrict);
+            return findNormalized(normalized.data(), normalized.size(), hash_name(normalized.data(), normalized.size()));
+        }
+
+        char (*normalize_char)(char) = mStrict ? &strict_normalize_char : &nonstrict_normalize_char;
+
+        char normalized[sMaxStackName];
+        size_t hash = sHashBasis;
+        for (size_t i=0; i<name.size(); ++i)
+        {
+            normalized[i] = normalize_char(name[i]);
+            hash = hash_char(hash, normalized[i]);
+        }
+
+        return findNormalized(normalized, name.size(), hash);
+    }
 
-        return getNormalized(normalized);
+    Files::IStreamPtr Manager::get(const std::string &name) const
+    {
+        File* file = find(name);
+        if (!file)
+        {
+            std::string normalized = name;
+            normalize_path(normalized, mStrict);
+            throw std::runtime_error("Resource '" + normalized + "' not found");
+        }
+        return file->open();
     }
 
     Files::IStreamPtr Manager::getNormalized(const std::string &normalizedName) const
     {
-        std::map<std::string, File*>::const_iterator found = mIndex.find(normalizedName);
-        if (found == mIndex.end())
+        File* file = findNormalized(normalizedName.data(), normalizedName.size(),
+                                    hash_name(normalizedName.data(), normalizedName.size()));
+        if (!file)
             throw std::runtime_error("Resource '" + normalizedName + "' not found");
-        return found->second->open();
+        return file->open();
     }
 
     bool Manager::exists(const std::string &name) const
     {
-        std::string normalized = name;
-        normalize_path(normalized, mStrict);
-
-        return mIndex.find(normalized) != mIndex.end();
+        return find(name) != NULL;
     }
 
     const std::map<std::string, File*>& Manager::getIndex() const
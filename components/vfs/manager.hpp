@@ -56,11 +56,29 @@ namespace VFS
         Files::IStreamPtr getNormalized(const std::string& normalizedName) const;
 
     private:
+        /// Entry of the hash index, pointing into mIndex.
+        struct HashEntry
+        {
+            size_t mHash;
+            const std::string* mName;
+            File* mFile;
+        };
+
+        /// Look up a file by name, normalizing it on the fly without allocating. Returns NULL if not found.
+        File* find(const std::string& name) const;
+
+        /// Look up a file by its normalized name and the hash of that name. Returns NULL if not found.
+        File* findNormalized(const char* name, size_t size, size_t hash) const;
+
         bool mStrict;
 
         std::vector<Archive*> mArchives;
 
         std::map<std::string, File*> mIndex;
+
+        /// Open addressing hash table over mIndex used for lookups. The size is a power of two, and is kept
+        /// at least twice the number of files so probe sequences stay short. Empty entries have a NULL mFile.
+        std::vector<HashEntry> mHashIndex;
     };
 
 }
@@ -1,5 +1,9 @@
 #version 120
 
+#if @instancing
+#extension GL_ARB_draw_instanced : require
+#endif
+
 #if @diffuseMap
 varying vec2 diffuseMapUV;
 #endif
@@ -33,6 +37,18 @@ varying vec2 envMapUV;
 varying vec2 specularMapUV;
 #endif
 
+#if @skinning
+// Bone matrices of the RigGeometry, and up to 4 bones per vertex that are blended by weight
+uniform mat4 boneMatrices[@skinningBones];
+attribute vec4 boneIndices;
+attribute vec4 boneWeights;
+#endif
+
+#if @instancing
+// Transforms of the copies drawn by an instanced draw call
+uniform mat4 instanceMatrices[@instancingCount];
+#endif
+
 varying float depth;
 
 #define PER_PIXEL_LIGHTING (@normalMap || @forcePPL)
@@ -49,12 +65,30 @@ varying vec3 passNormal;
 
 void main(void)
 {
-    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+#if @skinning
+    mat4 skinMatrix = boneMatrices[int(boneIndices.x)] * boneWeights.x
+                    + boneMatrices[int(boneIndices.y)] * boneWeights.y
+                    + boneMatrices[int(boneIndices.z)] * boneWeights.z
+                    + boneMatrices[int(boneIndices.w)] * boneWeights.w;
+    vec4 vertex = vec4((skinMatrix * gl_Vertex).xyz, 1.0);
+    vec3 normal = (skinMatrix * vec4(gl_Normal, 0.0)).xyz;
+#else
+    vec4 vertex = gl_Vertex;
+    vec3 normal = gl_Normal;
+#endif
+
+#if @instancing
+    mat4 instanceMatrix = instanceMatrices[gl_InstanceIDARB];
+    vertex = instanceMatrix * vertex;
+    normal = mat3(instanceMatrix) * normal;
+#endif
+
+    gl_Position = gl_ModelViewProjectionMatrix * vertex;
     depth = gl_Position.z;
 
-    vec4 viewPos = (gl_ModelViewMatrix * gl_Vertex);
+    vec4 viewPos = (gl_ModelViewMatrix * vertex);
     gl_ClipVertex = viewPos;
-    vec3 viewNormal = normalize((gl_NormalMatrix * gl_Normal).xyz);
+    vec3 viewNormal = normalize((gl_NormalMatrix * normal).xyz);
 
 #if @envMap
     vec3 viewVec = normalize(viewPos.xyz);
@@ -85,8 +119,15 @@ void main(void)
 
 #if @normalMap
     normalMapUV = (gl_TextureMatrix[@normalMapUV] * gl_MultiTexCoord@normalMapUV).xy;
+#if @skinning
+    passTangent = vec4((skinMatrix * vec4(gl_MultiTexCoord7.xyz, 0.0)).xyz, gl_MultiTexCoord7.w);
+#else
     passTangent = gl_MultiTexCoord7.xyzw;
 #endif
+#if @instancing
+    passTangent.xyz = mat3(instanceMatrix) * passTangent.xyz;
+#endif
+#endif
 
 #if @specularMap
     specularMapUV = (gl_TextureMatrix[@specularMapUV] * gl_MultiTexCoord@specularMapUV).xy;
@@ -98,5 +139,5 @@ void main(void)
     passColor = gl_Color;
 #endif
     passViewPos = viewPos.xyz;
-    passNormal = gl_Normal.xyz;
+    passNormal = normal;
 }